@@ -56,6 +56,7 @@ Dynamic_Array<T> array_to_dynamic_array(Array<T>* value) {
     result.data = value->data;
     result.size = value->size;
     result.capacity = value->size;
+    result.allocator = 0;
     return result;
 }
 
@@ -78,6 +79,12 @@ Array<byte> array_as_bytes(Array<T>* value) {
     return array_create_static<byte>((byte*)value->data, value->size * sizeof(T));
 }
 
+// Defined here and not in dynamic_array.hpp, since Array must be complete for the return type
+template<typename T>
+Array<byte> dynamic_array_as_bytes(Dynamic_Array<T>* value) {
+    return array_create_static<byte>((byte*)value->data, value->size * sizeof(T));
+}
+
 template<typename T>
 void array_destroy(Array<T>* array) {
     if (array->size > 0) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../utility/utils.hpp"
+#include "../utility/allocators.hpp"
 #include "array.hpp"
 #include "../math/scalars.hpp"
 
@@ -10,6 +11,7 @@ struct Dynamic_Array
     int capacity;
     int size;
     T* data;
+    Allocator* allocator; // 0 for default heap
 
     T& operator[](int index){
         if (index > size || index < 0) {
@@ -20,17 +22,18 @@ struct Dynamic_Array
 };
 
 template <typename T>
-Dynamic_Array<T> dynamic_array_create_empty(int capacity) {
+Dynamic_Array<T> dynamic_array_create_empty(int capacity, Allocator* allocator = 0) {
     Dynamic_Array<T> result;
     result.capacity = capacity;
     result.size = 0;
-    result.data = new T[capacity];
+    result.allocator = allocator;
+    result.data = allocator_allocate_array<T>(allocator, capacity);
     return result;
 }
 
 template<typename T>
-Dynamic_Array<T> dynamic_array_create_copy(T* data, int size) {
-    Dynamic_Array<T> result = dynamic_array_create_empty<T>(size);
+Dynamic_Array<T> dynamic_array_create_copy(T* data, int size, Allocator* allocator = 0) {
+    Dynamic_Array<T> result = dynamic_array_create_empty<T>(size, allocator);
     memory_copy(result.data, data, size * sizeof(T));
     result.size = size;
     return result;
@@ -38,15 +41,15 @@ Dynamic_Array<T> dynamic_array_create_copy(T* data, int size) {
 
 template <typename T>
 void dynamic_array_destroy(Dynamic_Array<T>* array) {
-    delete[] array->data;
+    allocator_free_array(array->allocator, array->data);
 }
 
 template <typename T>
 void dynamic_array_reserve(Dynamic_Array<T>* array, int capacity) {
     if (array->capacity < capacity) {
-        T* new_data = new T[capacity];
+        T* new_data = allocator_allocate_array<T>(array->allocator, capacity);
         memory_copy(new_data, array->data, sizeof(T) * array->size);
-        delete[] array->data;
+        allocator_free_array(array->allocator, array->data);
         array->capacity = capacity;
         array->data = new_data;
     }
@@ -133,15 +136,6 @@ Array<T> dynamic_array_as_array(Dynamic_Array<T>* array) {
     return new_array;
 }
 
-// Prototype
-template<typename T>
-Array<T> array_create_static(T* data, int size);
-
-template<typename T>
-Array<byte> dynamic_array_as_bytes(Dynamic_Array<T>* value) {
-    return array_create_static<byte>((byte*)value->data, value->size * sizeof(T));
-}
-
 template <typename T>
 void dynamic_array_reset(Dynamic_Array<T>* array) {
     array->size = 0;
@@ -2,6 +2,7 @@
 
 #include "../utility/datatypes.hpp"
 #include "array.hpp"
+#include "../utility/allocators.hpp"
 
 const float HASHSET_RESIZE_PERCENTAGE = 0.8f;
 
@@ -22,6 +23,7 @@ struct Hashset
     int element_count;
     u64(*hash_function)(T*);
     bool(*equals_function)(T*, T*);
+    Allocator* allocator; // 0 for default heap
 };
 
 template <typename T>
@@ -83,11 +85,13 @@ void hashset_iterator_next(Hashset_Iterator<T>* iterator)
 }
 
 template <typename T>
-Hashset<T> hashset_create_empty(int capacity, u64(*hash_function)(T*), bool(*equals_function)(T*, T*)) 
+Hashset<T> hashset_create_empty(int capacity, u64(*hash_function)(T*), bool(*equals_function)(T*, T*), Allocator* allocator = 0) 
 {
     Hashset<T> result;
     result.element_count = 0;
-    result.entries = array_create_empty<Hashset_Entry<T>>(primes_find_next_suitable_for_set_size(capacity));
+    result.allocator = allocator;
+    int entry_count = primes_find_next_suitable_for_set_size(capacity);
+    result.entries = array_create_static(allocator_allocate_array<Hashset_Entry<T>>(allocator, entry_count), entry_count);
     for (int i = 0; i < result.entries.size; i++) {
         result.entries[i].valid = false;
         result.entries[i].next = 0;
@@ -108,7 +112,7 @@ void hashset_reset(Hashset<T>* set)
             entry->next = 0;
             while (next != 0) {
                 Hashset_Entry<T>* next_next = next->next;
-                delete next;
+                allocator_free(set->allocator, next);
                 next = next_next;
             }
         }
@@ -125,12 +129,12 @@ void hashset_destroy(Hashset<T>* set)
             entry = entry->next;
             while (entry != 0) {
                 Hashset_Entry<T>* next = entry->next;
-                delete entry;
+                allocator_free(set->allocator, entry);
                 entry = next;
             }
         }
     }
-    array_destroy(&set->entries);
+    allocator_free_array(set->allocator, set->entries.data);
 }
 
 template <typename T>
@@ -156,10 +160,10 @@ void hashset_reserve(Hashset<T>* set, int capacity)
         return;
     }
     int new_capacity = primes_find_next_suitable_for_set_size(capacity);
-    Hashset<T> new_set = hashset_create_empty<T>(new_capacity, set->hash_function, set->equals_function);
+    Hashset<T> new_set = hashset_create_empty<T>(new_capacity, set->hash_function, set->equals_function, set->allocator);
     Hashset_Iterator<T> iterator = hashset_iterator_create(set);
     while (hashset_iterator_has_next(&iterator)) {
-        hashset_insert_element<T>(&new_set, *iterator.value);
+        hashset_insert_element(&new_set, *iterator.value);
         hashset_iterator_next(&iterator);
     }
     // Destroy old set data
@@ -191,7 +195,7 @@ bool hashset_insert_element(Hashset<T>* set, T value)
             return false;
         }
         if (entry->next == 0) { // Insert element as next
-            Hashset_Entry<T>* next = new Hashset_Entry<T>();
+            Hashset_Entry<T>* next = allocator_allocate<Hashset_Entry<T>>(set->allocator);
             entry->next = next;
             next->valid = true;
             next->value = value;
@@ -221,7 +225,7 @@ bool hashset_remove_element(Hashset<T>* set, T value)
         if (entry->next != 0) {
             set->entries[entry_index] = entry->next;
             set->entries[entry_index].valid = true;
-            delete entry->next;
+            allocator_free(set->allocator, entry->next);
         }
         return true;
     }
@@ -231,7 +235,7 @@ bool hashset_remove_element(Hashset<T>* set, T value)
     {
         if (set->equals_function(&next->value, &value)) {
             *entry = *next;
-            delete next;
+            allocator_free(set->allocator, next);
             entry->valid = true;
             return true;
         }
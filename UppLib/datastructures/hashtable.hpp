@@ -4,29 +4,54 @@
 #include "array.hpp"
 #include "hashset.hpp"
 #include "../utility/hash_functions.hpp"
+#include "../utility/allocators.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define HASHTABLE_USE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+    Open addressing hashtable (Swiss-table style).
+    Each slot has a control byte, which is either HASHTABLE_CONTROL_EMPTY or the lower 7 bits of the key-hash.
+    Lookups compare 16 control bytes at once, so the keys are only compared on a 7 bit hash match.
+    Collisions are resolved with linear probing, which lets us delete with backward shifting instead of tombstones.
+*/
+const int HASHTABLE_GROUP_WIDTH = 16;
+const u8 HASHTABLE_CONTROL_EMPTY = 0x80;
+const float HASHTABLE_MAX_LOAD_FACTOR = 0.75f;
+
+// Default hasher, calls the function pointers stored in the table.
+// Compile time hashers (See hash_functions.hpp) provide static hash/equals functions, which can be inlined
+template <typename K>
+struct Hasher_Runtime {};
 
 template <typename K, typename V>
 struct Hashtable_Entry
 {
     K key;
     V value;
-    Hashtable_Entry<K, V>* next;
-    bool valid;
 };
 
-template <typename K, typename V>
+template <typename K, typename V, typename Hasher = Hasher_Runtime<K>>
 struct Hashtable
 {
-    Array<Hashtable_Entry<K, V>> entries;
+    // Has entries.size + HASHTABLE_GROUP_WIDTH bytes, the first group is mirrored at the end so group loads never wrap
+    Array<u8> control_bytes;
+    Array<Hashtable_Entry<K, V>> entries; // Size is always a power of 2
     int element_count;
     u64(*hash_function)(K*);
     bool(*equals_function)(K*, K*);
+    Allocator* allocator; // 0 for default heap
 };
 
-template <typename K, typename V>
+template <typename K, typename V, typename Hasher = Hasher_Runtime<K>>
 struct Hashtable_Iterator
 {
-    Hashtable<K, V>* table;
+    Hashtable<K, V, Hasher>* table;
     Hashtable_Entry<K, V>* current_entry;
     int current_entry_index;
     // Things users should access
@@ -34,145 +59,254 @@ struct Hashtable_Iterator
     V* value;
 };
 
+
+
+/*
+    Internal helpers
+*/
+template <typename K, typename V, typename Hasher>
+u64 hashtable_hash_key(Hashtable<K, V, Hasher>*, K* key) {
+    return Hasher::hash(key);
+}
+
 template <typename K, typename V>
-Hashtable_Iterator<K,V> hashtable_iterator_create(Hashtable<K,V>* table) {
-    Hashtable_Iterator<K, V> result;
-    result.table = table;
-    for (int i = 0; i < table->entries.size; i++) {
-        if (table->entries[i].valid) {
-            result.current_entry = &table->entries[i];
-            result.current_entry_index = i;
-            result.key = &result.current_entry->key;
-            result.value = &result.current_entry->value;
-            return result;
+u64 hashtable_hash_key(Hashtable<K, V, Hasher_Runtime<K>>* table, K* key) {
+    return table->hash_function(key);
+}
+
+template <typename K, typename V, typename Hasher>
+bool hashtable_keys_are_equal(Hashtable<K, V, Hasher>*, K* a, K* b) {
+    return Hasher::equals(a, b);
+}
+
+template <typename K, typename V>
+bool hashtable_keys_are_equal(Hashtable<K, V, Hasher_Runtime<K>>* table, K* a, K* b) {
+    return table->equals_function(a, b);
+}
+
+// Returns a mask where bit i is set if group[i] == value
+inline u32 hashtable_group_match(u8* group, u8 value)
+{
+#ifdef HASHTABLE_USE_SSE2
+    __m128i control = _mm_loadu_si128((__m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char)value)));
+#else
+    u32 mask = 0;
+    for (int i = 0; i < HASHTABLE_GROUP_WIDTH; i++) {
+        if (group[i] == value) {
+            mask = mask | (1 << i);
         }
     }
-    result.current_entry = 0;
-    return result;
+    return mask;
+#endif
 }
 
-template <typename K, typename V>
-bool hashtable_iterator_has_next(Hashtable_Iterator<K, V>* iterator) {
-    return iterator->current_entry != 0;
+// Returns a mask where bit i is set if group[i] is empty (Only empty control bytes have the top bit set)
+inline u32 hashtable_group_match_empty(u8* group)
+{
+#ifdef HASHTABLE_USE_SSE2
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((__m128i*)group));
+#else
+    return hashtable_group_match(group, HASHTABLE_CONTROL_EMPTY);
+#endif
 }
 
-template <typename K, typename V>
-void hashtable_iterator_next(Hashtable_Iterator<K, V>* iterator) 
+inline int hashtable_mask_lowest_bit_index(u32 mask)
 {
-    if (iterator->current_entry == 0) {
-        return;
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+inline int hashtable_slot_count_for_element_count(int element_count)
+{
+    int slot_count = HASHTABLE_GROUP_WIDTH;
+    while (element_count > slot_count * HASHTABLE_MAX_LOAD_FACTOR) {
+        slot_count = slot_count * 2;
     }
+    return slot_count;
+}
 
-    if (iterator->current_entry->next != 0) {
-        iterator->current_entry = iterator->current_entry->next;
-        iterator->key = &iterator->current_entry->key;
-        iterator->value = &iterator->current_entry->value;
-        return;
+template <typename K, typename V, typename Hasher>
+void hashtable_set_control_byte(Hashtable<K, V, Hasher>* table, int slot_index, u8 value)
+{
+    table->control_bytes.data[slot_index] = value;
+    if (slot_index < HASHTABLE_GROUP_WIDTH) {
+        table->control_bytes.data[table->entries.size + slot_index] = value;
+    }
+}
+
+// Returns slot index or -1 if the key is not in the table
+template <typename K, typename V, typename Hasher>
+int hashtable_find_slot(Hashtable<K, V, Hasher>* table, K* key, u64 hash)
+{
+    u8 hash_bits = (u8)(hash & 0x7F);
+    int mask = table->entries.size - 1;
+    int position = (int)(hash >> 7) & mask;
+    while (true)
+    {
+        u8* group = &table->control_bytes.data[position];
+        u32 matches = hashtable_group_match(group, hash_bits);
+        while (matches != 0) {
+            int slot_index = (position + hashtable_mask_lowest_bit_index(matches)) & mask;
+            if (hashtable_keys_are_equal(table, &table->entries.data[slot_index].key, key)) {
+                return slot_index;
+            }
+            matches = matches & (matches - 1);
+        }
+        // Linear probing never leaves a hole between a key's home slot and the key
+        if (hashtable_group_match_empty(group) != 0) {
+            return -1;
+        }
+        position = (position + HASHTABLE_GROUP_WIDTH) & mask;
     }
-    for (int i = iterator->current_entry_index + 1; i < iterator->table->entries.size; i++) {
-        Hashtable<K, V>* table = iterator->table;
-        if (table->entries[i].valid) {
-            iterator->current_entry = &table->entries[i];
+}
+
+// Does not check if the key already exists
+template <typename K, typename V, typename Hasher>
+void hashtable_insert_into_free_slot(Hashtable<K, V, Hasher>* table, K key, V value, u64 hash)
+{
+    int mask = table->entries.size - 1;
+    int position = (int)(hash >> 7) & mask;
+    while (true)
+    {
+        u32 empty_slots = hashtable_group_match_empty(&table->control_bytes.data[position]);
+        if (empty_slots != 0) {
+            int slot_index = (position + hashtable_mask_lowest_bit_index(empty_slots)) & mask;
+            hashtable_set_control_byte(table, slot_index, (u8)(hash & 0x7F));
+            table->entries.data[slot_index].key = key;
+            table->entries.data[slot_index].value = value;
+            table->element_count++;
+            return;
+        }
+        position = (position + HASHTABLE_GROUP_WIDTH) & mask;
+    }
+}
+
+template <typename K, typename V, typename Hasher>
+Hashtable<K, V, Hasher> hashtable_create_with_slot_count(
+    int slot_count, u64(*hash_function)(K*), bool(*equals_function)(K*, K*), Allocator* allocator)
+{
+    Hashtable<K, V, Hasher> result;
+    result.element_count = 0;
+    result.allocator = allocator;
+    result.entries = array_create_static(allocator_allocate_array<Hashtable_Entry<K, V>>(allocator, slot_count), slot_count);
+    result.control_bytes = array_create_static(
+        allocator_allocate_array<u8>(allocator, slot_count + HASHTABLE_GROUP_WIDTH), slot_count + HASHTABLE_GROUP_WIDTH
+    );
+    memory_set_bytes(result.control_bytes.data, result.control_bytes.size, HASHTABLE_CONTROL_EMPTY);
+    result.hash_function = hash_function;
+    result.equals_function = equals_function;
+    return result;
+}
+
+
+
+/*
+    Hashtable
+*/
+template <typename K, typename V, typename Hasher>
+Hashtable_Iterator<K, V, Hasher> hashtable_iterator_create(Hashtable<K, V, Hasher>* table)
+{
+    Hashtable_Iterator<K, V, Hasher> result;
+    result.table = table;
+    result.current_entry_index = -1;
+    result.current_entry = 0;
+    hashtable_iterator_next(&result);
+    return result;
+}
+
+template <typename K, typename V, typename Hasher>
+bool hashtable_iterator_has_next(Hashtable_Iterator<K, V, Hasher>* iterator) {
+    return iterator->current_entry != 0;
+}
+
+template <typename K, typename V, typename Hasher>
+void hashtable_iterator_next(Hashtable_Iterator<K, V, Hasher>* iterator)
+{
+    Hashtable<K, V, Hasher>* table = iterator->table;
+    for (int i = iterator->current_entry_index + 1; i < table->entries.size; i++) {
+        if (table->control_bytes.data[i] != HASHTABLE_CONTROL_EMPTY) {
+            iterator->current_entry = &table->entries.data[i];
             iterator->current_entry_index = i;
             iterator->key = &iterator->current_entry->key;
             iterator->value = &iterator->current_entry->value;
             return;
         }
     }
-    
     iterator->current_entry = 0;
-    return;
+    iterator->current_entry_index = table->entries.size;
 }
 
 template <typename K, typename V>
-Hashtable<K, V> hashtable_create_empty(int capacity, u64(*hash_function)(K*), bool(*equals_function)(K*, K*)) 
+Hashtable<K, V> hashtable_create_empty(int capacity, u64(*hash_function)(K*), bool(*equals_function)(K*, K*), Allocator* allocator = 0)
 {
-    Hashtable<K, V> result;
-    result.element_count = 0;
-    result.entries = array_create_empty<Hashtable_Entry<K, V>>(primes_find_next_suitable_for_set_size(capacity));
-    for (int i = 0; i < result.entries.size; i++) {
-        result.entries[i].valid = false;
-        result.entries[i].next = 0;
-    }
-    result.hash_function = hash_function;
-    result.equals_function = equals_function;
-    return result;
+    return hashtable_create_with_slot_count<K, V, Hasher_Runtime<K>>(
+        hashtable_slot_count_for_element_count(capacity), hash_function, equals_function, allocator
+    );
+}
+
+// Hasher needs static u64 hash(K*) and bool equals(K*, K*) functions
+template <typename K, typename V, typename Hasher>
+Hashtable<K, V, Hasher> hashtable_create_empty(int capacity, Allocator* allocator = 0)
+{
+    return hashtable_create_with_slot_count<K, V, Hasher>(hashtable_slot_count_for_element_count(capacity), 0, 0, allocator);
 }
 
 template <typename K, typename V>
-Hashtable<K, V> hashtable_create_pointer_empty(int capacity) 
+Hashtable<K, V> hashtable_create_pointer_empty(int capacity, Allocator* allocator = 0)
 {
     return hashtable_create_empty<K, V>(
         capacity,
         [](K* key) -> u64 {return hash_pointer(*key); },
-        [](K* a, K* b) -> bool { return (*a) == (*b); }
+        [](K* a, K* b) -> bool { return (*a) == (*b); },
+        allocator
     );
 }
 
-template <typename K, typename V>
-void hashtable_reset(Hashtable<K, V>* table)
+template <typename K, typename V, typename Hasher>
+void hashtable_reset(Hashtable<K, V, Hasher>* table)
 {
     table->element_count = 0;
-    for (int i = 0; i < table->entries.size; i++) {
-        Hashtable_Entry<K,V>* entry = &table->entries[i];
-        entry->valid = false;
-        if (entry->next != 0) {
-            Hashtable_Entry<K, V>* next = entry->next;
-            entry->next = 0;
-            while (next != 0) {
-                Hashtable_Entry<K, V>* next_next = next->next;
-                delete next;
-                next = next_next;
-            }
-        }
-    }
+    memory_set_bytes(table->control_bytes.data, table->control_bytes.size, HASHTABLE_CONTROL_EMPTY);
 }
 
-template <typename K, typename V>
-void hashtable_destroy(Hashtable<K, V>* table) 
+template <typename K, typename V, typename Hasher>
+void hashtable_destroy(Hashtable<K, V, Hasher>* table)
 {
-    // Deleate all items in entry lists
-    for (int i = 0; i < table->entries.size; i++) {
-        Hashtable_Entry<K,V>* entry = &table->entries[i];
-        if (entry->next != 0) {
-            entry = entry->next;
-            while (entry != 0) {
-                Hashtable_Entry<K, V>* next = entry->next;
-                delete entry;
-                entry = next;
-            }
-        }
-    }
-    array_destroy(&table->entries);
+    allocator_free_array(table->allocator, table->control_bytes.data);
+    allocator_free_array(table->allocator, table->entries.data);
 }
 
-template <typename K, typename V>
-V* hashtable_find_element(Hashtable<K, V>* table, K key)
-{
-    u64 hash = table->hash_function(&key);
-    int entry_index = hash % table->entries.size;
-    Hashtable_Entry<K,V>* entry = &table->entries.data[entry_index];
-    while (entry != 0 && entry->valid) {
-        if (table->equals_function(&entry->key, &key)) {
-            return &entry->value;
-        }
-        entry = entry->next;
+template <typename K, typename V, typename Hasher>
+V* hashtable_find_element(Hashtable<K, V, Hasher>* table, K key)
+{
+    int slot_index = hashtable_find_slot(table, &key, hashtable_hash_key(table, &key));
+    if (slot_index == -1) {
+        return 0;
     }
-    return 0;
+    return &table->entries.data[slot_index].value;
 }
 
-template <typename K, typename V>
-void hashtable_reserve(Hashtable<K, V>* table, int capacity) 
+template <typename K, typename V, typename Hasher>
+void hashtable_reserve(Hashtable<K, V, Hasher>* table, int capacity)
 {
-    if (table->entries.size > capacity) {
+    int slot_count = hashtable_slot_count_for_element_count(capacity);
+    if (slot_count <= table->entries.size) {
         return;
     }
-    int new_capacity = primes_find_next_suitable_for_set_size(capacity);
-    Hashtable<K, V> new_table = hashtable_create_empty<K, V>(new_capacity, table->hash_function, table->equals_function);
-    Hashtable_Iterator<K, V> iterator = hashtable_iterator_create(table);
-    while (hashtable_iterator_has_next(&iterator)) {
-        hashtable_insert_element(&new_table, iterator.current_entry->key, iterator.current_entry->value);
-        hashtable_iterator_next(&iterator);
+    Hashtable<K, V, Hasher> new_table = hashtable_create_with_slot_count<K, V, Hasher>(
+        slot_count, table->hash_function, table->equals_function, table->allocator
+    );
+    for (int i = 0; i < table->entries.size; i++) {
+        if (table->control_bytes.data[i] != HASHTABLE_CONTROL_EMPTY) {
+            Hashtable_Entry<K, V>* entry = &table->entries.data[i];
+            hashtable_insert_into_free_slot(&new_table, entry->key, entry->value, hashtable_hash_key(table, &entry->key));
+        }
     }
     // Destroy old table data
     hashtable_destroy(table);
@@ -180,41 +314,46 @@ void hashtable_reserve(Hashtable<K, V>* table, int capacity)
 }
 
 // Returns true if element was inserted, else false (If key already exists)
-template <typename K, typename V>
-bool hashtable_insert_element(Hashtable<K, V>* table, K key, V value)
+template <typename K, typename V, typename Hasher>
+bool hashtable_insert_element(Hashtable<K, V, Hasher>* table, K key, V value)
 {
-    if ((float)(table->element_count + 1) / table->entries.size > HASHSET_RESIZE_PERCENTAGE) {
+    u64 hash = hashtable_hash_key(table, &key);
+    if (hashtable_find_slot(table, &key, hash) != -1) {
+        return false;
+    }
+    if (table->element_count + 1 > table->entries.size * HASHTABLE_MAX_LOAD_FACTOR) {
         hashtable_reserve(table, table->element_count + 1);
     }
+    hashtable_insert_into_free_slot(table, key, value, hash);
+    return true;
+}
 
-    u64 hash = table->hash_function(&key);
-    int entry_index = (hash % table->entries.size);
-    Hashtable_Entry<K, V>* entry = & (table->entries.data[entry_index]);
-    if (!entry->valid) {
-        entry->valid = true;
-        entry->key = key;
-        entry->value = value;
-        entry->next = 0;
-        table->element_count++;
-        return true;
+// Returns true if the element was removed, false if the key was not in the table
+template <typename K, typename V, typename Hasher>
+bool hashtable_remove_element(Hashtable<K, V, Hasher>* table, K key)
+{
+    int hole_index = hashtable_find_slot(table, &key, hashtable_hash_key(table, &key));
+    if (hole_index == -1) {
+        return false;
     }
 
-    while (true) {
-        if (table->equals_function(&entry->key, &key)) {
-            return false;
+    // Backward shift: Move following entries into the hole if that does not put them before their home slot
+    int mask = table->entries.size - 1;
+    int next_index = (hole_index + 1) & mask;
+    while (table->control_bytes.data[next_index] != HASHTABLE_CONTROL_EMPTY)
+    {
+        Hashtable_Entry<K, V>* next_entry = &table->entries.data[next_index];
+        int home_index = (int)(hashtable_hash_key(table, &next_entry->key) >> 7) & mask;
+        int distance_to_home = (next_index - home_index) & mask;
+        int distance_to_hole = (next_index - hole_index) & mask;
+        if (distance_to_home >= distance_to_hole) {
+            table->entries.data[hole_index] = *next_entry;
+            hashtable_set_control_byte(table, hole_index, table->control_bytes.data[next_index]);
+            hole_index = next_index;
         }
-        if (entry->next == 0) { // Insert element as next
-            Hashtable_Entry<K, V>* next = new Hashtable_Entry<K, V>();
-            next->valid = true;
-            next->key = key;
-            next->value = value;
-            next->next = 0;
-            entry->next = next;
-            table->element_count++;
-            return true;
-        }
-        entry = entry->next;
+        next_index = (next_index + 1) & mask;
     }
-
-    return false;
+    hashtable_set_control_byte(table, hole_index, HASHTABLE_CONTROL_EMPTY);
+    table->element_count--;
+    return true;
 }
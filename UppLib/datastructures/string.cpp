@@ -14,6 +14,7 @@ String string_create_static_with_size(const char* content, int length)
     result.size = length;
     result.characters = const_cast<char*>(content);
     result.capacity = length+1;
+    result.allocator = 0;
     return result;
 }
 
@@ -27,6 +28,7 @@ String string_create_substring_static(String* string, int start_pos, int end_pos
     String result;
     result.characters = string->characters + start_pos;
     result.size = end_pos - start_pos;
+    result.allocator = 0;
     return result;
 }
 
@@ -41,6 +43,7 @@ String string_create_substring(String* string, int start_index, int end_index)
     String result;
     result.capacity = end_index - start_index + 2;
     result.characters = new char[result.capacity];
+    result.allocator = 0;
     result.size = end_index - start_index+1;
     memory_copy(result.characters, &string->characters[start_index], result.size);
     result.characters[result.size] = 0;
@@ -59,12 +62,14 @@ String string_create_static(const char* content)
     result.characters = const_cast<char*>(content);
     result.size = (int)strlen(content);
     result.capacity = result.size + 1;
+    result.allocator = 0;
     return result;
 }
 
-String string_create_empty(int capacity) {
+String string_create_empty(int capacity, Allocator* allocator) {
     String result;
-    result.characters = new char[capacity];
+    result.allocator = allocator;
+    result.characters = allocator_allocate_array<char>(allocator, capacity);
     result.characters[0] = 0;
     result.size = 0;
     result.capacity = capacity;
@@ -75,17 +80,19 @@ String string_create_from_string_with_extra_capacity(String* other, int extra_ca
     String result;
     result.capacity = other->size + 1 + extra_capacity;
     result.characters = new char[result.capacity];
-    strcpy_s(result.characters, result.capacity, other->characters);
+    result.allocator = 0;
+    memcpy(result.characters, other->characters, other->size + 1);
     result.size = other->size;
     return result;
 }
 
-String string_create(const char* content) {
+String string_create(const char* content, Allocator* allocator) {
     String result;
     result.size = (int)strlen(content);
-    result.characters = new char[result.size+1];
+    result.allocator = allocator;
+    result.characters = allocator_allocate_array<char>(allocator, result.size+1);
     result.capacity = result.size + 1;
-    strcpy_s(result.characters, result.size+1, content);
+    memcpy(result.characters, content, result.size + 1);
     return result;
 }
 
@@ -119,7 +126,7 @@ void string_create_from_filepath_to_path_and_filename(String* path, String* file
 
 void string_destroy(String* string) {
     if (string->characters != 0) {
-        delete[] string->characters;
+        allocator_free_array(string->allocator, string->characters);
     }
 }
 
@@ -127,9 +134,9 @@ void string_reserve(String* string, int new_capacity) {
     if (string->capacity >= new_capacity) {
         return;
     }
-    char* resized_buffer = new char[new_capacity];
-    strcpy_s(resized_buffer, new_capacity, string->characters);
-    delete[] string->characters;
+    char* resized_buffer = allocator_allocate_array<char>(string->allocator, new_capacity);
+    memcpy(resized_buffer, string->characters, string->size + 1);
+    allocator_free_array(string->allocator, string->characters);
     string->characters = resized_buffer;
     string->capacity = new_capacity;
 }
@@ -140,7 +147,7 @@ void string_append(String* string, const char* appendix) {
     if (string->capacity < required_capacity) {
         string_reserve(string, required_capacity);
     }
-    strcpy_s(string->characters + string->size, appendix_length+1, appendix);
+    memcpy(string->characters + string->size, appendix, appendix_length + 1);
     string->size += appendix_length;
 }
 
@@ -192,11 +199,15 @@ String string_create_formated(const char* format, ...)
     va_list args;
     va_start(args, format);
 
-    // Allocate buffer
+    // Allocate buffer, the first vsnprintf consumes a copy since args cannot be reused after a call
+    va_list args_copy;
+    va_copy(args_copy, args);
     String result;
-    result.size = vsnprintf(0, 0, format, args);
+    result.size = vsnprintf(0, 0, format, args_copy);
+    va_end(args_copy);
     result.capacity = result.size+1;
     result.characters = new char[result.capacity];
+    result.allocator = 0;
 
     // Fill buffer
     vsnprintf(result.characters, result.capacity, format, args);
@@ -209,7 +220,10 @@ void string_append_formated(String* string, const char* format, ...)
 {
     va_list args;
     va_start(args, format);
-    int message_length = vsnprintf(0, 0, format, args);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int message_length = vsnprintf(0, 0, format, args_copy);
+    va_end(args_copy);
     string_reserve(string, string->size + message_length + 1);
     int ret_val = vsnprintf(string->characters + string->size, string->capacity - string->size, format, args);
     if (ret_val < 0) {
@@ -2,12 +2,14 @@
 
 #include "../utility/utils.hpp"
 #include "../datastructures/array.hpp"
+#include "../utility/allocators.hpp"
 
 struct String
 {
     char* characters;
     int size;
     int capacity;
+    Allocator* allocator; // 0 for default heap
     
     char& operator[](int index) {
         return characters[index];
@@ -15,10 +17,10 @@ struct String
 };
 
 String string_create_static(const char* content);
-String string_create_static_with_size(char* content, int size);
-String string_create(const char* content);
+String string_create_static_with_size(const char* content, int size);
+String string_create(const char* content, Allocator* allocator = 0);
 String string_create_formated(const char* format, ...);
-String string_create_empty(int capacity);
+String string_create_empty(int capacity, Allocator* allocator = 0);
 String string_create_from_string_with_extra_capacity(String* other, int extra_capacity);
 String string_create_substring(String* string, int start_index, int end_index);
 String string_create_substring_static(String* string, int start_pos, int end_pos);
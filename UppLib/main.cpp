@@ -1,10 +1,22 @@
+#include "programs/upp_lang/upp_cli.hpp"
+#ifndef UPPLIB_HEADLESS
 #include "programs/upp_lang/upp_lang.hpp"
 #include "programs/proc_city/proc_city.hpp"
+#endif
 
 int main(int argc, char** argv)
 {
+#ifdef UPPLIB_HEADLESS
+    // Builds without window and OpenGL support only contain the command line driver
+    return upp_cli_main(argc, argv);
+#else
+    // With arguments the headless compiler driver runs instead of the editor
+    if (argc > 1) {
+        return upp_cli_main(argc, argv);
+    }
     upp_lang_main();
     //proc_city_main();
     
     return 0;
+#endif
 }
\ No newline at end of file
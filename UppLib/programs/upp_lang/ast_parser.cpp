@@ -5,7 +5,7 @@ int ast_parser_check_for_undefines(AST_Parser* parser)
 {
     int count = 0;
     for (int i = 0; i < parser->next_free_node; i++) {
-        if (parser->nodes[i].type == AST_Node_Type::UNDEFINED) {
+        if (parser->node_types[i] == AST_Node_Type::UNDEFINED) {
             //logg("Undefined at %d\n", i);
             count++;
         }
@@ -18,38 +18,66 @@ int ast_parser_check_for_undefines(AST_Parser* parser)
 
 int ast_parser_get_next_node_index_no_parent(AST_Parser* parser)
 {
-    while (parser->next_free_node >= parser->nodes.size) {
-        AST_Node node;
-        node.type = AST_Node_Type::UNDEFINED;
-        node.children = dynamic_array_create_empty<AST_Node_Index>(2);
-        node.parent = -1;
-        dynamic_array_push_back(&parser->nodes, node);
+    while (parser->next_free_node >= parser->node_types.size) {
+        dynamic_array_push_back(&parser->node_types, AST_Node_Type::UNDEFINED);
+        dynamic_array_push_back(&parser->node_parents, -1);
+        dynamic_array_push_back(&parser->node_name_ids, 0);
+        dynamic_array_push_back(&parser->node_first_child, 0);
+        dynamic_array_push_back(&parser->node_child_counts, 0);
+        dynamic_array_push_back(&parser->link_first_child, -1);
+        dynamic_array_push_back(&parser->link_last_child, -1);
+        dynamic_array_push_back(&parser->link_next_sibling, -1);
         dynamic_array_push_back(&parser->token_mapping, token_range_make(-1, -1));
     }
 
-    AST_Node* node = &parser->nodes[parser->next_free_node];
+    int index = parser->next_free_node;
     parser->next_free_node++;
-    node->parent = -1;
-    dynamic_array_reset(&node->children);
-    return parser->next_free_node - 1;
+    parser->node_parents[index] = -1;
+    parser->node_child_counts[index] = 0;
+    parser->link_first_child[index] = -1;
+    parser->link_last_child[index] = -1;
+    parser->link_next_sibling[index] = -1;
+    return index;
+}
+
+void ast_parser_add_parent_child_connection(AST_Parser* parser, AST_Node_Index parent_index, AST_Node_Index child_index)
+{
+    parser->node_parents[child_index] = parent_index;
+    parser->link_next_sibling[child_index] = -1;
+    if (parser->link_last_child[parent_index] == -1) {
+        parser->link_first_child[parent_index] = child_index;
+    }
+    else {
+        parser->link_next_sibling[parser->link_last_child[parent_index]] = child_index;
+    }
+    parser->link_last_child[parent_index] = child_index;
+    parser->node_child_counts[parent_index]++;
 }
 
 int ast_parser_get_next_node_index(AST_Parser* parser, AST_Node_Index parent_index)
 {
     int index = ast_parser_get_next_node_index_no_parent(parser);
-    AST_Node* node = &parser->nodes[index];
-    node->parent = parent_index;
-        
     if (parent_index != -1) {
-        dynamic_array_push_back(&parser->nodes[parent_index].children, parser->next_free_node - 1);
+        ast_parser_add_parent_child_connection(parser, parent_index, index);
     }
     return index;
 }
 
-void ast_parser_add_parent_child_connection(AST_Parser* parser, AST_Node_Index parent_index, AST_Node_Index child_index)
+void ast_parser_remove_children_after(AST_Parser* parser, AST_Node_Index parent_index, int child_count)
 {
-    parser->nodes[child_index].parent = parent_index;
-    dynamic_array_push_back(&parser->nodes[parent_index].children, child_index);
+    if (child_count >= parser->node_child_counts[parent_index]) return;
+    parser->node_child_counts[parent_index] = child_count;
+    if (child_count == 0) {
+        parser->link_first_child[parent_index] = -1;
+        parser->link_last_child[parent_index] = -1;
+        return;
+    }
+    AST_Node_Index last = parser->link_first_child[parent_index];
+    for (int i = 1; i < child_count; i++) {
+        last = parser->link_next_sibling[last];
+    }
+    parser->link_next_sibling[last] = -1;
+    parser->link_last_child[parent_index] = last;
 }
 
 AST_Parser_Checkpoint ast_parser_checkpoint_make(AST_Parser* parser, AST_Node_Index parent_index)
@@ -58,7 +86,7 @@ AST_Parser_Checkpoint ast_parser_checkpoint_make(AST_Parser* parser, AST_Node_In
     result.parser = parser;
     result.parent_index = parent_index;
     if (parent_index != -1)
-        result.parent_child_count = parser->nodes.data[parent_index].children.size;
+        result.parent_child_count = parser->node_child_counts[parent_index];
     else
         result.parent_child_count = 0;
     result.rewind_token_index = parser->index;
@@ -71,14 +99,22 @@ void ast_parser_checkpoint_reset(AST_Parser_Checkpoint checkpoint)
     checkpoint.parser->index = checkpoint.rewind_token_index;
     checkpoint.parser->next_free_node = checkpoint.next_free_node_index;
     if (checkpoint.parent_index != -1) { // This is the case if root
-        Dynamic_Array<AST_Node_Index>* parent_childs = &checkpoint.parser->nodes.data[checkpoint.parent_index].children;
-        dynamic_array_remove_range_ordered(parent_childs, checkpoint.parent_child_count, parent_childs->size); 
-        dynamic_array_rollback_to_size(parent_childs, checkpoint.parent_child_count); 
+        ast_parser_remove_children_after(checkpoint.parser, checkpoint.parent_index, checkpoint.parent_child_count);
+    }
+}
+
+// Incremental parsing reuses a declaration only if the tokens its parse looked at did not change
+void ast_parser_mark_token_read(AST_Parser* parser, int token_index)
+{
+    token_index = math_minimum(token_index, parser->lexer->tokens.size);
+    if (token_index > parser->furthest_token_read) {
+        parser->furthest_token_read = token_index;
     }
 }
 
 bool ast_parser_test_next_token(AST_Parser* parser, Token_Type type)
 {
+    ast_parser_mark_token_read(parser, parser->index);
     if (parser->index >= parser->lexer->tokens.size) {
         return false;
     }
@@ -90,6 +126,7 @@ bool ast_parser_test_next_token(AST_Parser* parser, Token_Type type)
 
 bool ast_parser_test_next_2_tokens(AST_Parser* parser, Token_Type type1, Token_Type type2)
 {
+    ast_parser_mark_token_read(parser, parser->index + 1);
     if (parser->index + 1 >= parser->lexer->tokens.size) {
         return false;
     }
@@ -101,6 +138,7 @@ bool ast_parser_test_next_2_tokens(AST_Parser* parser, Token_Type type1, Token_T
 
 bool ast_parser_test_next_3_tokens(AST_Parser* parser, Token_Type type1, Token_Type type2, Token_Type type3)
 {
+    ast_parser_mark_token_read(parser, parser->index + 2);
     if (parser->index + 2 >= parser->lexer->tokens.size) {
         return false;
     }
@@ -115,6 +153,7 @@ bool ast_parser_test_next_3_tokens(AST_Parser* parser, Token_Type type1, Token_T
 bool ast_parser_test_next_4_tokens(AST_Parser* parser, Token_Type type1, Token_Type type2, Token_Type type3,
     Token_Type type4)
 {
+    ast_parser_mark_token_read(parser, parser->index + 3);
     if (parser->index + 3 >= parser->lexer->tokens.size) {
         return false;
     }
@@ -131,6 +170,7 @@ bool ast_parser_test_next_4_tokens(AST_Parser* parser, Token_Type type1, Token_T
 bool ast_parser_test_next_5_tokens(AST_Parser* parser, Token_Type type1, Token_Type type2, Token_Type type3,
     Token_Type type4, Token_Type type5)
 {
+    ast_parser_mark_token_read(parser, parser->index + 4);
     if (parser->index + 4 >= parser->lexer->tokens.size) {
         return false;
     }
@@ -150,10 +190,11 @@ int ast_parser_find_next_token_type(AST_Parser* parser, Token_Type type)
     while (index < parser->lexer->tokens.size)
     {
         if (parser->lexer->tokens[index].type == type) {
-            return index;
+            break;
         }
         index++;
     }
+    ast_parser_mark_token_read(parser, index);
     return index;
 }
 
@@ -163,9 +204,10 @@ int ast_parser_find_next_line_start_token(AST_Parser* parser)
     int line = parser->lexer->tokens[parser->index].position.start.line;
     while (i < parser->lexer->tokens.size) {
         int token_line = parser->lexer->tokens[i].position.start.line;
-        if (token_line != line) return i;
+        if (token_line != line) break;
         i++;
     }
+    ast_parser_mark_token_read(parser, i);
     return i;
 }
 
@@ -179,11 +221,12 @@ int ast_parser_find_parenthesis_ending(AST_Parser* parser, Token_Type open_type,
         if (parser->lexer->tokens[i].type == closed_type) {
             depth--;
             if (depth <= 0) {
-                return i;
+                break;
             }
         }
         i++;
     }
+    ast_parser_mark_token_read(parser, i);
     return i;
 }
 
@@ -244,14 +287,14 @@ bool ast_parser_parse_identifier_or_path(AST_Parser* parser, AST_Node_Index pare
         ast_parser_checkpoint_reset(checkpoint);
         return false;
     }
-    parser->nodes[node_index].name_id = parser->lexer->tokens[parser->index].attribute.identifier_number;
+    parser->node_name_ids[node_index] = parser->lexer->tokens[parser->index].attribute.identifier_number;
     parser->index++;
     if (!ast_parser_test_next_token(parser, Token_Type::DOUBLE_COLON)) {
-        parser->nodes[node_index].type = AST_Node_Type::IDENTIFIER;
+        parser->node_types[node_index] = AST_Node_Type::IDENTIFIER;
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return true;
     }
-    parser->nodes[node_index].type = AST_Node_Type::IDENTIFIER_PATH;
+    parser->node_types[node_index] = AST_Node_Type::IDENTIFIER_PATH;
     parser->index += 1;
 
     if (ast_parser_parse_identifier_or_path(parser, node_index)) {
@@ -269,7 +312,7 @@ bool ast_parser_parse_function_signature(AST_Parser* parser, AST_Node_Index pare
 
     if (ast_parser_test_next_token(parser, Token_Type::OPEN_PARENTHESIS)) 
     {
-        parser->nodes[node_index].type = AST_Node_Type::FUNCTION_SIGNATURE;
+        parser->node_types[node_index] = AST_Node_Type::FUNCTION_SIGNATURE;
         if (!ast_parser_parse_parameter_block(parser, node_index, true)) {
             ast_parser_checkpoint_reset(checkpoint);
             return false;
@@ -298,7 +341,7 @@ bool ast_parser_parse_type_function_pointer(AST_Parser* parser, AST_Node_Index p
 
     if (ast_parser_test_next_token(parser, Token_Type::OPEN_PARENTHESIS)) 
     {
-        parser->nodes[node_index].type = AST_Node_Type::TYPE_FUNCTION_POINTER;
+        parser->node_types[node_index] = AST_Node_Type::TYPE_FUNCTION_POINTER;
         if (!ast_parser_parse_parameter_block(parser, node_index, false)) {
             ast_parser_checkpoint_reset(checkpoint);
             return false;
@@ -330,13 +373,13 @@ bool ast_parser_parse_type(AST_Parser* parser, AST_Node_Index parent)
     AST_Node_Index node_index = ast_parser_get_next_node_index(parser, parent);
 
     if (ast_parser_parse_identifier_or_path(parser, node_index)) {
-        parser->nodes[node_index].type = AST_Node_Type::TYPE_IDENTIFIER;
+        parser->node_types[node_index] = AST_Node_Type::TYPE_IDENTIFIER;
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return true;
     }
 
     if (ast_parser_test_next_token(parser, Token_Type::OP_STAR)) {
-        parser->nodes[node_index].type = AST_Node_Type::TYPE_POINTER_TO;
+        parser->node_types[node_index] = AST_Node_Type::TYPE_POINTER_TO;
         parser->index++;
         if (ast_parser_parse_type(parser, node_index)) {
             parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
@@ -347,7 +390,7 @@ bool ast_parser_parse_type(AST_Parser* parser, AST_Node_Index parent)
     if (ast_parser_test_next_token(parser, Token_Type::OPEN_BRACKETS))
     {
         parser->index++;
-        parser->nodes[node_index].type = AST_Node_Type::TYPE_ARRAY_UNSIZED;
+        parser->node_types[node_index] = AST_Node_Type::TYPE_ARRAY_UNSIZED;
         if (ast_parser_test_next_token(parser, Token_Type::CLOSED_BRACKETS)) {
             parser->index++;
             if (!ast_parser_parse_type(parser, node_index)) {
@@ -358,7 +401,7 @@ bool ast_parser_parse_type(AST_Parser* parser, AST_Node_Index parent)
             return true;
         }
 
-        parser->nodes[node_index].type = AST_Node_Type::TYPE_ARRAY_SIZED;
+        parser->node_types[node_index] = AST_Node_Type::TYPE_ARRAY_SIZED;
         if (!ast_parser_parse_expression(parser, node_index)) {
             ast_parser_checkpoint_reset(checkpoint);
             return false;
@@ -384,7 +427,7 @@ bool ast_parser_parse_argument_block(AST_Parser* parser, AST_Node_Index parent_i
 {
     AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, parent_index);
     int node_index = ast_parser_get_next_node_index(parser, parent_index);
-    parser->nodes[node_index].type = AST_Node_Type::ARGUMENTS;
+    parser->node_types[node_index] = AST_Node_Type::ARGUMENTS;
 
     if (!ast_parser_test_next_token(parser, Token_Type::OPEN_PARENTHESIS)) {
         ast_parser_checkpoint_reset(checkpoint);
@@ -432,8 +475,8 @@ AST_Node_Index ast_parser_parse_member_access(AST_Parser* parser, int access_to_
     while (ast_parser_test_next_2_tokens(parser, Token_Type::DOT, Token_Type::IDENTIFIER)) 
     {
         int new_node_index = ast_parser_get_next_node_index_no_parent(parser);
-        parser->nodes[new_node_index].type = AST_Node_Type::EXPRESSION_MEMBER_ACCESS;
-        parser->nodes[new_node_index].name_id = parser->lexer->tokens[parser->index+1].attribute.identifier_number;
+        parser->node_types[new_node_index] = AST_Node_Type::EXPRESSION_MEMBER_ACCESS;
+        parser->node_name_ids[new_node_index] = parser->lexer->tokens[parser->index+1].attribute.identifier_number;
         parser->token_mapping[new_node_index] = token_range_make(parser->index, parser->index + 2);
         parser->index += 2;
         ast_parser_add_parent_child_connection(parser, new_node_index, node_index);
@@ -450,8 +493,8 @@ AST_Node_Index ast_parser_parse_variable_read(AST_Parser* parser)
         ast_parser_checkpoint_reset(checkpoint);
         return -1;
     }
-    parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_VARIABLE_READ;
-    parser->nodes[node_index].name_id = parser->lexer->tokens[parser->index].attribute.identifier_number;
+    parser->node_types[node_index] = AST_Node_Type::EXPRESSION_VARIABLE_READ;
+    parser->node_name_ids[node_index] = parser->lexer->tokens[parser->index].attribute.identifier_number;
     parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
     return node_index;
 }
@@ -467,7 +510,7 @@ AST_Node_Index ast_parser_parse_array_or_member_access(AST_Parser* parser, AST_N
         if (ast_parser_test_next_token(parser, Token_Type::OPEN_BRACKETS))
         {
             int new_node_index = ast_parser_get_next_node_index_no_parent(parser);
-            parser->nodes[new_node_index].type = AST_Node_Type::EXPRESSION_ARRAY_ACCESS;
+            parser->node_types[new_node_index] = AST_Node_Type::EXPRESSION_ARRAY_ACCESS;
             parser->index++;
             ast_parser_add_parent_child_connection(parser, new_node_index, node_index);
             if (!ast_parser_parse_expression(parser, new_node_index)) {
@@ -496,7 +539,7 @@ AST_Node_Index ast_parser_parse_general_access(AST_Parser* parser)
     if (ast_parser_test_next_2_tokens(parser, Token_Type::CAST, Token_Type::COMPARISON_LESS))
     {
         parser->index += 2;
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_CAST;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_CAST;
         if (!ast_parser_parse_type(parser, node_index)) {
             ast_parser_checkpoint_reset(checkpoint);
             return -1;
@@ -518,7 +561,7 @@ AST_Node_Index ast_parser_parse_general_access(AST_Parser* parser)
     if (ast_parser_test_next_token(parser, Token_Type::OP_STAR))
     {
         parser->index++;
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_ADDRESS_OF;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_ADDRESS_OF;
         AST_Node_Index child = ast_parser_parse_general_access(parser);
         if (child == -1) {
             ast_parser_checkpoint_reset(checkpoint);
@@ -531,7 +574,7 @@ AST_Node_Index ast_parser_parse_general_access(AST_Parser* parser)
     if (ast_parser_test_next_token(parser, Token_Type::LOGICAL_BITWISE_AND))
     {
         parser->index++;
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
         AST_Node_Index child = ast_parser_parse_general_access(parser);
         if (child == -1) {
             ast_parser_checkpoint_reset(checkpoint);
@@ -544,9 +587,9 @@ AST_Node_Index ast_parser_parse_general_access(AST_Parser* parser)
     if (ast_parser_test_next_token(parser, Token_Type::LOGICAL_AND))
     {
         parser->index++;
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
         AST_Node_Index child_index = ast_parser_get_next_node_index_no_parent(parser);
-        parser->nodes[child_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
+        parser->node_types[child_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
         AST_Node_Index child_child = ast_parser_parse_general_access(parser);
         if (child_child == -1) {
             ast_parser_checkpoint_reset(checkpoint);
@@ -641,7 +684,7 @@ AST_Node_Index ast_parser_parse_expression_single_value(AST_Parser* parser)
         int node_index = ast_parser_get_next_node_index_no_parent(parser);
         if (ast_parser_parse_identifier_or_path(parser, node_index)) 
         {
-            parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_FUNCTION_CALL;
+            parser->node_types[node_index] = AST_Node_Type::EXPRESSION_FUNCTION_CALL;
             if (ast_parser_parse_argument_block(parser, node_index)) {
                 parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
                 return node_index;
@@ -665,74 +708,70 @@ AST_Node_Index ast_parser_parse_expression_single_value(AST_Parser* parser)
         ast_parser_test_next_token(parser, Token_Type::STRING_LITERAL) ||
         ast_parser_test_next_token(parser, Token_Type::NULLPTR))
     {
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_LITERAL;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_LITERAL;
         parser->index++;
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return node_index;
     }
     else if (ast_parser_test_next_token(parser, Token_Type::OP_MINUS))
     {
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_NEGATE;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_NEGATE;
         parser->index++;
         AST_Node_Index child_index = ast_parser_parse_expression_single_value(parser);
         if (child_index == -1) {
             ast_parser_checkpoint_reset(checkpoint);
             return -1;
         }
-        dynamic_array_push_back(&parser->nodes[node_index].children, child_index);
-        parser->nodes[child_index].parent = node_index;
+        ast_parser_add_parent_child_connection(parser, node_index, child_index);
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return node_index;
     }
     else if (ast_parser_test_next_token(parser, Token_Type::LOGICAL_NOT))
     {
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_NOT;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_NOT;
         parser->index++;
         AST_Node_Index child_index = ast_parser_parse_expression_single_value(parser);
         if (child_index == -1) {
             ast_parser_checkpoint_reset(checkpoint);
             return -1;
         }
-        dynamic_array_push_back(&parser->nodes[node_index].children, child_index);
-        parser->nodes[child_index].parent = node_index;
+        ast_parser_add_parent_child_connection(parser, node_index, child_index);
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return node_index;
     }
     else if (ast_parser_test_next_token(parser, Token_Type::OP_STAR))
     {
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_ADDRESS_OF;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_ADDRESS_OF;
         parser->index++;
         AST_Node_Index child_index = ast_parser_parse_expression_single_value(parser);
         if (child_index == -1) {
             ast_parser_checkpoint_reset(checkpoint);
             return -1;
         }
-        dynamic_array_push_back(&parser->nodes[node_index].children, child_index);
-        parser->nodes[child_index].parent = node_index;
+        ast_parser_add_parent_child_connection(parser, node_index, child_index);
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return node_index;
     }
     else if (ast_parser_test_next_token(parser, Token_Type::LOGICAL_BITWISE_AND))
     {
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
         parser->index++;
         AST_Node_Index child_index = ast_parser_parse_expression_single_value(parser);
         if (child_index == -1) {
             ast_parser_checkpoint_reset(checkpoint);
             return -1;
         }
-        dynamic_array_push_back(&parser->nodes[node_index].children, child_index);
-        parser->nodes[child_index].parent = node_index;
+        ast_parser_add_parent_child_connection(parser, node_index, child_index);
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return node_index;
     }
     else if (ast_parser_test_next_token(parser, Token_Type::LOGICAL_AND))
     {
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
         parser->index++;
         {
             AST_Node_Index child_index = ast_parser_get_next_node_index(parser, node_index);
-            parser->nodes[child_index].type = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
+            parser->node_types[child_index] = AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE;
             AST_Node_Index child_child_index = ast_parser_parse_expression_single_value(parser);
             if (child_child_index == -1) {
                 ast_parser_checkpoint_reset(checkpoint);
@@ -760,6 +799,7 @@ bool ast_parser_parse_binary_operation(AST_Parser* parser, AST_Node_Type* op_typ
             5       ---     *, /
             6       ---     %
     */
+    ast_parser_mark_token_read(parser, parser->index + 1);
     if (parser->index + 1 >= parser->lexer->tokens.size) return false;
     switch (parser->lexer->tokens[parser->index].type)
     {
@@ -846,7 +886,7 @@ int ast_parser_parse_expression_priority(AST_Parser* parser, AST_Node_Index node
     int max_priority = 999;
     while (true)
     {
-        AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, parser->nodes[node_index].parent);
+        AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, parser->node_parents[node_index]);
 
         int first_op_priority;
         int first_op_index = parser->index;
@@ -863,7 +903,7 @@ int ast_parser_parse_expression_priority(AST_Parser* parser, AST_Node_Index node
         }
 
         AST_Node_Index operator_node = ast_parser_get_next_node_index_no_parent(parser);
-        parser->nodes[operator_node].type = AST_Node_Type::EXPRESSION_BINARY_OPERATION_AND; // This is just so that we dont have any undefines
+        parser->node_types[operator_node] = AST_Node_Type::EXPRESSION_BINARY_OPERATION_AND; // This is just so that we dont have any undefines
         AST_Node_Index right_operand_index = ast_parser_parse_expression_single_value(parser);
         if (right_operand_index == -1) {
             ast_parser_checkpoint_reset(checkpoint);
@@ -882,15 +922,13 @@ int ast_parser_parse_expression_priority(AST_Parser* parser, AST_Node_Index node
             }
         }
 
-        parser->nodes[node_index].parent = operator_node;
-        dynamic_array_push_back(&parser->nodes[operator_node].children, node_index);
-        parser->nodes[right_operand_index].parent = operator_node;
-        dynamic_array_push_back(&parser->nodes[operator_node].children, right_operand_index);
-        parser->nodes[operator_node].type = first_op_type;
+        ast_parser_add_parent_child_connection(parser, operator_node, node_index);
+        ast_parser_add_parent_child_connection(parser, operator_node, right_operand_index);
+        parser->node_types[operator_node] = first_op_type;
         /*
         parser->token_mapping[operator_node] = token_range_make(
-            parser->token_mapping[parser->nodes[operator_node].children[0]].start_index,
-            parser->token_mapping[parser->nodes[operator_node].children[1]].end_index
+            parser->token_mapping[node_index].start_index,
+            parser->token_mapping[right_operand_index].end_index
         );
         */
         parser->token_mapping[operator_node] = token_range_make(first_op_index, first_op_index + 1);
@@ -920,7 +958,7 @@ bool ast_parser_parse_single_statement_expression(AST_Parser* parser, int parent
     AST_Node_Index node_index = ast_parser_get_next_node_index(parser, parent_index);
     if (ast_parser_test_next_token(parser, Token_Type::NEW))
     {
-        parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_NEW;
+        parser->node_types[node_index] = AST_Node_Type::EXPRESSION_NEW;
         parser->index++;
         if (ast_parser_test_next_2_tokens(parser, Token_Type::OPEN_BRACKETS, Token_Type::CLOSED_BRACKETS)) {
             ast_parser_log_error(parser, "Cannot have new with empty brackets", token_range_make(checkpoint.rewind_token_index, parser->index));
@@ -929,7 +967,7 @@ bool ast_parser_parse_single_statement_expression(AST_Parser* parser, int parent
         }
         if (ast_parser_test_next_token(parser, Token_Type::OPEN_BRACKETS))
         {
-            parser->nodes[node_index].type = AST_Node_Type::EXPRESSION_NEW_ARRAY;
+            parser->node_types[node_index] = AST_Node_Type::EXPRESSION_NEW_ARRAY;
             parser->index++;
             if (!ast_parser_parse_expression(parser, node_index)) {
                 ast_parser_log_error(parser, "Invalid array-size expression in new", token_range_make(checkpoint.rewind_token_index, parser->index));
@@ -968,8 +1006,7 @@ bool ast_parser_parse_expression(AST_Parser* parser, int parent_index)
         return false;
     }
 
-    dynamic_array_push_back(&parser->nodes[parent_index].children, op_tree_root_index);
-    parser->nodes[op_tree_root_index].parent = parent_index;
+    ast_parser_add_parent_child_connection(parser, parent_index, op_tree_root_index);
     return true;
 }
 
@@ -988,7 +1025,7 @@ bool ast_parser_parse_single_statement_or_block(AST_Parser* parser, AST_Node_Ind
         ast_parser_checkpoint_reset(checkpoint);
         return false;
     }
-    parser->nodes[node_index].type = AST_Node_Type::STATEMENT_BLOCK;
+    parser->node_types[node_index] = AST_Node_Type::STATEMENT_BLOCK;
     parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
 
     return true;
@@ -1006,8 +1043,8 @@ bool ast_parser_parse_single_variable_definition(AST_Parser* parser, AST_Node_In
             return false;
         }
         if (ast_parser_test_next_token(parser, Token_Type::SEMICOLON)) {
-            parser->nodes[node_index].type = AST_Node_Type::STATEMENT_VARIABLE_DEFINITION;
-            parser->nodes[node_index].name_id = parser->lexer->tokens[checkpoint.rewind_token_index].attribute.identifier_number;
+            parser->node_types[node_index] = AST_Node_Type::STATEMENT_VARIABLE_DEFINITION;
+            parser->node_name_ids[node_index] = parser->lexer->tokens[checkpoint.rewind_token_index].attribute.identifier_number;
             parser->index += 1;
             parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
             return true;
@@ -1035,8 +1072,8 @@ bool ast_parser_parse_variable_creation_statement(AST_Parser* parser, AST_Node_I
         }
         if (ast_parser_test_next_token(parser, Token_Type::OP_ASSIGNMENT))
         {
-            parser->nodes[node_index].type = AST_Node_Type::STATEMENT_VARIABLE_DEFINE_ASSIGN;
-            parser->nodes[node_index].name_id = parser->lexer->tokens[checkpoint.rewind_token_index].attribute.identifier_number;
+            parser->node_types[node_index] = AST_Node_Type::STATEMENT_VARIABLE_DEFINE_ASSIGN;
+            parser->node_name_ids[node_index] = parser->lexer->tokens[checkpoint.rewind_token_index].attribute.identifier_number;
             parser->index += 1;
             if (!ast_parser_parse_expression(parser, node_index)) {
                 ast_parser_checkpoint_reset(checkpoint);
@@ -1058,8 +1095,8 @@ bool ast_parser_parse_variable_creation_statement(AST_Parser* parser, AST_Node_I
 
     if (ast_parser_test_next_2_tokens(parser, Token_Type::IDENTIFIER, Token_Type::INFER_ASSIGN))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_VARIABLE_DEFINE_INFER;
-        parser->nodes[node_index].name_id = parser->lexer->tokens[parser->index].attribute.identifier_number;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_VARIABLE_DEFINE_INFER;
+        parser->node_name_ids[node_index] = parser->lexer->tokens[parser->index].attribute.identifier_number;
         parser->index += 2;
         if (!ast_parser_parse_expression(parser, node_index)) {
             ast_parser_checkpoint_reset(checkpoint);
@@ -1094,10 +1131,10 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
     if (ast_parser_parse_expression(parser, node_index))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_EXPRESSION;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_EXPRESSION;
         if (ast_parser_test_next_token(parser, Token_Type::OP_ASSIGNMENT))
         {
-            parser->nodes[node_index].type = AST_Node_Type::STATEMENT_ASSIGNMENT;
+            parser->node_types[node_index] = AST_Node_Type::STATEMENT_ASSIGNMENT;
             parser->index++;
             if (!ast_parser_parse_expression(parser, node_index)) {
                 ast_parser_checkpoint_reset(checkpoint);
@@ -1118,7 +1155,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
     {
         parser->index++;
         if (ast_parser_parse_single_statement_or_block(parser, node_index)) {
-            parser->nodes[node_index].type = AST_Node_Type::STATEMENT_DEFER;
+            parser->node_types[node_index] = AST_Node_Type::STATEMENT_DEFER;
             parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
             return true;
         }
@@ -1129,7 +1166,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
     if (ast_parser_test_next_token(parser, Token_Type::DELETE_TOKEN))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_DELETE;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_DELETE;
         parser->index++;
         if (!ast_parser_parse_expression(parser, node_index)) {
             ast_parser_log_error(parser, "Invalid expression after delete", token_range_make(checkpoint.rewind_token_index, parser->index));
@@ -1149,7 +1186,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
     if (ast_parser_test_next_token(parser, Token_Type::IF))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_IF;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_IF;
         parser->index++;
         if (!ast_parser_parse_expression(parser, node_index)) {
             ast_parser_checkpoint_reset(checkpoint);
@@ -1162,7 +1199,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
         if (ast_parser_test_next_token(parser, Token_Type::ELSE))
         {
-            parser->nodes[node_index].type = AST_Node_Type::STATEMENT_IF_ELSE;
+            parser->node_types[node_index] = AST_Node_Type::STATEMENT_IF_ELSE;
             parser->index++;
             if (!ast_parser_parse_single_statement_or_block(parser, node_index)) {
                 ast_parser_checkpoint_reset(checkpoint);
@@ -1175,7 +1212,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
     if (ast_parser_test_next_token(parser, Token_Type::WHILE))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_WHILE;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_WHILE;
         parser->index++;
         if (!ast_parser_parse_expression(parser, node_index)) {
             ast_parser_checkpoint_reset(checkpoint);
@@ -1191,7 +1228,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
     if (ast_parser_test_next_2_tokens(parser, Token_Type::BREAK, Token_Type::SEMICOLON))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_BREAK;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_BREAK;
         parser->index += 2;
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return true;
@@ -1199,7 +1236,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
     if (ast_parser_test_next_2_tokens(parser, Token_Type::CONTINUE, Token_Type::SEMICOLON))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_CONTINUE;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_CONTINUE;
         parser->index += 2;
         parser->token_mapping[node_index] = token_range_make(checkpoint.rewind_token_index, parser->index);
         return true;
@@ -1207,7 +1244,7 @@ bool ast_parser_parse_statement(AST_Parser* parser, AST_Node_Index parent_index)
 
     if (ast_parser_test_next_token(parser, Token_Type::RETURN))
     {
-        parser->nodes[node_index].type = AST_Node_Type::STATEMENT_RETURN;
+        parser->node_types[node_index] = AST_Node_Type::STATEMENT_RETURN;
         parser->index++;
         if (ast_parser_test_next_token(parser, Token_Type::SEMICOLON)) {
             parser->index++;
@@ -1239,7 +1276,7 @@ bool ast_parser_parse_statement_block(AST_Parser* parser, AST_Node_Index parent_
     AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, parent_index);
     int node_index = ast_parser_get_next_node_index(parser, parent_index);
 
-    parser->nodes[node_index].type = AST_Node_Type::STATEMENT_BLOCK;
+    parser->node_types[node_index] = AST_Node_Type::STATEMENT_BLOCK;
     if (!ast_parser_test_next_token(parser, Token_Type::OPEN_BRACES)) {
         ast_parser_checkpoint_reset(checkpoint);
         return false;
@@ -1278,7 +1315,7 @@ bool ast_parser_parse_statement_block(AST_Parser* parser, AST_Node_Index parent_
     parser->index++;
 
     parser->token_mapping[node_index] = token_range_make(start_token_index, parser->index);
-    if (parser->nodes[node_index].type != AST_Node_Type::STATEMENT_BLOCK) {
+    if (parser->node_types[node_index] != AST_Node_Type::STATEMENT_BLOCK) {
         logg("Wath");
     }
     if (parser->token_mapping[node_index].start_index == 0) {
@@ -1293,10 +1330,10 @@ bool ast_parser_parse_parameter_block(AST_Parser* parser, AST_Node_Index parent_
     int block_index = ast_parser_get_next_node_index(parser, parent_index);
 
     if (is_named_parameter_block) {
-        parser->nodes[block_index].type = AST_Node_Type::PARAMETER_BLOCK_NAMED;
+        parser->node_types[block_index] = AST_Node_Type::PARAMETER_BLOCK_NAMED;
     }
     else {
-        parser->nodes[block_index].type = AST_Node_Type::PARAMETER_BLOCK_UNNAMED;
+        parser->node_types[block_index] = AST_Node_Type::PARAMETER_BLOCK_UNNAMED;
     }
 
     if (!ast_parser_test_next_token(parser, Token_Type::OPEN_PARENTHESIS)) {
@@ -1323,8 +1360,8 @@ bool ast_parser_parse_parameter_block(AST_Parser* parser, AST_Node_Index parent_
                 success = ast_parser_parse_type(parser, parameter_index);
                 if (success)
                 {
-                    parser->nodes[parameter_index].type = AST_Node_Type::NAMED_PARAMETER;
-                    parser->nodes[parameter_index].name_id = parser->lexer->tokens[recoverable_checkpoint.rewind_token_index].attribute.identifier_number;
+                    parser->node_types[parameter_index] = AST_Node_Type::NAMED_PARAMETER;
+                    parser->node_name_ids[parameter_index] = parser->lexer->tokens[recoverable_checkpoint.rewind_token_index].attribute.identifier_number;
                     parser->token_mapping[parameter_index].start_index = recoverable_checkpoint.rewind_token_index;
                     parser->token_mapping[parameter_index].end_index = parser->index;
                 }
@@ -1408,14 +1445,14 @@ bool ast_parser_parse_struct(AST_Parser* parser, AST_Node_Index parent_index)
 {
     AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, parent_index);
     int node_index = ast_parser_get_next_node_index(parser, parent_index);
-    parser->nodes[node_index].type = AST_Node_Type::STRUCT;
+    parser->node_types[node_index] = AST_Node_Type::STRUCT;
 
     // Parse Struct name
     if (!ast_parser_test_next_4_tokens(parser, Token_Type::IDENTIFIER, Token_Type::DOUBLE_COLON, Token_Type::STRUCT, Token_Type::OPEN_BRACES)) {
         ast_parser_checkpoint_reset(checkpoint);
         return false;
     }
-    parser->nodes[node_index].name_id = parser->lexer->tokens[parser->index].attribute.identifier_number;
+    parser->node_name_ids[node_index] = parser->lexer->tokens[parser->index].attribute.identifier_number;
     parser->index += 4;
     ast_parser_parse_struct_members(parser, node_index);
 
@@ -1432,14 +1469,14 @@ bool ast_parser_parse_function(AST_Parser* parser, AST_Node_Index parent_index)
 {
     AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, parent_index);
     int node_index = ast_parser_get_next_node_index(parser, parent_index);
-    parser->nodes[node_index].type = AST_Node_Type::FUNCTION;
+    parser->node_types[node_index] = AST_Node_Type::FUNCTION;
 
     // Parse Function start
     if (!ast_parser_test_next_2_tokens(parser, Token_Type::IDENTIFIER, Token_Type::DOUBLE_COLON)) {
         ast_parser_checkpoint_reset(checkpoint);
         return false;
     }
-    parser->nodes[node_index].name_id = parser->lexer->tokens[parser->index].attribute.identifier_number;
+    parser->node_name_ids[node_index] = parser->lexer->tokens[parser->index].attribute.identifier_number;
     parser->index += 2;
 
     if (!ast_parser_parse_function_signature(parser, node_index)) {
@@ -1464,8 +1501,8 @@ bool ast_parser_parse_module(AST_Parser* parser, int parent)
     }
     parser->index += 3;
     int node_index = ast_parser_get_next_node_index(parser, parent);
-    parser->nodes[node_index].name_id = parser->lexer->tokens[parser->index - 2].attribute.identifier_number;
-    parser->nodes[node_index].type = AST_Node_Type::MODULE;
+    parser->node_name_ids[node_index] = parser->lexer->tokens[parser->index - 2].attribute.identifier_number;
+    parser->node_types[node_index] = AST_Node_Type::MODULE;
 
     while (parser->index < parser->lexer->tokens.size)
     {
@@ -1497,44 +1534,60 @@ bool ast_parser_parse_module(AST_Parser* parser, int parent)
     return true;
 }
 
+bool ast_parser_parse_root_declaration(AST_Parser* parser, AST_Node_Index root_index)
+{
+    AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, root_index);
+    if (ast_parser_parse_function(parser, root_index)) {
+        return true;
+    }
+    else {
+        ast_parser_checkpoint_reset(checkpoint);
+    }
+    if (ast_parser_parse_struct(parser, root_index)) {
+        return true;
+    }
+    else {
+        ast_parser_checkpoint_reset(checkpoint);
+    }
+    if (ast_parser_parse_variable_creation_statement(parser, root_index)) {
+        return true;
+    }
+    else {
+        ast_parser_checkpoint_reset(checkpoint);
+    }
+    if (ast_parser_parse_module(parser, root_index)) {
+        return true;
+    }
+    else {
+        ast_parser_checkpoint_reset(checkpoint);
+    }
+
+    // TODO: Better error handling: Skip through each line (not in parenthesis) and try parsing function or struct
+    int next_closing_braces = ast_parser_find_parenthesis_ending(parser, Token_Type::OPEN_BRACES, Token_Type::CLOSED_BRACES);
+    ast_parser_checkpoint_reset(checkpoint);
+    ast_parser_log_error(parser, "Could not parse function", token_range_make(parser->index, next_closing_braces));
+    parser->index = next_closing_braces + 1;
+    return false;
+}
+
+// Parses one top level declaration at parser->index, or skips to the next closing braces on errors
+void ast_parser_parse_root_item(AST_Parser* parser, AST_Node_Index root_index)
+{
+    AST_Root_Item_Info info;
+    info.error_start_index = parser->errors.size;
+    if (ast_parser_parse_root_declaration(parser, root_index)) {
+        info.error_end_index = parser->errors.size;
+        info.furthest_token_read = parser->furthest_token_read;
+        dynamic_array_push_back(&parser->root_items, info);
+    }
+}
+
 void ast_parser_parse_root(AST_Parser* parser)
 {
     int root_index = ast_parser_get_next_node_index(parser, -1);
-    parser->nodes[root_index].type = AST_Node_Type::ROOT;
-    while (true)
-    {
-        AST_Parser_Checkpoint checkpoint = ast_parser_checkpoint_make(parser, root_index);
-        if (parser->index >= parser->lexer->tokens.size) break;
-        if (ast_parser_parse_function(parser, root_index)) {
-            continue;
-        }
-        else {
-            ast_parser_checkpoint_reset(checkpoint);
-        }
-        if (ast_parser_parse_struct(parser, root_index)) {
-            continue;
-        }
-        else {
-            ast_parser_checkpoint_reset(checkpoint);
-        }
-        if (ast_parser_parse_variable_creation_statement(parser, root_index)) {
-            continue;
-        }
-        else {
-            ast_parser_checkpoint_reset(checkpoint);
-        }
-        if (ast_parser_parse_module(parser, root_index)) {
-            continue;
-        }
-        else {
-            ast_parser_checkpoint_reset(checkpoint);
-        }
-
-        // TODO: Better error handling: Skip through each line (not in parenthesis) and try parsing function or struct
-        int next_closing_braces = ast_parser_find_parenthesis_ending(parser, Token_Type::OPEN_BRACES, Token_Type::CLOSED_BRACES);
-        ast_parser_checkpoint_reset(checkpoint);
-        ast_parser_log_error(parser, "Could not parse function", token_range_make(parser->index, next_closing_braces));
-        parser->index = next_closing_braces + 1;
+    parser->node_types[root_index] = AST_Node_Type::ROOT;
+    while (parser->index < parser->lexer->tokens.size) {
+        ast_parser_parse_root_item(parser, root_index);
     }
     parser->token_mapping[root_index].start_index = 0;
     parser->token_mapping[root_index].end_index = math_maximum(0, parser->lexer->tokens.size - 1);
@@ -1544,10 +1597,23 @@ AST_Parser ast_parser_create()
 {
     AST_Parser parser;
     parser.index = 0;
-    parser.nodes = dynamic_array_create_empty<AST_Node>(1024);
+    parser.node_types = dynamic_array_create_empty<AST_Node_Type>(1024);
+    parser.node_parents = dynamic_array_create_empty<AST_Node_Index>(1024);
+    parser.node_name_ids = dynamic_array_create_empty<int>(1024);
+    parser.node_first_child = dynamic_array_create_empty<int>(1024);
+    parser.node_child_counts = dynamic_array_create_empty<int>(1024);
+    parser.child_buffer = dynamic_array_create_empty<AST_Node_Index>(1024);
+    parser.link_first_child = dynamic_array_create_empty<AST_Node_Index>(1024);
+    parser.link_last_child = dynamic_array_create_empty<AST_Node_Index>(1024);
+    parser.link_next_sibling = dynamic_array_create_empty<AST_Node_Index>(1024);
     parser.token_mapping = dynamic_array_create_empty<Token_Range>(1024);
     parser.errors = dynamic_array_create_empty<Compiler_Error>(64);
+    parser.root_items = dynamic_array_create_empty<AST_Root_Item_Info>(64);
     parser.next_free_node = 0;
+    parser.detached_node_count = 0;
+    parser.furthest_token_read = -1;
+    parser.parse_generation = 0;
+    parser.lexer = 0;
     return parser;
 }
 
@@ -1559,16 +1625,16 @@ void ast_parser_check_sanity(AST_Parser* parser)
     count = 0;
 
     // Check parent indices
-    for (int i = 0; i < parser->nodes.size; i++)
+    for (int i = 0; i < parser->node_types.size; i++)
     {
-        int parent_index = parser->nodes[i].parent;
+        int parent_index = parser->node_parents[i];
         if (parent_index == -1) {
-            if (parser->nodes[i].type == AST_Node_Type::ROOT) {
+            if (parser->node_types[i] == AST_Node_Type::ROOT) {
                 continue;
             }
             panic("Should not happen");
         }
-        if (parent_index < 0 || parent_index >= parser->nodes.size) {
+        if (parent_index < 0 || parent_index >= parser->node_types.size) {
             panic("Should not happen");
         }
     }
@@ -1581,15 +1647,15 @@ void ast_parser_check_sanity(AST_Parser* parser)
         if (parser->lexer->tokens.size != 0)
         {
             if (start < 0 || end < 0 || start >= parser->lexer->tokens.size || end > parser->lexer->tokens.size) {
-                AST_Node* node = &parser->nodes[i];
+                AST_Node node = ast_parser_get_node(parser, i);
                 logg("Should not happen: range: %d-%d, index: %d\n", start, end, i);
                 panic("Should not happen!");
             }
             if (start == end) {
-                AST_Node* node = &parser->nodes[i];
-                if (node->type != AST_Node_Type::ROOT) {
+                AST_Node node = ast_parser_get_node(parser, i);
+                if (node.type != AST_Node_Type::ROOT) {
                     logg("Should not happen: range: %d-%d, index: %d\n", start, end, i);
-                    logg("Node_Type::%s\n", ast_node_type_to_string(node->type).characters);
+                    logg("Node_Type::%s\n", ast_node_type_to_string(node.type).characters);
                     panic("Should not happen!");
                 }
             }
@@ -1597,21 +1663,21 @@ void ast_parser_check_sanity(AST_Parser* parser)
     }
 
     // Check child types of nodes
-    for (int j = 0; j < parser->nodes.size; j++)
+    for (int j = 0; j < parser->node_types.size; j++)
     {
-        AST_Node* node = &parser->nodes[j];
-        for (int i = 0; i < node->children.size; i++) {
-            int index = node->children[i];
-            if (index < 0 || index >= parser->nodes.size) {
+        AST_Node node = ast_parser_get_node(parser, j);
+        for (int i = 0; i < node.children.size; i++) {
+            int index = node.children[i];
+            if (index < 0 || index >= parser->node_types.size) {
                 panic("Should not happen\n");
             }
         }
-        switch (node->type)
+        switch (node.type)
         {
         case AST_Node_Type::ROOT:
-            for (int i = 0; i < node->children.size; i++)
+            for (int i = 0; i < node.children.size; i++)
             {
-                AST_Node_Type child_type = parser->nodes[node->children[i]].type;
+                AST_Node_Type child_type = parser->node_types[node.children[i]];
                 if (child_type != AST_Node_Type::FUNCTION &&
                     child_type != AST_Node_Type::STRUCT &&
                     child_type != AST_Node_Type::MODULE &&
@@ -1624,9 +1690,9 @@ void ast_parser_check_sanity(AST_Parser* parser)
             }
             break;
         case AST_Node_Type::MODULE:
-            for (int i = 0; i < node->children.size; i++)
+            for (int i = 0; i < node.children.size; i++)
             {
-                AST_Node_Type child_type = parser->nodes[node->children[i]].type;
+                AST_Node_Type child_type = parser->node_types[node.children[i]];
                 if (child_type != AST_Node_Type::FUNCTION &&
                     child_type != AST_Node_Type::STRUCT &&
                     child_type != AST_Node_Type::MODULE &&
@@ -1639,82 +1705,82 @@ void ast_parser_check_sanity(AST_Parser* parser)
             }
             break;
         case AST_Node_Type::STRUCT:
-            for (int i = 0; i < node->children.size; i++) {
-                AST_Node_Type child_type = parser->nodes[node->children[i]].type;
+            for (int i = 0; i < node.children.size; i++) {
+                AST_Node_Type child_type = parser->node_types[node.children[i]];
                 if (child_type != AST_Node_Type::STATEMENT_VARIABLE_DEFINITION) {
                     panic("Should not happen");
                 }
             }
             break;
         case AST_Node_Type::IDENTIFIER:
-            if (node->children.size != 0) {
+            if (node.children.size != 0) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::IDENTIFIER_PATH:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (parser->nodes[node->children[0]].type != AST_Node_Type::IDENTIFIER &&
-                parser->nodes[node->children[0]].type != AST_Node_Type::IDENTIFIER_PATH) {
+            if (parser->node_types[node.children[0]] != AST_Node_Type::IDENTIFIER &&
+                parser->node_types[node.children[0]] != AST_Node_Type::IDENTIFIER_PATH) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::FUNCTION:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (parser->nodes[node->children[0]].type != AST_Node_Type::FUNCTION_SIGNATURE ||
-                parser->nodes[node->children[1]].type != AST_Node_Type::STATEMENT_BLOCK) {
+            if (parser->node_types[node.children[0]] != AST_Node_Type::FUNCTION_SIGNATURE ||
+                parser->node_types[node.children[1]] != AST_Node_Type::STATEMENT_BLOCK) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::PARAMETER_BLOCK_NAMED:
-            for (int i = 0; i < node->children.size; i++) {
-                AST_Node_Type child_type = parser->nodes[node->children[i]].type;
+            for (int i = 0; i < node.children.size; i++) {
+                AST_Node_Type child_type = parser->node_types[node.children[i]];
                 if (child_type != AST_Node_Type::NAMED_PARAMETER) {
                     panic("Should not happen");
                 }
             }
             break;
         case AST_Node_Type::PARAMETER_BLOCK_UNNAMED:
-            for (int i = 0; i < node->children.size; i++) {
-                AST_Node_Type child_type = parser->nodes[node->children[i]].type;
+            for (int i = 0; i < node.children.size; i++) {
+                AST_Node_Type child_type = parser->node_types[node.children[i]];
                 if (!ast_node_type_is_type(child_type)) {
                     panic("Should not happen");
                 }
             }
             break;
         case AST_Node_Type::FUNCTION_SIGNATURE:
-            if (node->children.size != 1 && node->children.size != 2) {
+            if (node.children.size != 1 && node.children.size != 2) {
                 panic("Should not happen");
             }
             {
-                AST_Node* child = &parser->nodes[node->children[0]];
-                if (child->type != AST_Node_Type::PARAMETER_BLOCK_NAMED) {
+                AST_Node child = ast_parser_get_node(parser, node.children[0]);
+                if (child.type != AST_Node_Type::PARAMETER_BLOCK_NAMED) {
                     panic("Should not happen");
                 }
             }
-            if (node->children.size == 2) {
-                AST_Node* child = &parser->nodes[node->children[1]];
-                if (!ast_node_type_is_type(child->type)) {
+            if (node.children.size == 2) {
+                AST_Node child = ast_parser_get_node(parser, node.children[1]);
+                if (!ast_node_type_is_type(child.type)) {
                     panic("Should not happen");
                 }
             }
             break;
         case AST_Node_Type::TYPE_FUNCTION_POINTER:
-            if (node->children.size != 1 && node->children.size != 2) {
+            if (node.children.size != 1 && node.children.size != 2) {
                 panic("Should not happen");
             }
             {
-                AST_Node* child = &parser->nodes[node->children[0]];
-                if (child->type != AST_Node_Type::PARAMETER_BLOCK_UNNAMED) {
+                AST_Node child = ast_parser_get_node(parser, node.children[0]);
+                if (child.type != AST_Node_Type::PARAMETER_BLOCK_UNNAMED) {
                     panic("Should not happen");
                 }
             }
-            if (node->children.size == 2) {
-                AST_Node* child = &parser->nodes[node->children[1]];
-                if (!ast_node_type_is_type(child->type)) {
+            if (node.children.size == 2) {
+                AST_Node child = ast_parser_get_node(parser, node.children[1]);
+                if (!ast_node_type_is_type(child.type)) {
                     panic("Should not happen");
                 }
             }
@@ -1722,24 +1788,24 @@ void ast_parser_check_sanity(AST_Parser* parser)
         case AST_Node_Type::TYPE_ARRAY_UNSIZED:
         case AST_Node_Type::TYPE_POINTER_TO:
         case AST_Node_Type::NAMED_PARAMETER:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_type(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_type(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::TYPE_ARRAY_SIZED:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_BLOCK:
-            for (int i = 0; i < node->children.size; i++) {
-                AST_Node_Type child_type = parser->nodes[node->children[i]].type;
+            for (int i = 0; i < node.children.size; i++) {
+                AST_Node_Type child_type = parser->node_types[node.children[i]];
                 if (!ast_node_type_is_statement(child_type)) {
                     panic("Should not happen");
                 }
@@ -1747,45 +1813,45 @@ void ast_parser_check_sanity(AST_Parser* parser)
             break;
         case AST_Node_Type::STATEMENT_WHILE:
         case AST_Node_Type::STATEMENT_IF:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (parser->nodes[node->children[1]].type != AST_Node_Type::STATEMENT_BLOCK) {
+            if (parser->node_types[node.children[1]] != AST_Node_Type::STATEMENT_BLOCK) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_IF_ELSE:
-            if (node->children.size != 3) {
+            if (node.children.size != 3) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (parser->nodes[node->children[1]].type != AST_Node_Type::STATEMENT_BLOCK) {
+            if (parser->node_types[node.children[1]] != AST_Node_Type::STATEMENT_BLOCK) {
                 panic("Should not happen");
             }
-            if (parser->nodes[node->children[2]].type != AST_Node_Type::STATEMENT_BLOCK) {
+            if (parser->node_types[node.children[2]] != AST_Node_Type::STATEMENT_BLOCK) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_DEFER:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (parser->nodes[node->children[0]].type != AST_Node_Type::STATEMENT_BLOCK) {
+            if (parser->node_types[node.children[0]] != AST_Node_Type::STATEMENT_BLOCK) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_BREAK:
         case AST_Node_Type::STATEMENT_CONTINUE:
         case AST_Node_Type::TYPE_IDENTIFIER: {
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            AST_Node_Type child_type = parser->nodes[node->children[0]].type;
+            AST_Node_Type child_type = parser->node_types[node.children[0]];
             if (child_type != AST_Node_Type::IDENTIFIER && child_type != AST_Node_Type::IDENTIFIER_PATH) {
                 panic("Should not happen");
             }
@@ -1793,99 +1859,99 @@ void ast_parser_check_sanity(AST_Parser* parser)
         }
         case AST_Node_Type::STATEMENT_EXPRESSION:
         case AST_Node_Type::STATEMENT_RETURN:
-            if (node->children.size == 0) return;
-            if (node->children.size != 1) {
+            if (node.children.size == 0) return;
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_ASSIGNMENT:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[1]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[1]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_VARIABLE_DEFINITION:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_type(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_type(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_VARIABLE_DEFINE_ASSIGN:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_type(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_type(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[1]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[1]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_VARIABLE_DEFINE_INFER:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::STATEMENT_DELETE:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::ARGUMENTS: {
-            for (int i = 0; i < node->children.size; i++) {
-                if (!ast_node_type_is_expression(parser->nodes[node->children[i]].type)) {
+            for (int i = 0; i < node.children.size; i++) {
+                if (!ast_node_type_is_expression(parser->node_types[node.children[i]])) {
                     panic("Should not happen");
                 }
             }
             break;
         }
         case AST_Node_Type::EXPRESSION_NEW:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_type(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_type(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::EXPRESSION_NEW_ARRAY:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_type(parser->nodes[node->children[1]].type)) {
+            if (!ast_node_type_is_type(parser->node_types[node.children[1]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::EXPRESSION_LITERAL:
-            if (node->children.size != 0) {
+            if (node.children.size != 0) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::EXPRESSION_FUNCTION_CALL:
         {
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            AST_Node_Type child_type_0 = parser->nodes[node->children[0]].type;
-            AST_Node_Type child_type_1 = parser->nodes[node->children[1]].type;
+            AST_Node_Type child_type_0 = parser->node_types[node.children[0]];
+            AST_Node_Type child_type_1 = parser->node_types[node.children[1]];
             if (child_type_0 != AST_Node_Type::IDENTIFIER && child_type_0 != AST_Node_Type::IDENTIFIER_PATH) {
                 panic("Should not happen");
             }
@@ -1895,41 +1961,41 @@ void ast_parser_check_sanity(AST_Parser* parser)
             break;
         }
         case AST_Node_Type::EXPRESSION_VARIABLE_READ:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (parser->nodes[node->children[0]].type != AST_Node_Type::IDENTIFIER &&
-                parser->nodes[node->children[0]].type != AST_Node_Type::IDENTIFIER_PATH) {
+            if (parser->node_types[node.children[0]] != AST_Node_Type::IDENTIFIER &&
+                parser->node_types[node.children[0]] != AST_Node_Type::IDENTIFIER_PATH) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::EXPRESSION_ARRAY_ACCESS:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[1]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[1]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::EXPRESSION_MEMBER_ACCESS:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
         case AST_Node_Type::EXPRESSION_CAST:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_type(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_type(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[1]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[1]])) {
                 panic("Should not happen");
             }
             break;
@@ -1946,13 +2012,13 @@ void ast_parser_check_sanity(AST_Parser* parser)
         case AST_Node_Type::EXPRESSION_BINARY_OPERATION_LESS_OR_EQUAL:
         case AST_Node_Type::EXPRESSION_BINARY_OPERATION_GREATER:
         case AST_Node_Type::EXPRESSION_BINARY_OPERATION_GREATER_OR_EQUAL:
-            if (node->children.size != 2) {
+            if (node.children.size != 2) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[1]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[1]])) {
                 panic("Should not happen");
             }
             break;
@@ -1960,10 +2026,10 @@ void ast_parser_check_sanity(AST_Parser* parser)
         case AST_Node_Type::EXPRESSION_UNARY_OPERATION_NOT:
         case AST_Node_Type::EXPRESSION_UNARY_OPERATION_ADDRESS_OF:
         case AST_Node_Type::EXPRESSION_UNARY_OPERATION_DEREFERENCE:
-            if (node->children.size != 1) {
+            if (node.children.size != 1) {
                 panic("Should not happen");
             }
-            if (!ast_node_type_is_expression(parser->nodes[node->children[0]].type)) {
+            if (!ast_node_type_is_expression(parser->node_types[node.children[0]])) {
                 panic("Should not happen");
             }
             break;
@@ -1977,35 +2043,202 @@ void ast_parser_check_sanity(AST_Parser* parser)
     }
 }
 
+void ast_parser_rollback_to_node_count(AST_Parser* parser, int node_count)
+{
+    dynamic_array_rollback_to_size(&parser->node_types, node_count);
+    dynamic_array_rollback_to_size(&parser->node_parents, node_count);
+    dynamic_array_rollback_to_size(&parser->node_name_ids, node_count);
+    dynamic_array_rollback_to_size(&parser->node_first_child, node_count);
+    dynamic_array_rollback_to_size(&parser->node_child_counts, node_count);
+    dynamic_array_rollback_to_size(&parser->link_first_child, node_count);
+    dynamic_array_rollback_to_size(&parser->link_last_child, node_count);
+    dynamic_array_rollback_to_size(&parser->link_next_sibling, node_count);
+    dynamic_array_rollback_to_size(&parser->token_mapping, node_count);
+}
+
+void ast_parser_flatten_children_recursive(AST_Parser* parser, AST_Node_Index node_index)
+{
+    for (AST_Node_Index child = parser->link_first_child[node_index]; child != -1; child = parser->link_next_sibling[child]) {
+        ast_parser_flatten_children_recursive(parser, child);
+    }
+    parser->node_first_child[node_index] = parser->child_buffer.size;
+    for (AST_Node_Index child = parser->link_first_child[node_index]; child != -1; child = parser->link_next_sibling[child]) {
+        dynamic_array_push_back(&parser->child_buffer, child);
+    }
+}
+
+// Copies the child lists into child_buffer, detached nodes are not reachable from the root and have no children
+void ast_parser_flatten_children(AST_Parser* parser)
+{
+    dynamic_array_reset(&parser->child_buffer);
+    dynamic_array_reserve(&parser->child_buffer, parser->node_types.size);
+    if (parser->node_types.size > 0) {
+        ast_parser_flatten_children_recursive(parser, 0);
+    }
+}
+
+AST_Node ast_parser_get_node(AST_Parser* parser, AST_Node_Index node_index)
+{
+    AST_Node node;
+    node.type = parser->node_types[node_index];
+    node.parent = parser->node_parents[node_index];
+    node.name_id = parser->node_name_ids[node_index];
+    node.children.data = &parser->child_buffer.data[parser->node_first_child[node_index]];
+    node.children.size = parser->node_child_counts[node_index];
+    return node;
+}
+
 void ast_parser_parse(AST_Parser* parser, Lexer* lexer)
 {
     parser->index = 0;
     parser->next_free_node = 0;
+    parser->detached_node_count = 0;
+    parser->furthest_token_read = -1;
+    parser->parse_generation++;
     parser->lexer = lexer;
     dynamic_array_reset(&parser->errors);
-    for (int i = 0; i < parser->nodes.size; i++) {
-        dynamic_array_destroy(&parser->nodes[i].children);
-    }
-    dynamic_array_reset(&parser->nodes);
-    dynamic_array_reset(&parser->token_mapping);
+    dynamic_array_reset(&parser->root_items);
+    ast_parser_rollback_to_node_count(parser, 0);
 
     ast_parser_parse_root(parser);
-    for (int i = parser->next_free_node; i < parser->nodes.size; i++) {
-        dynamic_array_destroy(&parser->nodes[i].children);
-    }
-    dynamic_array_rollback_to_size(&parser->nodes, parser->next_free_node);
-    dynamic_array_rollback_to_size(&parser->token_mapping, parser->next_free_node);
+    ast_parser_rollback_to_node_count(parser, parser->next_free_node);
+    ast_parser_flatten_children(parser);
 
     ast_parser_check_sanity(parser);
 }
 
-void ast_parser_destroy(AST_Parser* parser)
+void ast_parser_detach_subtree(AST_Parser* parser, AST_Node_Index node_index)
+{
+    for (AST_Node_Index child = parser->link_first_child[node_index]; child != -1; child = parser->link_next_sibling[child]) {
+        ast_parser_detach_subtree(parser, child);
+    }
+    parser->node_types[node_index] = AST_Node_Type::UNDEFINED;
+    parser->node_parents[node_index] = -1;
+    parser->node_child_counts[node_index] = 0;
+    parser->link_first_child[node_index] = -1;
+    parser->link_last_child[node_index] = -1;
+    parser->detached_node_count++;
+}
+
+void ast_parser_shift_subtree_tokens(AST_Parser* parser, AST_Node_Index node_index, int token_offset)
 {
-    for (int i = 0; i < parser->nodes.size; i++) {
-        dynamic_array_destroy(&parser->nodes[i].children);
+    Token_Range* range = &parser->token_mapping[node_index];
+    range->start_index += token_offset;
+    range->end_index += token_offset;
+    for (AST_Node_Index child = parser->link_first_child[node_index]; child != -1; child = parser->link_next_sibling[child]) {
+        ast_parser_shift_subtree_tokens(parser, child, token_offset);
+    }
+}
+
+void ast_parser_parse_incremental(AST_Parser* parser, Lexer* lexer, Token_Change change)
+{
+    // Reused nodes keep their index, so detached nodes accumulate in the pool until the next full parse
+    if (parser->lexer != lexer || parser->node_types.size == 0 || parser->detached_node_count > parser->node_types.size / 2) {
+        ast_parser_parse(parser, lexer);
+        return;
+    }
+
+    int token_offset = change.new_end_index - change.old_end_index;
+    AST_Node_Index root_index = 0;
+    Dynamic_Array<AST_Node_Index> old_items = dynamic_array_create_empty<AST_Node_Index>(math_maximum(parser->node_child_counts[root_index], 1));
+    for (AST_Node_Index child = parser->link_first_child[root_index]; child != -1; child = parser->link_next_sibling[child]) {
+        dynamic_array_push_back(&old_items, child);
+    }
+    ast_parser_remove_children_after(parser, root_index, 0);
+    Dynamic_Array<AST_Root_Item_Info> old_item_infos = parser->root_items;
+    parser->root_items = dynamic_array_create_empty<AST_Root_Item_Info>(math_maximum(old_items.size, 1));
+    SCOPE_EXIT(dynamic_array_destroy(&old_items));
+    SCOPE_EXIT(dynamic_array_destroy(&old_item_infos));
+
+    // furthest_token_read is accumulated over the whole parse, so it also covers failed attempts before each declaration
+    int reparse_start_token = 0;
+    int kept_error_count = 0;
+    parser->furthest_token_read = -1;
+    int first_changed_item = 0;
+    while (first_changed_item < old_items.size) {
+        AST_Root_Item_Info info = old_item_infos[first_changed_item];
+        if (info.furthest_token_read >= change.start_index) break;
+        ast_parser_add_parent_child_connection(parser, root_index, old_items[first_changed_item]);
+        dynamic_array_push_back(&parser->root_items, info);
+        reparse_start_token = parser->token_mapping[old_items[first_changed_item]].end_index;
+        kept_error_count = info.error_end_index;
+        parser->furthest_token_read = info.furthest_token_read;
+        first_changed_item++;
+    }
+
+    // Errors are ordered by the root item that logged them, so the errors of reused items are a prefix and a suffix
+    Dynamic_Array<Compiler_Error> old_errors = parser->errors;
+    parser->errors = dynamic_array_create_empty<Compiler_Error>(math_maximum(old_errors.size, 64));
+    SCOPE_EXIT(dynamic_array_destroy(&old_errors));
+    for (int i = 0; i < kept_error_count; i++) {
+        dynamic_array_push_back(&parser->errors, old_errors[i]);
+    }
+
+    // Reparse until the parser reaches the (shifted) start of an old declaration behind the change
+    parser->lexer = lexer;
+    parser->index = reparse_start_token;
+    parser->next_free_node = parser->node_types.size;
+    int sync_item = first_changed_item;
+    while (true)
+    {
+        while (sync_item < old_items.size) {
+            int start = parser->token_mapping[old_items[sync_item]].start_index;
+            if (start >= change.old_end_index && start + token_offset >= parser->index) break;
+            sync_item++;
+        }
+        if (sync_item < old_items.size && parser->token_mapping[old_items[sync_item]].start_index + token_offset == parser->index) break;
+        if (parser->index >= lexer->tokens.size) {
+            sync_item = old_items.size;
+            break;
+        }
+        ast_parser_parse_root_item(parser, root_index);
+    }
+    ast_parser_rollback_to_node_count(parser, parser->next_free_node);
+
+    for (int i = first_changed_item; i < sync_item; i++) {
+        ast_parser_detach_subtree(parser, old_items[i]);
+    }
+    int error_offset = 0;
+    if (sync_item < old_items.size) {
+        int first_reused_error = old_item_infos[sync_item].error_start_index;
+        error_offset = parser->errors.size - first_reused_error;
+        for (int i = first_reused_error; i < old_errors.size; i++) {
+            Compiler_Error error = old_errors[i];
+            error.range.start_index += token_offset;
+            error.range.end_index += token_offset;
+            dynamic_array_push_back(&parser->errors, error);
+        }
     }
-    dynamic_array_destroy(&parser->nodes);
+    for (int i = sync_item; i < old_items.size; i++) {
+        if (token_offset != 0) {
+            ast_parser_shift_subtree_tokens(parser, old_items[i], token_offset);
+        }
+        AST_Root_Item_Info info = old_item_infos[i];
+        info.error_start_index += error_offset;
+        info.error_end_index += error_offset;
+        info.furthest_token_read = math_maximum(info.furthest_token_read + token_offset, parser->furthest_token_read);
+        ast_parser_add_parent_child_connection(parser, root_index, old_items[i]);
+        dynamic_array_push_back(&parser->root_items, info);
+    }
+    parser->token_mapping[root_index].start_index = 0;
+    parser->token_mapping[root_index].end_index = math_maximum(0, lexer->tokens.size - 1);
+    ast_parser_flatten_children(parser);
+}
+
+void ast_parser_destroy(AST_Parser* parser)
+{
+    dynamic_array_destroy(&parser->node_types);
+    dynamic_array_destroy(&parser->node_parents);
+    dynamic_array_destroy(&parser->node_name_ids);
+    dynamic_array_destroy(&parser->node_first_child);
+    dynamic_array_destroy(&parser->node_child_counts);
+    dynamic_array_destroy(&parser->child_buffer);
+    dynamic_array_destroy(&parser->link_first_child);
+    dynamic_array_destroy(&parser->link_last_child);
+    dynamic_array_destroy(&parser->link_next_sibling);
     dynamic_array_destroy(&parser->token_mapping);
+    dynamic_array_destroy(&parser->errors);
+    dynamic_array_destroy(&parser->root_items);
 }
 
 String ast_node_type_to_string(AST_Node_Type type)
@@ -2091,21 +2324,21 @@ bool ast_node_type_is_type(AST_Node_Type type) {
 
 void ast_node_identifer_or_path_append_to_string(AST_Parser* parser, AST_Node_Index index, String* string)
 {
-    string_append(string, lexer_identifer_to_string(parser->lexer, parser->nodes[index].name_id).characters);
-    if (parser->nodes[index].type == AST_Node_Type::IDENTIFIER_PATH) {
+    string_append(string, lexer_identifer_to_string(parser->lexer, parser->node_name_ids[index]).characters);
+    if (parser->node_types[index] == AST_Node_Type::IDENTIFIER_PATH) {
         string_append(string, "::");
-        ast_node_identifer_or_path_append_to_string(parser, parser->nodes[index].children[0], string);
+        ast_node_identifer_or_path_append_to_string(parser, ast_parser_get_node(parser, index).children[0], string);
     }
 }
 
 void ast_node_expression_append_to_string(AST_Parser* parser, AST_Node_Index node_index, String* string);
 void ast_node_arguments_append_to_string(AST_Parser* parser, int node_index, String* string)
 {
-    AST_Node* node = &parser->nodes[node_index];
+    AST_Node node = ast_parser_get_node(parser, node_index);
     string_append(string, "(");
-    for (int i = 0; i < node->children.size; i++) {
-        ast_node_expression_append_to_string(parser, node->children[i], string);
-        if (i != node->children.size - 1) {
+    for (int i = 0; i < node.children.size; i++) {
+        ast_node_expression_append_to_string(parser, node.children[i], string);
+        if (i != node.children.size - 1) {
             string_append(string, ",");
         }
     }
@@ -2114,13 +2347,13 @@ void ast_node_arguments_append_to_string(AST_Parser* parser, int node_index, Str
 
 void ast_node_expression_append_to_string(AST_Parser* parser, AST_Node_Index node_index, String* string)
 {
-    AST_Node* node = &parser->nodes[node_index];
+    AST_Node node = ast_parser_get_node(parser, node_index);
     bool bin_op = false;
     bool unary_op = false;
     const char* bin_op_str = "asfd";
-    switch (node->type)
+    switch (node.type)
     {
-    case AST_Node_Type::EXPRESSION_LITERAL:
+    case AST_Node_Type::EXPRESSION_LITERAL: {
         Token t = parser->lexer->tokens[parser->token_mapping[node_index].start_index];
         switch (t.type) {
         case Token_Type::BOOLEAN_LITERAL: string_append_formated(string, t.attribute.bool_value ? "TRUE" : "FALSE"); break;
@@ -2130,26 +2363,27 @@ void ast_node_expression_append_to_string(AST_Parser* parser, AST_Node_Index nod
             lexer_identifer_to_string(parser->lexer, t.attribute.identifier_number).characters); break;
         }
         return;
+    }
     case AST_Node_Type::EXPRESSION_FUNCTION_CALL:
-        ast_node_identifer_or_path_append_to_string(parser, node->children[0], string);
-        ast_node_arguments_append_to_string(parser, node->children[1], string);
+        ast_node_identifer_or_path_append_to_string(parser, node.children[0], string);
+        ast_node_arguments_append_to_string(parser, node.children[1], string);
         return;
     case AST_Node_Type::EXPRESSION_VARIABLE_READ:
-        ast_node_identifer_or_path_append_to_string(parser, node->children[0], string);
+        ast_node_identifer_or_path_append_to_string(parser, node.children[0], string);
         return;
     case AST_Node_Type::EXPRESSION_ARRAY_ACCESS:
-        ast_node_expression_append_to_string(parser, node->children[0], string);
+        ast_node_expression_append_to_string(parser, node.children[0], string);
         string_append_formated(string, "[");
-        ast_node_expression_append_to_string(parser, node->children[1], string);
+        ast_node_expression_append_to_string(parser, node.children[1], string);
         string_append_formated(string, "]");
         return;
     case AST_Node_Type::EXPRESSION_MEMBER_ACCESS:
-        ast_node_expression_append_to_string(parser, node->children[0], string);
-        string_append_formated(string, ".%s", lexer_identifer_to_string(parser->lexer, node->name_id).characters);
+        ast_node_expression_append_to_string(parser, node.children[0], string);
+        string_append_formated(string, ".%s", lexer_identifer_to_string(parser->lexer, node.name_id).characters);
         return;
     case AST_Node_Type::EXPRESSION_CAST:
         string_append_formated(string, "cast(...)");
-        ast_node_expression_append_to_string(parser, node->children[1], string);
+        ast_node_expression_append_to_string(parser, node.children[1], string);
         return;
     case AST_Node_Type::EXPRESSION_BINARY_OPERATION_ADDITION: bin_op = true, bin_op_str = "+"; break;
     case AST_Node_Type::EXPRESSION_BINARY_OPERATION_SUBTRACTION: bin_op = true, bin_op_str = "-"; break;
@@ -2173,29 +2407,29 @@ void ast_node_expression_append_to_string(AST_Parser* parser, AST_Node_Index nod
     if (bin_op)
     {
         string_append_formated(string, "(");
-        ast_node_expression_append_to_string(parser, node->children[0], string);
+        ast_node_expression_append_to_string(parser, node.children[0], string);
         string_append_formated(string, " %s ", bin_op_str);
-        ast_node_expression_append_to_string(parser, node->children[1], string);
+        ast_node_expression_append_to_string(parser, node.children[1], string);
         string_append_formated(string, ")");
         return;
     }
     else if (unary_op)
     {
         string_append_formated(string, bin_op_str);
-        ast_node_expression_append_to_string(parser, node->children[0], string);
+        ast_node_expression_append_to_string(parser, node.children[0], string);
     }
 }
 
 void ast_node_append_to_string(AST_Parser* parser, int node_index, String* string, int indentation_lvl)
 {
-    AST_Node* node = &parser->nodes[node_index];
+    AST_Node node = ast_parser_get_node(parser, node_index);
     for (int j = 0; j < indentation_lvl; j++) {
         string_append_formated(string, "  ");
     }
     string_append_formated(string, "#%d ", node_index);
-    String type_str = ast_node_type_to_string(node->type);
+    String type_str = ast_node_type_to_string(node.type);
     string_append_string(string, &type_str);
-    if (ast_node_type_is_expression(node->type)) {
+    if (ast_node_type_is_expression(node.type)) {
         string_append_formated(string, ": ");
         ast_node_expression_append_to_string(parser, node_index, string);
         //string_append_formated(string, "\n");
@@ -2215,8 +2449,8 @@ void ast_node_append_to_string(AST_Parser* parser, int node_index, String* strin
     }
     {
         string_append_formated(string, "\n");
-        for (int i = 0; i < node->children.size; i++) {
-            ast_node_append_to_string(parser, node->children[i], string, indentation_lvl + 1);
+        for (int i = 0; i < node.children.size; i++) {
+            ast_node_append_to_string(parser, node.children[i], string, indentation_lvl + 1);
         }
     }
 }
@@ -2228,13 +2462,13 @@ void ast_parser_append_to_string(AST_Parser* parser, String* string) {
 int ast_parser_get_closest_node_to_text_position(AST_Parser* parser, Text_Position pos, Dynamic_Array<String> text)
 {
     int closest_index = 0;
-    AST_Node* closest = &parser->nodes[0];
+    AST_Node closest = ast_parser_get_node(parser, 0);
     while (true)
     {
         bool continue_search = true;
-        for (int i = 0; i < closest->children.size && continue_search; i++)
+        for (int i = 0; i < closest.children.size && continue_search; i++)
         {
-            int child_index = closest->children[i];
+            int child_index = closest.children[i];
             Token* token_start, * token_end;
             {
                 int min = 0;
@@ -2251,7 +2485,7 @@ int ast_parser_get_closest_node_to_text_position(AST_Parser* parser, Text_Positi
             Text_Slice node_slice = text_slice_make(token_start->position.start, token_end->position.end);
             if (text_slice_contains_position(node_slice, pos, text)) {
                 closest_index = child_index;
-                closest = &parser->nodes[closest_index];
+                closest = ast_parser_get_node(parser, closest_index);
                 continue_search = false;
             }
         }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../../datastructures/dynamic_array.hpp"
+#include "../../datastructures/array.hpp"
 #include "lexer.hpp"
 #include "text.hpp"
 
@@ -93,23 +94,47 @@ bool ast_node_type_is_statement(AST_Node_Type type);
 bool ast_node_type_is_type(AST_Node_Type type);
 
 typedef int AST_Node_Index;
+// View of a node assembled from the AST_Parser arrays, children point into child_buffer and stay valid until the next parse
 struct AST_Node
 {
     AST_Node_Type type; 
     AST_Node_Index parent;
-    Dynamic_Array<AST_Node_Index> children;
+    Array<AST_Node_Index> children;
     // Node information
     int name_id; // Multipurpose: variable read, write, function name, function call
 };
 
+// Bookkeeping for incremental parsing of each top level declaration
+struct AST_Root_Item_Info
+{
+    int error_start_index; // Range in AST_Parser::errors logged while parsing the declaration
+    int error_end_index;
+    int furthest_token_read; // Furthest token the parse looked at, including all previous declarations
+};
+
 struct AST_Parser
 {
-    Dynamic_Array<AST_Node> nodes;
+    // Nodes are stored as structure of arrays, all indexed by AST_Node_Index
+    Dynamic_Array<AST_Node_Type> node_types;
+    Dynamic_Array<AST_Node_Index> node_parents;
+    Dynamic_Array<int> node_name_ids;
+    Dynamic_Array<int> node_first_child; // Offset into child_buffer
+    Dynamic_Array<int> node_child_counts;
+    // Children of all nodes, filled in post-order after each parse so that the children of one node are contiguous
+    Dynamic_Array<AST_Node_Index> child_buffer;
+    // While parsing children are linked lists through these arrays, since nodes are rewound and reparented
+    Dynamic_Array<AST_Node_Index> link_first_child;
+    Dynamic_Array<AST_Node_Index> link_last_child;
+    Dynamic_Array<AST_Node_Index> link_next_sibling;
     Dynamic_Array<Token_Range> token_mapping;
     Dynamic_Array<Compiler_Error> errors;
     Lexer* lexer;
     int index;
     AST_Node_Index next_free_node;
+    int detached_node_count; // Nodes of replaced declarations after incremental parses, set to UNDEFINED without parent
+    Dynamic_Array<AST_Root_Item_Info> root_items; // Parallel to the children of the root node
+    int furthest_token_read;
+    int parse_generation; // Incremented by each full parse, node indices are only comparable within one generation
 };
 
 struct AST_Parser_Checkpoint
@@ -123,7 +148,10 @@ struct AST_Parser_Checkpoint
 
 AST_Parser ast_parser_create();
 void ast_parser_parse(AST_Parser* parser, Lexer* lexer);
+// Only reparses the top level declarations near the token change, untouched declarations keep their node indices
+void ast_parser_parse_incremental(AST_Parser* parser, Lexer* lexer, Token_Change change);
 void ast_parser_destroy(AST_Parser* parser);
+AST_Node ast_parser_get_node(AST_Parser* parser, AST_Node_Index node_index);
 void ast_parser_append_to_string(AST_Parser* parser, String* string);
 int ast_parser_get_closest_node_to_text_position(AST_Parser* parser, Text_Position pos, Dynamic_Array<String> text);
 String ast_node_type_to_string(AST_Node_Type type);
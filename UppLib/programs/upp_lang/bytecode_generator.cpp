@@ -2,6 +2,7 @@
 
 #include "compiler.hpp"
 #include "../../utility/hash_functions.hpp"
+#include "../../utility/parallel.hpp"
 
 int align_offset_next_multiple(int offset, int alignment) 
 {
@@ -13,6 +14,18 @@ int align_offset_next_multiple(int offset, int alignment)
     return offset + (alignment - dist);
 }
 
+int binary_operation_pack(Instruction_Type binary_operation, Primitive_Type type) {
+    return ((int)binary_operation << 8) | (int)type;
+}
+
+Instruction_Type binary_operation_unpack_instruction_type(int packed) {
+    return (Instruction_Type)(packed >> 8);
+}
+
+Primitive_Type binary_operation_unpack_primitive_type(int packed) {
+    return (Primitive_Type)(packed & 0xFF);
+}
+
 Bytecode_Generator bytecode_generator_create()
 {
     Bytecode_Generator result;
@@ -20,17 +33,32 @@ Bytecode_Generator bytecode_generator_create()
     result.instructions = dynamic_array_create_empty<Bytecode_Instruction>(64);
 
     // Code Information
-    result.function_locations = hashtable_create_pointer_empty<IR_Function*, int>(64);
-    result.function_parameter_stack_offset_index = hashtable_create_pointer_empty<IR_Function*, int>(64);
-    result.code_block_register_stack_offset_index = hashtable_create_pointer_empty<IR_Code_Block*, int>(64);
+    result.function_locations = hashtable_create_empty<IR_Function*, int, Hasher_Pointer<IR_Function*>>(64);
+    result.function_parameter_stack_offset_index = hashtable_create_empty<IR_Function*, int, Hasher_Pointer<IR_Function*>>(64);
+    result.code_block_register_stack_offset_index = hashtable_create_empty<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>>(64);
     result.stack_offsets = dynamic_array_create_empty<Dynamic_Array<int>>(64);
     result.global_data_offsets = dynamic_array_create_empty<int>(256);
+    result.stack_frames = dynamic_array_create_empty<Stack_Frame_Info>(64);
 
     // Fill outs
     result.fill_out_breaks = dynamic_array_create_empty<int>(64);
     result.fill_out_continues = dynamic_array_create_empty<int>(64);
     result.fill_out_calls = dynamic_array_create_empty<Function_Reference>(64);
     result.fill_out_function_ptr_loads = dynamic_array_create_empty<Function_Reference>(64);
+
+    // Stack slot allocation
+    result.register_lifetimes = dynamic_array_create_empty<Register_Lifetime>(64);
+    result.code_block_lifetimes = dynamic_array_create_empty<Code_Block_Lifetime>(16);
+    result.code_block_lifetime_index = hashtable_create_empty<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>>(16);
+    result.loop_lifetimes = dynamic_array_create_empty<Loop_Lifetime>(8);
+    result.lifetime_order = dynamic_array_create_empty<int>(64);
+    result.active_lifetimes = dynamic_array_create_empty<int>(16);
+
+    // Parallel generation
+    result.workers = dynamic_array_create_empty<Bytecode_Generator>(1);
+    result.is_worker = false;
+    result.worker_constant_memory = dynamic_array_create_empty<byte>(64);
+    result.fill_out_constant_reads = dynamic_array_create_empty<int>(16);
     return result;
 }
 
@@ -48,12 +76,29 @@ void bytecode_generator_destroy(Bytecode_Generator* generator)
         dynamic_array_destroy(&generator->stack_offsets[i]);
     }
     dynamic_array_destroy(&generator->stack_offsets);
+    dynamic_array_destroy(&generator->stack_frames);
 
     // Fill outs
     dynamic_array_destroy(&generator->fill_out_breaks);
     dynamic_array_destroy(&generator->fill_out_continues);
     dynamic_array_destroy(&generator->fill_out_calls);
     dynamic_array_destroy(&generator->fill_out_function_ptr_loads);
+
+    // Stack slot allocation
+    dynamic_array_destroy(&generator->register_lifetimes);
+    dynamic_array_destroy(&generator->code_block_lifetimes);
+    hashtable_destroy(&generator->code_block_lifetime_index);
+    dynamic_array_destroy(&generator->loop_lifetimes);
+    dynamic_array_destroy(&generator->lifetime_order);
+    dynamic_array_destroy(&generator->active_lifetimes);
+
+    // Parallel generation
+    for (int i = 0; i < generator->workers.size; i++) {
+        bytecode_generator_destroy(&generator->workers[i]);
+    }
+    dynamic_array_destroy(&generator->workers);
+    dynamic_array_destroy(&generator->worker_constant_memory);
+    dynamic_array_destroy(&generator->fill_out_constant_reads);
 } 
 
 Bytecode_Instruction instruction_make_0(Instruction_Type type) {
@@ -106,6 +151,9 @@ int bytecode_generator_create_temporary_stack_offset(Bytecode_Generator* generat
     generator->current_stack_offset = align_offset_next_multiple(generator->current_stack_offset, type->alignment_in_bytes);
     int result = generator->current_stack_offset;
     generator->current_stack_offset += type->size_in_bytes;
+    if (generator->current_stack_offset > generator->maximum_function_stack_depth) {
+        generator->maximum_function_stack_depth = generator->current_stack_offset;
+    }
     return result;
 }
 
@@ -288,14 +336,8 @@ int bytecode_generator_add_instruction_and_set_destination(Bytecode_Generator* g
 
 void bytecode_generator_move_accesses(Bytecode_Generator* generator, IR_Data_Access destination, IR_Data_Access source)
 {
-    int move_byte_size;
-    if (destination.is_memory_access) {
-        move_byte_size = 8;
-    }
-    else {
-        move_byte_size = ir_data_access_get_type(&destination)->size_in_bytes;
-    }
-
+    // For memory accesses this is the size of the pointed to value, which is written through the pointer afterwards
+    int move_byte_size = ir_data_access_get_type(&destination)->size_in_bytes;
     int source_offset = bytecode_generator_data_access_to_stack_offset(generator, source);
     Bytecode_Instruction instr = instruction_make_3(Instruction_Type::MOVE_STACK_DATA, 0, source_offset, move_byte_size);
     bytecode_generator_add_instruction_and_set_destination(generator, destination, instr);
@@ -340,6 +382,7 @@ int bytecode_generator_get_pointer_to_access(Bytecode_Generator* generator, IR_D
     }
     load_instr.op1 = bytecode_generator_create_temporary_stack_offset(generator, generator->compiler->type_system.void_ptr_type);
     load_instr.op2 = offset;
+    load_instr.op3 = ir_data_access_get_type(&access)->size_in_bytes;
     bytecode_generator_add_instruction(generator, load_instr);
     return load_instr.op1;
 }
@@ -358,23 +401,272 @@ int stack_offsets_calculate(Dynamic_Array<Type_Signature*>* types, Dynamic_Array
     return stack_offset;
 }
 
-void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Code_Block* code_block)
+/*
+    Stack slot allocation
+    Before generating a function, all instructions are numbered in generation order and the lifetime of each register
+    is the range between its first and last use. Registers defined outside of a loop and used inside are live for the
+    whole loop, registers whose address is taken are live in their whole code block.
+    Slots are assigned in order of first use, each register gets the lowest offset not overlapping a live register.
+*/
+void bytecode_generator_use_register(Bytecode_Generator* generator, IR_Data_Access* access, bool takes_address)
 {
-    // Generate Stack offsets
-    int rewind_stack_offset = generator->current_stack_offset;
-    SCOPE_EXIT(generator->current_stack_offset = rewind_stack_offset);
+    if (access->type != IR_Data_Access_Type::REGISTER) return;
+    int* block_index = hashtable_find_element(&generator->code_block_lifetime_index, access->option.definition_block);
+    assert(block_index != 0, "Register of a code block that is not part of the function");
+    Code_Block_Lifetime* block = &generator->code_block_lifetimes[*block_index];
+    Register_Lifetime* lifetime = &generator->register_lifetimes[block->first_register + access->index];
+    if (lifetime->first_use > lifetime->last_use) {
+        lifetime->first_use = generator->lifetime_position;
+    }
+    lifetime->last_use = generator->lifetime_position;
+    if (takes_address && !access->is_memory_access) {
+        lifetime->address_taken = true;
+    }
+}
+
+// Returns the stack size required if every register had its own slot (Nested blocks are placed after their parents)
+int bytecode_generator_collect_register_lifetimes(Bytecode_Generator* generator, IR_Code_Block* code_block, int stack_offset_without_reuse)
+{
+    int block_index = generator->code_block_lifetimes.size;
     {
+        Code_Block_Lifetime block;
+        block.start = generator->lifetime_position;
+        block.end = generator->lifetime_position;
+        block.first_register = generator->register_lifetimes.size;
+        block.stack_offset_index = generator->stack_offsets.size;
+        dynamic_array_push_back(&generator->code_block_lifetimes, block);
+        hashtable_insert_element(&generator->code_block_lifetime_index, code_block, block_index);
+
         Dynamic_Array<int> register_stack_offsets = dynamic_array_create_empty<int>(code_block->registers.size);
-        generator->current_stack_offset = stack_offsets_calculate(&code_block->registers, &register_stack_offsets, generator->current_stack_offset);
         dynamic_array_push_back(&generator->stack_offsets, register_stack_offsets);
         hashtable_insert_element(&generator->code_block_register_stack_offset_index, code_block, generator->stack_offsets.size - 1);
     }
+    for (int i = 0; i < code_block->registers.size; i++)
+    {
+        Register_Lifetime lifetime;
+        lifetime.first_use = 1;
+        lifetime.last_use = 0;
+        lifetime.address_taken = false;
+        lifetime.code_block_index = block_index;
+        lifetime.type = code_block->registers[i];
+        lifetime.stack_offset = 0;
+        dynamic_array_push_back(&generator->register_lifetimes, lifetime);
+
+        stack_offset_without_reuse = align_offset_next_multiple(stack_offset_without_reuse, lifetime.type->alignment_in_bytes);
+        stack_offset_without_reuse += lifetime.type->size_in_bytes;
+    }
 
+    int max_size_without_reuse = stack_offset_without_reuse;
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        generator->lifetime_position++;
+        int nested_size = 0;
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::FUNCTION_CALL:
+        {
+            IR_Instruction_Call* call = &instr->options.call;
+            if (call->call_type == IR_Instruction_Call_Type::FUNCTION_POINTER_CALL) {
+                bytecode_generator_use_register(generator, &call->options.pointer_access, false);
+            }
+            for (int j = 0; j < call->arguments.size; j++) {
+                bytecode_generator_use_register(generator, &call->arguments[j], false);
+            }
+            if (ir_instruction_call_get_return_type(call)->type != Signature_Type::VOID_TYPE) {
+                bytecode_generator_use_register(generator, &call->destination, false);
+            }
+            break;
+        }
+        case IR_Instruction_Type::IF:
+            bytecode_generator_use_register(generator, &instr->options.if_instr.condition, false);
+            nested_size = bytecode_generator_collect_register_lifetimes(generator, instr->options.if_instr.true_branch, stack_offset_without_reuse);
+            nested_size = math_maximum(nested_size,
+                bytecode_generator_collect_register_lifetimes(generator, instr->options.if_instr.false_branch, stack_offset_without_reuse)
+            );
+            break;
+        case IR_Instruction_Type::WHILE:
+        {
+            Loop_Lifetime loop;
+            loop.start = generator->lifetime_position;
+            nested_size = bytecode_generator_collect_register_lifetimes(generator, instr->options.while_instr.condition_code, stack_offset_without_reuse);
+            generator->lifetime_position++;
+            bytecode_generator_use_register(generator, &instr->options.while_instr.condition_access, false);
+            nested_size = math_maximum(nested_size,
+                bytecode_generator_collect_register_lifetimes(generator, instr->options.while_instr.code, stack_offset_without_reuse)
+            );
+            generator->lifetime_position++;
+            loop.end = generator->lifetime_position;
+            dynamic_array_push_back(&generator->loop_lifetimes, loop);
+            break;
+        }
+        case IR_Instruction_Type::BLOCK:
+            nested_size = bytecode_generator_collect_register_lifetimes(generator, instr->options.block, stack_offset_without_reuse);
+            break;
+        case IR_Instruction_Type::BREAK:
+        case IR_Instruction_Type::CONTINUE:
+            break;
+        case IR_Instruction_Type::RETURN:
+            if (instr->options.return_instr.type == IR_Instruction_Return_Type::RETURN_DATA) {
+                bytecode_generator_use_register(generator, &instr->options.return_instr.options.return_value, false);
+            }
+            break;
+        case IR_Instruction_Type::MOVE:
+            bytecode_generator_use_register(generator, &instr->options.move.destination, false);
+            bytecode_generator_use_register(generator, &instr->options.move.source, false);
+            break;
+        case IR_Instruction_Type::CAST: {
+            bool takes_address = instr->options.cast.type == IR_Instruction_Cast_Type::ARRAY_SIZED_TO_UNSIZED;
+            bytecode_generator_use_register(generator, &instr->options.cast.destination, takes_address);
+            bytecode_generator_use_register(generator, &instr->options.cast.source, takes_address);
+            break;
+        }
+        case IR_Instruction_Type::ADDRESS_OF:
+        {
+            IR_Instruction_Address_Of* address_of = &instr->options.address_of;
+            bytecode_generator_use_register(generator, &address_of->destination, false);
+            if (address_of->type != IR_Instruction_Address_Of_Type::FUNCTION) {
+                bytecode_generator_use_register(generator, &address_of->source, true);
+            }
+            if (address_of->type == IR_Instruction_Address_Of_Type::ARRAY_ELEMENT) {
+                bytecode_generator_use_register(generator, &address_of->options.index_access, false);
+            }
+            break;
+        }
+        case IR_Instruction_Type::UNARY_OP:
+            bytecode_generator_use_register(generator, &instr->options.unary_op.destination, false);
+            bytecode_generator_use_register(generator, &instr->options.unary_op.source, false);
+            break;
+        case IR_Instruction_Type::BINARY_OP:
+            bytecode_generator_use_register(generator, &instr->options.binary_op.destination, false);
+            bytecode_generator_use_register(generator, &instr->options.binary_op.operand_left, false);
+            bytecode_generator_use_register(generator, &instr->options.binary_op.operand_right, false);
+            break;
+        default: panic("Lul");
+        }
+        max_size_without_reuse = math_maximum(max_size_without_reuse, nested_size);
+    }
+    generator->code_block_lifetimes[block_index].end = generator->lifetime_position;
+
+    return max_size_without_reuse;
+}
+
+// Returns the end of the register area
+int bytecode_generator_allocate_register_slots(Bytecode_Generator* generator, int start_byte_offset)
+{
+    Dynamic_Array<Register_Lifetime>* lifetimes = &generator->register_lifetimes;
+    for (int i = 0; i < lifetimes->size; i++)
+    {
+        Register_Lifetime* lifetime = &lifetimes->data[i];
+        if (lifetime->first_use > lifetime->last_use) continue;
+        Code_Block_Lifetime* block = &generator->code_block_lifetimes[lifetime->code_block_index];
+        if (lifetime->address_taken) {
+            lifetime->first_use = block->start;
+            lifetime->last_use = block->end;
+        }
+        // Values of registers from outside the loop may be needed in the next iteration
+        for (int j = 0; j < generator->loop_lifetimes.size; j++)
+        {
+            Loop_Lifetime loop = generator->loop_lifetimes[j];
+            bool block_inside_loop = block->start >= loop.start && block->end <= loop.end;
+            if (!block_inside_loop && lifetime->first_use <= loop.end && lifetime->last_use >= loop.start) {
+                lifetime->first_use = math_minimum(lifetime->first_use, loop.start);
+                lifetime->last_use = math_maximum(lifetime->last_use, loop.end);
+            }
+        }
+    }
+
+    // Counting sort by first use, unused registers are skipped
+    Dynamic_Array<int>* order = &generator->lifetime_order;
+    dynamic_array_reset(order);
+    for (int i = 0; i < generator->lifetime_position + 2; i++) {
+        dynamic_array_push_back(order, 0);
+    }
+    int used_count = 0;
+    for (int i = 0; i < lifetimes->size; i++) {
+        Register_Lifetime* lifetime = &lifetimes->data[i];
+        if (lifetime->first_use > lifetime->last_use) continue;
+        order->data[lifetime->first_use + 1]++;
+        used_count++;
+    }
+    for (int i = 1; i < order->size; i++) {
+        order->data[i] += order->data[i - 1];
+    }
+    int bucket_count = order->size;
+    for (int i = 0; i < used_count; i++) {
+        dynamic_array_push_back(order, 0);
+    }
+    for (int i = 0; i < lifetimes->size; i++) {
+        Register_Lifetime* lifetime = &lifetimes->data[i];
+        if (lifetime->first_use > lifetime->last_use) continue;
+        order->data[bucket_count + order->data[lifetime->first_use]] = i;
+        order->data[lifetime->first_use]++;
+    }
+
+    // Active lifetimes are sorted by stack offset
+    Dynamic_Array<int>* active = &generator->active_lifetimes;
+    dynamic_array_reset(active);
+    int register_area_end = start_byte_offset;
+    for (int i = 0; i < used_count; i++)
+    {
+        Register_Lifetime* lifetime = &lifetimes->data[order->data[bucket_count + i]];
+        int keep_count = 0;
+        for (int j = 0; j < active->size; j++) {
+            if (lifetimes->data[active->data[j]].last_use >= lifetime->first_use) {
+                active->data[keep_count] = active->data[j];
+                keep_count++;
+            }
+        }
+        active->size = keep_count;
+
+        int size = lifetime->type->size_in_bytes;
+        int offset = align_offset_next_multiple(start_byte_offset, lifetime->type->alignment_in_bytes);
+        int insert_index = active->size;
+        for (int j = 0; j < active->size; j++)
+        {
+            Register_Lifetime* other = &lifetimes->data[active->data[j]];
+            if (other->stack_offset >= offset + size) {
+                insert_index = j;
+                break;
+            }
+            if (other->stack_offset + other->type->size_in_bytes > offset) {
+                offset = align_offset_next_multiple(other->stack_offset + other->type->size_in_bytes, lifetime->type->alignment_in_bytes);
+            }
+        }
+        lifetime->stack_offset = offset;
+        dynamic_array_insert_ordered(active, order->data[bucket_count + i], insert_index);
+        register_area_end = math_maximum(register_area_end, offset + size);
+    }
+
+    // Write offsets, unused registers get the start offset
+    for (int i = 0; i < generator->code_block_lifetimes.size; i++)
+    {
+        Code_Block_Lifetime* block = &generator->code_block_lifetimes[i];
+        Dynamic_Array<int>* offsets = &generator->stack_offsets[block->stack_offset_index];
+        int register_count = (i + 1 < generator->code_block_lifetimes.size ?
+            generator->code_block_lifetimes[i + 1].first_register : lifetimes->size) - block->first_register;
+        for (int j = 0; j < register_count; j++) {
+            Register_Lifetime* lifetime = &lifetimes->data[block->first_register + j];
+            if (lifetime->first_use > lifetime->last_use) {
+                dynamic_array_push_back(offsets, start_byte_offset);
+            }
+            else {
+                dynamic_array_push_back(offsets, lifetime->stack_offset);
+            }
+        }
+    }
+
+    return register_area_end;
+}
+
+void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Code_Block* code_block)
+{
     const int PLACEHOLDER = 0;
     // Generate instructions
     for (int i = 0; i < code_block->instructions.size; i++)
     {
         IR_Instruction* instr = &code_block->instructions[i];
+        generator->current_stack_offset = generator->register_area_end;
 
         switch (instr->type)
         {
@@ -399,6 +691,7 @@ void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Co
             // Put arguments into the correct place on the stack
             int pointer_offset = bytecode_generator_create_temporary_stack_offset(generator, generator->compiler->type_system.void_ptr_type);
             int argument_stack_offset = align_offset_next_multiple(generator->current_stack_offset, 16); // I think 16 is the hightest i have
+            int argument_start_offset = argument_stack_offset;
             for (int i = 0; i < function_sig->parameter_types.size; i++)
             {
                 Type_Signature* parameter_sig = function_sig->parameter_types[i];
@@ -429,7 +722,7 @@ void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Co
                 case IR_Data_Access_Type::PARAMETER: {
                     load_instruction.instruction_type = Instruction_Type::MOVE_STACK_DATA;
                     Dynamic_Array<int>* parameter_offsets = &generator->stack_offsets[
-                        *hashtable_find_element(&generator->function_parameter_stack_offset_index, code_block->function)
+                        *hashtable_find_element(&generator->function_parameter_stack_offset_index, argument_access->option.function)
                     ];
                     load_instruction.op2 = parameter_offsets->data[argument_access->index];
                     break;
@@ -437,7 +730,7 @@ void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Co
                 case IR_Data_Access_Type::REGISTER: {
                     load_instruction.instruction_type = Instruction_Type::MOVE_STACK_DATA;
                     Dynamic_Array<int>* register_offsets = &generator->stack_offsets[
-                        *hashtable_find_element(&generator->code_block_register_stack_offset_index, code_block)
+                        *hashtable_find_element(&generator->code_block_register_stack_offset_index, argument_access->option.definition_block)
                     ];
                     load_instruction.op2 = register_offsets->data[argument_access->index];
                     break;
@@ -461,14 +754,19 @@ void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Co
             }
 
             // Align argument_stack_offset for return pointer
+            int argument_size = argument_stack_offset - argument_start_offset;
             argument_stack_offset = align_offset_next_multiple(argument_stack_offset, 8);
+            // The called function stores the return address and the base pointer at the start of its frame
+            if (argument_stack_offset + 16 > generator->maximum_function_stack_depth) {
+                generator->maximum_function_stack_depth = argument_stack_offset + 16;
+            }
             switch (call->call_type)
             {
             case IR_Instruction_Call_Type::FUNCTION_CALL: {
                 Function_Reference call_ref;
                 call_ref.function = call->options.function;
                 call_ref.instruction_index = bytecode_generator_add_instruction(generator,
-                    instruction_make_2(Instruction_Type::CALL_FUNCTION, 0, argument_stack_offset)
+                    instruction_make_3(Instruction_Type::CALL_FUNCTION, 0, argument_stack_offset, argument_size)
                 );
                 dynamic_array_push_back(&generator->fill_out_calls, call_ref);
                 break;
@@ -476,17 +774,23 @@ void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Co
             case IR_Instruction_Call_Type::FUNCTION_POINTER_CALL: {
                 bytecode_generator_add_instruction(
                     generator,
-                    instruction_make_2(
+                    instruction_make_3(
                         Instruction_Type::CALL_FUNCTION_POINTER,
                         bytecode_generator_data_access_to_stack_offset(generator, call->options.pointer_access),
-                        argument_stack_offset
+                        argument_stack_offset,
+                        argument_size
                     )
                 );
                 break;
             }
             case IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL:
                 bytecode_generator_add_instruction(generator,
-                    instruction_make_2(Instruction_Type::CALL_HARDCODED_FUNCTION, (i32)call->options.hardcoded->type, argument_stack_offset)
+                    instruction_make_3(
+                        Instruction_Type::CALL_HARDCODED_FUNCTION,
+                        (i32)call->options.hardcoded->type,
+                        argument_stack_offset,
+                        argument_size
+                    )
                 );
                 break;
             default: panic("Error");
@@ -657,15 +961,22 @@ void bytecode_generator_generate_code_block(Bytecode_Generator* generator, IR_Co
                 ));
 
                 Type_Signature* array_sized_type = ir_data_access_get_type(&cast->source);
-                int offset = generator->ir_program->constant_pool.constant_memory.size;
+                Dynamic_Array<byte>* constant_memory = &generator->ir_program->constant_pool.constant_memory;
+                if (generator->is_worker) {
+                    constant_memory = &generator->worker_constant_memory;
+                }
+                int offset = constant_memory->size;
                 i32* size = &array_sized_type->array_element_count;
                 byte* data_ptr = (byte*)size;
                 for (int i = 0; i < 4; i++) {
-                    dynamic_array_push_back(&generator->ir_program->constant_pool.constant_memory, data_ptr[i]);
+                    dynamic_array_push_back(constant_memory, data_ptr[i]);
                 }
                 int const_val_offset = bytecode_generator_create_temporary_stack_offset(generator, generator->compiler->type_system.i32_type);
-                bytecode_generator_add_instruction(generator,
+                int read_constant_index = bytecode_generator_add_instruction(generator,
                     instruction_make_3(Instruction_Type::READ_CONSTANT, const_val_offset, offset, 4));
+                if (generator->is_worker) {
+                    dynamic_array_push_back(&generator->fill_out_constant_reads, read_constant_index);
+                }
                 bytecode_generator_add_instruction(generator,
                     instruction_make_3(Instruction_Type::WRITE_MEMORY, unsized_size_ptr_offset, const_val_offset, 4));
                 break;
@@ -832,20 +1143,36 @@ void bytecode_generator_generate_function_code(Bytecode_Generator* generator, IR
         for (int i = 0; i < parameter_offsets->size; i++) {
             parameter_offsets->data[i] -= parameter_stack_size;
         }
-        generator->current_stack_offset = 16;
+    }
+
+    // Generate register offsets, the frame starts with the return address and the base pointer
+    Stack_Frame_Info frame_info;
+    frame_info.function = function;
+    {
+        dynamic_array_reset(&generator->register_lifetimes);
+        dynamic_array_reset(&generator->code_block_lifetimes);
+        hashtable_reset(&generator->code_block_lifetime_index);
+        dynamic_array_reset(&generator->loop_lifetimes);
+        generator->lifetime_position = 0;
+        frame_info.register_size_without_reuse = bytecode_generator_collect_register_lifetimes(generator, function->code, 16) - 16;
+        generator->register_area_end = bytecode_generator_allocate_register_slots(generator, 16);
+        generator->current_stack_offset = generator->register_area_end;
+        frame_info.register_size = generator->register_area_end - 16;
     }
 
     // Register function
     hashtable_insert_element(&generator->function_locations, function, generator->instructions.size);
 
     // Generate code
+    int maximum_stack_depth = generator->maximum_function_stack_depth;
+    generator->maximum_function_stack_depth = generator->register_area_end;
     bytecode_generator_generate_code_block(generator, function->code);
-    if (generator->current_stack_offset > generator->maximum_function_stack_depth) {
-        generator->maximum_function_stack_depth = generator->current_stack_offset;
-    }
+    frame_info.frame_size = generator->maximum_function_stack_depth;
+    generator->maximum_function_stack_depth = math_maximum(maximum_stack_depth, frame_info.frame_size);
+    dynamic_array_push_back(&generator->stack_frames, frame_info);
 }
 
-void bytecode_generator_generate(Bytecode_Generator* generator, Compiler* compiler)
+void bytecode_generator_reset(Bytecode_Generator* generator, Compiler* compiler)
 {
     generator->ir_program = compiler->analyser.program;
     generator->compiler = compiler;
@@ -861,14 +1188,18 @@ void bytecode_generator_generate(Bytecode_Generator* generator, Compiler* compil
             dynamic_array_destroy(&generator->stack_offsets[i]);
         }
         dynamic_array_reset(&generator->stack_offsets);
+        dynamic_array_reset(&generator->stack_frames);
         // Reset fill outs
         dynamic_array_reset(&generator->fill_out_breaks);
         dynamic_array_reset(&generator->fill_out_continues);
         dynamic_array_reset(&generator->fill_out_calls);
         dynamic_array_reset(&generator->fill_out_function_ptr_loads);
+        dynamic_array_reset(&generator->worker_constant_memory);
+        dynamic_array_reset(&generator->fill_out_constant_reads);
     }
 
     // Generate global data offsets
+    generator->maximum_function_stack_depth = 0;
     generator->global_data_size = 0;
     dynamic_array_reserve(&generator->global_data_offsets, generator->ir_program->globals.size);
     for (int i = 0; i < generator->ir_program->globals.size; i++) {
@@ -877,19 +1208,10 @@ void bytecode_generator_generate(Bytecode_Generator* generator, Compiler* compil
         dynamic_array_push_back(&generator->global_data_offsets, generator->global_data_size);
         generator->global_data_size += signature->size_in_bytes;
     }
+}
 
-    // Generate code for all functions
-    for (int i = 0; i < generator->ir_program->functions.size; i++) {
-        Dynamic_Array<int> parameter_stack_offsets = dynamic_array_create_empty<int>(16);
-        dynamic_array_push_back(&generator->stack_offsets, parameter_stack_offsets);
-        hashtable_insert_element(&generator->function_parameter_stack_offset_index,
-            generator->ir_program->functions[i], generator->stack_offsets.size - 1
-        );
-    }
-    for (int i = 0; i < generator->ir_program->functions.size; i++) {
-        bytecode_generator_generate_function_code(generator, generator->ir_program->functions[i]);
-    }
-
+void bytecode_generator_fill_out_function_references(Bytecode_Generator* generator)
+{
     // Fill out all function calls
     for (int i = 0; i < generator->fill_out_calls.size; i++) {
         Function_Reference& call_loc = generator->fill_out_calls[i];
@@ -909,7 +1231,176 @@ void bytecode_generator_generate(Bytecode_Generator* generator, Compiler* compil
     generator->entry_point_index = *hashtable_find_element(&generator->function_locations, generator->ir_program->entry_function);
 }
 
+void bytecode_generator_generate(Bytecode_Generator* generator, Compiler* compiler)
+{
+    bytecode_generator_reset(generator, compiler);
+
+    // Generate code for all functions
+    for (int i = 0; i < generator->ir_program->functions.size; i++) {
+        Dynamic_Array<int> parameter_stack_offsets = dynamic_array_create_empty<int>(16);
+        dynamic_array_push_back(&generator->stack_offsets, parameter_stack_offsets);
+        hashtable_insert_element(&generator->function_parameter_stack_offset_index,
+            generator->ir_program->functions[i], generator->stack_offsets.size - 1
+        );
+    }
+    for (int i = 0; i < generator->ir_program->functions.size; i++) {
+        bytecode_generator_generate_function_code(generator, generator->ir_program->functions[i]);
+    }
+
+    bytecode_generator_fill_out_function_references(generator);
+}
+
+struct Bytecode_Generator_Parallel_Work
+{
+    Bytecode_Generator* generator;
+    Dynamic_Array<int> function_ranges; // Worker i generates functions [function_ranges[i], function_ranges[i + 1])
+};
+
+void bytecode_generator_worker_generate_functions(void* userdata, int worker_index)
+{
+    Bytecode_Generator_Parallel_Work* work = (Bytecode_Generator_Parallel_Work*)userdata;
+    Bytecode_Generator* worker = &work->generator->workers[worker_index];
+    for (int i = work->function_ranges[worker_index]; i < work->function_ranges[worker_index + 1]; i++)
+    {
+        IR_Function* function = worker->ir_program->functions[i];
+        Dynamic_Array<int> parameter_stack_offsets = dynamic_array_create_empty<int>(16);
+        dynamic_array_push_back(&worker->stack_offsets, parameter_stack_offsets);
+        hashtable_insert_element(&worker->function_parameter_stack_offset_index, function, worker->stack_offsets.size - 1);
+        bytecode_generator_generate_function_code(worker, function);
+    }
+}
+
+// Below this many IR instructions per worker, dispatching to the thread pool costs more than it saves
+const int BYTECODE_GENERATOR_PARALLEL_INSTRUCTIONS_PER_WORKER = 2048;
+
+void bytecode_generator_generate_parallel(Bytecode_Generator* generator, Compiler* compiler, int worker_count)
+{
+    bytecode_generator_reset(generator, compiler);
+    IR_Program* program = generator->ir_program;
+    Dynamic_Array<int> function_sizes = dynamic_array_create_empty<int>(program->functions.size + 1);
+    SCOPE_EXIT(dynamic_array_destroy(&function_sizes));
+    i64 total_size = 0;
+    for (int i = 0; i < program->functions.size; i++) {
+        int size = ir_code_block_count_instructions(program->functions[i]->code) + 1;
+        dynamic_array_push_back(&function_sizes, size);
+        total_size += size;
+    }
+
+    worker_count = math_minimum(worker_count, program->functions.size);
+    worker_count = (int)math_minimum((i64)worker_count, total_size / BYTECODE_GENERATOR_PARALLEL_INSTRUCTIONS_PER_WORKER);
+    if (worker_count <= 1) {
+        bytecode_generator_generate(generator, compiler);
+        return;
+    }
 
+    // Prepare workers, they are kept between compiles so their buffers can be reused
+    while (generator->workers.size < worker_count) {
+        Bytecode_Generator worker = bytecode_generator_create();
+        worker.is_worker = true;
+        dynamic_array_push_back(&generator->workers, worker);
+    }
+    for (int i = 0; i < worker_count; i++) {
+        bytecode_generator_reset(&generator->workers[i], compiler);
+    }
+
+    // Split functions into consecutive ranges of similar size, so that concatenating the workers keeps the serial function order
+    Bytecode_Generator_Parallel_Work work;
+    work.generator = generator;
+    work.function_ranges = dynamic_array_create_empty<int>(worker_count + 1);
+    SCOPE_EXIT(dynamic_array_destroy(&work.function_ranges));
+    {
+        dynamic_array_push_back(&work.function_ranges, 0);
+        i64 accumulated_size = 0;
+        int function_index = 0;
+        for (int i = 1; i < worker_count; i++)
+        {
+            i64 range_end_size = total_size * i / worker_count;
+            while (function_index < program->functions.size && accumulated_size < range_end_size) {
+                accumulated_size += function_sizes[function_index];
+                function_index++;
+            }
+            dynamic_array_push_back(&work.function_ranges, function_index);
+        }
+        dynamic_array_push_back(&work.function_ranges, program->functions.size);
+    }
+
+    parallel_run(worker_count, bytecode_generator_worker_generate_functions, &work);
+
+    // Link worker code, jump targets, constant reads and references are relative to the worker
+    Dynamic_Array<byte>* constant_memory = &program->constant_pool.constant_memory;
+    for (int i = 0; i < worker_count; i++)
+    {
+        Bytecode_Generator* worker = &generator->workers[i];
+        int instruction_base = generator->instructions.size;
+        int constant_base = constant_memory->size;
+
+        dynamic_array_reserve(&generator->instructions, generator->instructions.size + worker->instructions.size);
+        for (int j = 0; j < worker->instructions.size; j++)
+        {
+            Bytecode_Instruction instr = worker->instructions[j];
+            if (instr.instruction_type == Instruction_Type::JUMP ||
+                instr.instruction_type == Instruction_Type::JUMP_ON_TRUE ||
+                instr.instruction_type == Instruction_Type::JUMP_ON_FALSE) {
+                instr.op1 += instruction_base;
+            }
+            dynamic_array_push_back(&generator->instructions, instr);
+        }
+        for (int j = 0; j < worker->fill_out_constant_reads.size; j++) {
+            generator->instructions[instruction_base + worker->fill_out_constant_reads[j]].op2 += constant_base;
+        }
+        for (int j = 0; j < worker->worker_constant_memory.size; j++) {
+            dynamic_array_push_back(constant_memory, worker->worker_constant_memory[j]);
+        }
+
+        for (int j = 0; j < worker->fill_out_calls.size; j++) {
+            Function_Reference ref = worker->fill_out_calls[j];
+            ref.instruction_index += instruction_base;
+            dynamic_array_push_back(&generator->fill_out_calls, ref);
+        }
+        for (int j = 0; j < worker->fill_out_function_ptr_loads.size; j++) {
+            Function_Reference ref = worker->fill_out_function_ptr_loads[j];
+            ref.instruction_index += instruction_base;
+            dynamic_array_push_back(&generator->fill_out_function_ptr_loads, ref);
+        }
+        for (int j = work.function_ranges[i]; j < work.function_ranges[i + 1]; j++) {
+            IR_Function* function = program->functions[j];
+            int location = *hashtable_find_element(&worker->function_locations, function) + instruction_base;
+            hashtable_insert_element(&generator->function_locations, function, location);
+        }
+        for (int j = 0; j < worker->stack_frames.size; j++) {
+            dynamic_array_push_back(&generator->stack_frames, worker->stack_frames[j]);
+        }
+        if (worker->maximum_function_stack_depth > generator->maximum_function_stack_depth) {
+            generator->maximum_function_stack_depth = worker->maximum_function_stack_depth;
+        }
+    }
+
+    bytecode_generator_fill_out_function_references(generator);
+}
+
+
+
+void binary_operation_append_to_string(String* string, int packed)
+{
+    const char* name = "";
+    switch (binary_operation_unpack_instruction_type(packed))
+    {
+    case Instruction_Type::BINARY_OP_ADDITION: name = "+"; break;
+    case Instruction_Type::BINARY_OP_SUBTRACTION: name = "-"; break;
+    case Instruction_Type::BINARY_OP_MULTIPLICATION: name = "*"; break;
+    case Instruction_Type::BINARY_OP_DIVISION: name = "/"; break;
+    case Instruction_Type::BINARY_OP_MODULO: name = "%"; break;
+    case Instruction_Type::BINARY_OP_EQUAL: name = "=="; break;
+    case Instruction_Type::BINARY_OP_NOT_EQUAL: name = "!="; break;
+    case Instruction_Type::BINARY_OP_GREATER_THAN: name = ">"; break;
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL: name = ">="; break;
+    case Instruction_Type::BINARY_OP_LESS_THAN: name = "<"; break;
+    case Instruction_Type::BINARY_OP_LESS_EQUAL: name = "<="; break;
+    default: name = "?"; break;
+    }
+    String type_string = primitive_type_to_string(binary_operation_unpack_primitive_type(packed));
+    string_append_formated(string, "%s, type: %s", name, type_string.characters);
+}
 
 void bytecode_instruction_append_to_string(String* string, Bytecode_Instruction instruction)
 {
@@ -1077,6 +1568,17 @@ void bytecode_instruction_append_to_string(String* string, Bytecode_Instruction
             i.op1, i.op2, primitive_type_to_string((Primitive_Type)i.op3).characters
         );
         break;
+    case Instruction_Type::JUMP_ON_COMPARISON:
+        string_append_formated(string, "JUMP_ON_COMPARISON           instr-nr: %d, left: %d, right: %d, comparison: ", i.op1, i.op2, i.op3);
+        binary_operation_append_to_string(string, i.op4);
+        break;
+    case Instruction_Type::I32_ADD_CONSTANT:
+        string_append_formated(string, "I32_ADD_CONSTANT             dst: %d, src: %d, constant: %d", i.op1, i.op2, i.op3);
+        break;
+    case Instruction_Type::READ_GLOBAL_BINARY_OP:
+        string_append_formated(string, "READ_GLOBAL_BINARY_OP        dst: %d, left_global_offset: %d, right: %d, operation: ", i.op1, i.op2, i.op3);
+        binary_operation_append_to_string(string, i.op4);
+        break;
     default:
         string_append_formated(string, "FUCKING HELL\n");
         break;
@@ -1087,7 +1589,7 @@ void bytecode_generator_append_bytecode_to_string(Bytecode_Generator* generator,
 {
     string_append_formated(string, "Function starts:\n");
     {
-        Hashtable_Iterator<IR_Function*, int> function_iter = hashtable_iterator_create(&generator->function_locations);
+        Hashtable_Iterator<IR_Function*, int, Hasher_Pointer<IR_Function*>> function_iter = hashtable_iterator_create(&generator->function_locations);
         int i = 0;
         while (hashtable_iterator_has_next(&function_iter)) {
             string_append_formated(string, "\t%d: %d\n", i, *function_iter.value);
@@ -33,14 +33,14 @@ enum class Instruction_Type
     JUMP, // op1 = instruction_index
     JUMP_ON_TRUE, // op1 = instruction_index, op2 = cnd_reg
     JUMP_ON_FALSE, // op1 = instruction_index, op2 = cnd_reg
-    CALL_FUNCTION, // Pushes return address, op1 = instruction_index, op2 = stack_offset for new frame
-    CALL_FUNCTION_POINTER, // op1 = src_reg, op2 = stack_offset for new frame
-    CALL_HARDCODED_FUNCTION, // op1 = hardcoded_function_type, op2 = stack_offset for new frame
+    CALL_FUNCTION, // Pushes return address, op1 = instruction_index, op2 = stack_offset for new frame, op3 = argument size (Arguments start at op2 - op3 aligned to 8)
+    CALL_FUNCTION_POINTER, // op1 = src_reg, op2 = stack_offset for new frame, op3 = argument size
+    CALL_HARDCODED_FUNCTION, // op1 = hardcoded_function_type, op2 = stack_offset for new frame, op3 = argument size
     RETURN, // Pops return address, op1 = return_value reg, op2 = return_size (Capped at 16 bytes)
     EXIT, // op1 = exit_code
 
     LOAD_RETURN_VALUE, // op1 = dst_reg, op2 = size
-    LOAD_REGISTER_ADDRESS, // op1 = dest_reg, op2 = register_to_load
+    LOAD_REGISTER_ADDRESS, // op1 = dest_reg, op2 = register_to_load, op3 = register size
     LOAD_GLOBAL_ADDRESS, // op1 = dest_reg, op2 = global offset
     LOAD_FUNCTION_LOCATION, // op1 = dest_reg, op2 = funciton_index
 
@@ -66,9 +66,19 @@ enum class Instruction_Type
 
     // Unary operations work the following: op1 = dest_byte_offset, op2 = operand_offset, op3 = primitive_type
     UNARY_OP_NEGATE,
-    UNARY_OP_NOT
+    UNARY_OP_NOT,
+
+    // Superinstructions, only created by the bytecode optimizer. Packed operands are created with binary_operation_pack
+    JUMP_ON_COMPARISON, // op1 = instruction_index, op2 = left_reg, op3 = right_reg, op4 = packed comparison, jumps if the comparison is true
+    I32_ADD_CONSTANT, // op1 = dest_reg, op2 = src_reg, op3 = constant
+    READ_GLOBAL_BINARY_OP, // op1 = dest_reg, op2 = left global offset, op3 = right_reg, op4 = packed binary operation
 };
 
+// Packs a BINARY_OP_XXX instruction type and its primitive type into one operand
+int binary_operation_pack(Instruction_Type binary_operation, Primitive_Type type);
+Instruction_Type binary_operation_unpack_instruction_type(int packed);
+Primitive_Type binary_operation_unpack_primitive_type(int packed);
+
 struct Bytecode_Instruction
 {
     Instruction_Type instruction_type;
@@ -78,27 +88,64 @@ struct Bytecode_Instruction
     int op4;
 };
 
+Bytecode_Instruction instruction_make_3(Instruction_Type type, int src_1, int src_2, int src_3);
+Bytecode_Instruction instruction_make_4(Instruction_Type type, int src_1, int src_2, int src_3, int src_4);
+
 struct Function_Reference
 {
     IR_Function* function;
     int instruction_index;
 };
 
+// Registers of all blocks in a function share stack slots if their lifetimes do not overlap
+struct Register_Lifetime
+{
+    int first_use; // Instruction positions in generation order, first_use > last_use if the register is never used
+    int last_use;
+    bool address_taken;
+    int code_block_index;
+    Type_Signature* type;
+    int stack_offset;
+};
+
+struct Code_Block_Lifetime
+{
+    int start;
+    int end;
+    int first_register; // Index into register_lifetimes
+    int stack_offset_index;
+};
+
+struct Loop_Lifetime
+{
+    int start;
+    int end;
+};
+
+struct Stack_Frame_Info
+{
+    IR_Function* function;
+    int frame_size;
+    int register_size; // Bytes used by registers with slot reuse
+    int register_size_without_reuse; // Bytes used if every register had its own slot
+};
+
 struct Bytecode_Generator
 {
     // Result data
     Dynamic_Array<Bytecode_Instruction> instructions;
-    Hashtable<IR_Function*, int> function_locations;
+    Hashtable<IR_Function*, int, Hasher_Pointer<IR_Function*>> function_locations;
 
     // Program Information
     Dynamic_Array<Dynamic_Array<int>> stack_offsets;
-    Hashtable<IR_Code_Block*, int> code_block_register_stack_offset_index;
-    Hashtable<IR_Function*, int> function_parameter_stack_offset_index;
+    Hashtable<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>> code_block_register_stack_offset_index;
+    Hashtable<IR_Function*, int, Hasher_Pointer<IR_Function*>> function_parameter_stack_offset_index;
     Dynamic_Array<int> global_data_offsets;
 
     int global_data_size;
     int entry_point_index;
-    int maximum_function_stack_depth;
+    int maximum_function_stack_depth; // Largest frame size, includes temporaries and the start of the frame of called functions
+    Dynamic_Array<Stack_Frame_Info> stack_frames; // In function order
 
     // Data required for generation
     IR_Program* ir_program;
@@ -108,11 +155,29 @@ struct Bytecode_Generator
     Dynamic_Array<int> fill_out_breaks;
     Dynamic_Array<int> fill_out_continues;
     int current_stack_offset;
+
+    // Stack slot allocation, reset for each function
+    Dynamic_Array<Register_Lifetime> register_lifetimes;
+    Dynamic_Array<Code_Block_Lifetime> code_block_lifetimes;
+    Hashtable<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>> code_block_lifetime_index;
+    Dynamic_Array<Loop_Lifetime> loop_lifetimes;
+    Dynamic_Array<int> lifetime_order;
+    Dynamic_Array<int> active_lifetimes;
+    int lifetime_position;
+    int register_area_end; // Temporaries are placed after the registers, they only live for one IR instruction
+
+    // Parallel generation, workers generate consecutive ranges of functions into their own generators which are linked afterwards
+    Dynamic_Array<Bytecode_Generator> workers;
+    bool is_worker;
+    Dynamic_Array<byte> worker_constant_memory; // Workers cannot append to the shared constant pool, so they collect constants here
+    Dynamic_Array<int> fill_out_constant_reads; // READ_CONSTANT instructions of workers, op2 is an offset into worker_constant_memory
 };
 
 Bytecode_Generator bytecode_generator_create();
 void bytecode_generator_destroy(Bytecode_Generator* generator);
 void bytecode_generator_generate(Bytecode_Generator* generator, Compiler* compiler);
+// Produces the same code as bytecode_generator_generate, but generates the functions on up to worker_count threads, small programs are generated serially
+void bytecode_generator_generate_parallel(Bytecode_Generator* generator, Compiler* compiler, int worker_count);
 void bytecode_instruction_append_to_string(String* string, Bytecode_Instruction instruction);
 void bytecode_generator_append_bytecode_to_string(Bytecode_Generator* generator, String* string);
 
@@ -3,23 +3,142 @@
 #include <iostream>
 #include "../../utility/random.hpp"
 #include "compiler.hpp"
+#include "bytecode_profiler.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <unistd.h>
+#endif
 
 Bytecode_Interpreter bytecode_intepreter_create()
 {
     Bytecode_Interpreter result;
-    result.stack = array_create_empty<byte>(8192);
+    result.stack.data = 0;
+    result.stack.size = 0;
+    result.stack_guard_size = 0;
+    result.stack_size = 8 * 1024 * 1024;
     result.globals.data = 0;
     result.random = random_make_time_initalized();
+    result.use_threaded_dispatch = true;
+    result.threaded_code = dynamic_array_create_empty<Bytecode_Threaded_Instruction>(64);
+    result.profiler = 0;
     return result;
 }
 
+void bytecode_interpreter_unmap_stack(Bytecode_Interpreter* interpreter)
+{
+    if (interpreter->stack.data == 0) return;
+#ifdef _WIN32
+    VirtualFree(interpreter->stack.data, 0, MEM_RELEASE);
+#else
+    munmap(interpreter->stack.data, interpreter->stack.size + interpreter->stack_guard_size);
+#endif
+    interpreter->stack.data = 0;
+    interpreter->stack.size = 0;
+    interpreter->stack_guard_size = 0;
+}
+
+// Maps stack_size bytes followed by the guard region, the guard has to be larger than any frame so that no call can skip it
+void bytecode_interpreter_map_stack(Bytecode_Interpreter* interpreter, int maximum_frame_size)
+{
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    u64 page_size = system_info.dwPageSize;
+#else
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+#endif
+    u64 stack_size = (interpreter->stack_size + page_size - 1) / page_size * page_size;
+    u64 guard_size = ((u64)maximum_frame_size + page_size - 1) / page_size * page_size + page_size;
+    if (interpreter->stack.data != 0 && (u64)interpreter->stack.size == stack_size && (u64)interpreter->stack_guard_size >= guard_size) {
+        return;
+    }
+    bytecode_interpreter_unmap_stack(interpreter);
+
+#ifdef _WIN32
+    byte* memory = (byte*)VirtualAlloc(0, stack_size + guard_size, MEM_RESERVE, PAGE_NOACCESS);
+    if (memory == 0 || VirtualAlloc(memory, stack_size, MEM_COMMIT, PAGE_READWRITE) == 0) {
+        panic("Could not allocate interpreter stack\n");
+    }
+#else
+    byte* memory = (byte*)mmap(0, stack_size + guard_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED || mprotect(memory + stack_size, guard_size, PROT_NONE) != 0) {
+        panic("Could not allocate interpreter stack\n");
+    }
+#endif
+    interpreter->stack.data = memory;
+    interpreter->stack.size = (int)stack_size;
+    interpreter->stack_guard_size = (int)guard_size;
+}
+
 void bytecode_interpreter_destroy(Bytecode_Interpreter* interpreter) {
-    array_destroy(&interpreter->stack);
+    bytecode_interpreter_unmap_stack(interpreter);
+    dynamic_array_destroy(&interpreter->threaded_code);
     if (interpreter->globals.data != 0) {
         array_destroy(&interpreter->globals);
     }
 }
 
+template<typename T>
+T binary_operation_modulo(T left, T right) {
+    return left % right;
+}
+f32 binary_operation_modulo(f32, f32) {
+    panic("Modulo on float");
+    return 0.0f;
+}
+f64 binary_operation_modulo(f64, f64) {
+    panic("Modulo on float");
+    return 0.0;
+}
+
+template<typename T>
+void binary_operation_execute_typed(Instruction_Type type, byte* destination, byte* left_ptr, byte* right_ptr)
+{
+    T left = *(T*)left_ptr;
+    T right = *(T*)right_ptr;
+    switch (type)
+    {
+    case Instruction_Type::BINARY_OP_ADDITION: *(T*)destination = left + right; break;
+    case Instruction_Type::BINARY_OP_SUBTRACTION: *(T*)destination = left - right; break;
+    case Instruction_Type::BINARY_OP_MULTIPLICATION: *(T*)destination = left * right; break;
+    case Instruction_Type::BINARY_OP_DIVISION: *(T*)destination = left / right; break;
+    case Instruction_Type::BINARY_OP_MODULO: *(T*)destination = binary_operation_modulo(left, right); break;
+    case Instruction_Type::BINARY_OP_EQUAL: *(u8*)destination = left == right ? 1 : 0; break;
+    case Instruction_Type::BINARY_OP_NOT_EQUAL: *(u8*)destination = left != right ? 1 : 0; break;
+    case Instruction_Type::BINARY_OP_GREATER_THAN: *(u8*)destination = left > right ? 1 : 0; break;
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL: *(u8*)destination = left >= right ? 1 : 0; break;
+    case Instruction_Type::BINARY_OP_LESS_THAN: *(u8*)destination = left < right ? 1 : 0; break;
+    case Instruction_Type::BINARY_OP_LESS_EQUAL: *(u8*)destination = left <= right ? 1 : 0; break;
+    default: panic("Not a binary operation");
+    }
+}
+
+// Executes a packed binary operation (See binary_operation_pack), used by superinstructions
+void binary_operation_execute(int packed, byte* destination, byte* left, byte* right)
+{
+    Instruction_Type type = binary_operation_unpack_instruction_type(packed);
+    switch (binary_operation_unpack_primitive_type(packed))
+    {
+    case Primitive_Type::BOOLEAN: binary_operation_execute_typed<u8>(type, destination, left, right); break;
+    case Primitive_Type::SIGNED_INT_8: binary_operation_execute_typed<i8>(type, destination, left, right); break;
+    case Primitive_Type::SIGNED_INT_16: binary_operation_execute_typed<i16>(type, destination, left, right); break;
+    case Primitive_Type::SIGNED_INT_32: binary_operation_execute_typed<i32>(type, destination, left, right); break;
+    case Primitive_Type::SIGNED_INT_64: binary_operation_execute_typed<i64>(type, destination, left, right); break;
+    case Primitive_Type::UNSIGNED_INT_8: binary_operation_execute_typed<u8>(type, destination, left, right); break;
+    case Primitive_Type::UNSIGNED_INT_16: binary_operation_execute_typed<u16>(type, destination, left, right); break;
+    case Primitive_Type::UNSIGNED_INT_32: binary_operation_execute_typed<u32>(type, destination, left, right); break;
+    case Primitive_Type::UNSIGNED_INT_64: binary_operation_execute_typed<u64>(type, destination, left, right); break;
+    case Primitive_Type::FLOAT_32: binary_operation_execute_typed<f32>(type, destination, left, right); break;
+    case Primitive_Type::FLOAT_64: binary_operation_execute_typed<f64>(type, destination, left, right); break;
+    default: panic("What");
+    }
+}
+
 // Returns true if we need to stop execution, e.g. on exit instruction
 bool bytecode_interpreter_execute_current_instruction(Bytecode_Interpreter* interpreter)
 {
@@ -77,10 +196,6 @@ bool bytecode_interpreter_execute_current_instruction(Bytecode_Interpreter* inte
         }
         break;
     case Instruction_Type::CALL_FUNCTION: {
-        if (&interpreter->stack[interpreter->stack.size-1] - interpreter->stack_pointer < interpreter->generator->maximum_function_stack_depth) {
-            interpreter->exit_code = Exit_Code::STACK_OVERFLOW;
-            return true;
-        }
         byte* base_pointer = interpreter->stack_pointer;
         Bytecode_Instruction* next = interpreter->instruction_pointer + 1;
         interpreter->stack_pointer = interpreter->stack_pointer + i->op2;
@@ -91,11 +206,6 @@ bool bytecode_interpreter_execute_current_instruction(Bytecode_Interpreter* inte
         return false;
     }
     case Instruction_Type::CALL_FUNCTION_POINTER: {
-        if (&interpreter->stack[interpreter->stack.size-1] - interpreter->stack_pointer < interpreter->generator->maximum_function_stack_depth) {
-            interpreter->exit_code = Exit_Code::STACK_OVERFLOW;
-            return true;
-        }
-
         Bytecode_Instruction* jmp_to_instr = *(Bytecode_Instruction**)(interpreter->stack_pointer + i->op1);
         if (jmp_to_instr < interpreter->generator->instructions.data ||
             jmp_to_instr > &interpreter->generator->instructions.data[interpreter->generator->instructions.size]) {
@@ -330,8 +440,8 @@ bool bytecode_interpreter_execute_current_instruction(Bytecode_Interpreter* inte
         default: panic("what the frigg\n");
         }
         switch ((Primitive_Type)i->op3) {
-        case Primitive_Type::FLOAT_32: *(float*)(interpreter->stack_pointer + i->op1) = (float)(source_is_signed ? source_signed : source_unsigned); break;
-        case Primitive_Type::FLOAT_64: *(double*)(interpreter->stack_pointer + i->op1) = (double)(source_is_signed ? source_signed : source_unsigned); break;
+        case Primitive_Type::FLOAT_32: *(float*)(interpreter->stack_pointer + i->op1) = source_is_signed ? (float)source_signed : (float)source_unsigned; break;
+        case Primitive_Type::FLOAT_64: *(double*)(interpreter->stack_pointer + i->op1) = source_is_signed ? (double)source_signed : (double)source_unsigned; break;
         default: panic("what the frigg\n");
         }
         break;
@@ -801,6 +911,21 @@ bool bytecode_interpreter_execute_current_instruction(Bytecode_Interpreter* inte
     case Instruction_Type::UNARY_OP_NOT:
         *(bool*)(interpreter->stack_pointer + i->op1) = !*(bool*)(interpreter->stack_pointer + i->op2);
         break;
+    case Instruction_Type::JUMP_ON_COMPARISON: {
+        u8 condition;
+        binary_operation_execute(i->op4, &condition, interpreter->stack_pointer + i->op2, interpreter->stack_pointer + i->op3);
+        if (condition != 0) {
+            interpreter->instruction_pointer = &interpreter->generator->instructions[i->op1];
+            return false;
+        }
+        break;
+    }
+    case Instruction_Type::I32_ADD_CONSTANT:
+        *(i32*)(interpreter->stack_pointer + i->op1) = *(i32*)(interpreter->stack_pointer + i->op2) + i->op3;
+        break;
+    case Instruction_Type::READ_GLOBAL_BINARY_OP:
+        binary_operation_execute(i->op4, interpreter->stack_pointer + i->op1, interpreter->globals.data + i->op2, interpreter->stack_pointer + i->op3);
+        break;
     default: {
         panic("Should not happen!\n");
         return true;
@@ -867,11 +992,419 @@ void bytecode_interpreter_print_state(Bytecode_Interpreter* interpreter)
     */
 }
 
-void bytecode_interpreter_execute_main(Bytecode_Interpreter* interpreter, Compiler* compiler)
+/*
+    THREADED DISPATCH
+    Direct threaded engine using computed goto (GCC/Clang extension). Each handler jumps straight to the
+    handler of the next instruction, so there is no switch and no call per instruction. Instructions without
+    a specialized handler go through the FALLBACK handler, which executes them with the switch engine.
+*/
+#if defined(__GNUC__) || defined(__clang__)
+#define BYTECODE_INTERPRETER_HAS_THREADED_DISPATCH
+#endif
+
+#ifdef BYTECODE_INTERPRETER_HAS_THREADED_DISPATCH
+
+// Binary operations are specialized for these primitive types, the other ones use the fallback
+// X(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR), PREFIX distinguishes the stack, global and jump variants
+#define BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, OP_NAME, OPERATOR) \
+    X(PREFIX, OP_NAME, I32, i32, OPERATOR) \
+    X(PREFIX, OP_NAME, I64, i64, OPERATOR) \
+    X(PREFIX, OP_NAME, U32, u32, OPERATOR) \
+    X(PREFIX, OP_NAME, U64, u64, OPERATOR) \
+    X(PREFIX, OP_NAME, F32, f32, OPERATOR) \
+    X(PREFIX, OP_NAME, F64, f64, OPERATOR)
+
+#define BYTECODE_THREADED_INTEGER_TYPES(X, PREFIX, OP_NAME, OPERATOR) \
+    X(PREFIX, OP_NAME, I32, i32, OPERATOR) \
+    X(PREFIX, OP_NAME, I64, i64, OPERATOR) \
+    X(PREFIX, OP_NAME, U32, u32, OPERATOR) \
+    X(PREFIX, OP_NAME, U64, u64, OPERATOR)
+
+// Layout is relied upon by threaded_opcode_binary_operation_index
+#define BYTECODE_THREADED_ARITHMETIC_OPS(X, PREFIX) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, ADD, +) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, SUB, -) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, MUL, *) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, DIV, /) \
+    BYTECODE_THREADED_INTEGER_TYPES(X, PREFIX, MOD, %)
+
+#define BYTECODE_THREADED_COMPARISON_OPS(X, PREFIX) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, EQ, ==) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, NE, !=) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, GT, >) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, GE, >=) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, LT, <) \
+    BYTECODE_THREADED_PRIMITIVE_TYPES(X, PREFIX, LE, <=)
+
+#define BYTECODE_THREADED_SIMPLE_OPCODES(X) \
+    X(FALLBACK) \
+    X(MOVE_1) X(MOVE_4) X(MOVE_8) X(MOVE_N) \
+    X(READ_MEMORY_4) X(READ_MEMORY_8) X(READ_MEMORY_N) \
+    X(WRITE_MEMORY_4) X(WRITE_MEMORY_8) X(WRITE_MEMORY_N) \
+    X(READ_GLOBAL_4) X(READ_GLOBAL_8) X(READ_GLOBAL_N) \
+    X(WRITE_GLOBAL_4) X(WRITE_GLOBAL_8) X(WRITE_GLOBAL_N) \
+    X(READ_CONSTANT_4) X(READ_CONSTANT_8) X(READ_CONSTANT_N) \
+    X(LOAD_RETURN_VALUE_4) X(LOAD_RETURN_VALUE_8) X(LOAD_RETURN_VALUE_N) \
+    X(MEMORY_COPY) \
+    X(U64_ADD_CONSTANT_I32) X(U64_MULTIPLY_ADD_I32) X(I32_ADD_CONSTANT) \
+    X(JUMP) X(JUMP_ON_TRUE) X(JUMP_ON_FALSE) \
+    X(CALL_FUNCTION) X(CALL_FUNCTION_POINTER) X(RETURN) X(EXIT) \
+    X(LOAD_REGISTER_ADDRESS) X(LOAD_GLOBAL_ADDRESS) X(LOAD_FUNCTION_LOCATION) \
+    X(AND) X(OR) X(NOT) \
+    X(NEGATE_I32) X(NEGATE_I64) X(NEGATE_F32) X(NEGATE_F64) \
+    X(EQ_BOOL) X(NE_BOOL)
+
+enum class Threaded_Opcode
+{
+#define BYTECODE_THREADED_ENUM_SIMPLE(NAME) NAME,
+#define BYTECODE_THREADED_ENUM_TYPED(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR) PREFIX##OP_NAME##_##TYPE_NAME,
+    BYTECODE_THREADED_SIMPLE_OPCODES(BYTECODE_THREADED_ENUM_SIMPLE)
+    BYTECODE_THREADED_ARITHMETIC_OPS(BYTECODE_THREADED_ENUM_TYPED, )
+    BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_ENUM_TYPED, )
+    BYTECODE_THREADED_ARITHMETIC_OPS(BYTECODE_THREADED_ENUM_TYPED, GLOBAL_)
+    BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_ENUM_TYPED, GLOBAL_)
+    BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_ENUM_TYPED, JUMP_IF_)
+    COUNT
+};
+
+// Returns the offset from the ADD_I32/SUB_I32... opcode for the primitive type, or -1 if there is no specialization
+int threaded_opcode_primitive_type_offset(Primitive_Type type)
+{
+    switch (type)
+    {
+    case Primitive_Type::SIGNED_INT_32: return 0;
+    case Primitive_Type::SIGNED_INT_64: return 1;
+    case Primitive_Type::UNSIGNED_INT_32: return 2;
+    case Primitive_Type::UNSIGNED_INT_64: return 3;
+    case Primitive_Type::FLOAT_32: return 4;
+    case Primitive_Type::FLOAT_64: return 5;
+    }
+    return -1;
+}
+
+// Returns the offset from ADD_I32 (Or GLOBAL_ADD_I32), comparisons start at EQ_I32 - ADD_I32, or -1 if there is no specialization
+int threaded_opcode_binary_operation_index(Instruction_Type binary_operation, Primitive_Type type)
+{
+    int type_offset = threaded_opcode_primitive_type_offset(type);
+    if (type_offset == -1) {
+        return -1;
+    }
+    const int comparison_start = (int)Threaded_Opcode::EQ_I32 - (int)Threaded_Opcode::ADD_I32;
+    switch (binary_operation)
+    {
+    case Instruction_Type::BINARY_OP_ADDITION: return 0 + type_offset;
+    case Instruction_Type::BINARY_OP_SUBTRACTION: return 6 + type_offset;
+    case Instruction_Type::BINARY_OP_MULTIPLICATION: return 12 + type_offset;
+    case Instruction_Type::BINARY_OP_DIVISION: return 18 + type_offset;
+    case Instruction_Type::BINARY_OP_MODULO:
+        if (type_offset > 3) return -1;
+        return 24 + type_offset;
+    case Instruction_Type::BINARY_OP_EQUAL: return comparison_start + 0 + type_offset;
+    case Instruction_Type::BINARY_OP_NOT_EQUAL: return comparison_start + 6 + type_offset;
+    case Instruction_Type::BINARY_OP_GREATER_THAN: return comparison_start + 12 + type_offset;
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL: return comparison_start + 18 + type_offset;
+    case Instruction_Type::BINARY_OP_LESS_THAN: return comparison_start + 24 + type_offset;
+    case Instruction_Type::BINARY_OP_LESS_EQUAL: return comparison_start + 30 + type_offset;
+    }
+    return -1;
+}
+
+Threaded_Opcode threaded_opcode_select_sized(int size, Threaded_Opcode opcode_4, Threaded_Opcode opcode_8, Threaded_Opcode opcode_n)
+{
+    if (size == 4) return opcode_4;
+    if (size == 8) return opcode_8;
+    return opcode_n;
+}
+
+Threaded_Opcode threaded_opcode_select_binary_op(Instruction_Type binary_operation, Primitive_Type type, Threaded_Opcode first_opcode)
+{
+    int index = threaded_opcode_binary_operation_index(binary_operation, type);
+    if (index == -1) {
+        return Threaded_Opcode::FALLBACK;
+    }
+    return (Threaded_Opcode)((int)first_opcode + index);
+}
+
+Threaded_Opcode threaded_opcode_select(Bytecode_Instruction* instruction)
+{
+    switch (instruction->instruction_type)
+    {
+    case Instruction_Type::MOVE_STACK_DATA:
+        if (instruction->op3 == 1) return Threaded_Opcode::MOVE_1;
+        return threaded_opcode_select_sized(instruction->op3, Threaded_Opcode::MOVE_4, Threaded_Opcode::MOVE_8, Threaded_Opcode::MOVE_N);
+    case Instruction_Type::READ_MEMORY:
+        return threaded_opcode_select_sized(instruction->op3, Threaded_Opcode::READ_MEMORY_4, Threaded_Opcode::READ_MEMORY_8, Threaded_Opcode::READ_MEMORY_N);
+    case Instruction_Type::WRITE_MEMORY:
+        return threaded_opcode_select_sized(instruction->op3, Threaded_Opcode::WRITE_MEMORY_4, Threaded_Opcode::WRITE_MEMORY_8, Threaded_Opcode::WRITE_MEMORY_N);
+    case Instruction_Type::READ_GLOBAL:
+        return threaded_opcode_select_sized(instruction->op3, Threaded_Opcode::READ_GLOBAL_4, Threaded_Opcode::READ_GLOBAL_8, Threaded_Opcode::READ_GLOBAL_N);
+    case Instruction_Type::WRITE_GLOBAL:
+        return threaded_opcode_select_sized(instruction->op3, Threaded_Opcode::WRITE_GLOBAL_4, Threaded_Opcode::WRITE_GLOBAL_8, Threaded_Opcode::WRITE_GLOBAL_N);
+    case Instruction_Type::READ_CONSTANT:
+        return threaded_opcode_select_sized(instruction->op3, Threaded_Opcode::READ_CONSTANT_4, Threaded_Opcode::READ_CONSTANT_8, Threaded_Opcode::READ_CONSTANT_N);
+    case Instruction_Type::LOAD_RETURN_VALUE:
+        return threaded_opcode_select_sized(instruction->op2, Threaded_Opcode::LOAD_RETURN_VALUE_4, Threaded_Opcode::LOAD_RETURN_VALUE_8, Threaded_Opcode::LOAD_RETURN_VALUE_N);
+    case Instruction_Type::MEMORY_COPY: return Threaded_Opcode::MEMORY_COPY;
+    case Instruction_Type::U64_ADD_CONSTANT_I32: return Threaded_Opcode::U64_ADD_CONSTANT_I32;
+    case Instruction_Type::U64_MULTIPLY_ADD_I32: return Threaded_Opcode::U64_MULTIPLY_ADD_I32;
+    case Instruction_Type::JUMP: return Threaded_Opcode::JUMP;
+    case Instruction_Type::JUMP_ON_TRUE: return Threaded_Opcode::JUMP_ON_TRUE;
+    case Instruction_Type::JUMP_ON_FALSE: return Threaded_Opcode::JUMP_ON_FALSE;
+    case Instruction_Type::CALL_FUNCTION: return Threaded_Opcode::CALL_FUNCTION;
+    case Instruction_Type::CALL_FUNCTION_POINTER: return Threaded_Opcode::CALL_FUNCTION_POINTER;
+    case Instruction_Type::RETURN:
+        // The switch engine reports the overflow
+        if (instruction->op2 > 256) return Threaded_Opcode::FALLBACK;
+        return Threaded_Opcode::RETURN;
+    case Instruction_Type::EXIT: return Threaded_Opcode::EXIT;
+    case Instruction_Type::LOAD_REGISTER_ADDRESS: return Threaded_Opcode::LOAD_REGISTER_ADDRESS;
+    case Instruction_Type::LOAD_GLOBAL_ADDRESS: return Threaded_Opcode::LOAD_GLOBAL_ADDRESS;
+    case Instruction_Type::LOAD_FUNCTION_LOCATION: return Threaded_Opcode::LOAD_FUNCTION_LOCATION;
+    case Instruction_Type::BINARY_OP_EQUAL:
+    case Instruction_Type::BINARY_OP_NOT_EQUAL:
+        if ((Primitive_Type)instruction->op4 == Primitive_Type::BOOLEAN) {
+            return instruction->instruction_type == Instruction_Type::BINARY_OP_EQUAL ? Threaded_Opcode::EQ_BOOL : Threaded_Opcode::NE_BOOL;
+        }
+        return threaded_opcode_select_binary_op(instruction->instruction_type, (Primitive_Type)instruction->op4, Threaded_Opcode::ADD_I32);
+    case Instruction_Type::BINARY_OP_ADDITION:
+    case Instruction_Type::BINARY_OP_SUBTRACTION:
+    case Instruction_Type::BINARY_OP_MULTIPLICATION:
+    case Instruction_Type::BINARY_OP_DIVISION:
+    case Instruction_Type::BINARY_OP_MODULO:
+    case Instruction_Type::BINARY_OP_GREATER_THAN:
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL:
+    case Instruction_Type::BINARY_OP_LESS_THAN:
+    case Instruction_Type::BINARY_OP_LESS_EQUAL:
+        return threaded_opcode_select_binary_op(instruction->instruction_type, (Primitive_Type)instruction->op4, Threaded_Opcode::ADD_I32);
+    case Instruction_Type::READ_GLOBAL_BINARY_OP:
+        return threaded_opcode_select_binary_op(
+            binary_operation_unpack_instruction_type(instruction->op4), binary_operation_unpack_primitive_type(instruction->op4), Threaded_Opcode::GLOBAL_ADD_I32
+        );
+    case Instruction_Type::JUMP_ON_COMPARISON: {
+        Threaded_Opcode opcode = threaded_opcode_select_binary_op(
+            binary_operation_unpack_instruction_type(instruction->op4), binary_operation_unpack_primitive_type(instruction->op4), Threaded_Opcode::ADD_I32
+        );
+        if (opcode == Threaded_Opcode::FALLBACK) {
+            return opcode;
+        }
+        return (Threaded_Opcode)((int)opcode - (int)Threaded_Opcode::EQ_I32 + (int)Threaded_Opcode::JUMP_IF_EQ_I32);
+    }
+    case Instruction_Type::I32_ADD_CONSTANT: return Threaded_Opcode::I32_ADD_CONSTANT;
+    case Instruction_Type::BINARY_OP_AND: return Threaded_Opcode::AND;
+    case Instruction_Type::BINARY_OP_OR: return Threaded_Opcode::OR;
+    case Instruction_Type::UNARY_OP_NOT: return Threaded_Opcode::NOT;
+    case Instruction_Type::UNARY_OP_NEGATE:
+        switch ((Primitive_Type)instruction->op3)
+        {
+        case Primitive_Type::SIGNED_INT_32: return Threaded_Opcode::NEGATE_I32;
+        case Primitive_Type::SIGNED_INT_64: return Threaded_Opcode::NEGATE_I64;
+        case Primitive_Type::FLOAT_32: return Threaded_Opcode::NEGATE_F32;
+        case Primitive_Type::FLOAT_64: return Threaded_Opcode::NEGATE_F64;
+        }
+        return Threaded_Opcode::FALLBACK;
+    }
+    // Casts and hardcoded functions
+    return Threaded_Opcode::FALLBACK;
+}
+
+void bytecode_interpreter_execute_threaded(Bytecode_Interpreter* interpreter)
+{
+    static void* handlers[] = {
+#define BYTECODE_THREADED_LABEL_SIMPLE(NAME) &&handler_##NAME,
+#define BYTECODE_THREADED_LABEL_TYPED(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR) &&handler_##PREFIX##OP_NAME##_##TYPE_NAME,
+        BYTECODE_THREADED_SIMPLE_OPCODES(BYTECODE_THREADED_LABEL_SIMPLE)
+        BYTECODE_THREADED_ARITHMETIC_OPS(BYTECODE_THREADED_LABEL_TYPED, )
+        BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_LABEL_TYPED, )
+        BYTECODE_THREADED_ARITHMETIC_OPS(BYTECODE_THREADED_LABEL_TYPED, GLOBAL_)
+        BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_LABEL_TYPED, GLOBAL_)
+        BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_LABEL_TYPED, JUMP_IF_)
+    };
+    static_assert(sizeof(handlers) / sizeof(void*) == (int)Threaded_Opcode::COUNT, "Handler table must match Threaded_Opcode");
+
+    // Translate bytecode to threaded code
+    Dynamic_Array<Bytecode_Instruction>* bytecode = &interpreter->generator->instructions;
+    Dynamic_Array<Bytecode_Threaded_Instruction>* threaded_code = &interpreter->threaded_code;
+    dynamic_array_reset(threaded_code);
+    dynamic_array_reserve(threaded_code, bytecode->size);
+    for (int i = 0; i < bytecode->size; i++)
+    {
+        Bytecode_Instruction* instruction = &bytecode->data[i];
+        Bytecode_Threaded_Instruction threaded;
+        threaded.handler = handlers[(int)threaded_opcode_select(instruction)];
+        threaded.op1 = instruction->op1;
+        threaded.op2 = instruction->op2;
+        threaded.op3 = instruction->op3;
+        threaded.op4 = instruction->op4;
+        dynamic_array_push_back(threaded_code, threaded);
+    }
+
+    Bytecode_Threaded_Instruction* code = threaded_code->data;
+    Bytecode_Threaded_Instruction* ip = &code[interpreter->instruction_pointer - bytecode->data];
+    byte* sp = interpreter->stack_pointer;
+    byte* globals = interpreter->globals.data;
+    byte* constants = interpreter->compiler->analyser.program->constant_pool.constant_memory.data;
+
+#define BYTECODE_THREADED_DISPATCH() goto *ip->handler
+#define BYTECODE_THREADED_NEXT() ip++; BYTECODE_THREADED_DISPATCH()
+#define BYTECODE_THREADED_STOP() \
+    interpreter->stack_pointer = sp; \
+    interpreter->instruction_pointer = &bytecode->data[ip - code]; \
+    return;
+
+    BYTECODE_THREADED_DISPATCH();
+
+handler_FALLBACK:
+    interpreter->stack_pointer = sp;
+    interpreter->instruction_pointer = &bytecode->data[ip - code];
+    if (bytecode_interpreter_execute_current_instruction(interpreter)) {
+        return;
+    }
+    sp = interpreter->stack_pointer;
+    ip = &code[interpreter->instruction_pointer - bytecode->data];
+    BYTECODE_THREADED_DISPATCH();
+
+handler_MOVE_1: *(u8*)(sp + ip->op1) = *(u8*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_MOVE_4: *(u32*)(sp + ip->op1) = *(u32*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_MOVE_8: *(u64*)(sp + ip->op1) = *(u64*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_MOVE_N: memory_copy(sp + ip->op1, sp + ip->op2, ip->op3); BYTECODE_THREADED_NEXT();
+
+handler_READ_MEMORY_4: *(u32*)(sp + ip->op1) = **(u32**)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_READ_MEMORY_8: *(u64*)(sp + ip->op1) = **(u64**)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_READ_MEMORY_N: memory_copy(sp + ip->op1, *(void**)(sp + ip->op2), ip->op3); BYTECODE_THREADED_NEXT();
+
+handler_WRITE_MEMORY_4: **(u32**)(sp + ip->op1) = *(u32*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_WRITE_MEMORY_8: **(u64**)(sp + ip->op1) = *(u64*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_WRITE_MEMORY_N: memory_copy(*(void**)(sp + ip->op1), sp + ip->op2, ip->op3); BYTECODE_THREADED_NEXT();
+
+handler_READ_GLOBAL_4: *(u32*)(sp + ip->op1) = *(u32*)(globals + ip->op2); BYTECODE_THREADED_NEXT();
+handler_READ_GLOBAL_8: *(u64*)(sp + ip->op1) = *(u64*)(globals + ip->op2); BYTECODE_THREADED_NEXT();
+handler_READ_GLOBAL_N: memory_copy(sp + ip->op1, globals + ip->op2, ip->op3); BYTECODE_THREADED_NEXT();
+
+handler_WRITE_GLOBAL_4: *(u32*)(globals + ip->op1) = *(u32*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_WRITE_GLOBAL_8: *(u64*)(globals + ip->op1) = *(u64*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_WRITE_GLOBAL_N: memory_copy(globals + ip->op1, sp + ip->op2, ip->op3); BYTECODE_THREADED_NEXT();
+
+handler_READ_CONSTANT_4: *(u32*)(sp + ip->op1) = *(u32*)(constants + ip->op2); BYTECODE_THREADED_NEXT();
+handler_READ_CONSTANT_8: *(u64*)(sp + ip->op1) = *(u64*)(constants + ip->op2); BYTECODE_THREADED_NEXT();
+handler_READ_CONSTANT_N: memory_copy(sp + ip->op1, constants + ip->op2, ip->op3); BYTECODE_THREADED_NEXT();
+
+handler_LOAD_RETURN_VALUE_4: *(u32*)(sp + ip->op1) = *(u32*)interpreter->return_register; BYTECODE_THREADED_NEXT();
+handler_LOAD_RETURN_VALUE_8: *(u64*)(sp + ip->op1) = *(u64*)interpreter->return_register; BYTECODE_THREADED_NEXT();
+handler_LOAD_RETURN_VALUE_N: memory_copy(sp + ip->op1, interpreter->return_register, ip->op2); BYTECODE_THREADED_NEXT();
+
+handler_MEMORY_COPY: memory_copy(*(void**)(sp + ip->op1), *(void**)(sp + ip->op2), ip->op3); BYTECODE_THREADED_NEXT();
+
+handler_U64_ADD_CONSTANT_I32: *(u64*)(sp + ip->op1) = *(u64*)(sp + ip->op2) + (ip->op3); BYTECODE_THREADED_NEXT();
+handler_U64_MULTIPLY_ADD_I32: {
+    u64 offset = (u64)((*(u32*)(sp + ip->op3)) * (u64)ip->op4);
+    if ((i32)offset < 0) {
+        interpreter->exit_code = Exit_Code::OUT_OF_BOUNDS;
+        BYTECODE_THREADED_STOP();
+    }
+    *(byte**)(sp + ip->op1) = *(byte**)(sp + ip->op2) + offset;
+    BYTECODE_THREADED_NEXT();
+}
+
+handler_JUMP: ip = &code[ip->op1]; BYTECODE_THREADED_DISPATCH();
+handler_JUMP_ON_TRUE:
+    if (*(sp + ip->op2) != 0) {
+        ip = &code[ip->op1];
+        BYTECODE_THREADED_DISPATCH();
+    }
+    BYTECODE_THREADED_NEXT();
+handler_JUMP_ON_FALSE:
+    if (*(sp + ip->op2) == 0) {
+        ip = &code[ip->op1];
+        BYTECODE_THREADED_DISPATCH();
+    }
+    BYTECODE_THREADED_NEXT();
+
+    // Return addresses on the stack point into the threaded code while this engine runs
+handler_CALL_FUNCTION: {
+    byte* base_pointer = sp;
+    sp = sp + ip->op2;
+    *(Bytecode_Threaded_Instruction**)sp = ip + 1;
+    *(byte**)(sp + 8) = base_pointer;
+    ip = &code[ip->op1];
+    BYTECODE_THREADED_DISPATCH();
+}
+handler_CALL_FUNCTION_POINTER: {
+    Bytecode_Threaded_Instruction* jmp_to_instr = *(Bytecode_Threaded_Instruction**)(sp + ip->op1);
+    if (jmp_to_instr < code || jmp_to_instr >= &code[threaded_code->size]) {
+        interpreter->exit_code = Exit_Code::RETURN_VALUE_OVERFLOW;
+        BYTECODE_THREADED_STOP();
+    }
+    byte* base_pointer = sp;
+    sp = sp + ip->op2;
+    *(Bytecode_Threaded_Instruction**)sp = ip + 1;
+    *(byte**)(sp + 8) = base_pointer;
+    ip = jmp_to_instr;
+    BYTECODE_THREADED_DISPATCH();
+}
+handler_RETURN:
+    memory_copy(interpreter->return_register, sp + ip->op1, ip->op2);
+    ip = *(Bytecode_Threaded_Instruction**)sp;
+    sp = *(byte**)(sp + 8);
+    BYTECODE_THREADED_DISPATCH();
+handler_EXIT:
+    interpreter->exit_code = (Exit_Code)ip->op1;
+    BYTECODE_THREADED_STOP();
+
+handler_LOAD_REGISTER_ADDRESS: *(void**)(sp + ip->op1) = (void*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_LOAD_GLOBAL_ADDRESS: *(void**)(sp + ip->op1) = (void*)(globals + ip->op2); BYTECODE_THREADED_NEXT();
+handler_LOAD_FUNCTION_LOCATION: *(Bytecode_Threaded_Instruction**)(sp + ip->op1) = &code[ip->op2]; BYTECODE_THREADED_NEXT();
+
+handler_AND: *(bool*)(sp + ip->op1) = *(bool*)(sp + ip->op2) && *(bool*)(sp + ip->op3); BYTECODE_THREADED_NEXT();
+handler_OR: *(bool*)(sp + ip->op1) = *(bool*)(sp + ip->op2) || *(bool*)(sp + ip->op3); BYTECODE_THREADED_NEXT();
+handler_NOT: *(bool*)(sp + ip->op1) = !*(bool*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_EQ_BOOL: *(u8*)(sp + ip->op1) = *(u8*)(sp + ip->op2) == *(u8*)(sp + ip->op3) ? 1 : 0; BYTECODE_THREADED_NEXT();
+handler_NE_BOOL: *(u8*)(sp + ip->op1) = *(u8*)(sp + ip->op2) != *(u8*)(sp + ip->op3) ? 1 : 0; BYTECODE_THREADED_NEXT();
+
+handler_NEGATE_I32: *(i32*)(sp + ip->op1) = -*(i32*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_NEGATE_I64: *(i64*)(sp + ip->op1) = -*(i64*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_NEGATE_F32: *(f32*)(sp + ip->op1) = -*(f32*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+handler_NEGATE_F64: *(f64*)(sp + ip->op1) = -*(f64*)(sp + ip->op2); BYTECODE_THREADED_NEXT();
+
+handler_I32_ADD_CONSTANT: *(i32*)(sp + ip->op1) = *(i32*)(sp + ip->op2) + ip->op3; BYTECODE_THREADED_NEXT();
+
+#define BYTECODE_THREADED_HANDLER_ARITHMETIC(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR) \
+handler_##OP_NAME##_##TYPE_NAME: \
+    *(TYPE*)(sp + ip->op1) = *(TYPE*)(sp + ip->op2) OPERATOR *(TYPE*)(sp + ip->op3); \
+    BYTECODE_THREADED_NEXT();
+#define BYTECODE_THREADED_HANDLER_COMPARISON(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR) \
+handler_##OP_NAME##_##TYPE_NAME: \
+    *(u8*)(sp + ip->op1) = *(TYPE*)(sp + ip->op2) OPERATOR *(TYPE*)(sp + ip->op3) ? 1 : 0; \
+    BYTECODE_THREADED_NEXT();
+#define BYTECODE_THREADED_HANDLER_GLOBAL_ARITHMETIC(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR) \
+handler_GLOBAL_##OP_NAME##_##TYPE_NAME: \
+    *(TYPE*)(sp + ip->op1) = *(TYPE*)(globals + ip->op2) OPERATOR *(TYPE*)(sp + ip->op3); \
+    BYTECODE_THREADED_NEXT();
+#define BYTECODE_THREADED_HANDLER_GLOBAL_COMPARISON(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR) \
+handler_GLOBAL_##OP_NAME##_##TYPE_NAME: \
+    *(u8*)(sp + ip->op1) = *(TYPE*)(globals + ip->op2) OPERATOR *(TYPE*)(sp + ip->op3) ? 1 : 0; \
+    BYTECODE_THREADED_NEXT();
+#define BYTECODE_THREADED_HANDLER_JUMP_COMPARISON(PREFIX, OP_NAME, TYPE_NAME, TYPE, OPERATOR) \
+handler_JUMP_IF_##OP_NAME##_##TYPE_NAME: \
+    if (*(TYPE*)(sp + ip->op2) OPERATOR *(TYPE*)(sp + ip->op3)) { \
+        ip = &code[ip->op1]; \
+        BYTECODE_THREADED_DISPATCH(); \
+    } \
+    BYTECODE_THREADED_NEXT();
+    BYTECODE_THREADED_ARITHMETIC_OPS(BYTECODE_THREADED_HANDLER_ARITHMETIC, )
+    BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_HANDLER_COMPARISON, )
+    BYTECODE_THREADED_ARITHMETIC_OPS(BYTECODE_THREADED_HANDLER_GLOBAL_ARITHMETIC, )
+    BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_HANDLER_GLOBAL_COMPARISON, )
+    BYTECODE_THREADED_COMPARISON_OPS(BYTECODE_THREADED_HANDLER_JUMP_COMPARISON, )
+}
+
+#endif
+
+void bytecode_interpreter_prepare_execution(Bytecode_Interpreter* interpreter, Compiler* compiler)
 {
     interpreter->compiler = compiler;
     interpreter->generator = &compiler->bytecode_generator;
     memory_set_bytes(&interpreter->return_register, 256, 0);
+    bytecode_interpreter_map_stack(interpreter, interpreter->generator->maximum_function_stack_depth);
     memory_set_bytes(interpreter->stack.data, 16, 0);
     interpreter->instruction_pointer = &interpreter->generator->instructions[interpreter->generator->entry_point_index];
     interpreter->stack_pointer = &interpreter->stack[0];
@@ -881,10 +1414,114 @@ void bytecode_interpreter_execute_main(Bytecode_Interpreter* interpreter, Compil
         }
         interpreter->globals = array_create_empty<byte>(interpreter->generator->global_data_size);
     }
-    int current_instruction_index = interpreter->instruction_pointer - interpreter->generator->instructions.data;
+}
+
+#ifdef _WIN32
+
+static int bytecode_interpreter_stack_guard_filter(Bytecode_Interpreter* interpreter, EXCEPTION_POINTERS* exception)
+{
+    if (exception->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION) {
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+    byte* address = (byte*)exception->ExceptionRecord->ExceptionInformation[1];
+    byte* guard_start = interpreter->stack.data + interpreter->stack.size;
+    if (address >= guard_start && address < guard_start + interpreter->stack_guard_size) {
+        return EXCEPTION_EXECUTE_HANDLER;
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void bytecode_interpreter_execute_with_stack_guard(Bytecode_Interpreter* interpreter, void(*execute)(Bytecode_Interpreter*, void*), void* userdata)
+{
+    __try {
+        execute(interpreter, userdata);
+    }
+    __except (bytecode_interpreter_stack_guard_filter(interpreter, GetExceptionInformation())) {
+        interpreter->exit_code = Exit_Code::STACK_OVERFLOW;
+    }
+}
+
+#else
+
+// Signal handlers cannot take parameters, so the guarded execution is stored globally (Only one execution runs at a time)
+static Bytecode_Interpreter* stack_guard_interpreter = 0;
+static sigjmp_buf stack_guard_jump;
+static struct sigaction stack_guard_previous_action;
+
+static void bytecode_interpreter_stack_guard_handler(int, siginfo_t* info, void*)
+{
+    Bytecode_Interpreter* interpreter = stack_guard_interpreter;
+    byte* address = (byte*)info->si_addr;
+    if (interpreter != 0) {
+        byte* guard_start = interpreter->stack.data + interpreter->stack.size;
+        if (address >= guard_start && address < guard_start + interpreter->stack_guard_size) {
+            siglongjmp(stack_guard_jump, 1);
+        }
+    }
+    // Not a stack overflow, restore the previous handler, which handles the fault once the instruction is retried
+    sigaction(SIGSEGV, &stack_guard_previous_action, 0);
+}
+
+void bytecode_interpreter_execute_with_stack_guard(Bytecode_Interpreter* interpreter, void(*execute)(Bytecode_Interpreter*, void*), void* userdata)
+{
+    struct sigaction action;
+    memory_set_bytes(&action, sizeof(action), 0);
+    action.sa_sigaction = &bytecode_interpreter_stack_guard_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &stack_guard_previous_action);
+    stack_guard_interpreter = interpreter;
+    if (sigsetjmp(stack_guard_jump, 1) == 0) {
+        execute(interpreter, userdata);
+    }
+    else {
+        interpreter->exit_code = Exit_Code::STACK_OVERFLOW;
+    }
+    stack_guard_interpreter = 0;
+    sigaction(SIGSEGV, &stack_guard_previous_action, 0);
+}
+
+#endif
+
+void bytecode_interpreter_execute_profiled(Bytecode_Interpreter* interpreter)
+{
+    Bytecode_Profiler* profiler = interpreter->profiler;
+    bytecode_profiler_reset(profiler, interpreter->compiler);
+    Bytecode_Instruction* instructions = interpreter->generator->instructions.data;
+    u64* counts = profiler->instruction_counts.data;
+    u64 executed = 0;
+    while (true) {
+        counts[interpreter->instruction_pointer - instructions]++;
+        executed++;
+        // Reading the timer is too slow for every instruction
+        if ((executed & 1023) == 0) {
+            bytecode_profiler_sample(profiler, interpreter);
+        }
+        if (bytecode_interpreter_execute_current_instruction(interpreter)) { break; }
+    }
+}
+
+void bytecode_interpreter_execute_prepared(Bytecode_Interpreter* interpreter, void*)
+{
+    if (interpreter->profiler != 0) {
+        bytecode_interpreter_execute_profiled(interpreter);
+        return;
+    }
+#ifdef BYTECODE_INTERPRETER_HAS_THREADED_DISPATCH
+    if (interpreter->use_threaded_dispatch) {
+        bytecode_interpreter_execute_threaded(interpreter);
+        return;
+    }
+#endif
 
     while (true) {
         //bytecode_interpreter_print_state(interpreter);
         if (bytecode_interpreter_execute_current_instruction(interpreter)) { break; }
     }
+}
+
+void bytecode_interpreter_execute_main(Bytecode_Interpreter* interpreter, Compiler* compiler)
+{
+    bytecode_interpreter_prepare_execution(interpreter, compiler);
+    bytecode_interpreter_execute_with_stack_guard(interpreter, &bytecode_interpreter_execute_prepared, 0);
 }
\ No newline at end of file
@@ -1,29 +1,60 @@
 #pragma once
 
 #include "../../datastructures/array.hpp"
+#include "../../datastructures/dynamic_array.hpp"
 #include "../../utility/datatypes.hpp"
 #include "../../utility/random.hpp"
 #include "semantic_analyser.hpp"
 
 struct Compiler;
 struct Bytecode_Generator;
+struct Bytecode_Profiler;
 struct Bytecode_Instruction;
 
+/*
+    Threaded code is created from the bytecode before execution, one entry per Bytecode_Instruction (So indices stay the same).
+    Each entry stores the address of the handler label that executes it, specialized by operand size and primitive type.
+*/
+struct Bytecode_Threaded_Instruction
+{
+    void* handler;
+    int op1;
+    int op2;
+    int op3;
+    int op4;
+};
+
 struct Bytecode_Interpreter
 {
     Compiler* compiler;
     Bytecode_Generator* generator;
     Bytecode_Instruction* instruction_pointer;
     byte return_register[256];
-    Array<byte> stack;
+    /*
+        The stack is a virtual memory mapping, pages are only backed by memory once they are touched.
+        It is followed by a guard region without access rights, which is at least as large as the largest stack frame,
+        so overflows fault inside the guard region and end the execution with Exit_Code::STACK_OVERFLOW.
+    */
+    Array<byte> stack; // Usable part of the mapping
+    int stack_guard_size;
+    u64 stack_size; // Requested size, the mapping is recreated in prepare_execution if it changed
     Array<byte> globals;
     byte* stack_pointer;
     Exit_Code exit_code;
     Random random;
+
+    // Computed goto engine, only available with GCC/Clang, otherwise the switch engine is always used
+    bool use_threaded_dispatch;
+    Dynamic_Array<Bytecode_Threaded_Instruction> threaded_code;
+
+    Bytecode_Profiler* profiler; // If set, the switch engine runs with instruction counters and call stack sampling
 };
 
 Bytecode_Interpreter bytecode_intepreter_create();
 void bytecode_interpreter_destroy(Bytecode_Interpreter* interpreter);
 bool bytecode_interpreter_execute_current_instruction(Bytecode_Interpreter* interpreter);
+void bytecode_interpreter_prepare_execution(Bytecode_Interpreter* interpreter, Compiler* compiler); // Resets stack, instruction pointer and globals
 void bytecode_interpreter_execute_main(Bytecode_Interpreter* interpreter, Compiler* compiler);
+// Runs the function, faults in the stack guard region stop the execution with Exit_Code::STACK_OVERFLOW
+void bytecode_interpreter_execute_with_stack_guard(Bytecode_Interpreter* interpreter, void(*execute)(Bytecode_Interpreter*, void*), void* userdata);
 void bytecode_interpreter_print_state(Bytecode_Interpreter* interpreter);
@@ -0,0 +1,808 @@
+#include "bytecode_jit.hpp"
+
+#include <cstddef>
+#include "compiler.hpp"
+
+#ifdef BYTECODE_JIT_AVAILABLE
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+Bytecode_Jit bytecode_jit_create()
+{
+    Bytecode_Jit result;
+    result.code = dynamic_array_create_empty<byte>(4096);
+    result.instruction_offsets = dynamic_array_create_empty<int>(256);
+    result.fixups = dynamic_array_create_empty<Jit_Fixup>(256);
+    result.executable_memory = 0;
+    result.executable_size = 0;
+    return result;
+}
+
+void bytecode_jit_free_executable_memory(Bytecode_Jit* jit)
+{
+    if (jit->executable_memory == 0) return;
+#ifdef BYTECODE_JIT_AVAILABLE
+#ifdef _WIN32
+    VirtualFree(jit->executable_memory, 0, MEM_RELEASE);
+#else
+    munmap(jit->executable_memory, jit->executable_size);
+#endif
+#endif
+    jit->executable_memory = 0;
+    jit->executable_size = 0;
+}
+
+void bytecode_jit_destroy(Bytecode_Jit* jit)
+{
+    bytecode_jit_free_executable_memory(jit);
+    dynamic_array_destroy(&jit->code);
+    dynamic_array_destroy(&jit->instruction_offsets);
+    dynamic_array_destroy(&jit->fixups);
+}
+
+#ifdef BYTECODE_JIT_AVAILABLE
+
+enum class X64_Register
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// Condition codes, used for Jcc (0F 80+cc) and SETcc (0F 90+cc)
+enum class X64_Condition
+{
+    BELOW = 0x2,
+    ABOVE_EQUAL = 0x3,
+    EQUAL = 0x4,
+    NOT_EQUAL = 0x5,
+    BELOW_EQUAL = 0x6,
+    ABOVE = 0x7,
+    PARITY = 0xA,
+    NOT_PARITY = 0xB,
+    LESS = 0xC,
+    GREATER_EQUAL = 0xD,
+    LESS_EQUAL = 0xE,
+    GREATER = 0xF,
+};
+
+const X64_Register JIT_STACK_POINTER = X64_Register::RBX;
+const X64_Register JIT_INTERPRETER = X64_Register::R12;
+const X64_Register JIT_ENTRY_STACK = X64_Register::R13;
+const X64_Register JIT_GLOBALS = X64_Register::R14;
+const X64_Register JIT_CONSTANTS = X64_Register::R15;
+
+#ifdef _WIN32
+const X64_Register JIT_ARGUMENT_0 = X64_Register::RCX;
+const X64_Register JIT_ARGUMENT_1 = X64_Register::RDX;
+const X64_Register JIT_ARGUMENT_2 = X64_Register::R8;
+const int JIT_SHADOW_SPACE = 32;
+#else
+const X64_Register JIT_ARGUMENT_0 = X64_Register::RDI;
+const X64_Register JIT_ARGUMENT_1 = X64_Register::RSI;
+const X64_Register JIT_ARGUMENT_2 = X64_Register::RDX;
+const int JIT_SHADOW_SPACE = 0;
+#endif
+
+// Copies larger than this are executed by the interpreter
+const int JIT_MAXIMUM_INLINE_COPY_SIZE = 256;
+
+typedef void(*Jit_Entry_Function)(Bytecode_Interpreter* interpreter, byte* stack_pointer, void* entry_address);
+
+
+
+/*
+    ENCODING
+*/
+void jit_emit_byte(Bytecode_Jit* jit, int value) {
+    dynamic_array_push_back(&jit->code, (byte)value);
+}
+
+void jit_emit_i32(Bytecode_Jit* jit, i32 value) {
+    u32 bits = (u32)value;
+    for (int i = 0; i < 4; i++) {
+        jit_emit_byte(jit, (bits >> (i * 8)) & 0xFF);
+    }
+}
+
+void jit_emit_u64(Bytecode_Jit* jit, u64 value) {
+    for (int i = 0; i < 8; i++) {
+        jit_emit_byte(jit, (int)((value >> (i * 8)) & 0xFF));
+    }
+}
+
+// Opcodes with two bytes are given as 0x0FXX
+void jit_emit_opcode(Bytecode_Jit* jit, int opcode)
+{
+    if (opcode > 0xFF) {
+        jit_emit_byte(jit, opcode >> 8);
+    }
+    jit_emit_byte(jit, opcode & 0xFF);
+}
+
+void jit_emit_prefix_and_rex(Bytecode_Jit* jit, int prefix, bool rex_w, int reg, int rm, bool force_rex)
+{
+    if (prefix != 0) {
+        jit_emit_byte(jit, prefix);
+    }
+    int rex = 0x40 | (rex_w ? 8 : 0) | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40 || force_rex) {
+        jit_emit_byte(jit, rex);
+    }
+}
+
+// Instruction with memory operand [base + displacement], reg may also be an opcode extension (/digit)
+void jit_emit_memory_operation(Bytecode_Jit* jit, int prefix, bool rex_w, int opcode, int reg, X64_Register base, int displacement, bool force_rex = false)
+{
+    jit_emit_prefix_and_rex(jit, prefix, rex_w, reg, (int)base, force_rex);
+    jit_emit_opcode(jit, opcode);
+    jit_emit_byte(jit, 0x80 | ((reg & 7) << 3) | ((int)base & 7));
+    if (((int)base & 7) == 4) {
+        jit_emit_byte(jit, 0x24); // SIB for rsp/r12 base
+    }
+    jit_emit_i32(jit, displacement);
+}
+
+void jit_emit_register_operation(Bytecode_Jit* jit, int prefix, bool rex_w, int opcode, int reg, int rm, bool force_rex = false)
+{
+    jit_emit_prefix_and_rex(jit, prefix, rex_w, reg, rm, force_rex);
+    jit_emit_opcode(jit, opcode);
+    jit_emit_byte(jit, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void jit_emit_move_register(Bytecode_Jit* jit, X64_Register destination, X64_Register source) {
+    jit_emit_register_operation(jit, 0, true, 0x89, (int)source, (int)destination);
+}
+
+void jit_emit_move_immediate(Bytecode_Jit* jit, X64_Register destination, u64 value)
+{
+    jit_emit_prefix_and_rex(jit, 0, true, 0, (int)destination, false);
+    jit_emit_byte(jit, 0xB8 + ((int)destination & 7));
+    jit_emit_u64(jit, value);
+}
+
+void jit_emit_push(Bytecode_Jit* jit, X64_Register reg) {
+    jit_emit_prefix_and_rex(jit, 0, false, 0, (int)reg, false);
+    jit_emit_byte(jit, 0x50 + ((int)reg & 7));
+}
+
+void jit_emit_pop(Bytecode_Jit* jit, X64_Register reg) {
+    jit_emit_prefix_and_rex(jit, 0, false, 0, (int)reg, false);
+    jit_emit_byte(jit, 0x58 + ((int)reg & 7));
+}
+
+// add/sub/and reg, imm8 (sign extended)
+void jit_emit_rsp_immediate_operation(Bytecode_Jit* jit, int extension, int value) {
+    jit_emit_register_operation(jit, 0, true, 0x83, extension, (int)X64_Register::RSP);
+    jit_emit_byte(jit, value & 0xFF);
+}
+
+// Loads the value zero or sign extended to 64 bit
+void jit_emit_load_integer(Bytecode_Jit* jit, X64_Register destination, X64_Register base, int displacement, int size, bool is_signed)
+{
+    switch (size)
+    {
+    case 1: jit_emit_memory_operation(jit, 0, is_signed, is_signed ? 0x0FBE : 0x0FB6, (int)destination, base, displacement); break;
+    case 2: jit_emit_memory_operation(jit, 0, is_signed, is_signed ? 0x0FBF : 0x0FB7, (int)destination, base, displacement); break;
+    case 4: jit_emit_memory_operation(jit, 0, is_signed, is_signed ? 0x63 : 0x8B, (int)destination, base, displacement); break;
+    case 8: jit_emit_memory_operation(jit, 0, true, 0x8B, (int)destination, base, displacement); break;
+    default: panic("Invalid size");
+    }
+}
+
+void jit_emit_store_integer(Bytecode_Jit* jit, X64_Register source, X64_Register base, int displacement, int size)
+{
+    switch (size)
+    {
+    case 1: {
+        bool needs_rex = (int)source >= 4 && (int)source < 8; // Otherwise ah, ch... would be encoded
+        jit_emit_memory_operation(jit, 0, false, 0x88, (int)source, base, displacement, needs_rex);
+        break;
+    }
+    case 2: jit_emit_memory_operation(jit, 0x66, false, 0x89, (int)source, base, displacement); break;
+    case 4: jit_emit_memory_operation(jit, 0, false, 0x89, (int)source, base, displacement); break;
+    case 8: jit_emit_memory_operation(jit, 0, true, 0x89, (int)source, base, displacement); break;
+    default: panic("Invalid size");
+    }
+}
+
+void jit_emit_load_float(Bytecode_Jit* jit, int xmm, X64_Register base, int displacement, int size) {
+    jit_emit_memory_operation(jit, size == 4 ? 0xF3 : 0xF2, false, 0x0F10, xmm, base, displacement);
+}
+
+void jit_emit_store_float(Bytecode_Jit* jit, int xmm, X64_Register base, int displacement, int size) {
+    jit_emit_memory_operation(jit, size == 4 ? 0xF3 : 0xF2, false, 0x0F11, xmm, base, displacement);
+}
+
+void jit_emit_load_address(Bytecode_Jit* jit, X64_Register destination, X64_Register base, int displacement) {
+    jit_emit_memory_operation(jit, 0, true, 0x8D, (int)destination, base, displacement);
+}
+
+// Copies with rax, so neither base may be rax
+void jit_emit_copy(Bytecode_Jit* jit, X64_Register destination, int destination_offset, X64_Register source, int source_offset, int size)
+{
+    int offset = 0;
+    while (offset < size)
+    {
+        int chunk = 8;
+        while (chunk > size - offset) {
+            chunk = chunk / 2;
+        }
+        jit_emit_load_integer(jit, X64_Register::RAX, source, source_offset + offset, chunk, false);
+        jit_emit_store_integer(jit, X64_Register::RAX, destination, destination_offset + offset, chunk);
+        offset += chunk;
+    }
+}
+
+void jit_add_fixup(Bytecode_Jit* jit, int target, bool is_instruction)
+{
+    Jit_Fixup fixup;
+    fixup.position = jit->code.size;
+    fixup.target = target;
+    fixup.is_instruction = is_instruction;
+    dynamic_array_push_back(&jit->fixups, fixup);
+    jit_emit_i32(jit, 0);
+}
+
+void jit_emit_jump_to_instruction(Bytecode_Jit* jit, int instruction_index) {
+    jit_emit_byte(jit, 0xE9);
+    jit_add_fixup(jit, instruction_index, true);
+}
+
+void jit_emit_conditional_jump(Bytecode_Jit* jit, X64_Condition condition, int target, bool is_instruction) {
+    jit_emit_byte(jit, 0x0F);
+    jit_emit_byte(jit, 0x80 | (int)condition);
+    jit_add_fixup(jit, target, is_instruction);
+}
+
+void jit_emit_set_condition(Bytecode_Jit* jit, X64_Condition condition, X64_Register destination) {
+    jit_emit_register_operation(jit, 0, false, 0x0F90 | (int)condition, 0, (int)destination);
+}
+
+void jit_emit_jump_to_exit(Bytecode_Jit* jit, Exit_Code exit_code) {
+    jit_emit_byte(jit, 0xE9);
+    jit_add_fixup(jit, jit->exit_stub_offsets[(int)exit_code], false);
+}
+
+// lea reg, [rip + rel32] to the start of an instruction
+void jit_emit_load_instruction_address(Bytecode_Jit* jit, X64_Register destination, int instruction_index)
+{
+    jit_emit_prefix_and_rex(jit, 0, true, (int)destination, 0, false);
+    jit_emit_byte(jit, 0x8D);
+    jit_emit_byte(jit, 0x05 | (((int)destination & 7) << 3));
+    jit_add_fixup(jit, instruction_index, true);
+}
+
+// Calls a host function with the arguments (Bytecode_Interpreter*, stack_pointer, argument_2), the machine stack is aligned for the call
+void jit_emit_host_call(Bytecode_Jit* jit, void* function, u64 argument_2)
+{
+    jit_emit_move_register(jit, JIT_ARGUMENT_0, JIT_INTERPRETER);
+    jit_emit_move_register(jit, JIT_ARGUMENT_1, JIT_STACK_POINTER);
+    jit_emit_move_immediate(jit, JIT_ARGUMENT_2, argument_2);
+    jit_emit_move_immediate(jit, X64_Register::RAX, (u64)function);
+    jit_emit_move_register(jit, X64_Register::RBP, X64_Register::RSP);
+    jit_emit_rsp_immediate_operation(jit, 4, -16); // and rsp, -16
+    if (JIT_SHADOW_SPACE != 0) {
+        jit_emit_rsp_immediate_operation(jit, 5, JIT_SHADOW_SPACE); // sub rsp, shadow_space
+    }
+    jit_emit_register_operation(jit, 0, false, 0xFF, 2, (int)X64_Register::RAX); // call rax
+    jit_emit_move_register(jit, X64_Register::RSP, X64_Register::RBP);
+}
+
+
+
+/*
+    TRANSLATION
+*/
+// Executes the instruction with the interpreter, returns true if execution should stop
+bool bytecode_jit_execute_instruction_with_interpreter(Bytecode_Interpreter* interpreter, byte* stack_pointer, Bytecode_Instruction* instruction)
+{
+    interpreter->stack_pointer = stack_pointer;
+    interpreter->instruction_pointer = instruction;
+    return bytecode_interpreter_execute_current_instruction(interpreter);
+}
+
+void jit_emit_interpreter_fallback(Bytecode_Jit* jit, Bytecode_Instruction* instruction)
+{
+    jit_emit_host_call(jit, (void*)&bytecode_jit_execute_instruction_with_interpreter, (u64)instruction);
+    jit_emit_register_operation(jit, 0, false, 0x84, 0, 0); // test al, al
+    jit_emit_conditional_jump(jit, X64_Condition::NOT_EQUAL, jit->epilogue_offset, false);
+}
+
+/*
+    Overflow if stack_end - (stack_pointer + frame_offset) < maximum_function_stack_depth, uses rcx.
+    Only used on Windows: Other platforms catch overflows with the guard region of the interpreter stack, but the
+    generated code has no unwind information, so structured exception handling cannot unwind through it.
+*/
+void jit_emit_stack_overflow_check(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter, int frame_offset)
+{
+    byte* limit = &interpreter->stack[interpreter->stack.size - 1] - interpreter->generator->maximum_function_stack_depth - frame_offset;
+    jit_emit_move_immediate(jit, X64_Register::RCX, (u64)limit);
+    jit_emit_register_operation(jit, 0, true, 0x39, (int)X64_Register::RCX, (int)JIT_STACK_POINTER); // cmp rbx, rcx
+    jit_emit_conditional_jump(jit, X64_Condition::ABOVE, jit->exit_stub_offsets[(int)Exit_Code::STACK_OVERFLOW], false);
+}
+
+// Stores old stack pointer in the new frame, switches to the frame and calls the address (rax if target_instruction is -1)
+void jit_emit_upp_call(Bytecode_Jit* jit, int frame_offset, int target_instruction)
+{
+    jit_emit_memory_operation(jit, 0, true, 0x89, (int)JIT_STACK_POINTER, JIT_STACK_POINTER, frame_offset + 8);
+    jit_emit_load_address(jit, JIT_STACK_POINTER, JIT_STACK_POINTER, frame_offset);
+    if (target_instruction == -1) {
+        jit_emit_register_operation(jit, 0, false, 0xFF, 2, (int)X64_Register::RAX); // call rax
+    }
+    else {
+        jit_emit_byte(jit, 0xE8);
+        jit_add_fixup(jit, target_instruction, true);
+    }
+}
+
+X64_Condition jit_integer_condition(Instruction_Type comparison, bool is_signed)
+{
+    switch (comparison)
+    {
+    case Instruction_Type::BINARY_OP_EQUAL: return X64_Condition::EQUAL;
+    case Instruction_Type::BINARY_OP_NOT_EQUAL: return X64_Condition::NOT_EQUAL;
+    case Instruction_Type::BINARY_OP_GREATER_THAN: return is_signed ? X64_Condition::GREATER : X64_Condition::ABOVE;
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL: return is_signed ? X64_Condition::GREATER_EQUAL : X64_Condition::ABOVE_EQUAL;
+    case Instruction_Type::BINARY_OP_LESS_THAN: return is_signed ? X64_Condition::LESS : X64_Condition::BELOW;
+    case Instruction_Type::BINARY_OP_LESS_EQUAL: return is_signed ? X64_Condition::LESS_EQUAL : X64_Condition::BELOW_EQUAL;
+    }
+    panic("Not a comparison");
+    return X64_Condition::EQUAL;
+}
+
+/*
+    Emits a comparison of [left_base + left_offset] with [rbx + right_offset].
+    Integers only set the flags and the returned condition, floats write the result into al (Condition NOT_EQUAL for jumps).
+*/
+X64_Condition jit_emit_comparison(Bytecode_Jit* jit, Instruction_Type comparison, Primitive_Type type, X64_Register left_base, int left_offset, int right_offset)
+{
+    int size = primitive_type_size_in_bytes(type);
+    if (!primitive_type_is_float(type))
+    {
+        bool is_signed = primitive_type_is_signed(type);
+        jit_emit_load_integer(jit, X64_Register::RAX, left_base, left_offset, size, is_signed);
+        jit_emit_load_integer(jit, X64_Register::RCX, JIT_STACK_POINTER, right_offset, size, is_signed);
+        jit_emit_register_operation(jit, 0, true, 0x39, (int)X64_Register::RCX, (int)X64_Register::RAX); // cmp rax, rcx
+        return jit_integer_condition(comparison, is_signed);
+    }
+
+    // ucomiss/ucomisd sets flags like an unsigned compare, unordered (NaN) sets ZF, PF and CF
+    int compare_prefix = size == 8 ? 0x66 : 0;
+    jit_emit_load_float(jit, 0, left_base, left_offset, size);
+    jit_emit_load_float(jit, 1, JIT_STACK_POINTER, right_offset, size);
+    bool swap = comparison == Instruction_Type::BINARY_OP_LESS_THAN || comparison == Instruction_Type::BINARY_OP_LESS_EQUAL;
+    if (swap) {
+        jit_emit_register_operation(jit, compare_prefix, false, 0x0F2E, 1, 0);
+    }
+    else {
+        jit_emit_register_operation(jit, compare_prefix, false, 0x0F2E, 0, 1);
+    }
+    switch (comparison)
+    {
+    case Instruction_Type::BINARY_OP_EQUAL:
+        jit_emit_set_condition(jit, X64_Condition::EQUAL, X64_Register::RAX);
+        jit_emit_set_condition(jit, X64_Condition::NOT_PARITY, X64_Register::RCX);
+        jit_emit_register_operation(jit, 0, false, 0x20, (int)X64_Register::RCX, (int)X64_Register::RAX); // and al, cl
+        break;
+    case Instruction_Type::BINARY_OP_NOT_EQUAL:
+        jit_emit_set_condition(jit, X64_Condition::NOT_EQUAL, X64_Register::RAX);
+        jit_emit_set_condition(jit, X64_Condition::PARITY, X64_Register::RCX);
+        jit_emit_register_operation(jit, 0, false, 0x08, (int)X64_Register::RCX, (int)X64_Register::RAX); // or al, cl
+        break;
+    case Instruction_Type::BINARY_OP_GREATER_THAN:
+    case Instruction_Type::BINARY_OP_LESS_THAN:
+        jit_emit_set_condition(jit, X64_Condition::ABOVE, X64_Register::RAX);
+        break;
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL:
+    case Instruction_Type::BINARY_OP_LESS_EQUAL:
+        jit_emit_set_condition(jit, X64_Condition::ABOVE_EQUAL, X64_Register::RAX);
+        break;
+    default: panic("Not a comparison");
+    }
+    jit_emit_register_operation(jit, 0, false, 0x84, 0, 0); // test al, al
+    return X64_Condition::NOT_EQUAL;
+}
+
+// Returns false if the operation has no native translation
+bool jit_emit_binary_operation(Bytecode_Jit* jit, Instruction_Type operation, Primitive_Type type,
+    int destination_offset, X64_Register left_base, int left_offset, int right_offset)
+{
+    int size = primitive_type_size_in_bytes(type);
+    switch (operation)
+    {
+    case Instruction_Type::BINARY_OP_EQUAL:
+    case Instruction_Type::BINARY_OP_NOT_EQUAL:
+    case Instruction_Type::BINARY_OP_GREATER_THAN:
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL:
+    case Instruction_Type::BINARY_OP_LESS_THAN:
+    case Instruction_Type::BINARY_OP_LESS_EQUAL: {
+        X64_Condition condition = jit_emit_comparison(jit, operation, type, left_base, left_offset, right_offset);
+        jit_emit_set_condition(jit, condition, X64_Register::RAX);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, destination_offset, 1);
+        return true;
+    }
+    case Instruction_Type::BINARY_OP_AND:
+    case Instruction_Type::BINARY_OP_OR: {
+        jit_emit_load_integer(jit, X64_Register::RAX, left_base, left_offset, 1, false);
+        jit_emit_load_integer(jit, X64_Register::RCX, JIT_STACK_POINTER, right_offset, 1, false);
+        jit_emit_register_operation(jit, 0, false, 0x85, (int)X64_Register::RAX, (int)X64_Register::RAX); // test eax, eax
+        jit_emit_set_condition(jit, X64_Condition::NOT_EQUAL, X64_Register::RAX);
+        jit_emit_register_operation(jit, 0, false, 0x85, (int)X64_Register::RCX, (int)X64_Register::RCX); // test ecx, ecx
+        jit_emit_set_condition(jit, X64_Condition::NOT_EQUAL, X64_Register::RCX);
+        jit_emit_register_operation(jit, 0, false, operation == Instruction_Type::BINARY_OP_AND ? 0x20 : 0x08, (int)X64_Register::RCX, (int)X64_Register::RAX);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, destination_offset, 1);
+        return true;
+    }
+    }
+
+    if (type == Primitive_Type::BOOLEAN) {
+        return false;
+    }
+    if (primitive_type_is_float(type))
+    {
+        int sse_opcode;
+        switch (operation)
+        {
+        case Instruction_Type::BINARY_OP_ADDITION: sse_opcode = 0x0F58; break;
+        case Instruction_Type::BINARY_OP_SUBTRACTION: sse_opcode = 0x0F5C; break;
+        case Instruction_Type::BINARY_OP_MULTIPLICATION: sse_opcode = 0x0F59; break;
+        case Instruction_Type::BINARY_OP_DIVISION: sse_opcode = 0x0F5E; break;
+        default: return false;
+        }
+        jit_emit_load_float(jit, 0, left_base, left_offset, size);
+        jit_emit_load_float(jit, 1, JIT_STACK_POINTER, right_offset, size);
+        jit_emit_register_operation(jit, size == 4 ? 0xF3 : 0xF2, false, sse_opcode, 0, 1);
+        jit_emit_store_float(jit, 0, JIT_STACK_POINTER, destination_offset, size);
+        return true;
+    }
+
+    // Integers are calculated with 64 bit registers and truncated on store
+    bool is_signed = primitive_type_is_signed(type);
+    jit_emit_load_integer(jit, X64_Register::RAX, left_base, left_offset, size, is_signed);
+    jit_emit_load_integer(jit, X64_Register::RCX, JIT_STACK_POINTER, right_offset, size, is_signed);
+    X64_Register result = X64_Register::RAX;
+    switch (operation)
+    {
+    case Instruction_Type::BINARY_OP_ADDITION:
+        jit_emit_register_operation(jit, 0, true, 0x01, (int)X64_Register::RCX, (int)X64_Register::RAX);
+        break;
+    case Instruction_Type::BINARY_OP_SUBTRACTION:
+        jit_emit_register_operation(jit, 0, true, 0x29, (int)X64_Register::RCX, (int)X64_Register::RAX);
+        break;
+    case Instruction_Type::BINARY_OP_MULTIPLICATION:
+        jit_emit_register_operation(jit, 0, true, 0x0FAF, (int)X64_Register::RAX, (int)X64_Register::RCX);
+        break;
+    case Instruction_Type::BINARY_OP_DIVISION:
+    case Instruction_Type::BINARY_OP_MODULO:
+        // 32 bit division is a lot faster, and the results of smaller types fit
+        if (is_signed) {
+            if (size == 8) {
+                jit_emit_byte(jit, 0x48);
+            }
+            jit_emit_byte(jit, 0x99); // cdq/cqo
+            jit_emit_register_operation(jit, 0, size == 8, 0xF7, 7, (int)X64_Register::RCX); // idiv
+        }
+        else {
+            jit_emit_register_operation(jit, 0, false, 0x31, (int)X64_Register::RDX, (int)X64_Register::RDX); // xor edx, edx
+            jit_emit_register_operation(jit, 0, size == 8, 0xF7, 6, (int)X64_Register::RCX); // div
+        }
+        if (operation == Instruction_Type::BINARY_OP_MODULO) {
+            result = X64_Register::RDX;
+        }
+        break;
+    default: return false;
+    }
+    jit_emit_store_integer(jit, result, JIT_STACK_POINTER, destination_offset, size);
+    return true;
+}
+
+// Returns false if the instruction has no native translation
+bool jit_emit_instruction(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter, int instruction_index)
+{
+    Bytecode_Instruction* instr = &interpreter->generator->instructions[instruction_index];
+    switch (instr->instruction_type)
+    {
+    case Instruction_Type::MOVE_STACK_DATA:
+        if (instr->op3 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_copy(jit, JIT_STACK_POINTER, instr->op1, JIT_STACK_POINTER, instr->op2, instr->op3);
+        return true;
+    case Instruction_Type::READ_GLOBAL:
+        if (instr->op3 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_copy(jit, JIT_STACK_POINTER, instr->op1, JIT_GLOBALS, instr->op2, instr->op3);
+        return true;
+    case Instruction_Type::WRITE_GLOBAL:
+        if (instr->op3 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_copy(jit, JIT_GLOBALS, instr->op1, JIT_STACK_POINTER, instr->op2, instr->op3);
+        return true;
+    case Instruction_Type::READ_CONSTANT:
+        if (instr->op3 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_copy(jit, JIT_STACK_POINTER, instr->op1, JIT_CONSTANTS, instr->op2, instr->op3);
+        return true;
+    case Instruction_Type::READ_MEMORY:
+        if (instr->op3 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_load_integer(jit, X64_Register::RDX, JIT_STACK_POINTER, instr->op2, 8, false);
+        jit_emit_copy(jit, JIT_STACK_POINTER, instr->op1, X64_Register::RDX, 0, instr->op3);
+        return true;
+    case Instruction_Type::WRITE_MEMORY:
+        if (instr->op3 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_load_integer(jit, X64_Register::RDX, JIT_STACK_POINTER, instr->op1, 8, false);
+        jit_emit_copy(jit, X64_Register::RDX, 0, JIT_STACK_POINTER, instr->op2, instr->op3);
+        return true;
+    case Instruction_Type::MEMORY_COPY:
+        if (instr->op3 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_load_integer(jit, X64_Register::RDX, JIT_STACK_POINTER, instr->op1, 8, false);
+        jit_emit_load_integer(jit, X64_Register::RCX, JIT_STACK_POINTER, instr->op2, 8, false);
+        jit_emit_copy(jit, X64_Register::RDX, 0, X64_Register::RCX, 0, instr->op3);
+        return true;
+    case Instruction_Type::LOAD_RETURN_VALUE:
+        if (instr->op2 > JIT_MAXIMUM_INLINE_COPY_SIZE) return false;
+        jit_emit_copy(jit, JIT_STACK_POINTER, instr->op1, JIT_INTERPRETER, offsetof(Bytecode_Interpreter, return_register), instr->op2);
+        return true;
+    case Instruction_Type::U64_ADD_CONSTANT_I32:
+        jit_emit_load_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op2, 8, false);
+        jit_emit_byte(jit, 0x48); // add rax, imm32 (Sign extended)
+        jit_emit_byte(jit, 0x05);
+        jit_emit_i32(jit, instr->op3);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 8);
+        return true;
+    case Instruction_Type::U64_MULTIPLY_ADD_I32:
+        jit_emit_load_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op3, 4, false);
+        jit_emit_register_operation(jit, 0, true, 0x69, (int)X64_Register::RAX, (int)X64_Register::RAX); // imul rax, rax, imm32
+        jit_emit_i32(jit, instr->op4);
+        jit_emit_register_operation(jit, 0, false, 0x85, (int)X64_Register::RAX, (int)X64_Register::RAX); // test eax, eax
+        jit_emit_conditional_jump(jit, X64_Condition::LESS, jit->exit_stub_offsets[(int)Exit_Code::OUT_OF_BOUNDS], false);
+        jit_emit_memory_operation(jit, 0, true, 0x03, (int)X64_Register::RAX, JIT_STACK_POINTER, instr->op2); // add rax, [base]
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 8);
+        return true;
+    case Instruction_Type::I32_ADD_CONSTANT:
+        jit_emit_load_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op2, 4, false);
+        jit_emit_byte(jit, 0x05); // add eax, imm32
+        jit_emit_i32(jit, instr->op3);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 4);
+        return true;
+
+    case Instruction_Type::JUMP:
+        jit_emit_jump_to_instruction(jit, instr->op1);
+        return true;
+    case Instruction_Type::JUMP_ON_TRUE:
+    case Instruction_Type::JUMP_ON_FALSE:
+        jit_emit_memory_operation(jit, 0, false, 0x80, 7, JIT_STACK_POINTER, instr->op2); // cmp byte [rbx + op2], 0
+        jit_emit_byte(jit, 0);
+        jit_emit_conditional_jump(jit,
+            instr->instruction_type == Instruction_Type::JUMP_ON_TRUE ? X64_Condition::NOT_EQUAL : X64_Condition::EQUAL, instr->op1, true
+        );
+        return true;
+    case Instruction_Type::JUMP_ON_COMPARISON: {
+        X64_Condition condition = jit_emit_comparison(jit,
+            binary_operation_unpack_instruction_type(instr->op4), binary_operation_unpack_primitive_type(instr->op4),
+            JIT_STACK_POINTER, instr->op2, instr->op3
+        );
+        jit_emit_conditional_jump(jit, condition, instr->op1, true);
+        return true;
+    }
+    case Instruction_Type::CALL_FUNCTION:
+#ifdef _WIN32
+        jit_emit_stack_overflow_check(jit, interpreter, instr->op2);
+#endif
+        jit_emit_upp_call(jit, instr->op2, instr->op1);
+        return true;
+    case Instruction_Type::CALL_FUNCTION_POINTER: {
+#ifdef _WIN32
+        jit_emit_stack_overflow_check(jit, interpreter, instr->op2);
+#endif
+        // Function pointers are code addresses, check if the pointer is inside the generated code
+        jit_emit_load_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 8, false);
+        jit_emit_load_instruction_address(jit, X64_Register::RCX, 0);
+        jit_emit_register_operation(jit, 0, true, 0x39, (int)X64_Register::RCX, (int)X64_Register::RAX); // cmp rax, rcx
+        jit_emit_conditional_jump(jit, X64_Condition::BELOW, jit->exit_stub_offsets[(int)Exit_Code::RETURN_VALUE_OVERFLOW], false);
+        jit_emit_load_instruction_address(jit, X64_Register::RCX, interpreter->generator->instructions.size);
+        jit_emit_register_operation(jit, 0, true, 0x39, (int)X64_Register::RCX, (int)X64_Register::RAX);
+        jit_emit_conditional_jump(jit, X64_Condition::ABOVE_EQUAL, jit->exit_stub_offsets[(int)Exit_Code::RETURN_VALUE_OVERFLOW], false);
+        jit_emit_upp_call(jit, instr->op2, -1);
+        return true;
+    }
+    case Instruction_Type::RETURN:
+        if (instr->op2 > 256) {
+            jit_emit_jump_to_exit(jit, Exit_Code::RETURN_VALUE_OVERFLOW);
+            return true;
+        }
+        jit_emit_copy(jit, JIT_INTERPRETER, offsetof(Bytecode_Interpreter, return_register), JIT_STACK_POINTER, instr->op1, instr->op2);
+        jit_emit_load_integer(jit, JIT_STACK_POINTER, JIT_STACK_POINTER, 8, 8, false);
+        jit_emit_byte(jit, 0xC3); // ret
+        return true;
+    case Instruction_Type::EXIT:
+        jit_emit_memory_operation(jit, 0, false, 0xC7, 0, JIT_INTERPRETER, offsetof(Bytecode_Interpreter, exit_code)); // mov dword [r12 + exit_code], imm32
+        jit_emit_i32(jit, instr->op1);
+        jit_emit_byte(jit, 0xE9);
+        jit_add_fixup(jit, jit->epilogue_offset, false);
+        return true;
+
+    case Instruction_Type::LOAD_REGISTER_ADDRESS:
+        jit_emit_load_address(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op2);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 8);
+        return true;
+    case Instruction_Type::LOAD_GLOBAL_ADDRESS:
+        jit_emit_load_address(jit, X64_Register::RAX, JIT_GLOBALS, instr->op2);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 8);
+        return true;
+    case Instruction_Type::LOAD_FUNCTION_LOCATION:
+        jit_emit_load_instruction_address(jit, X64_Register::RAX, instr->op2);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 8);
+        return true;
+
+    case Instruction_Type::UNARY_OP_NOT:
+        jit_emit_memory_operation(jit, 0, false, 0x80, 7, JIT_STACK_POINTER, instr->op2); // cmp byte [rbx + op2], 0
+        jit_emit_byte(jit, 0);
+        jit_emit_set_condition(jit, X64_Condition::EQUAL, X64_Register::RAX);
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, 1);
+        return true;
+    case Instruction_Type::UNARY_OP_NEGATE: {
+        Primitive_Type type = (Primitive_Type)instr->op3;
+        int size = primitive_type_size_in_bytes(type);
+        jit_emit_load_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op2, size, false);
+        if (primitive_type_is_float(type)) {
+            jit_emit_register_operation(jit, 0, size == 8, 0x0FBA, 7, (int)X64_Register::RAX); // btc rax, sign_bit
+            jit_emit_byte(jit, size * 8 - 1);
+        }
+        else {
+            jit_emit_register_operation(jit, 0, true, 0xF7, 3, (int)X64_Register::RAX); // neg rax
+        }
+        jit_emit_store_integer(jit, X64_Register::RAX, JIT_STACK_POINTER, instr->op1, size);
+        return true;
+    }
+    case Instruction_Type::READ_GLOBAL_BINARY_OP:
+        return jit_emit_binary_operation(jit,
+            binary_operation_unpack_instruction_type(instr->op4), binary_operation_unpack_primitive_type(instr->op4),
+            instr->op1, JIT_GLOBALS, instr->op2, instr->op3
+        );
+
+    case Instruction_Type::BINARY_OP_ADDITION:
+    case Instruction_Type::BINARY_OP_SUBTRACTION:
+    case Instruction_Type::BINARY_OP_MULTIPLICATION:
+    case Instruction_Type::BINARY_OP_DIVISION:
+    case Instruction_Type::BINARY_OP_MODULO:
+    case Instruction_Type::BINARY_OP_EQUAL:
+    case Instruction_Type::BINARY_OP_NOT_EQUAL:
+    case Instruction_Type::BINARY_OP_GREATER_THAN:
+    case Instruction_Type::BINARY_OP_GREATER_EQUAL:
+    case Instruction_Type::BINARY_OP_LESS_THAN:
+    case Instruction_Type::BINARY_OP_LESS_EQUAL:
+    case Instruction_Type::BINARY_OP_AND:
+    case Instruction_Type::BINARY_OP_OR:
+        return jit_emit_binary_operation(jit, instr->instruction_type, (Primitive_Type)instr->op4, instr->op1, JIT_STACK_POINTER, instr->op2, instr->op3);
+    }
+    // Casts and hardcoded functions
+    return false;
+}
+
+/*
+    Code layout:
+        Entry function: Saves callee saved registers, calls the entry address and restores the registers (Epilogue)
+        Exit stubs: Set the exit code and jump to the epilogue
+        Instructions
+*/
+void jit_emit_entry_function(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter)
+{
+    jit_emit_push(jit, X64_Register::RBP);
+    jit_emit_push(jit, X64_Register::RBX);
+    jit_emit_push(jit, X64_Register::R12);
+    jit_emit_push(jit, X64_Register::R13);
+    jit_emit_push(jit, X64_Register::R14);
+    jit_emit_push(jit, X64_Register::R15);
+    jit_emit_rsp_immediate_operation(jit, 5, 8); // sub rsp, 8 (Align stack)
+    jit_emit_move_register(jit, JIT_INTERPRETER, JIT_ARGUMENT_0);
+    jit_emit_move_register(jit, JIT_STACK_POINTER, JIT_ARGUMENT_1);
+    jit_emit_move_immediate(jit, JIT_GLOBALS, (u64)interpreter->globals.data);
+    jit_emit_move_immediate(jit, JIT_CONSTANTS, (u64)interpreter->compiler->analyser.program->constant_pool.constant_memory.data);
+    jit_emit_move_register(jit, JIT_ENTRY_STACK, X64_Register::RSP);
+    jit_emit_register_operation(jit, 0, false, 0xFF, 2, (int)JIT_ARGUMENT_2); // call entry
+
+    // Exits jump here from any call depth
+    jit->epilogue_offset = jit->code.size;
+    jit_emit_move_register(jit, X64_Register::RSP, JIT_ENTRY_STACK);
+    jit_emit_rsp_immediate_operation(jit, 0, 8); // add rsp, 8
+    jit_emit_pop(jit, X64_Register::R15);
+    jit_emit_pop(jit, X64_Register::R14);
+    jit_emit_pop(jit, X64_Register::R13);
+    jit_emit_pop(jit, X64_Register::R12);
+    jit_emit_pop(jit, X64_Register::RBX);
+    jit_emit_pop(jit, X64_Register::RBP);
+    jit_emit_byte(jit, 0xC3);
+
+    for (int i = 0; i < 4; i++) {
+        jit->exit_stub_offsets[i] = jit->code.size;
+        jit_emit_memory_operation(jit, 0, false, 0xC7, 0, JIT_INTERPRETER, offsetof(Bytecode_Interpreter, exit_code));
+        jit_emit_i32(jit, i);
+        jit_emit_byte(jit, 0xE9);
+        jit_add_fixup(jit, jit->epilogue_offset, false);
+    }
+}
+
+bool bytecode_jit_compile(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter)
+{
+    Dynamic_Array<Bytecode_Instruction>* instructions = &interpreter->generator->instructions;
+    bytecode_jit_free_executable_memory(jit);
+    dynamic_array_reset(&jit->code);
+    dynamic_array_reset(&jit->instruction_offsets);
+    dynamic_array_reset(&jit->fixups);
+
+    jit_emit_entry_function(jit, interpreter);
+    for (int i = 0; i < instructions->size; i++)
+    {
+        dynamic_array_push_back(&jit->instruction_offsets, jit->code.size);
+        int code_start = jit->code.size;
+        int fixup_start = jit->fixups.size;
+        if (!jit_emit_instruction(jit, interpreter, i)) {
+            dynamic_array_rollback_to_size(&jit->code, code_start);
+            dynamic_array_rollback_to_size(&jit->fixups, fixup_start);
+            jit_emit_interpreter_fallback(jit, &instructions->data[i]);
+        }
+    }
+    dynamic_array_push_back(&jit->instruction_offsets, jit->code.size);
+
+    for (int i = 0; i < jit->fixups.size; i++) {
+        Jit_Fixup* fixup = &jit->fixups[i];
+        int target = fixup->is_instruction ? jit->instruction_offsets[fixup->target] : fixup->target;
+        i32 relative = target - (fixup->position + 4);
+        memory_copy(&jit->code[fixup->position], &relative, 4);
+    }
+
+    // Map memory writable, then switch to executable
+    u64 size = (u64)jit->code.size;
+#ifdef _WIN32
+    void* memory = VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (memory == 0) return false;
+    memory_copy(memory, jit->code.data, size);
+    DWORD old_protection;
+    if (!VirtualProtect(memory, size, PAGE_EXECUTE_READ, &old_protection)) {
+        VirtualFree(memory, 0, MEM_RELEASE);
+        return false;
+    }
+#else
+    void* memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return false;
+    memory_copy(memory, jit->code.data, size);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return false;
+    }
+#endif
+    jit->executable_memory = memory;
+    jit->executable_size = size;
+    return true;
+}
+
+void bytecode_jit_execute_compiled(Bytecode_Interpreter* interpreter, void* userdata)
+{
+    Bytecode_Jit* jit = (Bytecode_Jit*)userdata;
+    Jit_Entry_Function entry = (Jit_Entry_Function)jit->executable_memory;
+    byte* entry_address = (byte*)jit->executable_memory + jit->instruction_offsets[interpreter->generator->entry_point_index];
+    entry(interpreter, interpreter->stack_pointer, entry_address);
+}
+
+void bytecode_jit_execute_main(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter, Compiler* compiler)
+{
+    bytecode_interpreter_prepare_execution(interpreter, compiler);
+    if (!bytecode_jit_compile(jit, interpreter)) {
+        logg("JIT compilation failed, using interpreter\n");
+        bytecode_interpreter_execute_main(interpreter, compiler);
+        return;
+    }
+    bytecode_interpreter_execute_with_stack_guard(interpreter, &bytecode_jit_execute_compiled, jit);
+}
+
+#else
+
+bool bytecode_jit_compile(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter) {
+    return false;
+}
+
+void bytecode_jit_execute_main(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter, Compiler* compiler) {
+    bytecode_interpreter_execute_main(interpreter, compiler);
+}
+
+#endif
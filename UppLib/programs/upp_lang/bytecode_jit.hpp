@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../../datastructures/dynamic_array.hpp"
+#include "../../utility/datatypes.hpp"
+
+struct Compiler;
+struct Bytecode_Interpreter;
+
+/*
+    Translates the bytecode of the Bytecode_Generator to x86-64 machine code.
+    The generated code uses the same stack frames (Interpreter stack + stack offsets) and globals as the interpreter,
+    so instructions without a native translation (Casts, CALL_HARDCODED_FUNCTION...) call back into the interpreter.
+    Register usage inside generated code:
+        rbx = stack_pointer, r12 = Bytecode_Interpreter*, r13 = Machine stack pointer on entry,
+        r14 = globals, r15 = constant memory, rbp = saved machine stack pointer during host calls
+    Upp functions are called with native call/ret, the Return_Address slot of the stack frame is not used.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BYTECODE_JIT_AVAILABLE
+#endif
+
+struct Jit_Fixup
+{
+    int position; // Position of the rel32 in the code
+    int target; // Instruction index, or code offset if is_instruction is false
+    bool is_instruction;
+};
+
+struct Bytecode_Jit
+{
+    Dynamic_Array<byte> code;
+    Dynamic_Array<int> instruction_offsets; // Code offset per instruction, the last entry is the end of the code
+    Dynamic_Array<Jit_Fixup> fixups;
+    int epilogue_offset;
+    int exit_stub_offsets[4]; // Per Exit_Code
+
+    void* executable_memory;
+    u64 executable_size;
+};
+
+Bytecode_Jit bytecode_jit_create();
+void bytecode_jit_destroy(Bytecode_Jit* jit);
+// Translates the bytecode, the interpreter needs to be prepared for execution (Globals are referenced directly)
+bool bytecode_jit_compile(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter);
+// Same as bytecode_interpreter_execute_main, falls back to the interpreter if the JIT is not available
+void bytecode_jit_execute_main(Bytecode_Jit* jit, Bytecode_Interpreter* interpreter, Compiler* compiler);
@@ -0,0 +1,733 @@
+#include "bytecode_optimizer.hpp"
+
+#include "compiler.hpp"
+
+const int BYTECODE_OPTIMIZER_MAX_ROUNDS = 8;
+const int BYTECODE_OPTIMIZER_MAX_FRAME_SIZE = 1 << 16; // Functions with larger frames are not optimized
+
+struct Stack_Access
+{
+    int offset;
+    int size;
+    int operand; // 1-4 if the offset is stored in op1-op4, 0 if it cannot be rewritten (e.g. call arguments)
+};
+
+struct Instruction_Accesses
+{
+    Stack_Access reads[3];
+    int read_count;
+    Stack_Access write; // Only direct writes to the stack, writes through pointers are not tracked
+    bool has_write;
+    bool is_removable; // True if the instruction has no effect except the write
+    bool falls_through;
+    int jump_target; // -1 if the instruction does not jump
+};
+
+bool instruction_type_is_comparison(Instruction_Type type)
+{
+    return type == Instruction_Type::BINARY_OP_EQUAL || type == Instruction_Type::BINARY_OP_NOT_EQUAL ||
+        type == Instruction_Type::BINARY_OP_GREATER_THAN || type == Instruction_Type::BINARY_OP_GREATER_EQUAL ||
+        type == Instruction_Type::BINARY_OP_LESS_THAN || type == Instruction_Type::BINARY_OP_LESS_EQUAL;
+}
+
+bool instruction_type_is_arithmetic(Instruction_Type type)
+{
+    return type == Instruction_Type::BINARY_OP_ADDITION || type == Instruction_Type::BINARY_OP_SUBTRACTION ||
+        type == Instruction_Type::BINARY_OP_MULTIPLICATION || type == Instruction_Type::BINARY_OP_DIVISION ||
+        type == Instruction_Type::BINARY_OP_MODULO;
+}
+
+void instruction_accesses_add_read(Instruction_Accesses* accesses, int offset, int size, int operand)
+{
+    if (size <= 0) return;
+    Stack_Access* read = &accesses->reads[accesses->read_count];
+    read->offset = offset;
+    read->size = size;
+    read->operand = operand;
+    accesses->read_count++;
+}
+
+void instruction_accesses_set_write(Instruction_Accesses* accesses, int offset, int size)
+{
+    accesses->has_write = true;
+    accesses->write.offset = offset;
+    accesses->write.size = size;
+    accesses->write.operand = 1;
+}
+
+Instruction_Accesses bytecode_instruction_get_accesses(Bytecode_Instruction* instr)
+{
+    Instruction_Accesses result;
+    result.read_count = 0;
+    result.has_write = false;
+    result.is_removable = false;
+    result.falls_through = true;
+    result.jump_target = -1;
+
+    switch (instr->instruction_type)
+    {
+    case Instruction_Type::MOVE_STACK_DATA:
+        instruction_accesses_set_write(&result, instr->op1, instr->op3);
+        instruction_accesses_add_read(&result, instr->op2, instr->op3, 2);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::WRITE_MEMORY:
+        instruction_accesses_add_read(&result, instr->op1, 8, 1);
+        instruction_accesses_add_read(&result, instr->op2, instr->op3, 2);
+        break;
+    case Instruction_Type::READ_MEMORY:
+        instruction_accesses_set_write(&result, instr->op1, instr->op3);
+        instruction_accesses_add_read(&result, instr->op2, 8, 2);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::MEMORY_COPY:
+        instruction_accesses_add_read(&result, instr->op1, 8, 1);
+        instruction_accesses_add_read(&result, instr->op2, 8, 2);
+        break;
+    case Instruction_Type::READ_GLOBAL:
+    case Instruction_Type::READ_CONSTANT:
+        instruction_accesses_set_write(&result, instr->op1, instr->op3);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::WRITE_GLOBAL:
+        instruction_accesses_add_read(&result, instr->op2, instr->op3, 2);
+        break;
+    case Instruction_Type::U64_ADD_CONSTANT_I32:
+        instruction_accesses_set_write(&result, instr->op1, 8);
+        instruction_accesses_add_read(&result, instr->op2, 8, 2);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::U64_MULTIPLY_ADD_I32:
+        // Not removable, exits on out of bounds
+        instruction_accesses_set_write(&result, instr->op1, 8);
+        instruction_accesses_add_read(&result, instr->op2, 8, 2);
+        instruction_accesses_add_read(&result, instr->op3, 4, 3);
+        break;
+    case Instruction_Type::I32_ADD_CONSTANT:
+        instruction_accesses_set_write(&result, instr->op1, 4);
+        instruction_accesses_add_read(&result, instr->op2, 4, 2);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::JUMP:
+        result.falls_through = false;
+        result.jump_target = instr->op1;
+        break;
+    case Instruction_Type::JUMP_ON_TRUE:
+    case Instruction_Type::JUMP_ON_FALSE:
+        instruction_accesses_add_read(&result, instr->op2, 1, 2);
+        result.jump_target = instr->op1;
+        break;
+    case Instruction_Type::JUMP_ON_COMPARISON: {
+        int size = primitive_type_size_in_bytes(binary_operation_unpack_primitive_type(instr->op4));
+        instruction_accesses_add_read(&result, instr->op2, size, 2);
+        instruction_accesses_add_read(&result, instr->op3, size, 3);
+        result.jump_target = instr->op1;
+        break;
+    }
+    case Instruction_Type::CALL_FUNCTION:
+    case Instruction_Type::CALL_HARDCODED_FUNCTION:
+        instruction_accesses_add_read(&result, instr->op2 - align_offset_next_multiple(instr->op3, 8), instr->op3, 0);
+        break;
+    case Instruction_Type::CALL_FUNCTION_POINTER:
+        instruction_accesses_add_read(&result, instr->op1, 8, 1);
+        instruction_accesses_add_read(&result, instr->op2 - align_offset_next_multiple(instr->op3, 8), instr->op3, 0);
+        break;
+    case Instruction_Type::RETURN:
+        instruction_accesses_add_read(&result, instr->op1, instr->op2, 1);
+        result.falls_through = false;
+        break;
+    case Instruction_Type::EXIT:
+        result.falls_through = false;
+        break;
+    case Instruction_Type::LOAD_RETURN_VALUE:
+        instruction_accesses_set_write(&result, instr->op1, instr->op2);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::LOAD_REGISTER_ADDRESS:
+    case Instruction_Type::LOAD_GLOBAL_ADDRESS:
+    case Instruction_Type::LOAD_FUNCTION_LOCATION:
+        instruction_accesses_set_write(&result, instr->op1, 8);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::CAST_INTEGER_DIFFERENT_SIZE:
+    case Instruction_Type::CAST_FLOAT_DIFFERENT_SIZE:
+    case Instruction_Type::CAST_FLOAT_INTEGER:
+    case Instruction_Type::CAST_INTEGER_FLOAT:
+        instruction_accesses_set_write(&result, instr->op1, primitive_type_size_in_bytes((Primitive_Type)instr->op3));
+        instruction_accesses_add_read(&result, instr->op2, primitive_type_size_in_bytes((Primitive_Type)instr->op4), 2);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::BINARY_OP_AND:
+    case Instruction_Type::BINARY_OP_OR:
+        instruction_accesses_set_write(&result, instr->op1, 1);
+        instruction_accesses_add_read(&result, instr->op2, 1, 2);
+        instruction_accesses_add_read(&result, instr->op3, 1, 3);
+        result.is_removable = true;
+        break;
+    case Instruction_Type::READ_GLOBAL_BINARY_OP: {
+        Instruction_Type binary_operation = binary_operation_unpack_instruction_type(instr->op4);
+        int size = primitive_type_size_in_bytes(binary_operation_unpack_primitive_type(instr->op4));
+        instruction_accesses_set_write(&result, instr->op1, instruction_type_is_comparison(binary_operation) ? 1 : size);
+        instruction_accesses_add_read(&result, instr->op3, size, 3);
+        result.is_removable = true;
+        break;
+    }
+    case Instruction_Type::UNARY_OP_NEGATE: {
+        int size = primitive_type_size_in_bytes((Primitive_Type)instr->op3);
+        instruction_accesses_set_write(&result, instr->op1, size);
+        instruction_accesses_add_read(&result, instr->op2, size, 2);
+        result.is_removable = true;
+        break;
+    }
+    case Instruction_Type::UNARY_OP_NOT:
+        instruction_accesses_set_write(&result, instr->op1, 1);
+        instruction_accesses_add_read(&result, instr->op2, 1, 2);
+        result.is_removable = true;
+        break;
+    default:
+    {
+        if (instruction_type_is_arithmetic(instr->instruction_type) || instruction_type_is_comparison(instr->instruction_type)) {
+            int size = primitive_type_size_in_bytes((Primitive_Type)instr->op4);
+            instruction_accesses_set_write(&result, instr->op1, instruction_type_is_comparison(instr->instruction_type) ? 1 : size);
+            instruction_accesses_add_read(&result, instr->op2, size, 2);
+            instruction_accesses_add_read(&result, instr->op3, size, 3);
+            result.is_removable = true;
+            break;
+        }
+        panic("Unhandled instruction type in bytecode optimizer");
+    }
+    }
+    return result;
+}
+
+bool stack_accesses_overlap(int offset_a, int size_a, int offset_b, int size_b) {
+    return offset_a < offset_b + size_b && offset_b < offset_a + size_a;
+}
+
+
+
+/*
+    LIVENESS
+    One bit per stack byte of a function frame, bit 0 is the byte at frame_start.
+*/
+struct Bytecode_Liveness
+{
+    int range_start; // First instruction of the function
+    int range_end;
+    int frame_start; // Lowest stack offset accessed, negative for parameters
+    int frame_end;
+    int word_count;
+    Array<u64> live_in; // word_count words per instruction
+    Array<u64> escaped; // Bytes which must always be treated as live
+    Array<u64> temporary;
+};
+
+void liveness_bits_set(Bytecode_Liveness* liveness, u64* bits, int offset, int size)
+{
+    for (int i = offset; i < offset + size; i++) {
+        int bit = i - liveness->frame_start;
+        bits[bit / 64] |= (u64)1 << (bit % 64);
+    }
+}
+
+void liveness_bits_clear(Bytecode_Liveness* liveness, u64* bits, int offset, int size)
+{
+    for (int i = offset; i < offset + size; i++) {
+        int bit = i - liveness->frame_start;
+        bits[bit / 64] &= ~((u64)1 << (bit % 64));
+    }
+}
+
+bool liveness_bits_test_any(Bytecode_Liveness* liveness, u64* bits, int offset, int size)
+{
+    for (int i = offset; i < offset + size; i++) {
+        int bit = i - liveness->frame_start;
+        if ((bits[bit / 64] & ((u64)1 << (bit % 64))) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u64* liveness_get_live_in(Bytecode_Liveness* liveness, int instruction_index) {
+    return &liveness->live_in.data[(instruction_index - liveness->range_start) * liveness->word_count];
+}
+
+void liveness_or_successor(Bytecode_Liveness* liveness, u64* result, int successor)
+{
+    if (successor < liveness->range_start || successor >= liveness->range_end) {
+        // Leaving the function without return, should not happen, but stay conservative
+        for (int i = 0; i < liveness->word_count; i++) {
+            result[i] = ~(u64)0;
+        }
+        return;
+    }
+    u64* live_in = liveness_get_live_in(liveness, successor);
+    for (int i = 0; i < liveness->word_count; i++) {
+        result[i] |= live_in[i];
+    }
+}
+
+// Writes the live out set of the instruction into liveness->temporary and returns it
+u64* liveness_compute_live_out(Bytecode_Liveness* liveness, Instruction_Accesses* accesses, int instruction_index)
+{
+    u64* live_out = liveness->temporary.data;
+    memory_set_bytes(live_out, sizeof(u64) * liveness->word_count, 0);
+    if (accesses->falls_through) {
+        liveness_or_successor(liveness, live_out, instruction_index + 1);
+    }
+    if (accesses->jump_target != -1) {
+        liveness_or_successor(liveness, live_out, accesses->jump_target);
+    }
+    return live_out;
+}
+
+// Returns false if the function cannot be optimized (Frame too large)
+bool liveness_compute(Bytecode_Liveness* liveness, Dynamic_Array<Bytecode_Instruction>* instructions, int range_start, int range_end)
+{
+    liveness->range_start = range_start;
+    liveness->range_end = range_end;
+    liveness->frame_start = 0;
+    liveness->frame_end = 16;
+    for (int i = range_start; i < range_end; i++)
+    {
+        Bytecode_Instruction* instr = &instructions->data[i];
+        Instruction_Accesses accesses = bytecode_instruction_get_accesses(instr);
+        for (int j = 0; j < accesses.read_count; j++) {
+            liveness->frame_start = math_minimum(liveness->frame_start, accesses.reads[j].offset);
+            liveness->frame_end = math_maximum(liveness->frame_end, accesses.reads[j].offset + accesses.reads[j].size);
+        }
+        if (accesses.has_write) {
+            liveness->frame_start = math_minimum(liveness->frame_start, accesses.write.offset);
+            liveness->frame_end = math_maximum(liveness->frame_end, accesses.write.offset + accesses.write.size);
+        }
+        if (instr->instruction_type == Instruction_Type::LOAD_REGISTER_ADDRESS) {
+            liveness->frame_start = math_minimum(liveness->frame_start, instr->op2);
+            liveness->frame_end = math_maximum(liveness->frame_end, instr->op2 + instr->op3);
+        }
+    }
+    if (liveness->frame_end - liveness->frame_start > BYTECODE_OPTIMIZER_MAX_FRAME_SIZE) {
+        return false;
+    }
+
+    liveness->word_count = (liveness->frame_end - liveness->frame_start + 63) / 64;
+    liveness->live_in = array_create_empty<u64>((range_end - range_start) * liveness->word_count);
+    liveness->escaped = array_create_empty<u64>(liveness->word_count);
+    liveness->temporary = array_create_empty<u64>(liveness->word_count);
+    memory_set_bytes(liveness->live_in.data, sizeof(u64) * liveness->live_in.size, 0);
+    memory_set_bytes(liveness->escaped.data, sizeof(u64) * liveness->word_count, 0);
+
+    // Parameters belong to the caller, and addressed registers may be accessed through pointers
+    liveness_bits_set(liveness, liveness->escaped.data, liveness->frame_start, -liveness->frame_start);
+    for (int i = range_start; i < range_end; i++) {
+        Bytecode_Instruction* instr = &instructions->data[i];
+        if (instr->instruction_type == Instruction_Type::LOAD_REGISTER_ADDRESS) {
+            liveness_bits_set(liveness, liveness->escaped.data, instr->op2, instr->op3);
+        }
+    }
+
+    // Backwards dataflow until nothing changes
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = range_end - 1; i >= range_start; i--)
+        {
+            Instruction_Accesses accesses = bytecode_instruction_get_accesses(&instructions->data[i]);
+            u64* new_live_in = liveness_compute_live_out(liveness, &accesses, i);
+            if (accesses.has_write) {
+                liveness_bits_clear(liveness, new_live_in, accesses.write.offset, accesses.write.size);
+            }
+            for (int j = 0; j < accesses.read_count; j++) {
+                liveness_bits_set(liveness, new_live_in, accesses.reads[j].offset, accesses.reads[j].size);
+            }
+            u64* live_in = liveness_get_live_in(liveness, i);
+            for (int j = 0; j < liveness->word_count; j++) {
+                new_live_in[j] |= liveness->escaped.data[j];
+                if (new_live_in[j] != live_in[j]) {
+                    live_in[j] = new_live_in[j];
+                    changed = true;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void liveness_destroy(Bytecode_Liveness* liveness)
+{
+    array_destroy(&liveness->live_in);
+    array_destroy(&liveness->escaped);
+    array_destroy(&liveness->temporary);
+}
+
+
+
+/*
+    TRANSFORMATIONS
+    All transformations look at an instruction pair (first, first + 1), rewrite first and remove the second one (or the other way around).
+    Since an instruction takes part in at most one transformation per round, the liveness of the round stays conservative.
+*/
+struct Bytecode_Optimizer_Round
+{
+    Bytecode_Generator* generator;
+    Bytecode_Liveness liveness;
+    Array<bool> is_jump_target;
+    Array<bool> is_removed;
+};
+
+// Returns true if bytes of the range are live after the instruction, ignoring bytes the instruction overwrites itself
+bool optimizer_is_live_after(Bytecode_Optimizer_Round* round, int instruction_index, int offset, int size)
+{
+    Bytecode_Liveness* liveness = &round->liveness;
+    if (liveness_bits_test_any(liveness, liveness->escaped.data, offset, size)) {
+        return true;
+    }
+    Instruction_Accesses accesses = bytecode_instruction_get_accesses(&round->generator->instructions.data[instruction_index]);
+    u64* live_out = liveness_compute_live_out(liveness, &accesses, instruction_index);
+    if (accesses.has_write) {
+        liveness_bits_clear(liveness, live_out, accesses.write.offset, accesses.write.size);
+    }
+    return liveness_bits_test_any(liveness, live_out, offset, size);
+}
+
+// Instruction that writes t, followed by MOVE d <- t: The instruction writes to d directly
+bool optimizer_try_forward_destination(Bytecode_Optimizer_Round* round, int index)
+{
+    Bytecode_Instruction* first = &round->generator->instructions.data[index];
+    Bytecode_Instruction* move = &round->generator->instructions.data[index + 1];
+    if (move->instruction_type != Instruction_Type::MOVE_STACK_DATA) return false;
+
+    Instruction_Accesses accesses = bytecode_instruction_get_accesses(first);
+    if (!accesses.has_write || move->op2 != accesses.write.offset || move->op3 < accesses.write.size) return false;
+    int temporary = accesses.write.offset;
+    int destination = move->op1;
+    int write_size = accesses.write.size;
+    int move_size = move->op3;
+    if (stack_accesses_overlap(temporary, move_size, destination, move_size)) return false;
+    if (optimizer_is_live_after(round, index + 1, temporary, move_size)) return false;
+    // A larger move also copies bytes the instruction did not write, these must not be needed
+    if (move_size > write_size && optimizer_is_live_after(round, index + 1, destination + write_size, move_size - write_size)) return false;
+
+    first->op1 = destination;
+    round->is_removed[index + 1] = true;
+    return true;
+}
+
+// MOVE t <- s, followed by an instruction reading t: The instruction reads s directly
+bool optimizer_try_forward_source(Bytecode_Optimizer_Round* round, int index)
+{
+    Bytecode_Instruction* move = &round->generator->instructions.data[index];
+    Bytecode_Instruction* second = &round->generator->instructions.data[index + 1];
+    if (move->instruction_type != Instruction_Type::MOVE_STACK_DATA) return false;
+    int temporary = move->op1;
+    int source = move->op2;
+    int size = move->op3;
+    if (stack_accesses_overlap(temporary, size, source, size)) return false;
+
+    Instruction_Accesses accesses = bytecode_instruction_get_accesses(second);
+    bool reads_temporary = false;
+    for (int i = 0; i < accesses.read_count; i++)
+    {
+        Stack_Access* read = &accesses.reads[i];
+        if (!stack_accesses_overlap(read->offset, read->size, temporary, size)) continue;
+        if (read->operand == 0 || read->offset != temporary || read->size > size) return false;
+        reads_temporary = true;
+    }
+    if (!reads_temporary) return false;
+    if (optimizer_is_live_after(round, index + 1, temporary, size)) return false;
+
+    for (int i = 0; i < accesses.read_count; i++)
+    {
+        Stack_Access* read = &accesses.reads[i];
+        if (read->offset != temporary) continue;
+        switch (read->operand) {
+        case 1: second->op1 = source; break;
+        case 2: second->op2 = source; break;
+        case 3: second->op3 = source; break;
+        case 4: second->op4 = source; break;
+        }
+    }
+    round->is_removed[index] = true;
+    return true;
+}
+
+// BINARY_OP_XXX comparison followed by JUMP_ON_TRUE/JUMP_ON_FALSE on the result
+bool optimizer_try_fuse_compare_and_jump(Bytecode_Optimizer_Round* round, int index)
+{
+    Bytecode_Instruction* compare = &round->generator->instructions.data[index];
+    Bytecode_Instruction* jump = &round->generator->instructions.data[index + 1];
+    if (!instruction_type_is_comparison(compare->instruction_type)) return false;
+    if (jump->instruction_type != Instruction_Type::JUMP_ON_TRUE && jump->instruction_type != Instruction_Type::JUMP_ON_FALSE) return false;
+    if (jump->op2 != compare->op1) return false;
+
+    Instruction_Type comparison = compare->instruction_type;
+    Primitive_Type type = (Primitive_Type)compare->op4;
+    if (type == Primitive_Type::BOOLEAN && comparison != Instruction_Type::BINARY_OP_EQUAL && comparison != Instruction_Type::BINARY_OP_NOT_EQUAL) {
+        return false;
+    }
+    if (jump->instruction_type == Instruction_Type::JUMP_ON_FALSE)
+    {
+        // Invert comparison, which is only valid for floats on equality because of NaNs
+        bool is_equality = comparison == Instruction_Type::BINARY_OP_EQUAL || comparison == Instruction_Type::BINARY_OP_NOT_EQUAL;
+        if (primitive_type_is_float(type) && !is_equality) return false;
+        switch (comparison)
+        {
+        case Instruction_Type::BINARY_OP_EQUAL: comparison = Instruction_Type::BINARY_OP_NOT_EQUAL; break;
+        case Instruction_Type::BINARY_OP_NOT_EQUAL: comparison = Instruction_Type::BINARY_OP_EQUAL; break;
+        case Instruction_Type::BINARY_OP_LESS_THAN: comparison = Instruction_Type::BINARY_OP_GREATER_EQUAL; break;
+        case Instruction_Type::BINARY_OP_GREATER_EQUAL: comparison = Instruction_Type::BINARY_OP_LESS_THAN; break;
+        case Instruction_Type::BINARY_OP_GREATER_THAN: comparison = Instruction_Type::BINARY_OP_LESS_EQUAL; break;
+        case Instruction_Type::BINARY_OP_LESS_EQUAL: comparison = Instruction_Type::BINARY_OP_GREATER_THAN; break;
+        }
+    }
+    if (optimizer_is_live_after(round, index + 1, compare->op1, 1)) return false;
+
+    *compare = instruction_make_4(
+        Instruction_Type::JUMP_ON_COMPARISON, jump->op1, compare->op2, compare->op3, binary_operation_pack(comparison, type)
+    );
+    round->is_removed[index + 1] = true;
+    return true;
+}
+
+// READ_CONSTANT (4 byte) followed by a 32 bit addition/subtraction with the constant
+bool optimizer_try_fuse_add_constant(Bytecode_Optimizer_Round* round, int index)
+{
+    Bytecode_Instruction* load = &round->generator->instructions.data[index];
+    Bytecode_Instruction* add = &round->generator->instructions.data[index + 1];
+    if (load->instruction_type != Instruction_Type::READ_CONSTANT || load->op3 != 4) return false;
+    if (add->instruction_type != Instruction_Type::BINARY_OP_ADDITION && add->instruction_type != Instruction_Type::BINARY_OP_SUBTRACTION) return false;
+    Primitive_Type type = (Primitive_Type)add->op4;
+    if (type != Primitive_Type::SIGNED_INT_32 && type != Primitive_Type::UNSIGNED_INT_32) return false;
+
+    int constant_reg = load->op1;
+    int value_reg;
+    if (add->op3 == constant_reg && add->op2 != constant_reg) {
+        value_reg = add->op2;
+    }
+    else if (add->instruction_type == Instruction_Type::BINARY_OP_ADDITION && add->op2 == constant_reg && add->op3 != constant_reg) {
+        value_reg = add->op3;
+    }
+    else {
+        return false;
+    }
+    if (stack_accesses_overlap(value_reg, 4, constant_reg, 4)) return false;
+    if (optimizer_is_live_after(round, index + 1, constant_reg, 4)) return false;
+
+    u32 constant = *(u32*)(round->generator->ir_program->constant_pool.constant_memory.data + load->op2);
+    if (add->instruction_type == Instruction_Type::BINARY_OP_SUBTRACTION) {
+        constant = 0 - constant;
+    }
+    *load = instruction_make_3(Instruction_Type::I32_ADD_CONSTANT, add->op1, value_reg, (i32)constant);
+    round->is_removed[index + 1] = true;
+    return true;
+}
+
+// READ_GLOBAL followed by a binary operation using the global value
+bool optimizer_try_fuse_global_binary_op(Bytecode_Optimizer_Round* round, int index)
+{
+    Bytecode_Instruction* load = &round->generator->instructions.data[index];
+    Bytecode_Instruction* binary = &round->generator->instructions.data[index + 1];
+    if (load->instruction_type != Instruction_Type::READ_GLOBAL) return false;
+    Instruction_Type operation = binary->instruction_type;
+    if (!instruction_type_is_arithmetic(operation) && !instruction_type_is_comparison(operation)) return false;
+    Primitive_Type type = (Primitive_Type)binary->op4;
+    if (load->op3 != primitive_type_size_in_bytes(type)) return false;
+    if (type == Primitive_Type::BOOLEAN && operation != Instruction_Type::BINARY_OP_EQUAL && operation != Instruction_Type::BINARY_OP_NOT_EQUAL) {
+        return false;
+    }
+
+    int global_reg = load->op1;
+    int size = load->op3;
+    int other_reg;
+    if (binary->op2 == global_reg && !stack_accesses_overlap(binary->op3, size, global_reg, size)) {
+        other_reg = binary->op3;
+    }
+    else if (binary->op3 == global_reg && !stack_accesses_overlap(binary->op2, size, global_reg, size))
+    {
+        // Global is the right operand, swap if possible
+        other_reg = binary->op2;
+        switch (operation)
+        {
+        case Instruction_Type::BINARY_OP_ADDITION:
+        case Instruction_Type::BINARY_OP_MULTIPLICATION:
+        case Instruction_Type::BINARY_OP_EQUAL:
+        case Instruction_Type::BINARY_OP_NOT_EQUAL: break;
+        case Instruction_Type::BINARY_OP_LESS_THAN: operation = Instruction_Type::BINARY_OP_GREATER_THAN; break;
+        case Instruction_Type::BINARY_OP_LESS_EQUAL: operation = Instruction_Type::BINARY_OP_GREATER_EQUAL; break;
+        case Instruction_Type::BINARY_OP_GREATER_THAN: operation = Instruction_Type::BINARY_OP_LESS_THAN; break;
+        case Instruction_Type::BINARY_OP_GREATER_EQUAL: operation = Instruction_Type::BINARY_OP_LESS_EQUAL; break;
+        default: return false;
+        }
+    }
+    else {
+        return false;
+    }
+    if (optimizer_is_live_after(round, index + 1, global_reg, size)) return false;
+
+    *load = instruction_make_4(Instruction_Type::READ_GLOBAL_BINARY_OP, binary->op1, load->op2, other_reg, binary_operation_pack(operation, type));
+    round->is_removed[index + 1] = true;
+    return true;
+}
+
+bool optimizer_try_remove_dead_store(Bytecode_Optimizer_Round* round, int index)
+{
+    Instruction_Accesses accesses = bytecode_instruction_get_accesses(&round->generator->instructions.data[index]);
+    if (!accesses.is_removable || !accesses.has_write) return false;
+    Bytecode_Liveness* liveness = &round->liveness;
+    u64* live_out = liveness_compute_live_out(liveness, &accesses, index);
+    if (liveness_bits_test_any(liveness, live_out, accesses.write.offset, accesses.write.size)) return false;
+    if (liveness_bits_test_any(liveness, liveness->escaped.data, accesses.write.offset, accesses.write.size)) return false;
+    round->is_removed[index] = true;
+    return true;
+}
+
+bool optimizer_optimize_function(Bytecode_Optimizer_Round* round, int range_start, int range_end)
+{
+    if (!liveness_compute(&round->liveness, &round->generator->instructions, range_start, range_end)) {
+        return false;
+    }
+    SCOPE_EXIT(liveness_destroy(&round->liveness));
+
+    bool changed = false;
+    int i = range_start;
+    while (i < range_end)
+    {
+        if (optimizer_try_remove_dead_store(round, i)) {
+            changed = true;
+            i++;
+            continue;
+        }
+        if (i + 1 < range_end && !round->is_jump_target[i + 1])
+        {
+            if (optimizer_try_fuse_compare_and_jump(round, i) ||
+                optimizer_try_fuse_add_constant(round, i) ||
+                optimizer_try_fuse_global_binary_op(round, i) ||
+                optimizer_try_forward_destination(round, i) ||
+                optimizer_try_forward_source(round, i))
+            {
+                changed = true;
+                i += 2;
+                continue;
+            }
+        }
+        i++;
+    }
+    return changed;
+}
+
+// Removes instructions marked in is_removed and remaps all instruction indices
+void optimizer_compact_instructions(Bytecode_Optimizer_Round* round)
+{
+    Bytecode_Generator* generator = round->generator;
+    Dynamic_Array<Bytecode_Instruction>* instructions = &generator->instructions;
+    // Removed instructions map to the next remaining instruction
+    Array<int> new_indices = array_create_empty<int>(instructions->size + 1);
+    SCOPE_EXIT(array_destroy(&new_indices));
+    int count = 0;
+    for (int i = 0; i < instructions->size; i++) {
+        new_indices[i] = count;
+        if (!round->is_removed[i]) {
+            instructions->data[count] = instructions->data[i];
+            count++;
+        }
+    }
+    new_indices[instructions->size] = count;
+    instructions->size = count;
+
+    for (int i = 0; i < instructions->size; i++)
+    {
+        Bytecode_Instruction* instr = &instructions->data[i];
+        switch (instr->instruction_type)
+        {
+        case Instruction_Type::JUMP:
+        case Instruction_Type::JUMP_ON_TRUE:
+        case Instruction_Type::JUMP_ON_FALSE:
+        case Instruction_Type::JUMP_ON_COMPARISON:
+        case Instruction_Type::CALL_FUNCTION:
+            instr->op1 = new_indices[instr->op1];
+            break;
+        case Instruction_Type::LOAD_FUNCTION_LOCATION:
+            instr->op2 = new_indices[instr->op2];
+            break;
+        }
+    }
+
+    Hashtable_Iterator<IR_Function*, int, Hasher_Pointer<IR_Function*>> iter = hashtable_iterator_create(&generator->function_locations);
+    while (hashtable_iterator_has_next(&iter)) {
+        *iter.value = new_indices[*iter.value];
+        hashtable_iterator_next(&iter);
+    }
+    generator->entry_point_index = new_indices[generator->entry_point_index];
+}
+
+bool optimizer_run_round(Bytecode_Generator* generator)
+{
+    Dynamic_Array<Bytecode_Instruction>* instructions = &generator->instructions;
+    Bytecode_Optimizer_Round round;
+    round.generator = generator;
+    round.is_jump_target = array_create_empty<bool>(instructions->size + 1);
+    round.is_removed = array_create_empty<bool>(instructions->size + 1);
+    SCOPE_EXIT(array_destroy(&round.is_jump_target));
+    SCOPE_EXIT(array_destroy(&round.is_removed));
+    Array<bool> is_function_start = array_create_empty<bool>(instructions->size + 1);
+    SCOPE_EXIT(array_destroy(&is_function_start));
+    for (int i = 0; i < instructions->size + 1; i++) {
+        round.is_jump_target[i] = false;
+        round.is_removed[i] = false;
+        is_function_start[i] = false;
+    }
+
+    // Find jump targets and function ranges
+    is_function_start[0] = true;
+    is_function_start[generator->entry_point_index] = true;
+    Hashtable_Iterator<IR_Function*, int, Hasher_Pointer<IR_Function*>> iter = hashtable_iterator_create(&generator->function_locations);
+    while (hashtable_iterator_has_next(&iter)) {
+        is_function_start[*iter.value] = true;
+        hashtable_iterator_next(&iter);
+    }
+    for (int i = 0; i < instructions->size; i++)
+    {
+        Bytecode_Instruction* instr = &instructions->data[i];
+        Instruction_Accesses accesses = bytecode_instruction_get_accesses(instr);
+        if (accesses.jump_target != -1) {
+            round.is_jump_target[accesses.jump_target] = true;
+        }
+        if (instr->instruction_type == Instruction_Type::CALL_FUNCTION) {
+            is_function_start[instr->op1] = true;
+        }
+        else if (instr->instruction_type == Instruction_Type::LOAD_FUNCTION_LOCATION) {
+            is_function_start[instr->op2] = true;
+        }
+    }
+    for (int i = 0; i < instructions->size + 1; i++) {
+        if (is_function_start[i]) {
+            round.is_jump_target[i] = true;
+        }
+    }
+
+    bool changed = false;
+    int range_start = 0;
+    for (int i = 1; i <= instructions->size; i++) {
+        if (i == instructions->size || is_function_start[i]) {
+            if (optimizer_optimize_function(&round, range_start, i)) {
+                changed = true;
+            }
+            range_start = i;
+        }
+    }
+
+    if (changed) {
+        optimizer_compact_instructions(&round);
+    }
+    return changed;
+}
+
+void bytecode_optimizer_optimize(Bytecode_Generator* generator)
+{
+    for (int i = 0; i < BYTECODE_OPTIMIZER_MAX_ROUNDS; i++) {
+        if (!optimizer_run_round(generator)) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+struct Bytecode_Generator;
+
+/*
+    Peephole pass over the generated bytecode, runs after bytecode_generator_generate.
+    Uses per function liveness of stack bytes to do:
+        - Copy propagation (Instruction -> MOVE_STACK_DATA pairs and MOVE_STACK_DATA -> Instruction pairs)
+        - Dead store elimination
+        - Superinstructions: JUMP_ON_COMPARISON, I32_ADD_CONSTANT, READ_GLOBAL_BINARY_OP
+    Removed instructions are compacted afterwards, jumps, calls and function locations are remapped.
+    Stack bytes whose address is taken (LOAD_REGISTER_ADDRESS) and parameters are never optimized.
+*/
+void bytecode_optimizer_optimize(Bytecode_Generator* generator);
@@ -0,0 +1,261 @@
+#include "bytecode_profiler.hpp"
+
+#include "compiler.hpp"
+#include "../../utility/file_io.hpp"
+
+const int BYTECODE_PROFILER_MAX_SAMPLE_DEPTH = 256; // Deeper stacks keep the innermost frames
+
+struct Bytecode_Profiler_Entry
+{
+    int index;
+    u64 count;
+};
+
+Bytecode_Profiler bytecode_profiler_create(double sample_interval)
+{
+    Bytecode_Profiler result;
+    result.sample_interval = sample_interval;
+    result.next_sample_time = 0;
+    result.compiler = 0;
+    result.instruction_counts = dynamic_array_create_empty<u64>(64);
+    result.functions = dynamic_array_create_empty<Bytecode_Profiler_Function>(64);
+    result.folded_stacks = hashtable_create_empty<String, int, Hasher_String>(64);
+    result.sample_stack = dynamic_array_create_empty<int>(64);
+    result.sample_count = 0;
+    return result;
+}
+
+void bytecode_profiler_reset_folded_stacks(Bytecode_Profiler* profiler)
+{
+    Hashtable_Iterator<String, int, Hasher_String> iter = hashtable_iterator_create(&profiler->folded_stacks);
+    while (hashtable_iterator_has_next(&iter)) {
+        string_destroy(iter.key);
+        hashtable_iterator_next(&iter);
+    }
+    hashtable_reset(&profiler->folded_stacks);
+}
+
+void bytecode_profiler_destroy(Bytecode_Profiler* profiler)
+{
+    bytecode_profiler_reset_folded_stacks(profiler);
+    hashtable_destroy(&profiler->folded_stacks);
+    dynamic_array_destroy(&profiler->instruction_counts);
+    dynamic_array_destroy(&profiler->functions);
+    dynamic_array_destroy(&profiler->sample_stack);
+}
+
+void bytecode_profiler_reset(Bytecode_Profiler* profiler, Compiler* compiler)
+{
+    profiler->compiler = compiler;
+    profiler->sample_count = 0;
+    profiler->next_sample_time = timer_current_time_in_seconds(compiler->timer) + profiler->sample_interval;
+    bytecode_profiler_reset_folded_stacks(profiler);
+
+    Bytecode_Generator* generator = &compiler->bytecode_generator;
+    dynamic_array_reset(&profiler->instruction_counts);
+    for (int i = 0; i < generator->instructions.size; i++) {
+        dynamic_array_push_back(&profiler->instruction_counts, (u64)0);
+    }
+
+    // Function table sorted by start instruction, so instructions can be mapped to functions with a binary search
+    IR_Program* program = compiler->analyser.program;
+    dynamic_array_reset(&profiler->functions);
+    for (int i = 0; i < program->functions.size; i++)
+    {
+        int* location = hashtable_find_element(&generator->function_locations, program->functions[i]);
+        if (location == 0) continue;
+        Bytecode_Profiler_Function function;
+        function.start_instruction = *location;
+        function.name_handle = -1;
+        function.function_index = i;
+        Symbol_Table* root_table = compiler->analyser.root_table;
+        for (int j = 0; j < root_table->symbols.size; j++) {
+            Symbol* symbol = &root_table->symbols[j];
+            if (symbol->symbol_type == Symbol_Type::FUNCTION && symbol->options.function == program->functions[i]) {
+                function.name_handle = symbol->name_handle;
+                break;
+            }
+        }
+
+        dynamic_array_push_back(&profiler->functions, function);
+        for (int j = profiler->functions.size - 1; j > 0; j--) {
+            if (profiler->functions[j - 1].start_instruction <= function.start_instruction) break;
+            profiler->functions[j] = profiler->functions[j - 1];
+            profiler->functions[j - 1] = function;
+        }
+    }
+}
+
+// Returns the index into profiler->functions, or -1 if the instruction is before all functions
+int bytecode_profiler_find_function(Bytecode_Profiler* profiler, int instruction_index)
+{
+    int low = 0;
+    int high = profiler->functions.size - 1;
+    int result = -1;
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+        if (profiler->functions[middle].start_instruction <= instruction_index) {
+            result = middle;
+            low = middle + 1;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+    return result;
+}
+
+void bytecode_profiler_append_function_name(Bytecode_Profiler* profiler, String* string, int function)
+{
+    if (function == -1) {
+        string_append_formated(string, "unknown");
+        return;
+    }
+    Bytecode_Profiler_Function* info = &profiler->functions[function];
+    if (info->name_handle != -1) {
+        string_append_formated(string, "%s", lexer_identifer_to_string(&profiler->compiler->lexer, info->name_handle).characters);
+    }
+    else {
+        string_append_formated(string, "function_%d", info->function_index);
+    }
+}
+
+void bytecode_profiler_sample(Bytecode_Profiler* profiler, Bytecode_Interpreter* interpreter)
+{
+    double now = timer_current_time_in_seconds(profiler->compiler->timer);
+    if (now < profiler->next_sample_time) return;
+    profiler->next_sample_time = now + profiler->sample_interval;
+    profiler->sample_count++;
+
+    // Walk the frames, each stores the return address at offset 0 and the stack pointer of the caller at offset 8
+    Bytecode_Instruction* instructions = interpreter->generator->instructions.data;
+    dynamic_array_reset(&profiler->sample_stack);
+    Bytecode_Instruction* instruction = interpreter->instruction_pointer;
+    byte* stack_pointer = interpreter->stack_pointer;
+    bool truncated = false;
+    while (true)
+    {
+        if (profiler->sample_stack.size >= BYTECODE_PROFILER_MAX_SAMPLE_DEPTH) {
+            truncated = true;
+            break;
+        }
+        dynamic_array_push_back(&profiler->sample_stack, bytecode_profiler_find_function(profiler, (int)(instruction - instructions)));
+        Bytecode_Instruction* return_address = *(Bytecode_Instruction**)stack_pointer;
+        if (return_address == 0) break;
+        instruction = return_address - 1;
+        stack_pointer = *(byte**)(stack_pointer + 8);
+    }
+
+    String folded = string_create_empty(64);
+    if (truncated) {
+        string_append_formated(&folded, "[truncated];");
+    }
+    for (int i = profiler->sample_stack.size - 1; i >= 0; i--) {
+        bytecode_profiler_append_function_name(profiler, &folded, profiler->sample_stack[i]);
+        if (i != 0) {
+            string_append_formated(&folded, ";");
+        }
+    }
+    int* count = hashtable_find_element(&profiler->folded_stacks, folded);
+    if (count != 0) {
+        *count = *count + 1;
+        string_destroy(&folded);
+    }
+    else {
+        hashtable_insert_element(&profiler->folded_stacks, folded, 1);
+    }
+}
+
+// Sorts by count descending
+void bytecode_profiler_sort_entries(Dynamic_Array<Bytecode_Profiler_Entry>* entries)
+{
+    for (int i = 1; i < entries->size; i++)
+    {
+        Bytecode_Profiler_Entry entry = entries->data[i];
+        int j = i;
+        while (j > 0 && entries->data[j - 1].count < entry.count) {
+            entries->data[j] = entries->data[j - 1];
+            j--;
+        }
+        entries->data[j] = entry;
+    }
+}
+
+void bytecode_profiler_append_report_to_string(Bytecode_Profiler* profiler, String* string, int max_entries)
+{
+    Bytecode_Generator* generator = &profiler->compiler->bytecode_generator;
+    u64 total = 0;
+    for (int i = 0; i < profiler->instruction_counts.size; i++) {
+        total += profiler->instruction_counts[i];
+    }
+    string_append_formated(string, "Executed instructions: %llu, samples: %d\n", total, profiler->sample_count);
+    if (total == 0) return;
+
+    Dynamic_Array<Bytecode_Profiler_Entry> entries = dynamic_array_create_empty<Bytecode_Profiler_Entry>(64);
+    SCOPE_EXIT(dynamic_array_destroy(&entries));
+
+    // Per opcode, index is the Instruction_Type
+    int opcode_count = (int)Instruction_Type::READ_GLOBAL_BINARY_OP + 1;
+    for (int i = 0; i < opcode_count; i++) {
+        Bytecode_Profiler_Entry entry;
+        entry.index = i;
+        entry.count = 0;
+        dynamic_array_push_back(&entries, entry);
+    }
+    for (int i = 0; i < profiler->instruction_counts.size; i++) {
+        entries[(int)generator->instructions[i].instruction_type].count += profiler->instruction_counts[i];
+    }
+    bytecode_profiler_sort_entries(&entries);
+    string_append_formated(string, "Opcodes:\n");
+    String name = string_create_empty(64);
+    SCOPE_EXIT(string_destroy(&name));
+    for (int i = 0; i < entries.size && i < max_entries && entries[i].count != 0; i++)
+    {
+        // The opcode name is the first word of the instruction string
+        Bytecode_Instruction instruction = instruction_make_4((Instruction_Type)entries[i].index, 0, 0, 0, 0);
+        string_reset(&name);
+        bytecode_instruction_append_to_string(&name, instruction);
+        Optional<int> space = string_find_character_index(&name, ' ', 0);
+        if (space.available) {
+            string_truncate(&name, space.value);
+        }
+        string_append_formated(string, "    %-28s %12llu  %5.1f%%\n", name.characters, entries[i].count, entries[i].count * 100.0 / total);
+    }
+
+    // Per function, instructions of a function are executed until the next function starts
+    dynamic_array_reset(&entries);
+    for (int i = 0; i < profiler->functions.size; i++) {
+        Bytecode_Profiler_Entry entry;
+        entry.index = i;
+        entry.count = 0;
+        dynamic_array_push_back(&entries, entry);
+    }
+    for (int i = 0; i < profiler->functions.size; i++)
+    {
+        int end = i + 1 < profiler->functions.size ? profiler->functions[i + 1].start_instruction : profiler->instruction_counts.size;
+        for (int j = profiler->functions[i].start_instruction; j < end; j++) {
+            entries[i].count += profiler->instruction_counts[j];
+        }
+    }
+    bytecode_profiler_sort_entries(&entries);
+    string_append_formated(string, "Functions:\n");
+    for (int i = 0; i < entries.size && i < max_entries && entries[i].count != 0; i++)
+    {
+        string_reset(&name);
+        bytecode_profiler_append_function_name(profiler, &name, entries[i].index);
+        string_append_formated(string, "    %-28s %12llu  %5.1f%%\n", name.characters, entries[i].count, entries[i].count * 100.0 / total);
+    }
+}
+
+bool bytecode_profiler_write_folded_stacks(Bytecode_Profiler* profiler, const char* filepath)
+{
+    String output = string_create_empty(1024);
+    SCOPE_EXIT(string_destroy(&output));
+    Hashtable_Iterator<String, int, Hasher_String> iter = hashtable_iterator_create(&profiler->folded_stacks);
+    while (hashtable_iterator_has_next(&iter)) {
+        string_append_formated(&output, "%s %d\n", iter.key->characters, *iter.value);
+        hashtable_iterator_next(&iter);
+    }
+    return file_io_write_file(filepath, array_create_static((byte*)output.characters, output.size));
+}
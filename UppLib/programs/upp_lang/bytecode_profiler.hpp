@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../../datastructures/dynamic_array.hpp"
+#include "../../datastructures/hashtable.hpp"
+#include "../../datastructures/string.hpp"
+#include "../../utility/datatypes.hpp"
+#include "../../utility/hash_functions.hpp"
+
+struct Compiler;
+struct IR_Function;
+struct Bytecode_Interpreter;
+
+/*
+    Profiling mode of the bytecode interpreter, used if Bytecode_Interpreter::profiler is set.
+    Execution then always uses the switch engine and counts every executed instruction (Per instruction index,
+    which gives per opcode and per function counts). Every sample_interval seconds the call stack is sampled by walking
+    the stack frames (Return address + old stack pointer), samples are stored as folded stacks ("main;a;b"),
+    the format used by flame graph tools.
+*/
+struct Bytecode_Profiler_Function
+{
+    int start_instruction;
+    int name_handle; // -1 if the function is not defined in the root table
+    int function_index; // Index in IR_Program::functions
+};
+
+struct Bytecode_Profiler
+{
+    double sample_interval;
+    double next_sample_time;
+    Compiler* compiler;
+    Dynamic_Array<u64> instruction_counts; // Per bytecode instruction
+    Dynamic_Array<Bytecode_Profiler_Function> functions; // Sorted by start_instruction
+    Hashtable<String, int, Hasher_String> folded_stacks; // Sample count per folded stack, owns the strings
+    Dynamic_Array<int> sample_stack; // Function indices of the current sample, innermost first
+    int sample_count;
+};
+
+Bytecode_Profiler bytecode_profiler_create(double sample_interval);
+void bytecode_profiler_destroy(Bytecode_Profiler* profiler);
+// Resets all counts and samples, the bytecode of the compiler must be generated
+void bytecode_profiler_reset(Bytecode_Profiler* profiler, Compiler* compiler);
+// Records the current call stack of the interpreter if the sample interval has passed
+void bytecode_profiler_sample(Bytecode_Profiler* profiler, Bytecode_Interpreter* interpreter);
+void bytecode_profiler_append_report_to_string(Bytecode_Profiler* profiler, String* string, int max_entries);
+// One line "main;caller;callee count" per distinct stack
+bool bytecode_profiler_write_folded_stacks(Bytecode_Profiler* profiler, const char* filepath);
@@ -3,667 +3,790 @@
 #include "compiler.hpp"
 #include "../../utility/file_io.hpp"
 #include <cstdlib>
-#include <Windows.h>
-#include "../../win32/windows_helper_functions.hpp"
 
 C_Generator c_generator_create()
 {
     C_Generator result;
+    result.compiler = 0;
+    result.program = 0;
     result.output_string = string_create_empty(4096);
-    result.array_index_stack = dynamic_array_create_empty<int>(16);
+    result.indentation_level = 0;
+    result.type_indices = hashtable_create_empty<Type_Signature*, int, Hasher_Pointer<Type_Signature*>>(64);
+    result.function_indices = hashtable_create_empty<IR_Function*, int, Hasher_Pointer<IR_Function*>>(64);
+    result.code_block_indices = hashtable_create_empty<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>>(64);
+    result.function_name_handles = dynamic_array_create_empty<int>(64);
     return result;
 }
 
 void c_generator_destroy(C_Generator* generator)
 {
     string_destroy(&generator->output_string);
-    dynamic_array_destroy(&generator->array_index_stack);
+    hashtable_destroy(&generator->type_indices);
+    hashtable_destroy(&generator->function_indices);
+    hashtable_destroy(&generator->code_block_indices);
+    dynamic_array_destroy(&generator->function_name_handles);
 }
 
-const char* c_generator_id_to_string(C_Generator* generator, int name_handle) {
-    return lexer_identifer_to_string(&generator->compiler->lexer, name_handle).characters;
+bool c_generator_type_is_blob(Type_Signature* signature)
+{
+    return signature->type == Signature_Type::STRUCT ||
+        signature->type == Signature_Type::ARRAY_SIZED ||
+        signature->type == Signature_Type::ARRAY_UNSIZED;
 }
 
-void c_generator_generate_type_definition(C_Generator* generator, Type_Signature* signature, bool is_pointer)
+void c_generator_append_indentation(C_Generator* generator)
 {
-    /*
+    for (int i = 0; i < generator->indentation_level; i++) {
+        string_append_formated(&generator->output_string, "    ");
+    }
+}
+
+void c_generator_append_type(C_Generator* generator, Type_Signature* signature)
+{
+    String* output = &generator->output_string;
     switch (signature->type)
     {
-    case Signature_Type::VOID_TYPE: {
-        string_append_formated(&generator->output_string, "void");
+    case Signature_Type::VOID_TYPE:
+        string_append_formated(output, "void");
         break;
-    }
-    case Signature_Type::FUNCTION: {
-        panic("Should not happen yet, only when we have function pointers!\n");
+    case Signature_Type::POINTER:
+        // Pointers are untyped in C, memory accesses cast to the accessed type
+        string_append_formated(output, "void*");
         break;
-    }
-    case Signature_Type::POINTER: {
-        c_generator_generate_type_definition(generator, signature->child_type, true);
-        string_append_formated(&generator->output_string, "*");
-        break;
-    }
-    case Signature_Type::STRUCT: {
-        string_append_formated(&generator->output_string, "%s", c_generator_id_to_string(generator, signature->struct_name_handle));
-        break;
-    }
+    case Signature_Type::STRUCT:
+    case Signature_Type::ARRAY_SIZED:
     case Signature_Type::ARRAY_UNSIZED: {
-        string_append_formated(&generator->output_string, "Unsized_Array");
-        break;
-    }
-    case Signature_Type::ARRAY_SIZED: 
-    {
-        if (is_pointer) {
-            c_generator_generate_type_definition(generator, signature->child_type, true);
-        }
-        else 
-        {
-            Type_Signature* child = signature->child_type;
-            int element_count = signature->array_element_count;
-            while (child->type == Signature_Type::ARRAY_SIZED) {
-                element_count = element_count * child->array_element_count;
-                child = child->child_type;
-            }
-            dynamic_array_push_back(&generator->array_index_stack, element_count);
-            c_generator_generate_type_definition(generator, signature->child_type, true);
-        }
+        int* type_index = hashtable_find_element(&generator->type_indices, signature);
+        assert(type_index != 0, "All types should be registered in the type system");
+        string_append_formated(output, "Upp_Type_%d", *type_index);
         break;
     }
     case Signature_Type::PRIMITIVE:
     {
         switch (signature->primitive_type)
         {
-        case Primitive_Type::BOOLEAN:  string_append_formated(&generator->output_string, "bool"); break;
-        case Primitive_Type::FLOAT_32:  string_append_formated(&generator->output_string, "f32"); break;
-        case Primitive_Type::FLOAT_64:  string_append_formated(&generator->output_string, "f64"); break;
-        case Primitive_Type::SIGNED_INT_8:  string_append_formated(&generator->output_string, "i8"); break;
-        case Primitive_Type::SIGNED_INT_16:  string_append_formated(&generator->output_string, "i16"); break;
-        case Primitive_Type::SIGNED_INT_32:  string_append_formated(&generator->output_string, "i32"); break;
-        case Primitive_Type::SIGNED_INT_64:  string_append_formated(&generator->output_string, "i64"); break;
-        case Primitive_Type::UNSIGNED_INT_8:  string_append_formated(&generator->output_string, "u8"); break;
-        case Primitive_Type::UNSIGNED_INT_16:  string_append_formated(&generator->output_string, "u16"); break;
-        case Primitive_Type::UNSIGNED_INT_32:  string_append_formated(&generator->output_string, "u32"); break;
-        case Primitive_Type::UNSIGNED_INT_64:  string_append_formated(&generator->output_string, "u64"); break;
+        case Primitive_Type::BOOLEAN: string_append_formated(output, "bool"); break;
+        case Primitive_Type::SIGNED_INT_8: string_append_formated(output, "i8"); break;
+        case Primitive_Type::SIGNED_INT_16: string_append_formated(output, "i16"); break;
+        case Primitive_Type::SIGNED_INT_32: string_append_formated(output, "i32"); break;
+        case Primitive_Type::SIGNED_INT_64: string_append_formated(output, "i64"); break;
+        case Primitive_Type::UNSIGNED_INT_8: string_append_formated(output, "u8"); break;
+        case Primitive_Type::UNSIGNED_INT_16: string_append_formated(output, "u16"); break;
+        case Primitive_Type::UNSIGNED_INT_32: string_append_formated(output, "u32"); break;
+        case Primitive_Type::UNSIGNED_INT_64: string_append_formated(output, "u64"); break;
+        case Primitive_Type::FLOAT_32: string_append_formated(output, "f32"); break;
+        case Primitive_Type::FLOAT_64: string_append_formated(output, "f64"); break;
         default: panic("Should not happen");
         }
         break;
     }
+    default: panic("Function and error types cannot be used as C value types");
     }
-    */
 }
 
-void c_generator_generate_register_name(C_Generator* generator, int register_index)
+void c_generator_append_function_name(C_Generator* generator, IR_Function* function)
 {
-    /*
-    Intermediate_Register* reg = &generator->im_generator->functions[generator->current_function_index].registers[register_index];
-    if (reg->type == Intermediate_Register_Type::VARIABLE) {
-        string_append_formated(&generator->output_string, "%s_var%d", c_generator_id_to_string(generator, reg->name_id), register_index);
+    int* function_index = hashtable_find_element(&generator->function_indices, function);
+    assert(function_index != 0, "Function must be part of the program");
+    string_append_formated(&generator->output_string, "upp_function_%d", *function_index);
+    int name_handle = generator->function_name_handles[*function_index];
+    if (name_handle != -1) {
+        string_append_formated(&generator->output_string, "_%s", lexer_identifer_to_string(&generator->compiler->lexer, name_handle).characters);
     }
-    else if (reg->type == Intermediate_Register_Type::PARAMETER) {
-        string_append_formated(&generator->output_string, "%s_param_%d", c_generator_id_to_string(generator, reg->name_id), register_index);
+}
+
+void c_generator_append_function_signature(C_Generator* generator, IR_Function* function)
+{
+    Type_Signature* function_type = function->function_type;
+    c_generator_append_type(generator, function_type->return_type);
+    string_append_formated(&generator->output_string, " ");
+    c_generator_append_function_name(generator, function);
+    string_append_formated(&generator->output_string, "(");
+    for (int i = 0; i < function_type->parameter_types.size; i++)
+    {
+        if (i != 0) {
+            string_append_formated(&generator->output_string, ", ");
+        }
+        c_generator_append_type(generator, function_type->parameter_types[i]);
+        string_append_formated(&generator->output_string, " param_%d", i);
     }
-    else if (reg->type == Intermediate_Register_Type::EXPRESSION_RESULT) {
-        string_append_formated(&generator->output_string, "_upp_expr_%d", register_index);
+    if (function_type->parameter_types.size == 0) {
+        string_append_formated(&generator->output_string, "void");
     }
-    */
+    string_append_formated(&generator->output_string, ")");
 }
 
-void c_generator_generate_data_access(C_Generator* generator, IR_Data_Access access)
+void c_generator_append_primitive_constant(C_Generator* generator, Type_Signature* signature, byte* data)
 {
-    /*
-    if (access.type == Data_Access_Type::MEMORY_ACCESS) {
-        string_append_formated(&generator->output_string, "*");
+    String* output = &generator->output_string;
+    switch (signature->primitive_type)
+    {
+    case Primitive_Type::BOOLEAN: string_append_formated(output, "%s", *data == 0 ? "false" : "true"); break;
+    case Primitive_Type::SIGNED_INT_8: string_append_formated(output, "((i8)%d)", (int)*(i8*)data); break;
+    case Primitive_Type::SIGNED_INT_16: string_append_formated(output, "((i16)%d)", (int)*(i16*)data); break;
+    case Primitive_Type::SIGNED_INT_32: string_append_formated(output, "((i32)%d)", *(i32*)data); break;
+    case Primitive_Type::UNSIGNED_INT_8: string_append_formated(output, "((u8)%uu)", (u32)*(u8*)data); break;
+    case Primitive_Type::UNSIGNED_INT_16: string_append_formated(output, "((u16)%uu)", (u32)*(u16*)data); break;
+    case Primitive_Type::UNSIGNED_INT_32: string_append_formated(output, "((u32)%uu)", *(u32*)data); break;
+    // 64 bit values are written in hex, so that the minimum value does not need a special case
+    case Primitive_Type::SIGNED_INT_64: string_append_formated(output, "((i64)0x%llxull)", *(unsigned long long*)data); break;
+    case Primitive_Type::UNSIGNED_INT_64: string_append_formated(output, "((u64)0x%llxull)", *(unsigned long long*)data); break;
+    // Hexadecimal float literals are exact
+    case Primitive_Type::FLOAT_32: string_append_formated(output, "((f32)%a)", (double)*(f32*)data); break;
+    case Primitive_Type::FLOAT_64: string_append_formated(output, "((f64)%a)", *(f64*)data); break;
+    default: panic("Should not happen");
     }
-    c_generator_generate_register_name(generator, access.register_index);
-    */
 }
 
-/* C arrays suck a little, because:
-    x: [5]int       -->     int x[5];
-    x: [5][3]int    -->     int x[15];
-    x: *[5]int      -->     int* x;
-    x: [5]*int      -->     int* x[5];
-
-    The question is how I handle pointers and arrays
-    Unsized arrays should be ezy
-
-    The problem is that C passes arrays ALWAYS as a pointer, so I would need a memcpy after passing the parameter
-*/
-void c_generator_generate_variable_definition_with_name_handle(C_Generator* generator, int name_handle, Type_Signature* signature, bool semicolon)
+// Appends the variable name (Or the constant memory location) of the access, without the memory access
+void c_generator_append_data_access_name(C_Generator* generator, IR_Data_Access access)
 {
-    /*
-    dynamic_array_reset(&generator->array_index_stack);
-    c_generator_generate_type_definition(generator, signature, false);
-    string_append_formated(&generator->output_string, " %s", c_generator_id_to_string(generator, name_handle));
-    for (int i = 0; i < generator->array_index_stack.size; i++) {
-        string_append_formated(&generator->output_string, "[%d]", generator->array_index_stack[i]);
-    }
-    dynamic_array_reset(&generator->array_index_stack);
-    if (semicolon) {
-        string_append_formated(&generator->output_string, ";");
-    }
-    */
+    String* output = &generator->output_string;
+    switch (access.type)
+    {
+    case IR_Data_Access_Type::GLOBAL_DATA:
+        string_append_formated(output, "global_%d", access.index);
+        break;
+    case IR_Data_Access_Type::PARAMETER:
+        string_append_formated(output, "param_%d", access.index);
+        break;
+    case IR_Data_Access_Type::REGISTER: {
+        int* block_index = hashtable_find_element(&generator->code_block_indices, access.option.definition_block);
+        assert(block_index != 0, "Register accesses must be inside the defining block");
+        string_append_formated(output, "reg_%d_%d", *block_index, access.index);
+        break;
+    }
+    case IR_Data_Access_Type::CONSTANT: {
+        IR_Constant* constant = &generator->program->constant_pool.constants[access.index];
+        string_append_formated(output, "(*(");
+        c_generator_append_type(generator, constant->type);
+        string_append_formated(output, "*)(upp_constant_memory + %d))", constant->offset);
+        break;
+    }
+    default: panic("Should not happen");
+    }
 }
 
-void c_generator_generate_variable_definition_with_register_index(C_Generator* generator, int register_index, bool semicolon)
+// Appends an expression for the value of the access, which is also an lvalue for non-constant accesses
+void c_generator_append_data_access(C_Generator* generator, IR_Data_Access access)
 {
-    /*
-    Intermediate_Register* reg = &generator->im_generator->functions[generator->current_function_index].registers[register_index];
-    dynamic_array_reset(&generator->array_index_stack);
-    c_generator_generate_type_definition(generator, reg->type_signature, false);
-    string_append_formated(&generator->output_string, " ");
-    c_generator_generate_register_name(generator, register_index);
-    if (generator->array_index_stack.size > 0)
+    String* output = &generator->output_string;
+    if (access.type == IR_Data_Access_Type::CONSTANT && !access.is_memory_access)
     {
-        for (int i = 0; i < generator->array_index_stack.size; i++) {
-            string_append_formated(&generator->output_string, "[%d]", generator->array_index_stack[i]);
+        IR_Constant* constant = &generator->program->constant_pool.constants[access.index];
+        if (constant->type->type == Signature_Type::PRIMITIVE) {
+            c_generator_append_primitive_constant(generator, constant->type, &generator->program->constant_pool.constant_memory[constant->offset]);
+            return;
         }
     }
-    dynamic_array_reset(&generator->array_index_stack);
-    if (semicolon) {
-        string_append_formated(&generator->output_string, ";");
+
+    if (access.is_memory_access) {
+        string_append_formated(output, "(*(");
+        c_generator_append_type(generator, ir_data_access_get_type(&access));
+        string_append_formated(output, "*)");
+        c_generator_append_data_access_name(generator, access);
+        string_append_formated(output, ")");
+    }
+    else {
+        c_generator_append_data_access_name(generator, access);
     }
-    */
 }
 
-void c_generator_generate_function_header(C_Generator* generator, int function_index)
+// Appends an u8* expression pointing to the accessed data
+void c_generator_append_data_access_address(C_Generator* generator, IR_Data_Access access)
 {
-    /*
-    AST_Node* function_node = &generator->compiler->parser.nodes[generator->im_generator->function_to_ast_node_mapping[function_index]];
-    AST_Node* parameter_block_node = &generator->compiler->parser.nodes[function_node->children[0]];
-    Intermediate_Function* function = &generator->im_generator->functions[function_index];
-    Type_Signature* signature = function->function_type;
+    String* output = &generator->output_string;
+    if (access.is_memory_access) {
+        string_append_formated(output, "((u8*)");
+        c_generator_append_data_access_name(generator, access);
+        string_append_formated(output, ")");
+    }
+    else if (access.type == IR_Data_Access_Type::CONSTANT) {
+        string_append_formated(output, "(upp_constant_memory + %d)", generator->program->constant_pool.constants[access.index].offset);
+    }
+    else {
+        string_append_formated(output, "((u8*)&");
+        c_generator_append_data_access_name(generator, access);
+        string_append_formated(output, ")");
+    }
+}
 
-    c_generator_generate_type_definition(generator, signature->return_type, false);
-    if (function_index == generator->im_generator->main_function_index) {
-        string_append_formated(&generator->output_string, " _upp_main(");
+/*
+    Writes to memory need to copy the exact size of the type, since C rounds the size of the blob
+    structs up to their alignment (e.g. String is 20 bytes, but the C struct has 24), so a plain
+    assignment could overwrite following struct members.
+*/
+void c_generator_append_write_start(C_Generator* generator, IR_Data_Access destination)
+{
+    Type_Signature* type = ir_data_access_get_type(&destination);
+    c_generator_append_indentation(generator);
+    if (destination.is_memory_access && c_generator_type_is_blob(type)) {
+        string_append_formated(&generator->output_string, "{ ");
+        c_generator_append_type(generator, type);
+        string_append_formated(&generator->output_string, " upp_tmp = ");
     }
     else {
-        string_append_formated(&generator->output_string, " %s(", c_generator_id_to_string(generator, function->name_handle));
+        c_generator_append_data_access(generator, destination);
+        string_append_formated(&generator->output_string, " = ");
     }
+}
 
-    // I dont remember why i removed this, but I hope the reasons were bad...
-    for (int i = 0; i < function->registers.size; i++)
-    {
-        Intermediate_Register* reg = &function->registers[i];
-        if (reg->type != Intermediate_Register_Type::PARAMETER) continue;
-        if (i != 0) {
-            string_append_formated(&generator->output_string, ", ");
-        }
-        c_generator_generate_variable_definition_with_register_index(generator, i, false);
+void c_generator_append_write_end(C_Generator* generator, IR_Data_Access destination)
+{
+    Type_Signature* type = ir_data_access_get_type(&destination);
+    if (destination.is_memory_access && c_generator_type_is_blob(type)) {
+        string_append_formated(&generator->output_string, "; memcpy(");
+        c_generator_append_data_access_address(generator, destination);
+        string_append_formated(&generator->output_string, ", &upp_tmp, %d); }\n", type->size_in_bytes);
     }
-    */
-    /*
-    for (int i = 0; i < signature->parameter_types.size; i++)
-    {
-        Type_Signature* param_type = signature->parameter_types[i];
-        int param_name_id = generator->im_generator->analyser->parser->nodes[parameter_block_node->children[i]].name_id;
-        c_generator_generate_variable_definition(generator, param_name_id, param_type, false);
-        if (i != signature->parameter_types.size - 1) {
-            string_append_formated(&generator->output_string, ",");
-        }
+    else {
+        string_append_formated(&generator->output_string, ";\n");
     }
-    string_append_formated(&generator->output_string, ")");
-    */
 }
 
-void c_generator_generate_function_instruction_slice(
-    C_Generator* generator, int indentation_level, bool indent_first, int instr_start_index, int instr_end_index_exclusive)
+void c_generator_generate_code_block(C_Generator* generator, IR_Code_Block* code_block);
+void c_generator_generate_code_block_contents(C_Generator* generator, IR_Code_Block* code_block)
 {
-    /*
-    Intermediate_Function* function = &generator->im_generator->functions[generator->current_function_index];
-    for (int instruction_index = instr_start_index;
-        instruction_index < function->instructions.size && instruction_index < instr_end_index_exclusive;
-        instruction_index++)
+    String* output = &generator->output_string;
+    int block_index = generator->code_block_indices.element_count;
+    hashtable_insert_element(&generator->code_block_indices, code_block, block_index);
+    for (int i = 0; i < code_block->registers.size; i++) {
+        // Void registers are created for the results of void function calls
+        if (code_block->registers[i]->type == Signature_Type::VOID_TYPE) continue;
+        c_generator_append_indentation(generator);
+        c_generator_append_type(generator, code_block->registers[i]);
+        string_append_formated(output, " reg_%d_%d;\n", block_index, i);
+    }
+
+    for (int i = 0; i < code_block->instructions.size; i++)
     {
-        for (int i = 0; i < indentation_level; i++) {
-            if (instruction_index == instr_start_index && !indent_first) {
-                break;
-            }
-            string_append_formated(&generator->output_string, "    ");
-        }
-        Intermediate_Instruction* instr = &function->instructions[instruction_index];
-        bool is_binary_op = false;
-        bool is_unary_op = false;
-        const char* operation_str = "";
+        IR_Instruction* instr = &code_block->instructions[i];
         switch (instr->type)
         {
-        case Intermediate_Instruction_Type::MOVE_DATA:
-        {
-            c_generator_generate_data_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = ");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ";\n");
-            break;
-        }
-        case Intermediate_Instruction_Type::ADDRESS_OF:
+        case IR_Instruction_Type::FUNCTION_CALL:
         {
-            c_generator_generate_data_access(generator, instr->destination);
-            Intermediate_Register* reg = &function->registers[instr->source1.register_index];
-            if (reg->type_signature->type == Signature_Type::ARRAY_SIZED && instr->source1.type == Data_Access_Type::REGISTER_ACCESS) {
-                string_append_formated(&generator->output_string, " = ");
-                c_generator_generate_data_access(generator, instr->source1);
-                string_append_formated(&generator->output_string, ";\n");
+            IR_Instruction_Call* call = &instr->options.call;
+            Type_Signature* function_type = 0;
+            switch (call->call_type)
+            {
+            case IR_Instruction_Call_Type::FUNCTION_CALL:
+                function_type = call->options.function->function_type;
+                break;
+            case IR_Instruction_Call_Type::FUNCTION_POINTER_CALL:
+                function_type = ir_data_access_get_type(&call->options.pointer_access)->child_type;
                 break;
+            case IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL:
+                function_type = call->options.hardcoded->signature;
+                break;
+            default: panic("Should not happen");
             }
-            string_append_formated(&generator->output_string, " = &");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ";\n");
-            break;
-        }
-        case Intermediate_Instruction_Type::BREAK:
-        {
-            string_append_formated(&generator->output_string, "break;\n");
-            break;
-        }
-        case Intermediate_Instruction_Type::CALL_HARDCODED_FUNCTION:
-        case Intermediate_Instruction_Type::CALL_FUNCTION:
-        {
-            Type_Signature* return_type;
-            const char* function_str = "error";
-            bool cast_to_type = false;
-            if (instr->type == Intermediate_Instruction_Type::CALL_HARDCODED_FUNCTION)
-            {
-                Hardcoded_Function* hardcoded = &generator->compiler->analyser.hardcoded_functions[(u32)instr->hardcoded_function_type];
-                Type_Signature* function_type = hardcoded->function_type;
-                return_type = function_type->return_type;
-                if (instr->hardcoded_function_type == Hardcoded_Function_Type::FREE_POINTER) {
-                    function_str = "free_pointer";
-                }
-                else if (instr->hardcoded_function_type == Hardcoded_Function_Type::MALLOC_SIZE_I32) {
-                    function_str = "malloc_size_i32";
-                    cast_to_type = true;
-                }
-                else {
-                    function_str = c_generator_id_to_string(generator, hardcoded->name_handle);
-                }
+
+            bool has_return_value = function_type->return_type->type != Signature_Type::VOID_TYPE;
+            if (has_return_value) {
+                c_generator_append_write_start(generator, call->destination);
             }
             else {
-                Type_Signature* function_type = generator->im_generator->functions[instr->intermediate_function_index].function_type;
-                return_type = function_type->return_type;
-                function_str = c_generator_id_to_string(generator, generator->im_generator->functions[instr->intermediate_function_index].name_handle);
+                c_generator_append_indentation(generator);
             }
 
-            if (return_type != generator->compiler->type_system.void_type)
+            switch (call->call_type)
             {
-                c_generator_generate_data_access(generator, instr->destination);
-                string_append_formated(&generator->output_string, " = ");
-                if (cast_to_type) {
-                    string_append_formated(&generator->output_string, "(", function_str);
-                    c_generator_generate_type_definition(generator, return_type, true);
-                    string_append_formated(&generator->output_string, ")", function_str);
+            case IR_Instruction_Call_Type::FUNCTION_CALL:
+                c_generator_append_function_name(generator, call->options.function);
+                break;
+            case IR_Instruction_Call_Type::FUNCTION_POINTER_CALL: {
+                string_append_formated(output, "((");
+                c_generator_append_type(generator, function_type->return_type);
+                string_append_formated(output, "(*)(");
+                for (int j = 0; j < function_type->parameter_types.size; j++) {
+                    if (j != 0) {
+                        string_append_formated(output, ", ");
+                    }
+                    c_generator_append_type(generator, function_type->parameter_types[j]);
                 }
-            }
-            string_append_formated(&generator->output_string, "%s(", function_str);
-            for (int i = 0; i < instr->arguments.size; i++) {
-                c_generator_generate_data_access(generator, instr->arguments[i]);
-                if (i != instr->arguments.size - 1) {
-                    string_append_formated(&generator->output_string, ", ");
+                if (function_type->parameter_types.size == 0) {
+                    string_append_formated(output, "void");
                 }
-            }
-            string_append_formated(&generator->output_string, ");\n");
-            break;
-        }
-        case Intermediate_Instruction_Type::CONTINUE:
-        {
-            string_append_formated(&generator->output_string, "continue;\n");
-            break;
-        }
-        case Intermediate_Instruction_Type::EXIT:
-        {
-            int code = 0;
-            switch (instr->exit_code)
-            {
-            case Exit_Code::OUT_OF_BOUNDS: {
-                code = -1;
-                break;
-            }
-            case Exit_Code::RETURN_VALUE_OVERFLOW: {
-                code = -2;
+                string_append_formated(output, "))");
+                c_generator_append_data_access(generator, call->options.pointer_access);
+                string_append_formated(output, ")");
                 break;
             }
-            case Exit_Code::STACK_OVERFLOW: {
-                code = -3;
-                break;
-            }
-            case Exit_Code::SUCCESS: {
-                code = 0;
+            case IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL:
+            {
+                switch (call->options.hardcoded->type)
+                {
+                case IR_Hardcoded_Function_Type::PRINT_I32: string_append_formated(output, "print_i32"); break;
+                case IR_Hardcoded_Function_Type::PRINT_F32: string_append_formated(output, "print_f32"); break;
+                case IR_Hardcoded_Function_Type::PRINT_BOOL: string_append_formated(output, "print_bool"); break;
+                case IR_Hardcoded_Function_Type::PRINT_LINE: string_append_formated(output, "print_line"); break;
+                case IR_Hardcoded_Function_Type::PRINT_STRING: string_append_formated(output, "print_string"); break;
+                case IR_Hardcoded_Function_Type::READ_I32: string_append_formated(output, "read_i32"); break;
+                case IR_Hardcoded_Function_Type::READ_F32: string_append_formated(output, "read_f32"); break;
+                case IR_Hardcoded_Function_Type::READ_BOOL: string_append_formated(output, "read_bool"); break;
+                case IR_Hardcoded_Function_Type::RANDOM_I32: string_append_formated(output, "random_i32"); break;
+                case IR_Hardcoded_Function_Type::MALLOC_SIZE_I32: string_append_formated(output, "malloc_size_i32"); break;
+                case IR_Hardcoded_Function_Type::FREE_POINTER: string_append_formated(output, "free_pointer"); break;
+                default: panic("Should not happen");
+                }
                 break;
             }
+            default: panic("Should not happen");
             }
-            string_append_formated(&generator->output_string, "exit(%d);\n", code);
-            break;
-        }
-        case Intermediate_Instruction_Type::IF_BLOCK:
-        {
-            c_generator_generate_function_instruction_slice(generator, indentation_level, false,
-                instr->condition_calculation_instruction_start,
-                instr->condition_calculation_instruction_end_exclusive
-            );
-            for (int i = 0; i < indentation_level; i++) {
-                string_append_formated(&generator->output_string, "    ");
-            }
-            string_append_formated(&generator->output_string, "if (");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ") {\n");
-            c_generator_generate_function_instruction_slice(generator, indentation_level + 1, true,
-                instr->true_branch_instruction_start,
-                instr->true_branch_instruction_end_exclusive
-            );
-            for (int i = 0; i < indentation_level; i++) {
-                string_append_formated(&generator->output_string, "    ");
+
+            string_append_formated(output, "(");
+            if (call->call_type == IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL &&
+                call->options.hardcoded->type == IR_Hardcoded_Function_Type::PRINT_STRING)
+            {
+                // The runtime takes the character pointer and the size member of the String struct
+                string_append_formated(output, "*(const char**)");
+                c_generator_append_data_access_address(generator, call->arguments[0]);
+                string_append_formated(output, ", *(i32*)(");
+                c_generator_append_data_access_address(generator, call->arguments[0]);
+                string_append_formated(output, " + 16)");
             }
-            string_append_formated(&generator->output_string, "}\n");
-            instruction_index = instr->false_branch_instruction_end_exclusive - 1;
-            if (instr->false_branch_instruction_start != instr->false_branch_instruction_end_exclusive)
+            else
             {
-                instruction_index = instr->false_branch_instruction_end_exclusive - 1;
-                for (int i = 0; i < indentation_level; i++) {
-                    string_append_formated(&generator->output_string, "    ");
+                for (int j = 0; j < call->arguments.size; j++) {
+                    if (j != 0) {
+                        string_append_formated(output, ", ");
+                    }
+                    c_generator_append_data_access(generator, call->arguments[j]);
                 }
-                string_append_formated(&generator->output_string, "else {\n");
-                c_generator_generate_function_instruction_slice(generator, indentation_level + 1, true,
-                    instr->false_branch_instruction_start,
-                    instr->false_branch_instruction_end_exclusive
-                );
-                for (int i = 0; i < indentation_level; i++) {
-                    string_append_formated(&generator->output_string, "    ");
-                }
-                string_append_formated(&generator->output_string, "}\n");
+            }
+            string_append_formated(output, ")");
 
+            if (has_return_value) {
+                c_generator_append_write_end(generator, call->destination);
+            }
+            else {
+                string_append_formated(output, ";\n");
             }
             break;
         }
-        case Intermediate_Instruction_Type::LOAD_CONSTANT_BOOL:
+        case IR_Instruction_Type::IF:
         {
-            c_generator_generate_data_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = %s;\n", instr->constant_bool_value ? "true" : "false");
+            IR_Instruction_If* if_instr = &instr->options.if_instr;
+            c_generator_append_indentation(generator);
+            string_append_formated(output, "if (");
+            c_generator_append_data_access(generator, if_instr->condition);
+            string_append_formated(output, ")\n");
+            c_generator_generate_code_block(generator, if_instr->true_branch);
+            if (if_instr->false_branch->instructions.size != 0) {
+                c_generator_append_indentation(generator);
+                string_append_formated(output, "else\n");
+                c_generator_generate_code_block(generator, if_instr->false_branch);
+            }
             break;
         }
-        case Intermediate_Instruction_Type::LOAD_CONSTANT_F32:
+        case IR_Instruction_Type::WHILE:
         {
-            c_generator_generate_data_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = %f;\n", instr->constant_f32_value);
+            // The condition code is emitted inside the loop, so continue re-evaluates the condition
+            IR_Instruction_While* while_instr = &instr->options.while_instr;
+            c_generator_append_indentation(generator);
+            string_append_formated(output, "while (true)\n");
+            c_generator_append_indentation(generator);
+            string_append_formated(output, "{\n");
+            generator->indentation_level++;
+            c_generator_generate_code_block_contents(generator, while_instr->condition_code);
+            c_generator_append_indentation(generator);
+            string_append_formated(output, "if (!");
+            c_generator_append_data_access(generator, while_instr->condition_access);
+            string_append_formated(output, ") break;\n");
+            c_generator_generate_code_block(generator, while_instr->code);
+            generator->indentation_level--;
+            c_generator_append_indentation(generator);
+            string_append_formated(output, "}\n");
             break;
         }
-        case Intermediate_Instruction_Type::LOAD_CONSTANT_I32:
-        {
-            c_generator_generate_data_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = %d;\n", instr->constant_i32_value);
+        case IR_Instruction_Type::BLOCK:
+            c_generator_generate_code_block(generator, instr->options.block);
             break;
-        }
-        case Intermediate_Instruction_Type::RETURN:
+        case IR_Instruction_Type::BREAK:
+            c_generator_append_indentation(generator);
+            string_append_formated(output, "break;\n");
+            break;
+        case IR_Instruction_Type::CONTINUE:
+            c_generator_append_indentation(generator);
+            string_append_formated(output, "continue;\n");
+            break;
+        case IR_Instruction_Type::RETURN:
         {
-            if (!instr->return_has_value) {
-                string_append_formated(&generator->output_string, "return;\n");
+            IR_Instruction_Return* return_instr = &instr->options.return_instr;
+            c_generator_append_indentation(generator);
+            switch (return_instr->type)
+            {
+            case IR_Instruction_Return_Type::EXIT:
+                string_append_formated(output, "upp_exit(%d);\n", (int)return_instr->options.exit_code);
+                break;
+            case IR_Instruction_Return_Type::RETURN_EMPTY:
+                string_append_formated(output, "return;\n");
                 break;
+            case IR_Instruction_Return_Type::RETURN_DATA:
+                string_append_formated(output, "return ");
+                c_generator_append_data_access(generator, return_instr->options.return_value);
+                string_append_formated(output, ";\n");
+                break;
+            default: panic("Should not happen");
             }
-            string_append_formated(&generator->output_string, "return ");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ";\n");
             break;
         }
-        case Intermediate_Instruction_Type::WHILE_BLOCK:
+        case IR_Instruction_Type::MOVE:
         {
-            string_append_formated(&generator->output_string, "while (true) {\n");
-            c_generator_generate_function_instruction_slice(generator, indentation_level + 1, true,
-                instr->condition_calculation_instruction_start,
-                instr->condition_calculation_instruction_end_exclusive
-            );
-            for (int i = 0; i < indentation_level + 1; i++) {
-                string_append_formated(&generator->output_string, "    ");
+            IR_Instruction_Move* move = &instr->options.move;
+            Type_Signature* type = ir_data_access_get_type(&move->destination);
+            if (c_generator_type_is_blob(type)) {
+                c_generator_append_indentation(generator);
+                string_append_formated(output, "memcpy(");
+                c_generator_append_data_access_address(generator, move->destination);
+                string_append_formated(output, ", ");
+                c_generator_append_data_access_address(generator, move->source);
+                string_append_formated(output, ", %d);\n", type->size_in_bytes);
             }
-            string_append_formated(&generator->output_string, "if (!(");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ")) break;\n");
-
-            c_generator_generate_function_instruction_slice(generator, indentation_level + 1, true,
-                instr->true_branch_instruction_start,
-                instr->true_branch_instruction_end_exclusive
-            );
-            for (int i = 0; i < indentation_level; i++) {
-                string_append_formated(&generator->output_string, "    ");
+            else {
+                c_generator_append_write_start(generator, move->destination);
+                if (type->type == Signature_Type::PRIMITIVE && ir_data_access_get_type(&move->source)->type == Signature_Type::POINTER) {
+                    // The analyser currently emits these moves for some array accesses, the interpreter truncates the pointer
+                    string_append_formated(output, "(");
+                    c_generator_append_type(generator, type);
+                    string_append_formated(output, ")(u64)");
+                }
+                c_generator_append_data_access(generator, move->source);
+                c_generator_append_write_end(generator, move->destination);
             }
-            string_append_formated(&generator->output_string, "}\n");
-            instruction_index = instr->true_branch_instruction_end_exclusive - 1;
             break;
         }
-        case Intermediate_Instruction_Type::CALCULATE_ARRAY_ACCESS_POINTER:
+        case IR_Instruction_Type::CAST:
         {
-            // Either we have a base_pointer as source 1, or we have an unsized array I think
-            c_generator_generate_data_access(generator, instr->destination);
-            Type_Signature* result_type = function->registers[instr->destination.register_index].type_signature;
-            string_append_formated(&generator->output_string, " = (");
-            c_generator_generate_type_definition(generator, result_type, false);
-            string_append_formated(&generator->output_string, ")");
-
-            Intermediate_Register* base_reg = &function->registers[instr->source1.register_index];
-            if (base_reg->type_signature->type == Signature_Type::ARRAY_SIZED) 
+            IR_Instruction_Cast* cast = &instr->options.cast;
+            if (cast->type == IR_Instruction_Cast_Type::ARRAY_SIZED_TO_UNSIZED)
             {
-                if (instr->source1.type == Data_Access_Type::MEMORY_ACCESS) {
+                Type_Signature* array_sized_type = ir_data_access_get_type(&cast->source);
+                c_generator_append_indentation(generator);
+                string_append_formated(output, "*(u8**)");
+                c_generator_append_data_access_address(generator, cast->destination);
+                string_append_formated(output, " = ");
+                c_generator_append_data_access_address(generator, cast->source);
+                string_append_formated(output, ";\n");
+                c_generator_append_indentation(generator);
+                string_append_formated(output, "*(i32*)(");
+                c_generator_append_data_access_address(generator, cast->destination);
+                string_append_formated(output, " + 8) = %d;\n", array_sized_type->array_element_count);
+                break;
+            }
 
+            c_generator_append_write_start(generator, cast->destination);
+            switch (cast->type)
+            {
+            case IR_Instruction_Cast_Type::PRIMITIVE_TYPES:
+                string_append_formated(output, "(");
+                c_generator_append_type(generator, ir_data_access_get_type(&cast->destination));
+                string_append_formated(output, ")");
+                break;
+            case IR_Instruction_Cast_Type::POINTERS:
+            case IR_Instruction_Cast_Type::U64_TO_POINTER:
+                string_append_formated(output, "(void*)");
+                break;
+            case IR_Instruction_Cast_Type::POINTER_TO_U64:
+                string_append_formated(output, "(u64)");
+                break;
+            default: panic("Should not happen");
+            }
+            c_generator_append_data_access(generator, cast->source);
+            c_generator_append_write_end(generator, cast->destination);
+            break;
+        }
+        case IR_Instruction_Type::ADDRESS_OF:
+        {
+            IR_Instruction_Address_Of* address_of = &instr->options.address_of;
+            c_generator_append_write_start(generator, address_of->destination);
+            switch (address_of->type)
+            {
+            case IR_Instruction_Address_Of_Type::DATA:
+                c_generator_append_data_access_address(generator, address_of->source);
+                break;
+            case IR_Instruction_Address_Of_Type::FUNCTION:
+                string_append_formated(output, "(void*)&");
+                c_generator_append_function_name(generator, address_of->options.function);
+                break;
+            case IR_Instruction_Address_Of_Type::STRUCT_MEMBER:
+                c_generator_append_data_access_address(generator, address_of->source);
+                string_append_formated(output, " + %d", address_of->options.member.offset);
+                break;
+            case IR_Instruction_Address_Of_Type::ARRAY_ELEMENT:
+            {
+                Type_Signature* array_type = ir_data_access_get_type(&address_of->source);
+                string_append_formated(output, "upp_array_element(");
+                if (array_type->type == Signature_Type::ARRAY_SIZED) {
+                    c_generator_append_data_access_address(generator, address_of->source);
+                }
+                else if (array_type->type == Signature_Type::ARRAY_UNSIZED) {
+                    string_append_formated(output, "*(u8**)");
+                    c_generator_append_data_access_address(generator, address_of->source);
                 }
                 else {
-
+                    panic("Hey, should not happen, since this is illegal");
                 }
+                string_append_formated(output, ", ");
+                c_generator_append_data_access(generator, address_of->options.index_access);
+                string_append_formated(output, ", %d)",
+                    math_round_next_multiple(array_type->child_type->size_in_bytes, array_type->child_type->alignment_in_bytes)
+                );
+                break;
             }
-            string_append_formated(&generator->output_string, "((u8*)(");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ") + ");
-            c_generator_generate_data_access(generator, instr->source2);
-            string_append_formated(&generator->output_string, " * %d);\n", instr->constant_i32_value);
-
-            c_generator_generate_data_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = &((");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ")[");
-            c_generator_generate_data_access(generator, instr->source2);
-            string_append_formated(&generator->output_string, "]);\n");
+            default: panic("Should not happen");
+            }
+            c_generator_append_write_end(generator, address_of->destination);
             break;
         }
-        case Intermediate_Instruction_Type::CALCULATE_MEMBER_ACCESS_POINTER:
+        case IR_Instruction_Type::UNARY_OP:
         {
-            c_generator_generate_data_access(generator, instr->destination);
-            Type_Signature* result_type = function->registers[instr->destination.register_index].type_signature;
-            string_append_formated(&generator->output_string, " = (");
-            c_generator_generate_type_definition(generator, result_type, false);
-            string_append_formated(&generator->output_string, ") ((u8*)(&");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ") + %d);\n", instr->constant_i32_value);
-            break;
-
-             TODO: It would be nicer if I would use member access of C instead of pointer manipulation
-            Type_Signature* struct_signature = function->registers[instr->source1.register_index].type_signature;
-            if (struct_signature->type == Signature_Type::POINTER) struct_signature = struct_signature->child_type;
-            Struct_Member* found = nullptr;
-            for (int i = 0; i < struct_signature->member_types.size; i++) {
-                Struct_Member* member = &struct_signature->member_types[i];
-                if (member->offset == instr->constant_i32_value) {
-                    found = member;
-                }
+            IR_Instruction_Unary_OP* unary_op = &instr->options.unary_op;
+            c_generator_append_write_start(generator, unary_op->destination);
+            switch (unary_op->type)
+            {
+            case IR_Instruction_Unary_OP_Type::NOT: string_append_formated(output, "!"); break;
+            case IR_Instruction_Unary_OP_Type::NEGATE: string_append_formated(output, "-"); break;
+            default: panic("Should not happen");
             }
-            if (found == nullptr) { break; } // TODO: Handle member access of arrays (.data and .size)
-
-            c_generator_generate_register_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = &((");
-            c_generator_generate_register_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ").%s);\n", c_generator_id_to_string(generator, found->name_handle));
+            c_generator_append_data_access(generator, unary_op->source);
+            c_generator_append_write_end(generator, unary_op->destination);
             break;
         }
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_ADDITION_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_ADDITION_I32: is_binary_op = true; operation_str = "+"; break;
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_SUBTRACTION_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_SUBTRACTION_I32:  is_binary_op = true; operation_str = "-"; break;
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_MULTIPLICATION_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_MULTIPLICATION_I32:  is_binary_op = true; operation_str = "*"; break;
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_DIVISION_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_DIVISION_I32:  is_binary_op = true; operation_str = "/"; break;
-        case Intermediate_Instruction_Type::BINARY_OP_ARITHMETIC_MODULO_I32:  is_binary_op = true; operation_str = "%"; break;
-
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_EQUAL_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_EQUAL_BOOL:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_EQUAL_I32:  is_binary_op = true; operation_str = "=="; break;
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_NOT_EQUAL_BOOL:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_NOT_EQUAL_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_NOT_EQUAL_I32:  is_binary_op = true; operation_str = "!="; break;
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_GREATER_THAN_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_GREATER_THAN_I32:  is_binary_op = true; operation_str = ">"; break;
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_GREATER_EQUAL_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_GREATER_EQUAL_I32:  is_binary_op = true; operation_str = ">="; break;
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_LESS_THAN_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_LESS_THAN_I32:  is_binary_op = true; operation_str = "<"; break;
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_LESS_EQUAL_F32:
-        case Intermediate_Instruction_Type::BINARY_OP_COMPARISON_LESS_EQUAL_I32:  is_binary_op = true; operation_str = "<="; break;
-
-        case Intermediate_Instruction_Type::BINARY_OP_BOOLEAN_AND:  is_binary_op = true; operation_str = "&&"; break;
-        case Intermediate_Instruction_Type::BINARY_OP_BOOLEAN_OR:  is_binary_op = true; operation_str = "||"; break;
-
-        case Intermediate_Instruction_Type::UNARY_OP_ARITHMETIC_NEGATE_F32:
-        case Intermediate_Instruction_Type::UNARY_OP_ARITHMETIC_NEGATE_I32:   is_unary_op = true; operation_str = "-"; break;
-        case Intermediate_Instruction_Type::UNARY_OP_BOOLEAN_NOT:   is_unary_op = true; operation_str = "!"; break;
-        default: {
-            string_append_formated(&generator->output_string, "Not implemented yet!;\n");
-        }
-        }
-
-        if (is_binary_op) {
-            c_generator_generate_data_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = (");
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ") %s (", operation_str);
-            c_generator_generate_data_access(generator, instr->source2);
-            string_append_formated(&generator->output_string, ");\n");
+        case IR_Instruction_Type::BINARY_OP:
+        {
+            IR_Instruction_Binary_OP* binary_op = &instr->options.binary_op;
+            const char* operation_str = "";
+            switch (binary_op->type)
+            {
+            case IR_Instruction_Binary_OP_Type::ADDITION: operation_str = "+"; break;
+            case IR_Instruction_Binary_OP_Type::SUBTRACTION: operation_str = "-"; break;
+            case IR_Instruction_Binary_OP_Type::MULTIPLICATION: operation_str = "*"; break;
+            case IR_Instruction_Binary_OP_Type::DIVISION: operation_str = "/"; break;
+            case IR_Instruction_Binary_OP_Type::MODULO: operation_str = "%"; break;
+            case IR_Instruction_Binary_OP_Type::EQUAL: operation_str = "=="; break;
+            case IR_Instruction_Binary_OP_Type::NOT_EQUAL: operation_str = "!="; break;
+            case IR_Instruction_Binary_OP_Type::GREATER_THAN: operation_str = ">"; break;
+            case IR_Instruction_Binary_OP_Type::GREATER_EQUAL: operation_str = ">="; break;
+            case IR_Instruction_Binary_OP_Type::LESS_THAN: operation_str = "<"; break;
+            case IR_Instruction_Binary_OP_Type::LESS_EQUAL: operation_str = "<="; break;
+            case IR_Instruction_Binary_OP_Type::AND: operation_str = "&&"; break;
+            case IR_Instruction_Binary_OP_Type::OR: operation_str = "||"; break;
+            default: panic("Should not happen");
+            }
+            c_generator_append_write_start(generator, binary_op->destination);
+            c_generator_append_data_access(generator, binary_op->operand_left);
+            string_append_formated(output, " %s ", operation_str);
+            c_generator_append_data_access(generator, binary_op->operand_right);
+            c_generator_append_write_end(generator, binary_op->destination);
+            break;
         }
-        else if (is_unary_op) {
-            c_generator_generate_data_access(generator, instr->destination);
-            string_append_formated(&generator->output_string, " = %s(", operation_str);
-            c_generator_generate_data_access(generator, instr->source1);
-            string_append_formated(&generator->output_string, ");\n", operation_str);
+        default: panic("Should not happen");
         }
     }
-    */
+}
+
+void c_generator_generate_code_block(C_Generator* generator, IR_Code_Block* code_block)
+{
+    c_generator_append_indentation(generator);
+    string_append_formated(&generator->output_string, "{\n");
+    generator->indentation_level++;
+    c_generator_generate_code_block_contents(generator, code_block);
+    generator->indentation_level--;
+    c_generator_append_indentation(generator);
+    string_append_formated(&generator->output_string, "}\n");
 }
 
 void c_generator_generate(C_Generator* generator, Compiler* compiler)
 {
-    /*
     generator->compiler = compiler;
-    generator->im_generator = &compiler->intermediate_generator;
+    generator->program = compiler->analyser.program;
+    generator->indentation_level = 0;
     string_reset(&generator->output_string);
+    hashtable_reset(&generator->type_indices);
+    hashtable_reset(&generator->function_indices);
+    hashtable_reset(&generator->code_block_indices);
+    dynamic_array_reset(&generator->function_name_handles);
 
-    string_append_formated(&generator->output_string, "#pragma once\n#include <cstdlib>\n#include \"compiler/hardcoded_functions.h\"\n#include \"compiler/datatypes.h\"\n\n");
-    string_append_formated(&generator->output_string, "struct Unsized_Array {void* data; i32 size;};\n\n");
+    IR_Program* program = generator->program;
+    Type_System* type_system = &compiler->type_system;
+    String* output = &generator->output_string;
 
-    // Create forward declaration for structs
-    Symbol_Table* root_table = compiler->analyser.symbol_tables[0];
-    for (int i = 0; i < root_table->symbols.size; i++)
+    string_append_formated(output, "// Generated by the Upp C backend\n");
+    string_append_formated(output, "#include <string.h>\n#include <stdlib.h>\n#include <stdio.h>\n");
+    string_append_formated(output, "#include \"compiler/hardcoded_functions.h\"\n\n");
+
+    // Types
+    for (int i = 0; i < type_system->types.size; i++)
     {
-        Symbol* symbol = &root_table->symbols[i];
-        if (symbol->symbol_type != Symbol_Type::TYPE) continue;
-        Type_Signature* signature = symbol->type;
-        if (signature->type != Signature_Type::STRUCT) continue;
-        string_append_formated(&generator->output_string, "struct %s;\n", c_generator_id_to_string(generator, symbol->name_handle));
+        Type_Signature* signature = type_system->types[i];
+        hashtable_insert_element(&generator->type_indices, signature, i);
+        if (!c_generator_type_is_blob(signature)) continue;
+        string_append_formated(output, "typedef struct { _Alignas(%d) u8 bytes[%d]; } Upp_Type_%d; // ",
+            math_maximum(signature->alignment_in_bytes, 1), math_maximum(signature->size_in_bytes, 1), i
+        );
+        type_signature_append_to_string(output, signature);
+        string_append_formated(output, "\n");
+    }
+    string_append_formated(output, "\n");
+
+    // Constant memory, pointers to string literals are set in upp_constants_initialize
+    {
+        Dynamic_Array<byte>* memory = &program->constant_pool.constant_memory;
+        Array<bool> is_string_pointer = array_create_empty<bool>(math_maximum(memory->size, 1));
+        SCOPE_EXIT(array_destroy(&is_string_pointer));
+        for (int i = 0; i < is_string_pointer.size; i++) {
+            is_string_pointer[i] = false;
+        }
+
+        for (int i = 0; i < program->constant_pool.constants.size; i++)
+        {
+            IR_Constant* constant = &program->constant_pool.constants[i];
+            if (constant->type != type_system->string_type) continue;
+            for (int j = 0; j < 8; j++) {
+                is_string_pointer[constant->offset + j] = true;
+            }
+
+            const char* characters = *(const char**)&memory->data[constant->offset];
+            int capacity = *(i32*)&memory->data[constant->offset + 8];
+            int size = *(i32*)&memory->data[constant->offset + 16];
+            string_append_formated(output, "static char upp_string_literal_%d[%d] = \"", i, math_maximum(capacity, size + 1));
+            for (int j = 0; j < size; j++)
+            {
+                char c = characters[j];
+                if (c >= 32 && c < 127 && c != '"' && c != '\\' && c != '?') {
+                    string_append_character(output, c);
+                }
+                else {
+                    string_append_formated(output, "\\%03o", (u32)(u8)c);
+                }
+            }
+            string_append_formated(output, "\";\n");
+        }
+
+        // Padding, since blob structs may be read with their size rounded up to the alignment
+        string_append_formated(output, "static _Alignas(16) u8 upp_constant_memory[%d] = {", memory->size + 16);
+        for (int i = 0; i < memory->size; i++) {
+            if (i % 32 == 0) {
+                string_append_formated(output, "\n    ");
+            }
+            string_append_formated(output, "%d,", is_string_pointer[i] ? 0 : (int)memory->data[i]);
+        }
+        string_append_formated(output, "\n};\n\n");
+
+        string_append_formated(output, "static void upp_constants_initialize(void)\n{\n");
+        for (int i = 0; i < program->constant_pool.constants.size; i++) {
+            IR_Constant* constant = &program->constant_pool.constants[i];
+            if (constant->type != type_system->string_type) continue;
+            string_append_formated(output, "    *(char**)(upp_constant_memory + %d) = upp_string_literal_%d;\n", constant->offset, i);
+        }
+        string_append_formated(output, "}\n\n");
     }
 
-    // Create struct definitions
+    // Globals
+    for (int i = 0; i < program->globals.size; i++) {
+        string_append_formated(output, "static ");
+        c_generator_append_type(generator, program->globals[i]);
+        string_append_formated(output, " global_%d;\n", i);
+    }
+    string_append_formated(output, "\n");
+
+    // Exit codes are mapped like in the old backend (OUT_OF_BOUNDS = -1, RETURN_VALUE_OVERFLOW = -2, STACK_OVERFLOW = -3)
+    string_append_formated(output, "static void upp_exit(int exit_code)\n{\n");
+    string_append_formated(output, "    switch (exit_code) {\n");
+    string_append_formated(output, "    case %d: exit(0);\n", (int)Exit_Code::SUCCESS);
+    string_append_formated(output, "    case %d: fprintf(stderr, \"Exit: OUT_OF_BOUNDS\\n\"); exit(-1);\n", (int)Exit_Code::OUT_OF_BOUNDS);
+    string_append_formated(output, "    case %d: fprintf(stderr, \"Exit: RETURN_VALUE_OVERFLOW\\n\"); exit(-2);\n", (int)Exit_Code::RETURN_VALUE_OVERFLOW);
+    string_append_formated(output, "    case %d: fprintf(stderr, \"Exit: STACK_OVERFLOW\\n\"); exit(-3);\n", (int)Exit_Code::STACK_OVERFLOW);
+    string_append_formated(output, "    }\n    exit(-4);\n}\n\n");
+
+    // Same check as U64_MULTIPLY_ADD_I32 in the interpreter
+    string_append_formated(output, "static u8* upp_array_element(u8* base, i32 index, i32 element_size)\n{\n");
+    string_append_formated(output, "    u64 offset = (u64)(u32)index * (u64)element_size;\n");
+    string_append_formated(output, "    if ((i32)offset < 0) upp_exit(%d);\n", (int)Exit_Code::OUT_OF_BOUNDS);
+    string_append_formated(output, "    return base + offset;\n}\n\n");
+
+    // Function names
+    for (int i = 0; i < program->functions.size; i++) {
+        hashtable_insert_element(&generator->function_indices, program->functions[i], i);
+        dynamic_array_push_back(&generator->function_name_handles, -1);
+    }
+    Symbol_Table* root_table = compiler->analyser.root_table;
     for (int i = 0; i < root_table->symbols.size; i++)
     {
         Symbol* symbol = &root_table->symbols[i];
-        if (symbol->symbol_type != Symbol_Type::TYPE) continue;
-        Type_Signature* signature = symbol->type;
-        if (signature->type != Signature_Type::STRUCT) continue;
-
-        string_append_formated(&generator->output_string, "struct %s\n{\n", c_generator_id_to_string(generator, symbol->name_handle));
-        for (int j = 0; j < signature->member_types.size; j++) {
-            Struct_Member* member = &signature->member_types[j];
-            string_append_formated(&generator->output_string, "    ");
-            c_generator_generate_variable_definition_with_name_handle(generator, member->name_handle, member->type, true);
-            string_append_formated(&generator->output_string, "\n");
+        if (symbol->symbol_type != Symbol_Type::FUNCTION) continue;
+        int* function_index = hashtable_find_element(&generator->function_indices, symbol->options.function);
+        if (function_index != 0) {
+            generator->function_name_handles[*function_index] = symbol->name_handle;
         }
-        string_append_formated(&generator->output_string, "};\n");
     }
 
-    // Generate function headers
-    for (int i = 0; i < generator->im_generator->functions.size; i++) {
-        generator->current_function_index = i;
-        c_generator_generate_function_header(generator, i);
-        string_append_formated(&generator->output_string, ";\n");
+    // Function declarations
+    for (int i = 0; i < program->functions.size; i++) {
+        string_append_formated(output, "static ");
+        c_generator_append_function_signature(generator, program->functions[i]);
+        string_append_formated(output, ";\n");
     }
-    // Generate Function Code
-    for (int i = 0; i < generator->im_generator->functions.size; i++)
+    string_append_formated(output, "\n");
+
+    // Function definitions
+    for (int i = 0; i < program->functions.size; i++)
     {
-        generator->current_function_index = i;
-        c_generator_generate_function_header(generator, i);
-        string_append_formated(&generator->output_string, "\n{\n");
-        for (int j = 0; j < im_generator->functions[i].registers.size; j++)
-        {
-            Intermediate_Register* reg = &im_generator->functions[i].registers[j];
-            if (reg->type == Intermediate_Register_Type::VARIABLE || reg->type == Intermediate_Register_Type::EXPRESSION_RESULT) {
-                string_append_formated(&generator->output_string, "    ");
-                c_generator_generate_variable_definition_with_register_index(generator, j, true);
-                string_append_formated(&generator->output_string, "\n");
-            }
-        }
-        c_generator_generate_function_instruction_slice(generator, 1, true, 0, im_generator->functions[i].instructions.size);
-        string_append_formated(&generator->output_string, "\n}\n");
-    }
-
-    // Create real main function
-    string_append_formated(&generator->output_string, "\n int main(int argc, const char** argv) {\n    random_initialize();\n    _upp_main();\n    return 0;\n}");
-
-    // Compile
-    file_io_write_file("backend/main.cpp", array_create_static((byte*)generator->output_string.characters, generator->output_string.size));
-    */
-
-    //const char* cmd_setup_compiler_vars = "\"P:\\Programme\\Visual Studio Community 2019\\VC\\Auxiliary\\Build\\vcvars64.bat\"";
-    //system(cmd_setup_compiler_vars);
-    //const char* cmd_compile = "cl /MTd /Fi /Zi /Wall /RTCsu /JMC backend\\main.exe backend\\main.cpp backed\\compiler\\hardcoded_functions.cpp";
-    //const char* cmd_compile_simple = "cl.exe";
-    //system(cmd_compile_simple);
-    /*
-    PROCESS_INFORMATION proc_info;
-    STARTUPINFOA start_info = {};
-    start_info.cb = sizeof(start_info);
-
-    char buffer[1024];
-    char* file_part;
-    int ret_val = SearchPathA(NULL, "cmd", ".exe", 1024, buffer, &file_part);
-    if (ret_val == 0) {
-        logg("Could not find cmd.exe location");
-        return;
-    }
-
-    int return_val = CreateProcessA(
-        //"P:\\Programme\\Visual Studio Community 2019\\VC\\Tools\\MSVC\\14.27.29110\\bin\\Hostx64\\x64\\cl.exe",
-        //"backend\\main.exe backend\\main.cpp backend\\compiler\\hardcoded_functions.cpp", 
-        buffer,
-        "/c compile_and_run.bat",
-        NULL, NULL, FALSE,
-        NULL,
-        NULL, NULL,
-        &start_info,
-        &proc_info
-    );
-    if (return_val == 0) {
-        helper_print_last_error();
-        logg("Error!");
+        IR_Function* function = program->functions[i];
+        string_append_formated(output, "static ");
+        c_generator_append_function_signature(generator, function);
+        string_append_formated(output, "\n");
+        c_generator_generate_code_block(generator, function->code);
+        string_append_formated(output, "\n");
     }
-    else
+
+    string_append_formated(output, "int main(int argc, const char** argv)\n{\n");
+    string_append_formated(output, "    random_initialize();\n");
+    string_append_formated(output, "    upp_constants_initialize();\n    ");
+    c_generator_append_function_name(generator, program->entry_function);
+    string_append_formated(output, "();\n    return 0;\n}\n");
+}
+
+bool c_generator_compile(C_Generator* generator)
+{
+    if (!file_io_write_file("backend/main.c", array_create_static((byte*)generator->output_string.characters, generator->output_string.size))) {
+        logg("C-Backend: Could not write backend/main.c\n");
+        return false;
+    }
+
+    // The runtime is C++, so the C++ standard library is linked
+#ifdef _WIN32
+    const char* command = "cl /nologo /O2 /Fe:backend\\main.exe backend\\main.c backend\\compiler\\hardcoded_functions.cpp";
+    int exit_code = system(command);
+#else
+    const char* compilers[] = { "cc", "gcc", "clang" };
+    const char* found_compiler = 0;
+    for (int i = 0; i < 3 && found_compiler == 0; i++)
     {
-        WaitForSingleObject(proc_info.hProcess, INFINITE);
-        DWORD exit_code = 0;
-        if (FALSE == GetExitCodeProcess(proc_info.hProcess, &exit_code)) {
-            logg("Could not get exit code?\n");
+        String check_command = string_create_formated("%s --version > /dev/null 2>&1", compilers[i]);
+        SCOPE_EXIT(string_destroy(&check_command));
+        if (system(check_command.characters) == 0) {
+            found_compiler = compilers[i];
         }
-        CloseHandle(proc_info.hProcess);
-        CloseHandle(proc_info.hThread);
+    }
+    if (found_compiler == 0) {
+        logg("C-Backend: No C compiler found (Tried cc, gcc and clang)\n");
+        return false;
+    }
 
-        if (exit_code == 0) {
-            system("backend\\main.exe");
-        }
-        else {
-            system("There were build ERRORS\n");
-        }
-        logg("\n");
+    // Signed overflow wraps and blobs are accessed through casted pointers, like in the interpreter
+    String command = string_create_formated(
+        "%s -O2 -fwrapv -fno-strict-aliasing -o backend/main backend/main.c backend/compiler/hardcoded_functions.cpp -lstdc++",
+        found_compiler
+    );
+    SCOPE_EXIT(string_destroy(&command));
+    int exit_code = system(command.characters);
+#endif
+
+    if (exit_code != 0) {
+        logg("C-Backend: Compilation failed\n");
+        return false;
     }
-    */
+    return true;
 }
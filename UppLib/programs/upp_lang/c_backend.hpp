@@ -2,19 +2,39 @@
 
 #include "../../datastructures/dynamic_array.hpp"
 #include "../../datastructures/string.hpp"
+#include "../../datastructures/hashtable.hpp"
+#include "semantic_analyser.hpp"
 
 struct Compiler;
-struct Intermediate_Generator;
+
+/*
+    Translates the IR_Program into a standalone C file (backend/main.c), which is
+    compiled together with the runtime in backend/compiler/hardcoded_functions.cpp.
+    Naming in the generated code:
+        Functions:  upp_function_X(_name)
+        Parameters: param_X
+        Registers:  reg_B_X (B = index of the defining code block)
+        Globals:    global_X
+        Constants:  Bytes in upp_constant_memory, primitive constants are inlined
+    Structs and arrays are emitted as byte blobs with the size/alignment of the type system,
+    so that member and element offsets stay identical to the bytecode backend.
+*/
 
 struct C_Generator
 {
     Compiler* compiler;
-    Intermediate_Generator* im_generator;
+    IR_Program* program;
     String output_string;
-    Dynamic_Array<int> array_index_stack;
-    int current_function_index;
+    int indentation_level;
+
+    Hashtable<Type_Signature*, int, Hasher_Pointer<Type_Signature*>> type_indices;
+    Hashtable<IR_Function*, int, Hasher_Pointer<IR_Function*>> function_indices;
+    Hashtable<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>> code_block_indices;
+    Dynamic_Array<int> function_name_handles; // Per function index, -1 if the function is not defined in the root table
 };
 
 C_Generator c_generator_create();
 void c_generator_destroy(C_Generator* generator);
-void c_generator_generate(C_Generator* generator, Compiler* compiler);
\ No newline at end of file
+void c_generator_generate(C_Generator* generator, Compiler* compiler);
+// Writes the output_string to backend/main.c and invokes a local C compiler, returns true if backend/main was built
+bool c_generator_compile(C_Generator* generator);
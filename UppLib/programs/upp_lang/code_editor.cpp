@@ -96,15 +96,14 @@ void code_editor_update(Code_Editor* editor, Input* input, double time)
 
     if (text_changed || input->key_pressed[(int)Key_Code::F5])
     {
-        String source_code = string_create_empty(2048);
-        SCOPE_EXIT(string_destroy(&source_code));
-        text_append_to_string(&editor->text_editor->text, &source_code);
+        Text_Changed_Lines changed_lines = editor->text_editor->history.changed_lines;
+        editor->text_editor->history.changed_lines = text_changed_lines_make_empty();
         if (input->key_pressed[(int)Key_Code::F5]) {
-            compiler_compile(&editor->compiler, &source_code, true);
+            compiler_compile_incremental(&editor->compiler, &editor->text_editor->text, changed_lines, true);
             compiler_execute(&editor->compiler);
         }
         else {
-            compiler_compile(&editor->compiler, &source_code, false);
+            compiler_compile_incremental(&editor->compiler, &editor->text_editor->text, changed_lines, false);
         }
 
         // Do syntax highlighting
@@ -135,13 +134,13 @@ void code_editor_update(Code_Editor* editor, Input* input, double time)
                 AST_Node_Index nearest_node_index = ast_parser_get_closest_node_to_text_position(
                     &editor->compiler.parser, t.position.start, editor->text_editor->text
                 );
-                AST_Node* nearest_node = &editor->compiler.parser.nodes[nearest_node_index];
+                AST_Node nearest_node = ast_parser_get_node(&editor->compiler.parser, nearest_node_index);
                 vec3 color = IDENTIFIER_FALLBACK_COLOR;
-                if (nearest_node->type == AST_Node_Type::EXPRESSION_FUNCTION_CALL ||
-                    nearest_node->type == AST_Node_Type::FUNCTION) {
+                if (nearest_node.type == AST_Node_Type::EXPRESSION_FUNCTION_CALL ||
+                    nearest_node.type == AST_Node_Type::FUNCTION) {
                     color = FUNCTION_COLOR;
                 }
-                if (nearest_node->type == AST_Node_Type::STRUCT) {
+                if (nearest_node.type == AST_Node_Type::STRUCT) {
                     color = TYPE_COLOR;
                 }
                 /*
@@ -1,5 +1,11 @@
 #include "compiler.hpp"
+
+#include <cstring>
 #include "../../win32/timing.hpp"
+#include "../../utility/parallel.hpp"
+#include "bytecode_optimizer.hpp"
+#include "ir_optimizer.hpp"
+#include "../../utility/process_memory.hpp"
 
 Token_Range token_range_make(int start_index, int end_index)
 {
@@ -13,6 +19,7 @@ Compiler compiler_create(Timer* timer)
 {
     Compiler result;
     result.timer = timer;
+    result.arena = arena_create(1024 * 1024);
     result.lexer = lexer_create();
     result.parser = ast_parser_create();
     result.lexer = lexer_create();
@@ -20,7 +27,11 @@ Compiler compiler_create(Timer* timer)
     result.analyser = semantic_analyser_create();
     result.bytecode_generator = bytecode_generator_create();
     result.bytecode_interpreter = bytecode_intepreter_create();
+    result.bytecode_jit = bytecode_jit_create();
+    result.bytecode_profiler = bytecode_profiler_create(0.001);
     result.c_generator = c_generator_create();
+    memory_set_bytes(&result.phase_statistics, sizeof(result.phase_statistics), 0);
+    result.measure_phase_memory = false;
     return result;
 }
 
@@ -32,15 +43,29 @@ void compiler_destroy(Compiler* compiler)
     semantic_analyser_destroy(&compiler->analyser);
     bytecode_generator_destroy(&compiler->bytecode_generator);
     bytecode_interpreter_destroy(&compiler->bytecode_interpreter);
+    bytecode_jit_destroy(&compiler->bytecode_jit);
+    bytecode_profiler_destroy(&compiler->bytecode_profiler);
     c_generator_destroy(&compiler->c_generator);
+    arena_destroy(&compiler->arena);
 }
 
 bool enable_lexing = true;
 bool enable_parsing = true;
 bool enable_analysis = true;
+bool enable_parallel_analysis = true; // Analyses function bodies on all hardware threads
+bool enable_ir_optimization = true;
+int ir_inlining_instruction_budget = 24; // Functions with more IR instructions are not inlined, 0 disables inlining
 bool enable_bytecode_gen = true;
+bool enable_parallel_bytecode_gen = true; // Generates functions on all hardware threads, the resulting code is identical
+bool enable_bytecode_optimization = true;
 bool enable_execution = true;
 bool enable_output = true;
+bool enable_jit = false;
+bool validate_jit = false; // Runs the interpreter after the JIT and compares exit code and globals
+u64 interpreter_stack_size = 8 * 1024 * 1024; // Only reserved, pages are backed by memory once a program touches them
+bool enable_profiling = false; // Interprets with instruction counters and call stack samples, the JIT is not used
+const char* profiling_folded_stacks_file = "upp_profile.folded";
+bool enable_c_backend = false; // Generates backend/main.c and compiles it to backend/main
 
 bool output_lexing = false;
 bool output_identifiers = false;
@@ -49,38 +74,152 @@ bool output_type_system = false;
 bool output_root_table = false;
 bool output_im = true;
 bool output_bytecode = true;
+bool output_stack_frames = false;
 bool output_timing = true;
 
-void compiler_compile(Compiler* compiler, String* source_code, bool generate_code)
+const char* compiler_phase_to_string(Compiler_Phase phase)
+{
+    switch (phase)
+    {
+    case Compiler_Phase::LEXING: return "lexing";
+    case Compiler_Phase::PARSING: return "parsing";
+    case Compiler_Phase::ANALYSIS: return "analysis";
+    case Compiler_Phase::IR_OPTIMIZATION: return "ir_optimization";
+    case Compiler_Phase::BYTECODE_GENERATION: return "bytecode_generation";
+    case Compiler_Phase::BYTECODE_OPTIMIZATION: return "bytecode_optimization";
+    case Compiler_Phase::C_BACKEND: return "c_backend";
+    case Compiler_Phase::EXECUTION: return "execution";
+    default: panic("Should not happen");
+    }
+    return "";
+}
+
+// Memory is measured as the peak since the last recorded phase, so phases need to be recorded in order
+void compiler_record_phase(Compiler* compiler, Compiler_Phase phase, bool executed, double time_start, double time_end)
+{
+    Compiler_Phase_Statistics* statistics = &compiler->phase_statistics[(int)phase];
+    statistics->executed = executed;
+    statistics->time = time_end - time_start;
+    statistics->peak_memory = 0;
+    if (compiler->measure_phase_memory) {
+        statistics->peak_memory = process_memory_peak_usage();
+        process_memory_reset_peak();
+    }
+}
+
+// Either source_code is given (Full lexing), or the editor text with the lines changed since the last compile
+void compiler_compile_internal(Compiler* compiler, String* source_code, Dynamic_Array<String>* text, Text_Changed_Lines changed_lines, bool generate_code)
 {
     bool do_lexing = enable_lexing;
     bool do_parsing = do_lexing && enable_parsing;
     bool do_analysis = do_parsing && enable_analysis;
     bool do_bytecode_gen = do_analysis && enable_bytecode_gen;
+    arena_reset(&compiler->arena);
+    if (compiler->measure_phase_memory) {
+        process_memory_reset_peak();
+    }
 
     double time_start_lexing = timer_current_time_in_seconds(compiler->timer);
-    if (do_lexing) {
-        lexer_parse_string(&compiler->lexer, source_code);
+    bool tokens_changed_incrementally = false;
+    Token_Change token_change;
+    if (do_lexing)
+    {
+        Lexer* lexer = &compiler->lexer;
+        if (source_code != 0) {
+            lexer_parse_string(lexer, source_code, &compiler->arena.allocator);
+        }
+        else if (lexer->identifier_allocator == 0 && lexer->tokens_with_whitespaces.size != 0) {
+            // Tokens are from the last incremental compile, so only the changed lines need relexing
+            if (changed_lines.changed) {
+                token_change = lexer_relex_lines(lexer, text, changed_lines.first_line, changed_lines.old_end_line, changed_lines.new_end_line);
+            }
+            else {
+                token_change.start_index = lexer->tokens.size;
+                token_change.old_end_index = lexer->tokens.size;
+                token_change.new_end_index = lexer->tokens.size;
+            }
+            tokens_changed_incrementally = true;
+        }
+        else {
+            // Identifiers must survive the arena reset between incremental compiles, so they are heap allocated
+            String code = string_create_empty(2048);
+            SCOPE_EXIT(string_destroy(&code));
+            text_append_to_string(text, &code);
+            lexer_parse_string(lexer, &code, 0);
+        }
     }
     double time_end_lexing = timer_current_time_in_seconds(compiler->timer);
+    compiler_record_phase(compiler, Compiler_Phase::LEXING, do_lexing, time_start_lexing, time_end_lexing);
 
     double time_start_parsing = timer_current_time_in_seconds(compiler->timer);
     if (do_parsing) {
-        ast_parser_parse(&compiler->parser, &compiler->lexer);
+        if (tokens_changed_incrementally) {
+            ast_parser_parse_incremental(&compiler->parser, &compiler->lexer, token_change);
+        }
+        else {
+            ast_parser_parse(&compiler->parser, &compiler->lexer);
+        }
     }
     double time_end_parsing = timer_current_time_in_seconds(compiler->timer);
+    compiler_record_phase(compiler, Compiler_Phase::PARSING, do_parsing, time_start_parsing, time_end_parsing);
 
     double time_start_analysis = timer_current_time_in_seconds(compiler->timer);
     if (do_analysis) {
-        semantic_analyser_analyse(&compiler->analyser, compiler);
+        compiler->analyser.body_worker_count = enable_parallel_analysis ? parallel_hardware_thread_count() : 1;
+        if (source_code == 0) {
+            semantic_analyser_analyse_incremental(&compiler->analyser, compiler);
+        }
+        else {
+            semantic_analyser_analyse(&compiler->analyser, compiler);
+        }
     }
     double time_end_analysis = timer_current_time_in_seconds(compiler->timer);
+    compiler_record_phase(compiler, Compiler_Phase::ANALYSIS, do_analysis, time_start_analysis, time_end_analysis);
+
+    double time_start_ir_opt = timer_current_time_in_seconds(compiler->timer);
+    IR_Optimizer_Statistics ir_opt_stats;
+    memory_set_bytes(&ir_opt_stats, sizeof(ir_opt_stats), 0);
+    int inlined_call_count = 0;
+    bool do_ir_opt = do_analysis && enable_ir_optimization && compiler->parser.errors.size == 0 && compiler->analyser.errors.size == 0;
+    if (do_ir_opt) {
+        if (ir_inlining_instruction_budget > 0) {
+            inlined_call_count = ir_optimizer_inline_functions(&compiler->analyser, ir_inlining_instruction_budget);
+        }
+        ir_opt_stats = ir_optimizer_optimize(compiler->analyser.program);
+    }
+    double time_end_ir_opt = timer_current_time_in_seconds(compiler->timer);
+    compiler_record_phase(compiler, Compiler_Phase::IR_OPTIMIZATION, do_ir_opt, time_start_ir_opt, time_end_ir_opt);
 
     double time_start_codegen = timer_current_time_in_seconds(compiler->timer);
-    if (do_bytecode_gen && compiler->parser.errors.size == 0 && compiler->analyser.errors.size == 0) {
-        bytecode_generator_generate(&compiler->bytecode_generator, compiler);
+    bool do_codegen = do_bytecode_gen && compiler->parser.errors.size == 0 && compiler->analyser.errors.size == 0;
+    if (do_codegen) {
+        if (enable_parallel_bytecode_gen) {
+            bytecode_generator_generate_parallel(&compiler->bytecode_generator, compiler, parallel_hardware_thread_count());
+        }
+        else {
+            bytecode_generator_generate(&compiler->bytecode_generator, compiler);
+        }
     }
     double time_end_codegen = timer_current_time_in_seconds(compiler->timer);
+    compiler_record_phase(compiler, Compiler_Phase::BYTECODE_GENERATION, do_codegen, time_start_codegen, time_end_codegen);
+
+    double time_start_bytecode_opt = timer_current_time_in_seconds(compiler->timer);
+    int instruction_count_before_opt = compiler->bytecode_generator.instructions.size;
+    bool do_bytecode_opt = do_codegen && enable_bytecode_optimization;
+    if (do_bytecode_opt) {
+        bytecode_optimizer_optimize(&compiler->bytecode_generator);
+    }
+    double time_end_bytecode_opt = timer_current_time_in_seconds(compiler->timer);
+    compiler_record_phase(compiler, Compiler_Phase::BYTECODE_OPTIMIZATION, do_bytecode_opt, time_start_bytecode_opt, time_end_bytecode_opt);
+
+    double time_start_c_backend = timer_current_time_in_seconds(compiler->timer);
+    bool do_c_backend = do_analysis && enable_c_backend && generate_code && compiler->parser.errors.size == 0 && compiler->analyser.errors.size == 0;
+    if (do_c_backend) {
+        c_generator_generate(&compiler->c_generator, compiler);
+        c_generator_compile(&compiler->c_generator);
+    }
+    double time_end_c_backend = timer_current_time_in_seconds(compiler->timer);
+    compiler_record_phase(compiler, Compiler_Phase::C_BACKEND, do_c_backend, time_start_c_backend, time_end_c_backend);
 
     double time_start_output = timer_current_time_in_seconds(compiler->timer);
     if (enable_output && generate_code)
@@ -141,6 +280,17 @@ void compiler_compile(Compiler* compiler, String* source_code, bool generate_cod
                     logg("\n----------------BYTECODE_GENERATOR RESULT---------------: \n%s\n", result_str.characters);
                 }
             }
+
+            if (do_bytecode_gen && output_stack_frames)
+            {
+                logg("\n--------STACK FRAMES---------\n");
+                for (int i = 0; i < compiler->bytecode_generator.stack_frames.size; i++) {
+                    Stack_Frame_Info* info = &compiler->bytecode_generator.stack_frames[i];
+                    logg("Function #%d: registers %d -> %d bytes, frame %d bytes\n", i,
+                        info->register_size_without_reuse, info->register_size, info->frame_size
+                    );
+                }
+            }
         }
     }
     double time_end_output = timer_current_time_in_seconds(compiler->timer);
@@ -155,10 +305,38 @@ void compiler_compile(Compiler* compiler, String* source_code, bool generate_cod
             logg("parsing      ... %3.2fms\n", (time_end_parsing - time_start_parsing) * 1000);
         }
         if (enable_analysis) {
-            logg("analysis     ... %3.2fms\n", (time_end_analysis - time_start_analysis) * 1000);
+            logg("analysis     ... %3.2fms (%d/%d function bodies analysed)\n", (time_end_analysis - time_start_analysis) * 1000,
+                compiler->analyser.analysed_function_count, compiler->analyser.location_functions.size
+            );
+            Symbol_Lookup_Statistics* stats = &compiler->analyser.lookup_statistics;
+            logg("    symbol lookups: %d, %3.2f tables visited per lookup (%d hashed)\n", stats->lookup_count,
+                stats->lookup_count == 0 ? 0.0 : (double)stats->tables_visited / stats->lookup_count, stats->hashed_tables_visited
+            );
+        }
+        if (enable_analysis && enable_ir_optimization) {
+            logg("ir_opt       ... %3.2fms (%d calls inlined, %d folded, %d propagated, %d branches and %d moves removed)\n",
+                (time_end_ir_opt - time_start_ir_opt) * 1000, inlined_call_count, ir_opt_stats.folded_instruction_count, ir_opt_stats.propagated_access_count,
+                ir_opt_stats.removed_branch_count, ir_opt_stats.removed_move_count
+            );
         }
         if (enable_bytecode_gen) {
-            logg("bytecode_gen ... %3.2fms\n", (time_end_codegen - time_start_codegen) * 1000);
+            int register_size = 0;
+            int register_size_without_reuse = 0;
+            for (int i = 0; i < compiler->bytecode_generator.stack_frames.size; i++) {
+                register_size += compiler->bytecode_generator.stack_frames[i].register_size;
+                register_size_without_reuse += compiler->bytecode_generator.stack_frames[i].register_size_without_reuse;
+            }
+            logg("bytecode_gen ... %3.2fms (registers %d -> %d bytes, max frame %d bytes)\n", (time_end_codegen - time_start_codegen) * 1000,
+                register_size_without_reuse, register_size, compiler->bytecode_generator.maximum_function_stack_depth
+            );
+        }
+        if (enable_bytecode_gen && enable_bytecode_optimization) {
+            logg("bytecode_opt ... %3.2fms (%d -> %d instructions)\n", (time_end_bytecode_opt - time_start_bytecode_opt) * 1000,
+                instruction_count_before_opt, compiler->bytecode_generator.instructions.size
+            );
+        }
+        if (enable_c_backend) {
+            logg("c_backend    ... %3.2fms\n", (time_end_c_backend - time_start_c_backend) * 1000);
         }
         if (enable_output) {
             logg("output       ... %3.2fms\n", (time_end_output - time_start_output) * 1000);
@@ -166,6 +344,14 @@ void compiler_compile(Compiler* compiler, String* source_code, bool generate_cod
     }
 }
 
+void compiler_compile(Compiler* compiler, String* source_code, bool generate_code) {
+    compiler_compile_internal(compiler, source_code, 0, text_changed_lines_make_empty(), generate_code);
+}
+
+void compiler_compile_incremental(Compiler* compiler, Dynamic_Array<String>* text, Text_Changed_Lines changed_lines, bool generate_code) {
+    compiler_compile_internal(compiler, 0, text, changed_lines, generate_code);
+}
+
 void compiler_execute(Compiler* compiler)
 {
     bool do_execution =
@@ -176,11 +362,46 @@ void compiler_execute(Compiler* compiler)
         enable_execution;
 
     // Execute
+    compiler->phase_statistics[(int)Compiler_Phase::EXECUTION].executed = false;
+    compiler->phase_statistics[(int)Compiler_Phase::EXECUTION].time = 0;
+    compiler->phase_statistics[(int)Compiler_Phase::EXECUTION].peak_memory = 0;
     if (compiler->parser.errors.size == 0 && compiler->analyser.errors.size == 0 && do_execution)
     {
+        if (compiler->measure_phase_memory) {
+            process_memory_reset_peak();
+        }
         double bytecode_start = timer_current_time_in_seconds(compiler->timer);
-        bytecode_interpreter_execute_main(&compiler->bytecode_interpreter, compiler);
+        compiler->bytecode_interpreter.stack_size = interpreter_stack_size;
+        compiler->bytecode_interpreter.profiler = enable_profiling ? &compiler->bytecode_profiler : 0;
+        if (enable_jit && !enable_profiling) {
+            bytecode_jit_execute_main(&compiler->bytecode_jit, &compiler->bytecode_interpreter, compiler);
+        }
+        else {
+            bytecode_interpreter_execute_main(&compiler->bytecode_interpreter, compiler);
+        }
         double bytecode_end = timer_current_time_in_seconds(compiler->timer);
+        compiler_record_phase(compiler, Compiler_Phase::EXECUTION, true, bytecode_start, bytecode_end);
+        if (enable_jit && validate_jit && !enable_profiling)
+        {
+            Bytecode_Interpreter* interpreter = &compiler->bytecode_interpreter;
+            Exit_Code jit_exit_code = interpreter->exit_code;
+            int global_size = compiler->bytecode_generator.global_data_size;
+            Array<byte> jit_globals = array_create_empty<byte>(math_maximum(global_size, 1));
+            SCOPE_EXIT(array_destroy(&jit_globals));
+            if (global_size != 0) {
+                memory_copy(jit_globals.data, interpreter->globals.data, global_size);
+            }
+            bytecode_interpreter_execute_main(interpreter, compiler);
+            if (interpreter->exit_code != jit_exit_code) {
+                logg("JIT validation failed: Exit codes do not match\n");
+            }
+            else if (global_size != 0 && memcmp(jit_globals.data, interpreter->globals.data, global_size) != 0) {
+                logg("JIT validation failed: Globals do not match\n");
+            }
+            else {
+                logg("JIT validation successfull\n");
+            }
+        }
         float bytecode_time = (bytecode_end - bytecode_start);
         if (compiler->bytecode_interpreter.exit_code == Exit_Code::SUCCESS) {
             logg("Interpreter: Exit SUCCESS");
@@ -193,8 +414,16 @@ void compiler_execute(Compiler* compiler)
             logg("Bytecode interpreter error: %s\n", tmp.characters);
         }
 
-        //c_generator_generate(&compiler->c_generator, &&compiler->intermediate_generator);
-        //logg("C-Code:\n------------------\n%s\n", &compiler->c_generator.output_string.characters);
+        if (enable_profiling)
+        {
+            String report = string_create_empty(1024);
+            SCOPE_EXIT(string_destroy(&report));
+            bytecode_profiler_append_report_to_string(&compiler->bytecode_profiler, &report, 20);
+            logg("\n--------- PROFILE -----------\n%s", report.characters);
+            if (!bytecode_profiler_write_folded_stacks(&compiler->bytecode_profiler, profiling_folded_stacks_file)) {
+                logg("Could not write folded stacks to %s\n", profiling_folded_stacks_file);
+            }
+        }
     }
 }
 
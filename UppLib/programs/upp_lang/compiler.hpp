@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../../win32/timing.hpp"
+#include "../../utility/allocators.hpp"
 
 struct Lexer;
 struct Compiler;
@@ -25,6 +26,27 @@ struct Compiler_Error
     Token_Range range;
 };
 
+enum class Compiler_Phase
+{
+    LEXING,
+    PARSING,
+    ANALYSIS,
+    IR_OPTIMIZATION,
+    BYTECODE_GENERATION,
+    BYTECODE_OPTIMIZATION,
+    C_BACKEND,
+    EXECUTION,
+    PHASE_COUNT, // Should always be last element
+};
+const char* compiler_phase_to_string(Compiler_Phase phase);
+
+struct Compiler_Phase_Statistics
+{
+    bool executed; // False if the phase is disabled or was skipped because of errors
+    double time; // Seconds
+    u64 peak_memory; // Peak resident memory of the process during the phase, only set if Compiler::measure_phase_memory
+};
+
 struct Compiler;
 
 #include "lexer.hpp"
@@ -32,6 +54,8 @@ struct Compiler;
 #include "semantic_analyser.hpp"
 #include "bytecode_generator.hpp"
 #include "bytecode_interpreter.hpp"
+#include "bytecode_jit.hpp"
+#include "bytecode_profiler.hpp"
 #include "c_backend.hpp"
 
 struct Compiler
@@ -42,12 +66,29 @@ struct Compiler
     Semantic_Analyser analyser;
     Bytecode_Generator bytecode_generator;
     Bytecode_Interpreter bytecode_interpreter;
+    Bytecode_Jit bytecode_jit;
+    Bytecode_Profiler bytecode_profiler;
     C_Generator c_generator;
     Timer* timer;
+    // Of the last compile and execution
+    Compiler_Phase_Statistics phase_statistics[(int)Compiler_Phase::PHASE_COUNT];
+    bool measure_phase_memory;
+    Arena arena; // Per compilation data (Identifiers, symbol tables), reset at the start of compiler_compile
 };
 
 Compiler compiler_create(Timer* timer);
 void compiler_destroy(Compiler* compiler);
 void compiler_compile(Compiler* compiler, String* source_code, bool generate_code);
+// Relexes only the changed lines of text if the previous compile was also incremental
+void compiler_compile_incremental(Compiler* compiler, Dynamic_Array<String>* text, Text_Changed_Lines changed_lines, bool generate_code);
 void compiler_execute(Compiler* compiler);
+
+// Options, defined in compiler.cpp
+extern bool enable_output;
+extern bool enable_execution;
+extern bool enable_jit;
+extern bool enable_profiling;
+extern bool output_im;
+extern bool output_bytecode;
+extern bool output_timing;
 Text_Slice token_range_to_text_slice(Token_Range range, Compiler* compiler);
\ No newline at end of file
@@ -0,0 +1,870 @@
+#include "ir_optimizer.hpp"
+
+#include "compiler.hpp"
+
+struct IR_Optimizer_Register
+{
+    int write_count;
+    int read_count;
+    int replaced_read_count;
+    bool address_taken;
+    bool is_constant; // Set once the single write was visited, reads afterwards are replaced with constant_access
+    IR_Data_Access constant_access;
+};
+
+struct IR_Optimizer
+{
+    IR_Program* program;
+    // Registers of all code blocks of the current function, register_offsets stores the index of the first register of a block
+    Hashtable<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>> register_offsets;
+    Dynamic_Array<IR_Optimizer_Register> registers;
+    IR_Optimizer_Statistics statistics;
+};
+
+IR_Optimizer_Register* ir_optimizer_get_register(IR_Optimizer* optimizer, IR_Data_Access* access)
+{
+    if (access->type != IR_Data_Access_Type::REGISTER) {
+        return 0;
+    }
+    IR_Code_Block* block = access->option.definition_block;
+    int* offset = hashtable_find_element(&optimizer->register_offsets, block);
+    if (offset == 0)
+    {
+        int first_register = optimizer->registers.size;
+        hashtable_insert_element(&optimizer->register_offsets, block, first_register);
+        for (int i = 0; i < block->registers.size; i++) {
+            IR_Optimizer_Register reg;
+            reg.write_count = 0;
+            reg.read_count = 0;
+            reg.replaced_read_count = 0;
+            reg.address_taken = false;
+            reg.is_constant = false;
+            dynamic_array_push_back(&optimizer->registers, reg);
+        }
+        return &optimizer->registers[first_register + access->index];
+    }
+    return &optimizer->registers[*offset + access->index];
+}
+
+
+
+/*
+    Register usage collection
+*/
+void ir_optimizer_collect_read(IR_Optimizer* optimizer, IR_Data_Access* access)
+{
+    IR_Optimizer_Register* reg = ir_optimizer_get_register(optimizer, access);
+    if (reg != 0) {
+        reg->read_count++;
+    }
+}
+
+void ir_optimizer_collect_write(IR_Optimizer* optimizer, IR_Data_Access* access)
+{
+    IR_Optimizer_Register* reg = ir_optimizer_get_register(optimizer, access);
+    if (reg == 0) return;
+    // Writing through a pointer only reads the register
+    if (access->is_memory_access) {
+        reg->read_count++;
+    }
+    else {
+        reg->write_count++;
+    }
+}
+
+void ir_optimizer_collect_code_block(IR_Optimizer* optimizer, IR_Code_Block* code_block)
+{
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::FUNCTION_CALL:
+        {
+            IR_Instruction_Call* call = &instr->options.call;
+            if (call->call_type == IR_Instruction_Call_Type::FUNCTION_POINTER_CALL) {
+                ir_optimizer_collect_read(optimizer, &call->options.pointer_access);
+            }
+            for (int j = 0; j < call->arguments.size; j++) {
+                ir_optimizer_collect_read(optimizer, &call->arguments[j]);
+            }
+            if (ir_instruction_call_get_return_type(call)->type != Signature_Type::VOID_TYPE) {
+                ir_optimizer_collect_write(optimizer, &call->destination);
+            }
+            break;
+        }
+        case IR_Instruction_Type::IF:
+            ir_optimizer_collect_read(optimizer, &instr->options.if_instr.condition);
+            ir_optimizer_collect_code_block(optimizer, instr->options.if_instr.true_branch);
+            ir_optimizer_collect_code_block(optimizer, instr->options.if_instr.false_branch);
+            break;
+        case IR_Instruction_Type::WHILE:
+            ir_optimizer_collect_code_block(optimizer, instr->options.while_instr.condition_code);
+            ir_optimizer_collect_read(optimizer, &instr->options.while_instr.condition_access);
+            ir_optimizer_collect_code_block(optimizer, instr->options.while_instr.code);
+            break;
+        case IR_Instruction_Type::BLOCK:
+            ir_optimizer_collect_code_block(optimizer, instr->options.block);
+            break;
+        case IR_Instruction_Type::BREAK:
+        case IR_Instruction_Type::CONTINUE:
+            break;
+        case IR_Instruction_Type::RETURN:
+            if (instr->options.return_instr.type == IR_Instruction_Return_Type::RETURN_DATA) {
+                ir_optimizer_collect_read(optimizer, &instr->options.return_instr.options.return_value);
+            }
+            break;
+        case IR_Instruction_Type::MOVE:
+            ir_optimizer_collect_write(optimizer, &instr->options.move.destination);
+            ir_optimizer_collect_read(optimizer, &instr->options.move.source);
+            break;
+        case IR_Instruction_Type::CAST:
+            ir_optimizer_collect_write(optimizer, &instr->options.cast.destination);
+            ir_optimizer_collect_read(optimizer, &instr->options.cast.source);
+            break;
+        case IR_Instruction_Type::ADDRESS_OF:
+        {
+            IR_Instruction_Address_Of* address_of = &instr->options.address_of;
+            ir_optimizer_collect_write(optimizer, &address_of->destination);
+            if (address_of->type != IR_Instruction_Address_Of_Type::FUNCTION) {
+                IR_Optimizer_Register* reg = ir_optimizer_get_register(optimizer, &address_of->source);
+                if (reg != 0) {
+                    reg->address_taken = true;
+                    reg->read_count++;
+                }
+            }
+            if (address_of->type == IR_Instruction_Address_Of_Type::ARRAY_ELEMENT) {
+                ir_optimizer_collect_read(optimizer, &address_of->options.index_access);
+            }
+            break;
+        }
+        case IR_Instruction_Type::UNARY_OP:
+            ir_optimizer_collect_write(optimizer, &instr->options.unary_op.destination);
+            ir_optimizer_collect_read(optimizer, &instr->options.unary_op.source);
+            break;
+        case IR_Instruction_Type::BINARY_OP:
+            ir_optimizer_collect_write(optimizer, &instr->options.binary_op.destination);
+            ir_optimizer_collect_read(optimizer, &instr->options.binary_op.operand_left);
+            ir_optimizer_collect_read(optimizer, &instr->options.binary_op.operand_right);
+            break;
+        default: panic("Lul");
+        }
+    }
+}
+
+
+
+/*
+    Constant folding
+*/
+// Returns the bytes of the constant if the access is a primitive constant, otherwise 0
+// The pointer is only valid until the next constant is created
+byte* ir_optimizer_get_primitive_constant(IR_Data_Access* access)
+{
+    if (access->type != IR_Data_Access_Type::CONSTANT || access->is_memory_access) {
+        return 0;
+    }
+    IR_Constant* constant = &access->option.program->constant_pool.constants[access->index];
+    if (constant->type->type != Signature_Type::PRIMITIVE) {
+        return 0;
+    }
+    return &access->option.program->constant_pool.constant_memory[constant->offset];
+}
+
+template<typename T>
+bool ir_optimizer_modulo(T left, T right, T* result) {
+    *result = left % right;
+    return true;
+}
+bool ir_optimizer_modulo(f32, f32, f32*) {
+    return false;
+}
+bool ir_optimizer_modulo(f64, f64, f64*) {
+    return false;
+}
+
+// Returns false if the operation cannot be folded, result needs space for 8 bytes
+template<typename T>
+bool ir_optimizer_fold_binary_op_typed(IR_Instruction_Binary_OP_Type type, bool is_integer, byte* left_ptr, byte* right_ptr, byte* result)
+{
+    T left = *(T*)left_ptr;
+    T right = *(T*)right_ptr;
+    if (is_integer && (type == IR_Instruction_Binary_OP_Type::DIVISION || type == IR_Instruction_Binary_OP_Type::MODULO)) {
+        // Division by zero and INT_MIN / -1 trap at runtime, so they stay runtime errors
+        if (right == (T)0 || ((T)-1 < (T)0 && right == (T)-1)) {
+            return false;
+        }
+    }
+    switch (type)
+    {
+    case IR_Instruction_Binary_OP_Type::ADDITION: *(T*)result = left + right; break;
+    case IR_Instruction_Binary_OP_Type::SUBTRACTION: *(T*)result = left - right; break;
+    case IR_Instruction_Binary_OP_Type::MULTIPLICATION: *(T*)result = left * right; break;
+    case IR_Instruction_Binary_OP_Type::DIVISION: *(T*)result = left / right; break;
+    case IR_Instruction_Binary_OP_Type::MODULO: return ir_optimizer_modulo(left, right, (T*)result);
+    case IR_Instruction_Binary_OP_Type::EQUAL: *(u8*)result = left == right ? 1 : 0; break;
+    case IR_Instruction_Binary_OP_Type::NOT_EQUAL: *(u8*)result = left != right ? 1 : 0; break;
+    case IR_Instruction_Binary_OP_Type::GREATER_THAN: *(u8*)result = left > right ? 1 : 0; break;
+    case IR_Instruction_Binary_OP_Type::GREATER_EQUAL: *(u8*)result = left >= right ? 1 : 0; break;
+    case IR_Instruction_Binary_OP_Type::LESS_THAN: *(u8*)result = left < right ? 1 : 0; break;
+    case IR_Instruction_Binary_OP_Type::LESS_EQUAL: *(u8*)result = left <= right ? 1 : 0; break;
+    default: return false;
+    }
+    return true;
+}
+
+bool ir_optimizer_fold_binary_op(IR_Instruction_Binary_OP_Type type, Primitive_Type operand_type, byte* left, byte* right, byte* result)
+{
+    bool is_integer = primitive_type_is_integer(operand_type);
+    switch (operand_type)
+    {
+    case Primitive_Type::BOOLEAN: {
+        bool left_value = *left != 0;
+        bool right_value = *right != 0;
+        switch (type)
+        {
+        case IR_Instruction_Binary_OP_Type::AND: *result = left_value && right_value ? 1 : 0; return true;
+        case IR_Instruction_Binary_OP_Type::OR: *result = left_value || right_value ? 1 : 0; return true;
+        case IR_Instruction_Binary_OP_Type::EQUAL: *result = *left == *right ? 1 : 0; return true;
+        case IR_Instruction_Binary_OP_Type::NOT_EQUAL: *result = *left != *right ? 1 : 0; return true;
+        }
+        return false;
+    }
+    case Primitive_Type::SIGNED_INT_8: return ir_optimizer_fold_binary_op_typed<i8>(type, is_integer, left, right, result);
+    case Primitive_Type::SIGNED_INT_16: return ir_optimizer_fold_binary_op_typed<i16>(type, is_integer, left, right, result);
+    case Primitive_Type::SIGNED_INT_32: return ir_optimizer_fold_binary_op_typed<i32>(type, is_integer, left, right, result);
+    case Primitive_Type::SIGNED_INT_64: return ir_optimizer_fold_binary_op_typed<i64>(type, is_integer, left, right, result);
+    case Primitive_Type::UNSIGNED_INT_8: return ir_optimizer_fold_binary_op_typed<u8>(type, is_integer, left, right, result);
+    case Primitive_Type::UNSIGNED_INT_16: return ir_optimizer_fold_binary_op_typed<u16>(type, is_integer, left, right, result);
+    case Primitive_Type::UNSIGNED_INT_32: return ir_optimizer_fold_binary_op_typed<u32>(type, is_integer, left, right, result);
+    case Primitive_Type::UNSIGNED_INT_64: return ir_optimizer_fold_binary_op_typed<u64>(type, is_integer, left, right, result);
+    case Primitive_Type::FLOAT_32: return ir_optimizer_fold_binary_op_typed<f32>(type, is_integer, left, right, result);
+    case Primitive_Type::FLOAT_64: return ir_optimizer_fold_binary_op_typed<f64>(type, is_integer, left, right, result);
+    }
+    return false;
+}
+
+bool ir_optimizer_fold_unary_op(IR_Instruction_Unary_OP_Type type, Primitive_Type operand_type, byte* source, byte* result)
+{
+    if (type == IR_Instruction_Unary_OP_Type::NOT) {
+        if (operand_type != Primitive_Type::BOOLEAN) return false;
+        *result = *source == 0 ? 1 : 0;
+        return true;
+    }
+    switch (operand_type)
+    {
+    case Primitive_Type::SIGNED_INT_8: *(i8*)result = -*(i8*)source; return true;
+    case Primitive_Type::SIGNED_INT_16: *(i16*)result = -*(i16*)source; return true;
+    case Primitive_Type::SIGNED_INT_32: *(i32*)result = -*(i32*)source; return true;
+    case Primitive_Type::SIGNED_INT_64: *(i64*)result = -*(i64*)source; return true;
+    case Primitive_Type::FLOAT_32: *(f32*)result = -*(f32*)source; return true;
+    case Primitive_Type::FLOAT_64: *(f64*)result = -*(f64*)source; return true;
+    }
+    return false;
+}
+
+bool ir_optimizer_fold_cast(Primitive_Type source_type, Primitive_Type destination_type, byte* source, byte* result)
+{
+    if (source_type == Primitive_Type::BOOLEAN || destination_type == Primitive_Type::BOOLEAN) {
+        return false;
+    }
+
+    // Source is widened to 64 bit first, like the cast instructions of the interpreter
+    bool source_is_float = primitive_type_is_float(source_type);
+    bool source_is_signed = primitive_type_is_signed(source_type);
+    f64 source_float = 0.0;
+    i64 source_signed = 0;
+    u64 source_unsigned = 0;
+    switch (source_type)
+    {
+    case Primitive_Type::SIGNED_INT_8: source_signed = *(i8*)source; break;
+    case Primitive_Type::SIGNED_INT_16: source_signed = *(i16*)source; break;
+    case Primitive_Type::SIGNED_INT_32: source_signed = *(i32*)source; break;
+    case Primitive_Type::SIGNED_INT_64: source_signed = *(i64*)source; break;
+    case Primitive_Type::UNSIGNED_INT_8: source_unsigned = *(u8*)source; break;
+    case Primitive_Type::UNSIGNED_INT_16: source_unsigned = *(u16*)source; break;
+    case Primitive_Type::UNSIGNED_INT_32: source_unsigned = *(u32*)source; break;
+    case Primitive_Type::UNSIGNED_INT_64: source_unsigned = *(u64*)source; break;
+    case Primitive_Type::FLOAT_32: source_float = *(f32*)source; break;
+    case Primitive_Type::FLOAT_64: source_float = *(f64*)source; break;
+    default: return false;
+    }
+    if (!source_is_float && source_is_signed) {
+        source_unsigned = (u64)source_signed;
+    }
+
+    switch (destination_type)
+    {
+    case Primitive_Type::FLOAT_32:
+        if (source_is_float) *(f32*)result = (f32)source_float;
+        else *(f32*)result = source_is_signed ? (f32)source_signed : (f32)source_unsigned;
+        return true;
+    case Primitive_Type::FLOAT_64:
+        if (source_is_float) *(f64*)result = source_float;
+        else *(f64*)result = source_is_signed ? (f64)source_signed : (f64)source_unsigned;
+        return true;
+    }
+
+    switch (destination_type)
+    {
+    case Primitive_Type::SIGNED_INT_8: *(i8*)result = source_is_float ? (i8)source_float : (i8)source_unsigned; break;
+    case Primitive_Type::SIGNED_INT_16: *(i16*)result = source_is_float ? (i16)source_float : (i16)source_unsigned; break;
+    case Primitive_Type::SIGNED_INT_32: *(i32*)result = source_is_float ? (i32)source_float : (i32)source_unsigned; break;
+    case Primitive_Type::SIGNED_INT_64: *(i64*)result = source_is_float ? (i64)source_float : (i64)source_unsigned; break;
+    case Primitive_Type::UNSIGNED_INT_8: *(u8*)result = source_is_float ? (u8)source_float : (u8)source_unsigned; break;
+    case Primitive_Type::UNSIGNED_INT_16: *(u16*)result = source_is_float ? (u16)source_float : (u16)source_unsigned; break;
+    case Primitive_Type::UNSIGNED_INT_32: *(u32*)result = source_is_float ? (u32)source_float : (u32)source_unsigned; break;
+    case Primitive_Type::UNSIGNED_INT_64: *(u64*)result = source_is_float ? (u64)source_float : (u64)source_unsigned; break;
+    default: return false;
+    }
+    return true;
+}
+
+// Turns the instruction into a move of the folded result into destination
+void ir_optimizer_replace_with_constant_move(IR_Optimizer* optimizer, IR_Instruction* instr, IR_Data_Access destination, byte* result)
+{
+    Type_Signature* result_type = ir_data_access_get_type(&destination);
+    IR_Instruction move;
+    move.type = IR_Instruction_Type::MOVE;
+    move.options.move.destination = destination;
+    move.options.move.source = ir_data_access_create_constant_access(
+        optimizer->program, result_type, array_create_static(result, result_type->size_in_bytes)
+    );
+    *instr = move;
+    optimizer->statistics.folded_instruction_count++;
+}
+
+bool ir_optimizer_access_is_primitive(IR_Data_Access* access, Primitive_Type* primitive_type)
+{
+    Type_Signature* signature = ir_data_access_get_type(access);
+    if (signature->type != Signature_Type::PRIMITIVE) {
+        return false;
+    }
+    *primitive_type = signature->primitive_type;
+    return true;
+}
+
+void ir_optimizer_fold_instruction(IR_Optimizer* optimizer, IR_Instruction* instr)
+{
+    byte result[8];
+    switch (instr->type)
+    {
+    case IR_Instruction_Type::BINARY_OP:
+    {
+        IR_Instruction_Binary_OP* binary_op = &instr->options.binary_op;
+        byte* left = ir_optimizer_get_primitive_constant(&binary_op->operand_left);
+        byte* right = ir_optimizer_get_primitive_constant(&binary_op->operand_right);
+        Primitive_Type operand_type;
+        Primitive_Type result_type;
+        if (left == 0 || right == 0 ||
+            !ir_optimizer_access_is_primitive(&binary_op->operand_left, &operand_type) ||
+            !ir_optimizer_access_is_primitive(&binary_op->destination, &result_type)) {
+            return;
+        }
+        bool result_is_bool = binary_op->type >= IR_Instruction_Binary_OP_Type::EQUAL;
+        if (result_type != (result_is_bool ? Primitive_Type::BOOLEAN : operand_type)) {
+            return;
+        }
+        if (ir_optimizer_fold_binary_op(binary_op->type, operand_type, left, right, result)) {
+            ir_optimizer_replace_with_constant_move(optimizer, instr, binary_op->destination, result);
+        }
+        break;
+    }
+    case IR_Instruction_Type::UNARY_OP:
+    {
+        IR_Instruction_Unary_OP* unary_op = &instr->options.unary_op;
+        byte* source = ir_optimizer_get_primitive_constant(&unary_op->source);
+        Primitive_Type operand_type;
+        Primitive_Type result_type;
+        if (source == 0 ||
+            !ir_optimizer_access_is_primitive(&unary_op->source, &operand_type) ||
+            !ir_optimizer_access_is_primitive(&unary_op->destination, &result_type) || operand_type != result_type) {
+            return;
+        }
+        if (ir_optimizer_fold_unary_op(unary_op->type, operand_type, source, result)) {
+            ir_optimizer_replace_with_constant_move(optimizer, instr, unary_op->destination, result);
+        }
+        break;
+    }
+    case IR_Instruction_Type::CAST:
+    {
+        IR_Instruction_Cast* cast = &instr->options.cast;
+        if (cast->type != IR_Instruction_Cast_Type::PRIMITIVE_TYPES) return;
+        byte* source = ir_optimizer_get_primitive_constant(&cast->source);
+        Primitive_Type source_type;
+        Primitive_Type destination_type;
+        if (source == 0 ||
+            !ir_optimizer_access_is_primitive(&cast->source, &source_type) ||
+            !ir_optimizer_access_is_primitive(&cast->destination, &destination_type)) {
+            return;
+        }
+        if (ir_optimizer_fold_cast(source_type, destination_type, source, result)) {
+            ir_optimizer_replace_with_constant_move(optimizer, instr, cast->destination, result);
+        }
+        break;
+    }
+    }
+}
+
+
+
+/*
+    Propagation and branch removal
+*/
+void ir_optimizer_propagate_access(IR_Optimizer* optimizer, IR_Data_Access* access)
+{
+    if (access->is_memory_access) return;
+    IR_Optimizer_Register* reg = ir_optimizer_get_register(optimizer, access);
+    if (reg != 0 && reg->is_constant) {
+        *access = reg->constant_access;
+        reg->replaced_read_count++;
+        optimizer->statistics.propagated_access_count++;
+    }
+}
+
+// Returns -1 if the condition is not constant, otherwise 0 or 1
+int ir_optimizer_get_constant_condition(IR_Data_Access* condition)
+{
+    byte* value = ir_optimizer_get_primitive_constant(condition);
+    if (value == 0) {
+        return -1;
+    }
+    return *value != 0 ? 1 : 0;
+}
+
+void ir_optimizer_optimize_code_block(IR_Optimizer* optimizer, IR_Code_Block* code_block)
+{
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::FUNCTION_CALL:
+        {
+            IR_Instruction_Call* call = &instr->options.call;
+            if (call->call_type == IR_Instruction_Call_Type::FUNCTION_POINTER_CALL) {
+                ir_optimizer_propagate_access(optimizer, &call->options.pointer_access);
+            }
+            for (int j = 0; j < call->arguments.size; j++) {
+                ir_optimizer_propagate_access(optimizer, &call->arguments[j]);
+            }
+            break;
+        }
+        case IR_Instruction_Type::IF:
+        {
+            // Dropped branches stay in the IR allocator until the next full analysis
+            IR_Instruction_If* if_instr = &instr->options.if_instr;
+            ir_optimizer_propagate_access(optimizer, &if_instr->condition);
+            int condition = ir_optimizer_get_constant_condition(&if_instr->condition);
+            if (condition == -1) {
+                ir_optimizer_optimize_code_block(optimizer, if_instr->true_branch);
+                ir_optimizer_optimize_code_block(optimizer, if_instr->false_branch);
+                break;
+            }
+            IR_Code_Block* taken_branch = condition == 1 ? if_instr->true_branch : if_instr->false_branch;
+            instr->type = IR_Instruction_Type::BLOCK;
+            instr->options.block = taken_branch;
+            optimizer->statistics.removed_branch_count++;
+            ir_optimizer_optimize_code_block(optimizer, taken_branch);
+            break;
+        }
+        case IR_Instruction_Type::WHILE:
+        {
+            IR_Instruction_While* while_instr = &instr->options.while_instr;
+            ir_optimizer_optimize_code_block(optimizer, while_instr->condition_code);
+            ir_optimizer_propagate_access(optimizer, &while_instr->condition_access);
+            if (ir_optimizer_get_constant_condition(&while_instr->condition_access) == 0) {
+                IR_Code_Block* condition_code = while_instr->condition_code;
+                instr->type = IR_Instruction_Type::BLOCK;
+                instr->options.block = condition_code;
+                optimizer->statistics.removed_branch_count++;
+                break;
+            }
+            ir_optimizer_optimize_code_block(optimizer, while_instr->code);
+            break;
+        }
+        case IR_Instruction_Type::BLOCK:
+            ir_optimizer_optimize_code_block(optimizer, instr->options.block);
+            break;
+        case IR_Instruction_Type::BREAK:
+        case IR_Instruction_Type::CONTINUE:
+            break;
+        case IR_Instruction_Type::RETURN:
+            if (instr->options.return_instr.type == IR_Instruction_Return_Type::RETURN_DATA) {
+                ir_optimizer_propagate_access(optimizer, &instr->options.return_instr.options.return_value);
+            }
+            break;
+        case IR_Instruction_Type::MOVE:
+            ir_optimizer_propagate_access(optimizer, &instr->options.move.source);
+            break;
+        case IR_Instruction_Type::CAST:
+            ir_optimizer_propagate_access(optimizer, &instr->options.cast.source);
+            ir_optimizer_fold_instruction(optimizer, instr);
+            break;
+        case IR_Instruction_Type::ADDRESS_OF:
+            if (instr->options.address_of.type == IR_Instruction_Address_Of_Type::ARRAY_ELEMENT) {
+                ir_optimizer_propagate_access(optimizer, &instr->options.address_of.options.index_access);
+            }
+            break;
+        case IR_Instruction_Type::UNARY_OP:
+            ir_optimizer_propagate_access(optimizer, &instr->options.unary_op.source);
+            ir_optimizer_fold_instruction(optimizer, instr);
+            break;
+        case IR_Instruction_Type::BINARY_OP:
+            ir_optimizer_propagate_access(optimizer, &instr->options.binary_op.operand_left);
+            ir_optimizer_propagate_access(optimizer, &instr->options.binary_op.operand_right);
+            ir_optimizer_fold_instruction(optimizer, instr);
+            break;
+        default: panic("Lul");
+        }
+
+        // Constant moves into registers of this block are visible to all following instructions
+        if (instr->type == IR_Instruction_Type::MOVE)
+        {
+            IR_Instruction_Move* move = &instr->options.move;
+            if (move->destination.type == IR_Data_Access_Type::REGISTER && !move->destination.is_memory_access &&
+                move->destination.option.definition_block == code_block &&
+                ir_optimizer_get_primitive_constant(&move->source) != 0)
+            {
+                IR_Optimizer_Register* reg = ir_optimizer_get_register(optimizer, &move->destination);
+                if (reg->write_count == 1 && !reg->address_taken) {
+                    reg->is_constant = true;
+                    reg->constant_access = move->source;
+                }
+            }
+        }
+    }
+}
+
+void ir_optimizer_remove_dead_moves(IR_Optimizer* optimizer, IR_Code_Block* code_block)
+{
+    int write_index = 0;
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::IF:
+            ir_optimizer_remove_dead_moves(optimizer, instr->options.if_instr.true_branch);
+            ir_optimizer_remove_dead_moves(optimizer, instr->options.if_instr.false_branch);
+            break;
+        case IR_Instruction_Type::WHILE:
+            ir_optimizer_remove_dead_moves(optimizer, instr->options.while_instr.condition_code);
+            ir_optimizer_remove_dead_moves(optimizer, instr->options.while_instr.code);
+            break;
+        case IR_Instruction_Type::BLOCK:
+            ir_optimizer_remove_dead_moves(optimizer, instr->options.block);
+            break;
+        case IR_Instruction_Type::MOVE: {
+            IR_Optimizer_Register* reg = 0;
+            if (!instr->options.move.destination.is_memory_access) {
+                reg = ir_optimizer_get_register(optimizer, &instr->options.move.destination);
+            }
+            if (reg != 0 && reg->is_constant && reg->replaced_read_count == reg->read_count) {
+                optimizer->statistics.removed_move_count++;
+                continue;
+            }
+            break;
+        }
+        }
+        code_block->instructions[write_index] = *instr;
+        write_index++;
+    }
+    code_block->instructions.size = write_index;
+}
+
+IR_Optimizer_Statistics ir_optimizer_optimize(IR_Program* program)
+{
+    IR_Optimizer optimizer;
+    optimizer.program = program;
+    optimizer.register_offsets = hashtable_create_empty<IR_Code_Block*, int, Hasher_Pointer<IR_Code_Block*>>(64);
+    optimizer.registers = dynamic_array_create_empty<IR_Optimizer_Register>(256);
+    SCOPE_EXIT(hashtable_destroy(&optimizer.register_offsets));
+    SCOPE_EXIT(dynamic_array_destroy(&optimizer.registers));
+    optimizer.statistics.folded_instruction_count = 0;
+    optimizer.statistics.propagated_access_count = 0;
+    optimizer.statistics.removed_branch_count = 0;
+    optimizer.statistics.removed_move_count = 0;
+
+    for (int i = 0; i < program->functions.size; i++)
+    {
+        IR_Function* function = program->functions[i];
+        hashtable_reset(&optimizer.register_offsets);
+        dynamic_array_reset(&optimizer.registers);
+        ir_optimizer_collect_code_block(&optimizer, function->code);
+        ir_optimizer_optimize_code_block(&optimizer, function->code);
+        ir_optimizer_remove_dead_moves(&optimizer, function->code);
+    }
+    return optimizer.statistics;
+}
+
+
+
+/*
+    Inlining
+*/
+const int IR_INLINER_MAX_ROUNDS = 4;
+
+struct IR_Inliner
+{
+    IR_Program* program;
+    IR_Function* callee;
+    Hashtable<IR_Code_Block*, IR_Code_Block*, Hasher_Pointer<IR_Code_Block*>> block_mapping; // Callee block -> Copy
+    IR_Code_Block* parameter_block;
+    int parameter_register_base;
+};
+
+// Callees are leaves with a single return at the end, so the copied body can simply fall through to the code after the call.
+// Loops are not inlined, their call overhead is small compared to the loop itself
+bool ir_inliner_code_block_is_inlinable(IR_Code_Block* code_block, bool is_function_body)
+{
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::FUNCTION_CALL:
+            if (instr->options.call.call_type != IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL) return false;
+            break;
+        case IR_Instruction_Type::IF:
+            if (!ir_inliner_code_block_is_inlinable(instr->options.if_instr.true_branch, false)) return false;
+            if (!ir_inliner_code_block_is_inlinable(instr->options.if_instr.false_branch, false)) return false;
+            break;
+        case IR_Instruction_Type::BLOCK:
+            if (!ir_inliner_code_block_is_inlinable(instr->options.block, false)) return false;
+            break;
+        case IR_Instruction_Type::WHILE:
+        case IR_Instruction_Type::BREAK:
+        case IR_Instruction_Type::CONTINUE:
+            return false;
+        case IR_Instruction_Type::RETURN:
+            if (!is_function_body || i != code_block->instructions.size - 1) return false;
+            if (instr->options.return_instr.type == IR_Instruction_Return_Type::EXIT) return false;
+            break;
+        }
+    }
+    return true;
+}
+
+IR_Data_Access ir_inliner_map_access(IR_Inliner* inliner, IR_Data_Access access)
+{
+    if (access.type == IR_Data_Access_Type::REGISTER) {
+        IR_Code_Block** copy = hashtable_find_element(&inliner->block_mapping, access.option.definition_block);
+        assert(copy != 0, "Register of a block outside of the callee");
+        access.option.definition_block = *copy;
+    }
+    else if (access.type == IR_Data_Access_Type::PARAMETER && access.option.function == inliner->callee) {
+        access.type = IR_Data_Access_Type::REGISTER;
+        access.option.definition_block = inliner->parameter_block;
+        access.index = inliner->parameter_register_base + access.index;
+    }
+    return access;
+}
+
+IR_Code_Block* ir_inliner_copy_code_block(IR_Inliner* inliner, IR_Code_Block* code_block, IR_Code_Block* copy, int instruction_count);
+IR_Code_Block* ir_inliner_copy_nested_block(IR_Inliner* inliner, IR_Code_Block* code_block, IR_Function* caller)
+{
+    IR_Code_Block* copy = ir_code_block_create(caller, inliner->program->allocator);
+    return ir_inliner_copy_code_block(inliner, code_block, copy, code_block->instructions.size);
+}
+
+// Appends registers and the first instruction_count instructions of code_block to copy
+IR_Code_Block* ir_inliner_copy_code_block(IR_Inliner* inliner, IR_Code_Block* code_block, IR_Code_Block* copy, int instruction_count)
+{
+    hashtable_insert_element(&inliner->block_mapping, code_block, copy);
+    for (int i = 0; i < code_block->registers.size; i++) {
+        dynamic_array_push_back(&copy->registers, code_block->registers[i]);
+    }
+    IR_Function* caller = copy->function;
+    for (int i = 0; i < instruction_count; i++)
+    {
+        IR_Instruction instr = code_block->instructions[i];
+        switch (instr.type)
+        {
+        case IR_Instruction_Type::FUNCTION_CALL:
+        {
+            IR_Instruction_Call* call = &instr.options.call;
+            Dynamic_Array<IR_Data_Access> arguments = dynamic_array_create_empty<IR_Data_Access>(
+                math_maximum(call->arguments.size, 1), inliner->program->allocator
+            );
+            for (int j = 0; j < call->arguments.size; j++) {
+                dynamic_array_push_back(&arguments, ir_inliner_map_access(inliner, call->arguments[j]));
+            }
+            call->arguments = arguments;
+            if (ir_instruction_call_get_return_type(call)->type != Signature_Type::VOID_TYPE) {
+                call->destination = ir_inliner_map_access(inliner, call->destination);
+            }
+            break;
+        }
+        case IR_Instruction_Type::IF:
+            instr.options.if_instr.condition = ir_inliner_map_access(inliner, instr.options.if_instr.condition);
+            instr.options.if_instr.true_branch = ir_inliner_copy_nested_block(inliner, instr.options.if_instr.true_branch, caller);
+            instr.options.if_instr.false_branch = ir_inliner_copy_nested_block(inliner, instr.options.if_instr.false_branch, caller);
+            break;
+        case IR_Instruction_Type::BLOCK:
+            instr.options.block = ir_inliner_copy_nested_block(inliner, instr.options.block, caller);
+            break;
+        case IR_Instruction_Type::MOVE:
+            instr.options.move.destination = ir_inliner_map_access(inliner, instr.options.move.destination);
+            instr.options.move.source = ir_inliner_map_access(inliner, instr.options.move.source);
+            break;
+        case IR_Instruction_Type::CAST:
+            instr.options.cast.destination = ir_inliner_map_access(inliner, instr.options.cast.destination);
+            instr.options.cast.source = ir_inliner_map_access(inliner, instr.options.cast.source);
+            break;
+        case IR_Instruction_Type::ADDRESS_OF:
+        {
+            IR_Instruction_Address_Of* address_of = &instr.options.address_of;
+            address_of->destination = ir_inliner_map_access(inliner, address_of->destination);
+            if (address_of->type != IR_Instruction_Address_Of_Type::FUNCTION) {
+                address_of->source = ir_inliner_map_access(inliner, address_of->source);
+            }
+            if (address_of->type == IR_Instruction_Address_Of_Type::ARRAY_ELEMENT) {
+                address_of->options.index_access = ir_inliner_map_access(inliner, address_of->options.index_access);
+            }
+            break;
+        }
+        case IR_Instruction_Type::UNARY_OP:
+            instr.options.unary_op.destination = ir_inliner_map_access(inliner, instr.options.unary_op.destination);
+            instr.options.unary_op.source = ir_inliner_map_access(inliner, instr.options.unary_op.source);
+            break;
+        case IR_Instruction_Type::BINARY_OP:
+            instr.options.binary_op.destination = ir_inliner_map_access(inliner, instr.options.binary_op.destination);
+            instr.options.binary_op.operand_left = ir_inliner_map_access(inliner, instr.options.binary_op.operand_left);
+            instr.options.binary_op.operand_right = ir_inliner_map_access(inliner, instr.options.binary_op.operand_right);
+            break;
+        default: panic("Not inlinable, see ir_inliner_code_block_is_inlinable");
+        }
+        dynamic_array_push_back(&copy->instructions, instr);
+    }
+    return copy;
+}
+
+// Returns a block that moves the arguments into parameter registers, runs the callee body and moves the return value into the call destination
+IR_Code_Block* ir_inliner_inline_call(IR_Inliner* inliner, IR_Function* caller, IR_Instruction_Call* call)
+{
+    IR_Function* callee = call->options.function;
+    IR_Code_Block* body = callee->code;
+    inliner->callee = callee;
+    hashtable_reset(&inliner->block_mapping);
+
+    IR_Code_Block* block = ir_code_block_create(caller, inliner->program->allocator);
+    inliner->parameter_block = block;
+    inliner->parameter_register_base = body->registers.size;
+    for (int i = 0; i < callee->function_type->parameter_types.size; i++)
+    {
+        IR_Instruction move;
+        move.type = IR_Instruction_Type::MOVE;
+        move.options.move.destination.type = IR_Data_Access_Type::REGISTER;
+        move.options.move.destination.is_memory_access = false;
+        move.options.move.destination.option.definition_block = block;
+        move.options.move.destination.index = inliner->parameter_register_base + i;
+        move.options.move.source = call->arguments[i];
+        dynamic_array_push_back(&block->instructions, move);
+    }
+    // Registers of the body come first, then the parameters
+    ir_inliner_copy_code_block(inliner, body, block, body->instructions.size - 1);
+    for (int i = 0; i < callee->function_type->parameter_types.size; i++) {
+        dynamic_array_push_back(&block->registers, callee->function_type->parameter_types[i]);
+    }
+
+    IR_Instruction_Return* return_instr = &body->instructions[body->instructions.size - 1].options.return_instr;
+    if (return_instr->type == IR_Instruction_Return_Type::RETURN_DATA) {
+        IR_Instruction move;
+        move.type = IR_Instruction_Type::MOVE;
+        move.options.move.destination = call->destination;
+        move.options.move.source = ir_inliner_map_access(inliner, return_instr->options.return_value);
+        dynamic_array_push_back(&block->instructions, move);
+    }
+    return block;
+}
+
+void ir_inliner_add_inlined_function(IR_Function* caller, IR_Function* function)
+{
+    for (int i = 0; i < caller->inlined_functions.size; i++) {
+        if (caller->inlined_functions[i] == function) return;
+    }
+    dynamic_array_push_back(&caller->inlined_functions, function);
+}
+
+int ir_inliner_inline_calls_in_block(IR_Inliner* inliner, IR_Function* caller, IR_Code_Block* code_block,
+    Hashtable<IR_Function*, bool, Hasher_Pointer<IR_Function*>>* inlinable_functions)
+{
+    int inlined_count = 0;
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::FUNCTION_CALL:
+        {
+            IR_Instruction_Call* call = &instr->options.call;
+            if (call->call_type != IR_Instruction_Call_Type::FUNCTION_CALL ||
+                hashtable_find_element(inlinable_functions, call->options.function) == 0) {
+                break;
+            }
+            IR_Function* callee = call->options.function;
+            IR_Code_Block* block = ir_inliner_inline_call(inliner, caller, call);
+            instr->type = IR_Instruction_Type::BLOCK;
+            instr->options.block = block;
+            ir_inliner_add_inlined_function(caller, callee);
+            for (int j = 0; j < callee->inlined_functions.size; j++) {
+                ir_inliner_add_inlined_function(caller, callee->inlined_functions[j]);
+            }
+            inlined_count++;
+            break;
+        }
+        case IR_Instruction_Type::IF:
+            inlined_count += ir_inliner_inline_calls_in_block(inliner, caller, instr->options.if_instr.true_branch, inlinable_functions);
+            inlined_count += ir_inliner_inline_calls_in_block(inliner, caller, instr->options.if_instr.false_branch, inlinable_functions);
+            break;
+        case IR_Instruction_Type::WHILE:
+            inlined_count += ir_inliner_inline_calls_in_block(inliner, caller, instr->options.while_instr.condition_code, inlinable_functions);
+            inlined_count += ir_inliner_inline_calls_in_block(inliner, caller, instr->options.while_instr.code, inlinable_functions);
+            break;
+        case IR_Instruction_Type::BLOCK:
+            inlined_count += ir_inliner_inline_calls_in_block(inliner, caller, instr->options.block, inlinable_functions);
+            break;
+        }
+    }
+    return inlined_count;
+}
+
+int ir_optimizer_inline_functions(Semantic_Analyser* analyser, int instruction_budget)
+{
+    IR_Program* program = analyser->program;
+    IR_Inliner inliner;
+    inliner.program = program;
+    inliner.block_mapping = hashtable_create_empty<IR_Code_Block*, IR_Code_Block*, Hasher_Pointer<IR_Code_Block*>>(16);
+    SCOPE_EXIT(hashtable_destroy(&inliner.block_mapping));
+    Hashtable<IR_Function*, bool, Hasher_Pointer<IR_Function*>> inlinable_functions =
+        hashtable_create_empty<IR_Function*, bool, Hasher_Pointer<IR_Function*>>(64);
+    SCOPE_EXIT(hashtable_destroy(&inlinable_functions));
+
+    // Each round callers whose calls were all inlined may become inlinable leaves themselves, recursive functions never do
+    int inlined_count = 0;
+    for (int round = 0; round < IR_INLINER_MAX_ROUNDS; round++)
+    {
+        hashtable_reset(&inlinable_functions);
+        for (int i = 0; i < program->functions.size; i++)
+        {
+            IR_Function* function = program->functions[i];
+            if (function == program->entry_function || function == analyser->global_init_function) continue;
+            IR_Code_Block* body = function->code;
+            if (body->instructions.size == 0 || body->instructions[body->instructions.size - 1].type != IR_Instruction_Type::RETURN) continue;
+            if (ir_code_block_count_instructions(body) <= instruction_budget && ir_inliner_code_block_is_inlinable(body, true)) {
+                hashtable_insert_element(&inlinable_functions, function, true);
+            }
+        }
+        if (inlinable_functions.element_count == 0) break;
+
+        int round_inlined_count = 0;
+        for (int i = 0; i < program->functions.size; i++) {
+            IR_Function* function = program->functions[i];
+            round_inlined_count += ir_inliner_inline_calls_in_block(&inliner, function, function->code, &inlinable_functions);
+        }
+        inlined_count += round_inlined_count;
+        if (round_inlined_count == 0) break;
+    }
+    return inlined_count;
+}
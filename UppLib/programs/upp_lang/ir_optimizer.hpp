@@ -0,0 +1,35 @@
+#pragma once
+
+struct IR_Program;
+struct Semantic_Analyser;
+
+struct IR_Optimizer_Statistics
+{
+    int folded_instruction_count;
+    int propagated_access_count;
+    int removed_branch_count;
+    int removed_move_count;
+};
+
+/*
+    Pass over the IR_Program, runs after semantic analysis and before bytecode/C generation.
+    Per function it does:
+        - Constant folding of Binary_OP, Unary_OP and primitive Casts with constant operands (Result is a new constant)
+        - Constant propagation through registers that are written exactly once with a constant and whose address is never taken,
+          only reads after the write inside the defining block are replaced, so the write always executes before them
+        - If with a constant condition is replaced by the taken branch, While with a constant false condition by its condition code
+        - Moves into registers are removed once all reads of the register were replaced
+    Folding follows the semantics of the bytecode interpreter, division and modulo by zero or -1 are never folded.
+    The pass can run multiple times over the same IR (Incremental compilation keeps the IR of unchanged functions).
+*/
+IR_Optimizer_Statistics ir_optimizer_optimize(IR_Program* program);
+
+/*
+    Replaces calls to small functions with a block containing a copy of the function body.
+    Parameters become registers of that block, which are initialized with the call arguments.
+    Only leaf functions (Calls to hardcoded functions are allowed) with at most instruction_budget instructions,
+    no loops and a single return at the end are inlined. This is repeated a few rounds, so that callers which
+    are leaves after inlining get inlined as well. Inlined functions are recorded in IR_Function::inlined_functions,
+    which the incremental analysis uses to invalidate the callers. Returns the number of inlined calls.
+*/
+int ir_optimizer_inline_functions(Semantic_Analyser* analyser, int instruction_budget);
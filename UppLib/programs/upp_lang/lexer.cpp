@@ -1,6 +1,116 @@
 #include "lexer.hpp"
 
 #include "../../utility/hash_functions.hpp"
+#include "../../math/scalars.hpp"
+#include "../../utility/file_io.hpp"
+#include "../../win32/timing.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define LEXER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Character classes of the lookup table, a byte can be in multiple classes
+const u8 CHARACTER_CLASS_LETTER = 1;
+const u8 CHARACTER_CLASS_DIGIT = 2;
+const u8 CHARACTER_CLASS_IDENTIFIER = 4; // Letters, digits and underscore
+const u8 CHARACTER_CLASS_WHITESPACE = 8; // Without newline
+const u8 CHARACTER_CLASS_SINGLE_TOKEN = 16; // Always a token of length 1, see lexer_single_character_tokens
+const u8 CHARACTER_CLASS_ERROR_DELIMITER = 32; // Ends an error token
+const u8 CHARACTER_CLASS_SKIPPABLE_START = 64; // Whitespace, newline or a slash that may start a comment
+
+static u8 lexer_character_classes[256];
+static Token_Type lexer_single_character_tokens[256];
+static bool lexer_character_table_initialized = false;
+
+void lexer_initialize_character_table()
+{
+    if (lexer_character_table_initialized) return;
+    lexer_character_table_initialized = true;
+    for (int i = 0; i < 256; i++) {
+        lexer_character_classes[i] = 0;
+        lexer_single_character_tokens[i] = Token_Type::ERROR_TOKEN;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+        lexer_character_classes[c] |= CHARACTER_CLASS_LETTER | CHARACTER_CLASS_IDENTIFIER;
+    }
+    for (int c = 'A'; c <= 'Z'; c++) {
+        lexer_character_classes[c] |= CHARACTER_CLASS_LETTER | CHARACTER_CLASS_IDENTIFIER;
+    }
+    for (int c = '0'; c <= '9'; c++) {
+        lexer_character_classes[c] |= CHARACTER_CLASS_DIGIT | CHARACTER_CLASS_IDENTIFIER;
+    }
+    lexer_character_classes['_'] |= CHARACTER_CLASS_IDENTIFIER;
+    lexer_character_classes[' '] |= CHARACTER_CLASS_WHITESPACE;
+    lexer_character_classes['\t'] |= CHARACTER_CLASS_WHITESPACE;
+    lexer_character_classes['\r'] |= CHARACTER_CLASS_WHITESPACE;
+    const char* skippable_starts = " \t\r\n/";
+    for (int i = 0; skippable_starts[i] != 0; i++) {
+        lexer_character_classes[(u8)skippable_starts[i]] |= CHARACTER_CLASS_SKIPPABLE_START;
+    }
+
+    const char* delimiters = ";,.(){}[]=+*%-/\n \r\t!";
+    for (int i = 0; delimiters[i] != 0; i++) {
+        lexer_character_classes[(u8)delimiters[i]] |= CHARACTER_CLASS_ERROR_DELIMITER;
+    }
+
+    struct Single_Character_Token { char c; Token_Type type; };
+    Single_Character_Token single_tokens[] = {
+        {'.', Token_Type::DOT}, {';', Token_Type::SEMICOLON}, {',', Token_Type::COMMA},
+        {'(', Token_Type::OPEN_PARENTHESIS}, {')', Token_Type::CLOSED_PARENTHESIS},
+        {'{', Token_Type::OPEN_BRACES}, {'}', Token_Type::CLOSED_BRACES},
+        {'[', Token_Type::OPEN_BRACKETS}, {']', Token_Type::CLOSED_BRACKETS},
+        {'+', Token_Type::OP_PLUS}, {'*', Token_Type::OP_STAR}, {'/', Token_Type::OP_SLASH}, {'%', Token_Type::OP_PERCENT},
+    };
+    int single_token_count = (int)(sizeof(single_tokens) / sizeof(Single_Character_Token));
+    for (int i = 0; i < single_token_count; i++) {
+        lexer_character_classes[(u8)single_tokens[i].c] |= CHARACTER_CLASS_SINGLE_TOKEN;
+        lexer_single_character_tokens[(u8)single_tokens[i].c] = single_tokens[i].type;
+    }
+}
+
+#ifdef LEXER_USE_SSE2
+// Returns a mask where bit i is set if data[i] is in the character class (Only digit, whitespace and identifier runs)
+u32 lexer_match_character_class_16(const char* data, u8 character_class)
+{
+    __m128i bytes = _mm_loadu_si128((__m128i*)data);
+    // Signed compares, so bytes >= 128 are negative and never inside a range
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1)));
+    if (character_class == CHARACTER_CLASS_DIGIT) {
+        return (u32)_mm_movemask_epi8(digits);
+    }
+    if (character_class == CHARACTER_CLASS_WHITESPACE) {
+        __m128i matches = _mm_or_si128(
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')))
+        );
+        return (u32)_mm_movemask_epi8(matches);
+    }
+    // Identifier class, setting bit 5 maps upper case to lower case letters
+    __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i matches = _mm_or_si128(_mm_or_si128(letters, digits), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_')));
+    return (u32)_mm_movemask_epi8(matches);
+}
+#endif
+
+// Returns the index of the first character at or after index that is not in the character class
+int lexer_skip_character_class(String* code, int index, u8 character_class)
+{
+#ifdef LEXER_USE_SSE2
+    while (index + 16 <= code->size) {
+        u32 mismatches = ~lexer_match_character_class_16(code->characters + index, character_class) & 0xFFFF;
+        if (mismatches != 0) {
+            return index + hashtable_mask_lowest_bit_index(mismatches);
+        }
+        index += 16;
+    }
+#endif
+    while (index < code->size && (lexer_character_classes[(u8)code->characters[index]] & character_class) != 0) {
+        index++;
+    }
+    return index;
+}
 
 bool token_type_is_keyword(Token_Type type)
 {
@@ -121,7 +231,7 @@ Token token_make_with_slice(Token_Type type, Token_Attribute attribute, Text_Sli
     return result;
 }
 
-bool code_parse_comments(Lexer* lexer, String* code, int* index, int* character_pos, int* line_number)
+bool code_parse_comments(Dynamic_Array<Token>* tokens, String* code, int* index, int* character_pos, int* line_number)
 {
     if (*index + 1 >= code->size) return false;
     // Single line comments
@@ -137,7 +247,7 @@ bool code_parse_comments(Lexer* lexer, String* code, int* index, int* character_
         *index = *index + 1;
         *character_pos = 0;
         *line_number = *line_number + 1;
-        dynamic_array_push_back(&lexer->tokens, token_make(
+        dynamic_array_push_back(tokens, token_make(
             Token_Type::COMMENT, 
             token_attribute_make_empty(), 
             text_slice_make(text_position_make(line_start, start_char), text_position_make(*line_number, 0)),
@@ -190,7 +300,7 @@ bool code_parse_comments(Lexer* lexer, String* code, int* index, int* character_
             }
             *index = *index + 1;
         }
-        dynamic_array_push_back(&lexer->tokens, token_make(
+        dynamic_array_push_back(tokens, token_make(
             Token_Type::COMMENT, 
             token_attribute_make_empty(), 
             text_slice_make(text_position_make(line_start, start_char), text_position_make(*line_number, *character_pos)),
@@ -201,12 +311,12 @@ bool code_parse_comments(Lexer* lexer, String* code, int* index, int* character_
     return false;
 }
 
-bool code_parse_newline(Lexer* lexer, String* code, int* index, int* character_pos, int* line_number)
+bool code_parse_newline(Dynamic_Array<Token>* tokens, String* code, int* index, int* character_pos, int* line_number)
 {
     int i = *index;
     if (i < code->size && code->characters[i] == '\n') 
     {
-        dynamic_array_push_back(&lexer->tokens, token_make(
+        dynamic_array_push_back(tokens, token_make(
             Token_Type::NEW_LINE, 
             token_attribute_make_empty(), 
             text_slice_make(text_position_make(*line_number, *character_pos), text_position_make(*line_number+1, 0)),
@@ -220,19 +330,14 @@ bool code_parse_newline(Lexer* lexer, String* code, int* index, int* character_p
     return false;
 }
 
-bool code_parse_whitespace(Lexer* lexer, String* code, int* index, int* character_pos, int* line_number)
+bool code_parse_whitespace(Dynamic_Array<Token>* tokens, String* code, int* index, int* character_pos, int* line_number)
 {
     int start = *index;
     int char_start = *character_pos;
-    bool changed = false;
-    while (*index < code->size && string_contains_character(string_create_static("\t \r"), code->characters[*index]))
-    {
-        (*character_pos)++;
-        *index = *index + 1;
-        changed = true;
-    }
-    if (changed) {
-        dynamic_array_push_back(&lexer->tokens, token_make(
+    *index = lexer_skip_character_class(code, start, CHARACTER_CLASS_WHITESPACE);
+    *character_pos += *index - start;
+    if (*index != start) {
+        dynamic_array_push_back(tokens, token_make(
             Token_Type::WHITESPACE, token_attribute_make_empty(), *line_number, char_start, *character_pos - char_start, start)
         );
         return true;
@@ -240,13 +345,13 @@ bool code_parse_whitespace(Lexer* lexer, String* code, int* index, int* characte
     return false;
 }
 
-void code_skip_whitespace_and_comments(Lexer* lexer, String* code, int* index, int* character_pos, int* line_number)
+void code_skip_whitespace_and_comments(Dynamic_Array<Token>* tokens, String* code, int* index, int* character_pos, int* line_number)
 {
-    while (true)
+    while (*index < code->size && (lexer_character_classes[(u8)code->characters[*index]] & CHARACTER_CLASS_SKIPPABLE_START) != 0)
     {
-        if (code_parse_comments(lexer, code, index, character_pos, line_number)) continue;
-        if (code_parse_newline(lexer, code, index, character_pos, line_number)) continue;
-        if (code_parse_whitespace(lexer, code, index, character_pos, line_number)) continue;
+        if (code_parse_comments(tokens, code, index, character_pos, line_number)) continue;
+        if (code_parse_newline(tokens, code, index, character_pos, line_number)) continue;
+        if (code_parse_whitespace(tokens, code, index, character_pos, line_number)) continue;
         break;
     }
 }
@@ -268,7 +373,11 @@ int lexer_add_or_find_identifier_by_string(Lexer* lexer, String identifier)
         return *identifier_id;
     }
     else {
-        String identifier_string_copy = string_create(identifier.characters);
+        // Identifier may point into the source code, so it is not null terminated
+        String identifier_string_copy = string_create_empty(identifier.size + 1, lexer->identifier_allocator);
+        memory_copy(identifier_string_copy.characters, identifier.characters, identifier.size);
+        identifier_string_copy.characters[identifier.size] = 0;
+        identifier_string_copy.size = identifier.size;
         dynamic_array_push_back(&lexer->identifiers, identifier_string_copy);
         int index = lexer->identifiers.size - 1;
         hashtable_insert_element(&lexer->identifier_index_lookup_table, identifier_string_copy, index);
@@ -279,12 +388,14 @@ int lexer_add_or_find_identifier_by_string(Lexer* lexer, String identifier)
 Lexer lexer_create()
 {
     Lexer lexer;
-    lexer.identifier_index_lookup_table = hashtable_create_empty<String, int>(2048, &hash_string, &string_equals);
+    lexer.identifier_index_lookup_table = hashtable_create_empty<String, int, Hasher_String>(2048);
     lexer.identifiers = dynamic_array_create_empty<String>(1024);
     lexer.tokens = dynamic_array_create_empty<Token>(1024);
     lexer.tokens_with_whitespaces = dynamic_array_create_empty<Token>(1024);
+    lexer.identifier_allocator = 0;
+    lexer_initialize_character_table();
 
-    lexer.keywords = hashtable_create_empty<String, Token_Type>(64, &hash_string, &string_equals);
+    lexer.keywords = hashtable_create_empty<String, Token_Type, Hasher_String>(64);
     hashtable_insert_element(&lexer.keywords, string_create_static("if"), Token_Type::IF);
     hashtable_insert_element(&lexer.keywords, string_create_static("else"), Token_Type::ELSE);
     hashtable_insert_element(&lexer.keywords, string_create_static("for"), Token_Type::FOR);
@@ -305,24 +416,18 @@ Lexer lexer_create()
     return lexer;
 }
 
-void lexer_parse_string(Lexer* lexer, String* code)
+// Lexes the whole code into tokens (Including whitespaces and comments), code[0] is at the given line/character
+void lexer_tokenize(Lexer* lexer, Dynamic_Array<Token>* tokens, String* code, int line_number, int character_pos)
 {
     String identifier_string = string_create_empty(256);
     SCOPE_EXIT(string_destroy(&identifier_string));
 
-    dynamic_array_reset(&lexer->tokens);
-    dynamic_array_reset(&lexer->tokens_with_whitespaces);
-    dynamic_array_reset(&lexer->identifiers);
-    hashtable_reset(&lexer->identifier_index_lookup_table);
-
     int index = 0;
-    int character_pos = 0;
-    int line_number = 0;
     bool has_errors = false;
     while (index < code->size)
     {
         // Advance index
-        code_skip_whitespace_and_comments(lexer, code, &index, &character_pos, &line_number);
+        code_skip_whitespace_and_comments(tokens, code, &index, &character_pos, &line_number);
         if (index >= code->size) {
             break;
         }
@@ -334,166 +439,110 @@ void lexer_parse_string(Lexer* lexer, String* code)
             next_character = code->characters[index + 1];
         }
 
-        switch (current_character)
-        {
-            // Check for single symbols
-        case '.':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::DOT, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case ';':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::SEMICOLON, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case ',':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COMMA, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '(':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OPEN_PARENTHESIS, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case ')':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::CLOSED_PARENTHESIS, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '{':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OPEN_BRACES, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '}':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::CLOSED_BRACES, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '[':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OPEN_BRACKETS, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case ']':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::CLOSED_BRACKETS, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '+':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OP_PLUS, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '*':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OP_STAR, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '/':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OP_SLASH, token_attribute_make_empty(), line_number, character_pos, 1, index));
-            character_pos++;
-            index++;
-            continue;
-        case '%':
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OP_PERCENT, token_attribute_make_empty(), line_number, character_pos, 1, index));
+        u8 character_class = lexer_character_classes[(u8)current_character];
+        if (character_class & CHARACTER_CLASS_SINGLE_TOKEN) {
+            dynamic_array_push_back(tokens, token_make(
+                lexer_single_character_tokens[(u8)current_character], token_attribute_make_empty(), line_number, character_pos, 1, index)
+            );
             character_pos++;
             index++;
             continue;
+        }
+
+        switch (current_character)
+        {
             // Check for ambiguities between one and two characters (< and <=, = and ==, ! and !=, ...)
         case '=':
             if (next_character == '=') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COMPARISON_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::COMPARISON_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OP_ASSIGNMENT, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::OP_ASSIGNMENT, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
         case '-':
             if (next_character == '>') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::ARROW, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::ARROW, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::OP_MINUS, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::OP_MINUS, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
         case '<':
             if (next_character == '=') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COMPARISON_LESS_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::COMPARISON_LESS_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COMPARISON_LESS, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::COMPARISON_LESS, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
         case '>':
             if (next_character == '=') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COMPARISON_GREATER_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::COMPARISON_GREATER_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COMPARISON_GREATER, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::COMPARISON_GREATER, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
         case '!':
             if (next_character == '=') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COMPARISON_NOT_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::COMPARISON_NOT_EQUAL, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::LOGICAL_NOT, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::LOGICAL_NOT, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
         case '&':
             if (next_character == '&') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::LOGICAL_AND, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::LOGICAL_AND, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::LOGICAL_BITWISE_AND, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::LOGICAL_BITWISE_AND, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
         case '|':
             if (next_character == '|') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::LOGICAL_OR, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::LOGICAL_OR, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::LOGICAL_BITWISE_OR, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::LOGICAL_BITWISE_OR, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
         case ':':
             if (next_character == ':') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::DOUBLE_COLON, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::DOUBLE_COLON, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
             else if (next_character == '=') {
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::INFER_ASSIGN, token_attribute_make_empty(), line_number, character_pos, 2, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::INFER_ASSIGN, token_attribute_make_empty(), line_number, character_pos, 2, index));
                 index += 2;
                 character_pos += 2;
                 continue;
             }
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::COLON, token_attribute_make_empty(), line_number, character_pos, 1, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::COLON, token_attribute_make_empty(), line_number, character_pos, 1, index));
             character_pos++;
             index++;
             continue;
@@ -568,7 +617,7 @@ void lexer_parse_string(Lexer* lexer, String* code)
             if (!terminated_successfull || invalid_escape_found)
             {
                 has_errors = true;
-                dynamic_array_push_back(&lexer->tokens,
+                dynamic_array_push_back(tokens,
                     token_make_with_slice(Token_Type::ERROR_TOKEN, token_attribute_make_empty(), token_slice,
                         index - string_literal_start_index, string_literal_start_index)
                 );
@@ -582,13 +631,13 @@ void lexer_parse_string(Lexer* lexer, String* code)
                 attribute.identifier_number = *identifier_id;
             }
             else {
-                String identifier_string_copy = string_create(identifier_string.characters);
+                String identifier_string_copy = string_create(identifier_string.characters, lexer->identifier_allocator);
                 dynamic_array_push_back(&lexer->identifiers, identifier_string_copy);
                 attribute.identifier_number = lexer->identifiers.size - 1;
                 hashtable_insert_element(&lexer->identifier_index_lookup_table, identifier_string_copy, attribute.identifier_number);
             }
 
-            dynamic_array_push_back(&lexer->tokens, token_make_with_slice(Token_Type::STRING_LITERAL, attribute,
+            dynamic_array_push_back(tokens, token_make_with_slice(Token_Type::STRING_LITERAL, attribute,
                 token_slice, index - string_literal_start_index, string_literal_start_index));
             continue;
         }
@@ -596,15 +645,11 @@ void lexer_parse_string(Lexer* lexer, String* code)
 
         // Constants, Identifier and Keywords
         // Parse Numbers
-        if (current_character >= '0' && current_character <= '9')
+        if (character_class & CHARACTER_CLASS_DIGIT)
         {
             int pre_comma_start_index = index;
-            int pre_comma_end_index = index;
             // Parse number characters
-            while (pre_comma_end_index < code->size && code->characters[pre_comma_end_index] >= '0' && code->characters[pre_comma_end_index] <= '9') {
-                pre_comma_end_index++;
-            }
-            pre_comma_end_index--;
+            int pre_comma_end_index = lexer_skip_character_class(code, index, CHARACTER_CLASS_DIGIT) - 1;
 
             bool comma_exists = false;
             int post_comma_start_index, post_comma_end_index;
@@ -617,12 +662,7 @@ void lexer_parse_string(Lexer* lexer, String* code)
                     post_comma_start_index = pre_comma_end_index + 1;
                 }
                 else {
-                    post_comma_end_index = post_comma_start_index;
-                    while (post_comma_end_index < code->size &&
-                        code->characters[post_comma_end_index] >= '0' && code->characters[post_comma_end_index] <= '9') {
-                        post_comma_end_index++;
-                    }
-                    post_comma_end_index--;
+                    post_comma_end_index = lexer_skip_character_class(code, post_comma_start_index, CHARACTER_CLASS_DIGIT) - 1;
                 }
             }
 
@@ -653,7 +693,7 @@ void lexer_parse_string(Lexer* lexer, String* code)
                 else {
                     character_length = post_comma_end_index - pre_comma_start_index + 1;
                 }
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::FLOAT_LITERAL, attribute, line_number, character_pos, character_length, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::FLOAT_LITERAL, attribute, line_number, character_pos, character_length, index));
                 index += character_length;
                 character_pos += character_length;
                 continue;
@@ -663,7 +703,7 @@ void lexer_parse_string(Lexer* lexer, String* code)
                 Token_Attribute attribute;
                 attribute.integer_value = int_value;
                 int character_length = pre_comma_end_index - pre_comma_start_index + 1;
-                dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::INTEGER_LITERAL, attribute, line_number, character_pos, character_length, index));
+                dynamic_array_push_back(tokens, token_make(Token_Type::INTEGER_LITERAL, attribute, line_number, character_pos, character_length, index));
                 index += character_length;
                 character_pos += character_length;
                 continue;
@@ -671,80 +711,42 @@ void lexer_parse_string(Lexer* lexer, String* code)
         }
 
         // Identifiers, keywords or error
-        if (!character_is_letter(code->characters[index]))
+        if (!(character_class & CHARACTER_CLASS_LETTER))
         {
             // Error, parse till next Delimiter
             int error_end_index = index;
-            while (error_end_index < code->size && !(
-                code->characters[error_end_index] == ';' ||
-                code->characters[error_end_index] == ',' ||
-                code->characters[error_end_index] == '.' ||
-                code->characters[error_end_index] == '(' ||
-                code->characters[error_end_index] == ')' ||
-                code->characters[error_end_index] == '{' ||
-                code->characters[error_end_index] == '}' ||
-                code->characters[error_end_index] == '[' ||
-                code->characters[error_end_index] == ']' ||
-                code->characters[error_end_index] == '=' ||
-                code->characters[error_end_index] == '+' ||
-                code->characters[error_end_index] == '*' ||
-                code->characters[error_end_index] == '%' ||
-                code->characters[error_end_index] == '-' ||
-                code->characters[error_end_index] == '/' ||
-                code->characters[error_end_index] == '\n' ||
-                code->characters[error_end_index] == ' ' ||
-                code->characters[error_end_index] == '\r' ||
-                code->characters[error_end_index] == '\t' ||
-                code->characters[error_end_index] == '!'
-                )) {
+            while (error_end_index < code->size && !(lexer_character_classes[(u8)code->characters[error_end_index]] & CHARACTER_CLASS_ERROR_DELIMITER)) {
                 error_end_index++;
             }
             has_errors = true;
             error_end_index--;
             int error_length = error_end_index - index + 1;
-            dynamic_array_push_back(&lexer->tokens, token_make(Token_Type::ERROR_TOKEN, token_attribute_make_empty(), line_number, character_pos, error_length, index));
+            dynamic_array_push_back(tokens, token_make(Token_Type::ERROR_TOKEN, token_attribute_make_empty(), line_number, character_pos, error_length, index));
             index += error_length;
             character_pos += error_length;
             continue;
         }
 
-        // Parse identifier/keyword
+        // Parse identifier/keyword, lookups hash the characters in the source code directly
         {
-            int identifier_end_index = index;
-            while (identifier_end_index < code->size && (
-                character_is_letter(code->characters[identifier_end_index]) ||
-                character_is_digit(code->characters[identifier_end_index]) ||
-                code->characters[identifier_end_index] == '_'
-                )) {
-                identifier_end_index++;
-            }
-            identifier_end_index--;
-
-            int identifier_string_length = identifier_end_index - index + 1;
-            string_reserve(&identifier_string, identifier_string_length);
-            memory_copy(identifier_string.characters, code->characters + index, identifier_string_length + 1);
-            identifier_string.size = identifier_string_length;
-            identifier_string.characters[identifier_string.size] = 0;
+            int identifier_end_index = lexer_skip_character_class(code, index, CHARACTER_CLASS_IDENTIFIER);
+            int identifier_string_length = identifier_end_index - index;
+            String identifier_view = string_create_static_with_size(code->characters + index, identifier_string_length);
 
             // Check if identifier is a keyword
-            Token_Type* keyword_type = hashtable_find_element(&lexer->keywords, identifier_string);
+            Token_Type* keyword_type = hashtable_find_element(&lexer->keywords, identifier_view);
             if (keyword_type != nullptr) {
                 Token_Attribute attrib = token_attribute_make_empty();
                 if (*keyword_type == Token_Type::BOOLEAN_LITERAL) {
-                    if (string_equals(&identifier_string, &string_create_static("true"))) {
-                        attrib.bool_value = 1;
-                    }
-                    else {
-                        attrib.bool_value = 0;
-                    }
+                    attrib.bool_value = identifier_view.characters[0] == 't';
                 }
-                dynamic_array_push_back(&lexer->tokens, 
+                dynamic_array_push_back(tokens, 
                     token_make(*keyword_type, attrib, line_number, character_pos, identifier_string_length, index));
             }
             else {
                 Token_Attribute attribute;
-                attribute.identifier_number = lexer_add_or_find_identifier_by_string(lexer, identifier_string);
-                dynamic_array_push_back(&lexer->tokens, 
+                attribute.identifier_number = lexer_add_or_find_identifier_by_string(lexer, identifier_view);
+                dynamic_array_push_back(tokens, 
                     token_make(Token_Type::IDENTIFIER, attribute, line_number, character_pos, identifier_string_length, index));
             }
             index += identifier_string_length;
@@ -752,18 +754,227 @@ void lexer_parse_string(Lexer* lexer, String* code)
         }
     }
 
+}
+
+bool token_type_is_whitespace(Token_Type type) {
+    return type == Token_Type::WHITESPACE || type == Token_Type::NEW_LINE || type == Token_Type::COMMENT;
+}
+
+void lexer_parse_string(Lexer* lexer, String* code, Allocator* identifier_allocator)
+{
+    // Each identifier knows its allocator, so this is a no-op for arena allocated ones
+    for (int i = 0; i < lexer->identifiers.size; i++) {
+        string_destroy(&lexer->identifiers[i]);
+    }
+    lexer->identifier_allocator = identifier_allocator;
+    dynamic_array_reset(&lexer->tokens);
+    dynamic_array_reset(&lexer->tokens_with_whitespaces);
+    dynamic_array_reset(&lexer->identifiers);
+    hashtable_reset(&lexer->identifier_index_lookup_table);
+    // Rough upper estimates of tokens per source byte, so that tokenizing rarely has to grow the arrays
+    dynamic_array_reserve(&lexer->tokens_with_whitespaces, code->size / 2 + 16);
+    dynamic_array_reserve(&lexer->tokens, code->size / 4 + 16);
+
+    lexer_tokenize(lexer, &lexer->tokens_with_whitespaces, code, 0, 0);
+
     // Make tokens with non_whitespaces
-    for (int i = 0; i < lexer->tokens.size; i++) {
-        if (lexer->tokens[i].type == Token_Type::WHITESPACE ||
-            lexer->tokens[i].type == Token_Type::NEW_LINE ||
-            lexer->tokens[i].type == Token_Type::COMMENT) {
-            continue;
+    for (int i = 0; i < lexer->tokens_with_whitespaces.size; i++) {
+        Token* token = &lexer->tokens_with_whitespaces.data[i];
+        if (token_type_is_whitespace(token->type)) continue;
+        dynamic_array_push_back(&lexer->tokens, *token);
+    }
+}
+
+double lexer_benchmark_source(String* content, const char* name, int repetitions)
+{
+    Lexer lexer = lexer_create();
+    SCOPE_EXIT(lexer_destroy(&lexer));
+    Timer timer = timer_make();
+    double time_start = timer_current_time_in_seconds(&timer);
+    for (int i = 0; i < repetitions; i++) {
+        lexer_parse_string(&lexer, content, 0);
+    }
+    double time_end = timer_current_time_in_seconds(&timer);
+
+    double megabytes = (double)content->size * repetitions / (1024.0 * 1024.0);
+    double throughput = megabytes / math_maximum(time_end - time_start, 0.000001);
+    logg("Lexer benchmark: %s (%d bytes, %d tokens) x %d in %3.2fms, %3.2f MB/s\n", name, content->size,
+        lexer.tokens_with_whitespaces.size, repetitions, (time_end - time_start) * 1000, throughput);
+    return throughput;
+}
+
+double lexer_benchmark(const char* filepath, int repetitions)
+{
+    Optional<File_Mapping> mapping = file_io_map_file(filepath);
+    if (!mapping.available) {
+        logg("Lexer benchmark: Could not load file %s\n", filepath);
+        return 0.0;
+    }
+    SCOPE_EXIT(file_io_unmap_file(&mapping.value));
+    String content = file_io_mapping_as_string(&mapping.value);
+    return lexer_benchmark_source(&content, filepath, repetitions);
+}
+
+// Replaces tokens [start, end) with the replacement tokens, the tail after end is moved by the line/index offset
+void lexer_splice_tokens(Dynamic_Array<Token>* tokens, int start, int end, Token* replacement, int replacement_count, int line_offset, int index_offset)
+{
+    int new_size = start + replacement_count + (tokens->size - end);
+    int move_distance = start + replacement_count - end;
+    if (new_size > tokens->capacity) {
+        dynamic_array_reserve(tokens, math_maximum(new_size, tokens->capacity * 2));
+    }
+    if (move_distance > 0) {
+        for (int i = tokens->size - 1; i >= end; i--) {
+            tokens->data[i + move_distance] = tokens->data[i];
+        }
+    }
+    else if (move_distance < 0) {
+        for (int i = end; i < tokens->size; i++) {
+            tokens->data[i + move_distance] = tokens->data[i];
+        }
+    }
+    tokens->size = new_size;
+
+    for (int i = start + replacement_count; i < tokens->size; i++) {
+        Token* token = &tokens->data[i];
+        token->position.start.line += line_offset;
+        token->position.end.line += line_offset;
+        token->source_code_index += index_offset;
+    }
+    for (int i = 0; i < replacement_count; i++) {
+        tokens->data[start + i] = replacement[i];
+    }
+}
+
+// Returns the first token with source_code_index >= index
+int lexer_find_token_by_code_index(Dynamic_Array<Token>* tokens, int index)
+{
+    int low = 0;
+    int high = tokens->size;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (tokens->data[mid].source_code_index < index) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+Token_Change lexer_relex_lines(Lexer* lexer, Dynamic_Array<String>* text, int first_line, int old_end_line, int new_end_line)
+{
+    Dynamic_Array<Token>* old_tokens = &lexer->tokens_with_whitespaces;
+    int line_offset = new_end_line - old_end_line;
+
+    // Start at the first token touching the changed lines. Since tokens tile the code and newline/comment tokens end 
+    // at the start of the next line, this token starts either before first_line or at the start of the code
+    int relex_start = 0;
+    {
+        int high = old_tokens->size;
+        while (relex_start < high) {
+            int mid = (relex_start + high) / 2;
+            if (old_tokens->data[mid].position.end.line < first_line) {
+                relex_start = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        if (relex_start == old_tokens->size && relex_start > 0) {
+            relex_start--;
         }
-        dynamic_array_push_back(&lexer->tokens_with_whitespaces, lexer->tokens[i]);
     }
-    Dynamic_Array<Token> swap = lexer->tokens_with_whitespaces;
-    lexer->tokens_with_whitespaces = lexer->tokens;
-    lexer->tokens = swap;
+    Text_Position start_pos = text_position_make(0, 0);
+    int start_index = 0;
+    if (relex_start < old_tokens->size) {
+        start_pos = old_tokens->data[relex_start].position.start;
+        start_index = old_tokens->data[relex_start].source_code_index;
+    }
+
+    Dynamic_Array<Token> new_tokens = dynamic_array_create_empty<Token>(64);
+    SCOPE_EXIT(dynamic_array_destroy(&new_tokens));
+    Dynamic_Array<Token> new_non_whitespace_tokens = dynamic_array_create_empty<Token>(64);
+    SCOPE_EXIT(dynamic_array_destroy(&new_non_whitespace_tokens));
+    String code = string_create_empty(1024);
+    SCOPE_EXIT(string_destroy(&code));
+
+    // Lex chunks of growing size until the new tokens resynchronize with the old ones after the changed lines
+    int extra_lines = 8;
+    int sync_new = -1;
+    int sync_old = -1;
+    while (true)
+    {
+        int chunk_end_line = math_minimum(text->size, new_end_line + extra_lines);
+        bool chunk_reaches_text_end = chunk_end_line >= text->size;
+        string_reset(&code);
+        for (int line = start_pos.line; line < chunk_end_line; line++) {
+            String* line_string = &text->data[line];
+            int from = line == start_pos.line ? start_pos.character : 0;
+            string_append_character_array(&code, array_create_static(line_string->characters + from, line_string->size - from));
+            if (line != text->size - 1) {
+                string_append_character(&code, '\n');
+            }
+        }
+
+        dynamic_array_reset(&new_tokens);
+        lexer_tokenize(lexer, &new_tokens, &code, start_pos.line, start_pos.character);
+
+        // Resync on the first token behind the changed lines that starts where a (shifted) old token started
+        sync_new = -1;
+        sync_old = -1;
+        int old_index = relex_start;
+        for (int i = 0; i < new_tokens.size && old_index < old_tokens->size; i++)
+        {
+            Text_Position pos = new_tokens[i].position.start;
+            if (pos.line < new_end_line) continue;
+            while (old_index < old_tokens->size) {
+                Text_Position old_pos = old_tokens->data[old_index].position.start;
+                old_pos.line += line_offset;
+                if (old_pos.line > pos.line || (old_pos.line == pos.line && old_pos.character >= pos.character)) break;
+                old_index++;
+            }
+            if (old_index >= old_tokens->size) break;
+            Text_Position old_pos = old_tokens->data[old_index].position.start;
+            if (old_pos.line + line_offset == pos.line && old_pos.character == pos.character) {
+                sync_new = i;
+                sync_old = old_index;
+                break;
+            }
+        }
+        if (sync_new != -1 || chunk_reaches_text_end) break;
+        extra_lines *= 2;
+    }
+
+    int replace_count = sync_new == -1 ? new_tokens.size : sync_new;
+    int old_end = sync_old == -1 ? old_tokens->size : sync_old;
+    for (int i = 0; i < replace_count; i++) {
+        new_tokens[i].source_code_index += start_index;
+        if (!token_type_is_whitespace(new_tokens[i].type)) {
+            dynamic_array_push_back(&new_non_whitespace_tokens, new_tokens[i]);
+        }
+    }
+    int index_offset = 0;
+    if (sync_new != -1) {
+        index_offset = new_tokens[sync_new].source_code_index + start_index - old_tokens->data[sync_old].source_code_index;
+    }
+
+    // Non-whitespace range has to be found before the old token indices are patched
+    int non_whitespace_start = lexer_find_token_by_code_index(&lexer->tokens, start_index);
+    int non_whitespace_end = lexer->tokens.size;
+    if (sync_old != -1) {
+        non_whitespace_end = lexer_find_token_by_code_index(&lexer->tokens, old_tokens->data[sync_old].source_code_index);
+    }
+    lexer_splice_tokens(old_tokens, relex_start, old_end, new_tokens.data, replace_count, line_offset, index_offset);
+    lexer_splice_tokens(&lexer->tokens, non_whitespace_start, non_whitespace_end, 
+        new_non_whitespace_tokens.data, new_non_whitespace_tokens.size, line_offset, index_offset);
+
+    Token_Change change;
+    change.start_index = non_whitespace_start;
+    change.old_end_index = non_whitespace_end;
+    change.new_end_index = non_whitespace_start + new_non_whitespace_tokens.size;
+    return change;
 }
 
 void lexer_destroy(Lexer* lexer)
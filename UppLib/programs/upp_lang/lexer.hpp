@@ -90,10 +90,11 @@ struct Token
 struct Lexer
 {
     Dynamic_Array<String> identifiers;
-    Hashtable<String, int> identifier_index_lookup_table;
-    Hashtable<String, Token_Type> keywords;
+    Hashtable<String, int, Hasher_String> identifier_index_lookup_table;
+    Hashtable<String, Token_Type, Hasher_String> keywords;
     Dynamic_Array<Token> tokens;
     Dynamic_Array<Token> tokens_with_whitespaces;
+    Allocator* identifier_allocator; // Set by lexer_parse_string, 0 for heap
 };
 
 bool token_type_is_keyword(Token_Type type);
@@ -101,7 +102,24 @@ const char* token_type_to_string(Token_Type type);
 
 Lexer lexer_create();
 void lexer_destroy(Lexer* result);
-void lexer_parse_string(Lexer* lexer, String* code);
+void lexer_parse_string(Lexer* lexer, String* code, Allocator* identifier_allocator);
+// The tokens [start_index, old_end_index) were replaced by the tokens [start_index, new_end_index)
+struct Token_Change
+{
+    int start_index;
+    int old_end_index;
+    int new_end_index;
+};
+
+// Relexes after the lines [first_line, old_end_line) were replaced by [first_line, new_end_line) in text, only until
+// the token stream resynchronizes. Identifier indices stay the same, so identifier_allocator must outlive the edits (e.g. heap)
+// Returns the change of the non-whitespace tokens
+Token_Change lexer_relex_lines(Lexer* lexer, Dynamic_Array<String>* text, int first_line, int old_end_line, int new_end_line);
+
+// Lexes the source repetitions times, logs and returns the throughput in MB/s
+double lexer_benchmark_source(String* content, const char* name, int repetitions);
+// Same as lexer_benchmark_source with the content of the file (e.g. big_test.txt)
+double lexer_benchmark(const char* filepath, int repetitions);
 
 String lexer_identifer_to_string(Lexer* Lexer, int index);
 int lexer_add_or_find_identifier_by_string(Lexer* Lexer, String identifier);
@@ -24,6 +24,26 @@ String primitive_type_to_string(Primitive_Type type)
     return string_create_static("INVALID_VALUE_TYPE_ENUM");
 }
 
+int primitive_type_size_in_bytes(Primitive_Type type)
+{
+    switch (type)
+    {
+    case Primitive_Type::BOOLEAN:
+    case Primitive_Type::SIGNED_INT_8:
+    case Primitive_Type::UNSIGNED_INT_8: return 1;
+    case Primitive_Type::SIGNED_INT_16:
+    case Primitive_Type::UNSIGNED_INT_16: return 2;
+    case Primitive_Type::SIGNED_INT_32:
+    case Primitive_Type::UNSIGNED_INT_32:
+    case Primitive_Type::FLOAT_32: return 4;
+    case Primitive_Type::SIGNED_INT_64:
+    case Primitive_Type::UNSIGNED_INT_64:
+    case Primitive_Type::FLOAT_64: return 8;
+    }
+    panic("What");
+    return 0;
+}
+
 bool primitive_type_is_integer(Primitive_Type type)
 {
     switch (type)
@@ -152,6 +172,39 @@ bool type_signatures_are_equal(Type_Signature* sig1, Type_Signature* sig2)
     return false;
 }
 
+u64 type_signature_hash(Type_Signature* signature)
+{
+    u64 parts[4];
+    parts[0] = (u64)signature->type;
+    parts[1] = 0;
+    parts[2] = 0;
+    parts[3] = 0;
+    switch (signature->type)
+    {
+    case Signature_Type::ARRAY_SIZED:
+        parts[1] = (u64)signature->child_type;
+        parts[2] = (u64)signature->array_element_count;
+        break;
+    case Signature_Type::ARRAY_UNSIZED:
+    case Signature_Type::POINTER:
+        parts[1] = (u64)signature->child_type;
+        break;
+    case Signature_Type::PRIMITIVE:
+        parts[1] = (u64)signature->primitive_type;
+        break;
+    case Signature_Type::FUNCTION:
+        parts[1] = (u64)signature->return_type;
+        parts[2] = (u64)signature->parameter_types.size;
+        parts[3] = hash_memory(array_create_static((byte*)signature->parameter_types.data, signature->parameter_types.size * sizeof(Type_Signature*)));
+        break;
+    case Signature_Type::STRUCT:
+        parts[1] = (u64)signature->struct_name_handle;
+        break;
+    default: break;
+    }
+    return hash_memory(array_create_static((byte*)parts, sizeof(parts)));
+}
+
 void type_signature_append_to_string_with_children(String* string, Type_Signature* signature, bool print_child)
 {
     switch (signature->type)
@@ -174,10 +227,11 @@ void type_signature_append_to_string_with_children(String* string, Type_Signatur
         string_append_formated(string, "*");
         type_signature_append_to_string_with_children(string, signature->child_type, print_child);
         break;
-    case Signature_Type::PRIMITIVE:
+    case Signature_Type::PRIMITIVE: {
         String s = primitive_type_to_string(signature->primitive_type);
         string_append_string(string, &s);
         break;
+    }
     case Signature_Type::STRUCT:
         string_append_formated(string, "STRUCT {");
         for (int i = 0; i < signature->member_types.size && print_child; i++) {
@@ -404,6 +458,9 @@ void type_system_add_primitives(Type_System* system)
     dynamic_array_push_back(&system->types, system->error_type);
     dynamic_array_push_back(&system->types, system->void_type);
     dynamic_array_push_back(&system->types, system->void_ptr_type);
+    for (int i = 0; i < system->types.size; i++) {
+        hashtable_insert_element(&system->interned_types, system->types[i], system->types[i]);
+    }
 
     {
         Struct_Member character_buffer_member;
@@ -435,12 +492,17 @@ Type_System type_system_create(Lexer* lexer)
     Type_System result;
     result.lexer = lexer;
     result.types = dynamic_array_create_empty<Type_Signature*>(256);
+    result.interned_types = hashtable_create_empty<Type_Signature*, Type_Signature*, Hasher_Type_Signature>(256);
+    result.is_concurrent = false;
+    result.mutex = mutex_create();
     type_system_add_primitives(&result);
     return result;
 }
 
 void type_system_destroy(Type_System* system) {
     dynamic_array_destroy(&system->types);
+    hashtable_destroy(&system->interned_types);
+    mutex_destroy(&system->mutex);
 }
 
 void type_system_reset_all(Type_System* system, Lexer* lexer) {
@@ -449,23 +511,27 @@ void type_system_reset_all(Type_System* system, Lexer* lexer) {
         delete system->types[i];
     }
     dynamic_array_reset(&system->types);
+    hashtable_reset(&system->interned_types);
     system->lexer = lexer;
     type_system_add_primitives(system);
 }
 
 Type_Signature* type_system_make_type(Type_System* system, Type_Signature signature)
 {
-    for (int i = 0; i < system->types.size; i++)
-    {
-        Type_Signature* cmp = system->types[i];
-        if (type_signatures_are_equal(cmp, &signature)) {
-            type_signature_destroy(&signature);
-            return cmp;
-        }
+    bool lock = system->is_concurrent;
+    if (lock) mutex_lock(&system->mutex);
+    SCOPE_EXIT(if (lock) mutex_unlock(&system->mutex));
+
+    Type_Signature* key = &signature;
+    Type_Signature** interned = hashtable_find_element(&system->interned_types, key);
+    if (interned != 0) {
+        type_signature_destroy(&signature);
+        return *interned;
     }
     Type_Signature* new_sig = new Type_Signature();
     *new_sig = signature;
     dynamic_array_push_back(&system->types, new_sig);
+    hashtable_insert_element(&system->interned_types, new_sig, new_sig);
     return new_sig;
 }
 
@@ -537,20 +603,43 @@ void type_system_print(Type_System* system)
 /*
     Symbol Table
 */
-Symbol* symbol_table_find_symbol_with_scope_info(Symbol_Table* table, int name_handle, bool* in_current_scope)
+// Set by analysis workers, so that lookups in shared tables do not write to the statistics of the main analyser
+thread_local Symbol_Lookup_Statistics* thread_lookup_statistics = 0;
+
+Symbol_Lookup_Statistics* symbol_table_get_statistics(Symbol_Table* table) {
+    return thread_lookup_statistics != 0 ? thread_lookup_statistics : table->statistics;
+}
+
+Symbol* symbol_table_find_symbol_in_table(Symbol_Table* table, int name_handle)
 {
-    *in_current_scope = false;
+    Symbol_Lookup_Statistics* statistics = symbol_table_get_statistics(table);
+    statistics->tables_visited++;
+    if (table->is_hashed) {
+        statistics->hashed_tables_visited++;
+        int* index = hashtable_find_element(&table->symbol_indices, name_handle);
+        if (index == 0) return 0;
+        return &table->symbols[*index];
+    }
     for (int i = 0; i < table->symbols.size; i++) {
         if (table->symbols[i].name_handle == name_handle) {
-            *in_current_scope = true;
             return &table->symbols[i];
         }
     }
-    if (table->parent != 0) {
-        Symbol* result = symbol_table_find_symbol_with_scope_info(table->parent, name_handle, in_current_scope);
+    return 0;
+}
+
+Symbol* symbol_table_find_symbol_with_scope_info(Symbol_Table* table, int name_handle, bool* in_current_scope)
+{
+    symbol_table_get_statistics(table)->lookup_count++;
+    *in_current_scope = true;
+    while (table != 0)
+    {
+        Symbol* symbol = symbol_table_find_symbol_in_table(table, name_handle);
+        if (symbol != 0) return symbol;
         *in_current_scope = false;
-        return result;
+        table = table->parent;
     }
+    *in_current_scope = false;
     return 0;
 }
 
@@ -571,18 +660,17 @@ Symbol* symbol_table_find_symbol_by_string(Symbol_Table* table, String* string,
 
 Symbol* symbol_table_find_symbol_of_type_with_scope_info(Symbol_Table* table, int name_handle, Symbol_Type symbol_type, bool* in_current_scope)
 {
-    *in_current_scope = false;
-    for (int i = 0; i < table->symbols.size; i++) {
-        if (table->symbols[i].name_handle == name_handle && table->symbols[i].symbol_type == symbol_type) {
-            *in_current_scope = true;
-            return &table->symbols[i];
-        }
-    }
-    if (table->parent != 0) {
-        Symbol* result = symbol_table_find_symbol_of_type_with_scope_info(table->parent, name_handle, symbol_type, in_current_scope);
+    // Names are unique per table, so a symbol of another type only hides the name in this table
+    symbol_table_get_statistics(table)->lookup_count++;
+    *in_current_scope = true;
+    while (table != 0)
+    {
+        Symbol* symbol = symbol_table_find_symbol_in_table(table, name_handle);
+        if (symbol != 0 && symbol->symbol_type == symbol_type) return symbol;
         *in_current_scope = false;
-        return result;
+        table = table->parent;
     }
+    *in_current_scope = false;
     return 0;
 }
 
@@ -594,31 +682,31 @@ Symbol* symbol_table_find_symbol_of_type(Symbol_Table* table, int name_handle, S
 
 Symbol* symbol_table_find_symbol_of_identifer_node(Symbol_Table* table, AST_Parser* parser, int node_index)
 {
-    AST_Node* node = &parser->nodes[node_index];
-    assert(node->type == AST_Node_Type::IDENTIFIER || node->type == AST_Node_Type::IDENTIFIER_PATH, "Cannot lookup non identifer code");
+    AST_Node node = ast_parser_get_node(parser, node_index);
+    assert(node.type == AST_Node_Type::IDENTIFIER || node.type == AST_Node_Type::IDENTIFIER_PATH, "Cannot lookup non identifer code");
 
-    if (node->type == AST_Node_Type::IDENTIFIER) {
-        return symbol_table_find_symbol(table, node->name_id);
+    if (node.type == AST_Node_Type::IDENTIFIER) {
+        return symbol_table_find_symbol(table, node.name_id);
     }
     else {
-        Symbol* module_symbol = symbol_table_find_symbol_of_type(table, node->name_id, Symbol_Type::MODULE);
+        Symbol* module_symbol = symbol_table_find_symbol_of_type(table, node.name_id, Symbol_Type::MODULE);
         if (module_symbol == 0) return 0;
-        return symbol_table_find_symbol_of_identifer_node(module_symbol->options.module_table, parser, node->children[0]);
+        return symbol_table_find_symbol_of_identifer_node(module_symbol->options.module_table, parser, node.children[0]);
     }
 }
 
 Symbol* symbol_table_find_symbol_of_identifer_node_of_type(Symbol_Table* table, Symbol_Type type, AST_Parser* parser, int node_index)
 {
-    AST_Node* node = &parser->nodes[node_index];
-    assert(node->type == AST_Node_Type::IDENTIFIER || node->type == AST_Node_Type::IDENTIFIER_PATH, "Cannot lookup non identifer code");
+    AST_Node node = ast_parser_get_node(parser, node_index);
+    assert(node.type == AST_Node_Type::IDENTIFIER || node.type == AST_Node_Type::IDENTIFIER_PATH, "Cannot lookup non identifer code");
 
-    if (node->type == AST_Node_Type::IDENTIFIER) {
-        return symbol_table_find_symbol_of_type(table, node->name_id, type);
+    if (node.type == AST_Node_Type::IDENTIFIER) {
+        return symbol_table_find_symbol_of_type(table, node.name_id, type);
     }
     else {
-        Symbol* module_symbol = symbol_table_find_symbol_of_type(table, node->name_id, Symbol_Type::MODULE);
+        Symbol* module_symbol = symbol_table_find_symbol_of_type(table, node.name_id, Symbol_Type::MODULE);
         if (module_symbol == 0) return 0;
-        return symbol_table_find_symbol_of_identifer_node_of_type(module_symbol->options.module_table, type, parser, node->children[0]);
+        return symbol_table_find_symbol_of_identifer_node_of_type(module_symbol->options.module_table, type, parser, node.children[0]);
     }
 }
 
@@ -674,16 +762,23 @@ void symbol_table_define_symbol(Symbol_Table* table, Semantic_Analyser* analyser
 {
     bool in_current_scope;
     Symbol* found_symbol = symbol_table_find_symbol_with_scope_info(table, symbol.name_handle, &in_current_scope);
-    if (found_symbol == 0) {
-        dynamic_array_push_back(&table->symbols, symbol);
+    if (found_symbol != 0 && (!shadowing_enabled || in_current_scope)) {
+        semantic_analyser_log_error(analyser, "Symbol already defined", symbol.definition_node_index);
         return;
     }
 
-    if (shadowing_enabled && !in_current_scope) {
-        dynamic_array_push_back(&table->symbols, symbol);
-        return;
+    dynamic_array_push_back(&table->symbols, symbol);
+    if (table->is_hashed) {
+        hashtable_insert_element(&table->symbol_indices, symbol.name_handle, table->symbols.size - 1);
+    }
+    else if (table->symbols.size > SYMBOL_TABLE_HASH_THRESHOLD)
+    {
+        table->is_hashed = true;
+        table->symbol_indices = hashtable_create_empty<int, int, Hasher_I32>(table->symbols.size * 2, table->symbols.allocator);
+        for (int i = 0; i < table->symbols.size; i++) {
+            hashtable_insert_element(&table->symbol_indices, table->symbols[i].name_handle, i);
+        }
     }
-    semantic_analyser_log_error(analyser, "Symbol already defined", symbol.definition_node_index);
 }
 
 
@@ -814,12 +909,13 @@ void ir_instruction_destroy(IR_Instruction* instruction)
     }
 }
 
-IR_Code_Block* ir_code_block_create(IR_Function* function)
+// The allocator is usually function->program->allocator, analysis workers allocate the bodies they analyse themselves
+IR_Code_Block* ir_code_block_create(IR_Function* function, Allocator* allocator)
 {
-    IR_Code_Block* block = new IR_Code_Block();
+    IR_Code_Block* block = allocator_allocate<IR_Code_Block>(allocator);
     block->function = function;
-    block->instructions = dynamic_array_create_empty<IR_Instruction>(64);
-    block->registers = dynamic_array_create_empty<Type_Signature*>(32);
+    block->instructions = dynamic_array_create_empty<IR_Instruction>(64, allocator);
+    block->registers = dynamic_array_create_empty<Type_Signature*>(32, allocator);
     return block;
 }
 
@@ -830,15 +926,52 @@ void ir_code_block_destroy(IR_Code_Block* block)
     }
     dynamic_array_destroy(&block->instructions);
     dynamic_array_destroy(&block->registers);
-    delete block;
+    allocator_free(block->function->program->allocator, block);
+}
+
+Type_Signature* ir_instruction_call_get_return_type(IR_Instruction_Call* call)
+{
+    switch (call->call_type)
+    {
+    case IR_Instruction_Call_Type::FUNCTION_CALL: return call->options.function->function_type->return_type;
+    case IR_Instruction_Call_Type::FUNCTION_POINTER_CALL: return ir_data_access_get_type(&call->options.pointer_access)->child_type->return_type;
+    case IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL: return call->options.hardcoded->signature->return_type;
+    default: panic("Error");
+    }
+    return 0;
+}
+
+int ir_code_block_count_instructions(IR_Code_Block* code_block)
+{
+    int count = code_block->instructions.size;
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::IF:
+            count += ir_code_block_count_instructions(instr->options.if_instr.true_branch);
+            count += ir_code_block_count_instructions(instr->options.if_instr.false_branch);
+            break;
+        case IR_Instruction_Type::WHILE:
+            count += ir_code_block_count_instructions(instr->options.while_instr.condition_code);
+            count += ir_code_block_count_instructions(instr->options.while_instr.code);
+            break;
+        case IR_Instruction_Type::BLOCK:
+            count += ir_code_block_count_instructions(instr->options.block);
+            break;
+        }
+    }
+    return count;
 }
 
 IR_Function* ir_function_create(IR_Program* program, Type_Signature* signature)
 {
-    IR_Function* function = new IR_Function();
-    function->code = ir_code_block_create(function);
-    function->function_type = signature;
+    IR_Function* function = allocator_allocate<IR_Function>(program->allocator);
     function->program = program;
+    function->code = ir_code_block_create(function, program->allocator);
+    function->function_type = signature;
+    function->inlined_functions = dynamic_array_create_empty<IR_Function*>(1, program->allocator);
     dynamic_array_push_back(&program->functions, function);
     return function;
 }
@@ -846,22 +979,26 @@ IR_Function* ir_function_create(IR_Program* program, Type_Signature* signature)
 void ir_function_destroy(IR_Function* function)
 {
     ir_code_block_destroy(function->code);
-    delete function;
+    dynamic_array_destroy(&function->inlined_functions);
+    allocator_free(function->program->allocator, function);
 }
 
-IR_Program* ir_program_create(Type_System* type_system)
+IR_Program* ir_program_create(Type_System* type_system, Allocator* allocator)
 {
-    IR_Program* result = new IR_Program();
-    result->constant_pool.constants = dynamic_array_create_empty<IR_Constant>(128);
-    result->constant_pool.constant_memory = dynamic_array_create_empty<byte>(2048);
+    IR_Program* result = allocator_allocate<IR_Program>(allocator);
+    result->allocator = allocator;
+    result->constant_pool.constants = dynamic_array_create_empty<IR_Constant>(128, allocator);
+    result->constant_pool.constant_memory = dynamic_array_create_empty<byte>(2048, allocator);
     result->entry_function = 0;
-    result->functions = dynamic_array_create_empty<IR_Function*>(64);
-    result->globals = dynamic_array_create_empty<Type_Signature*>(64);
+    result->functions = dynamic_array_create_empty<IR_Function*>(64, allocator);
+    result->globals = dynamic_array_create_empty<Type_Signature*>(64, allocator);
 
-    result->hardcoded_functions = dynamic_array_create_empty<IR_Hardcoded_Function*>((int)IR_Hardcoded_Function_Type::HARDCODED_FUNCTION_COUNT);
+    result->hardcoded_functions = dynamic_array_create_empty<IR_Hardcoded_Function*>(
+        (int)IR_Hardcoded_Function_Type::HARDCODED_FUNCTION_COUNT, allocator
+    );
     for (int i = 0; i < (int)IR_Hardcoded_Function_Type::HARDCODED_FUNCTION_COUNT; i++)
     {
-        IR_Hardcoded_Function* function = new IR_Hardcoded_Function();
+        IR_Hardcoded_Function* function = allocator_allocate<IR_Hardcoded_Function>(allocator);
         IR_Hardcoded_Function_Type type = (IR_Hardcoded_Function_Type)i;
         function->type = type;
 
@@ -922,11 +1059,11 @@ void ir_program_destroy(IR_Program* program)
         ir_function_destroy(program->functions[i]);
     }
     for (int i = 0; i < program->hardcoded_functions.size; i++) {
-        delete program->hardcoded_functions[i];
+        allocator_free(program->allocator, program->hardcoded_functions[i]);
     }
     dynamic_array_destroy(&program->hardcoded_functions);
     dynamic_array_destroy(&program->functions);
-    delete program;
+    allocator_free(program->allocator, program);
 }
 
 void ir_data_access_append_to_string(IR_Data_Access* access, String* string)
@@ -1319,6 +1456,13 @@ void semantic_analyser_log_error(Semantic_Analyser* analyser, const char* msg, i
     error.message = msg;
     error.range = analyser->compiler->parser.token_mapping[node_index];
     dynamic_array_push_back(&analyser->errors, error);
+    if (analyser->error_recording != 0) {
+        Semantic_Cached_Error cached;
+        cached.message = msg;
+        cached.start_node_index = node_index;
+        cached.end_node_index = node_index;
+        dynamic_array_push_back(analyser->error_recording, cached);
+    }
 }
 
 void semantic_analyser_log_error(Semantic_Analyser* analyser, const char* msg, int node_start_index, int node_end_index)
@@ -1328,14 +1472,24 @@ void semantic_analyser_log_error(Semantic_Analyser* analyser, const char* msg, i
     error.range.start_index = analyser->compiler->parser.token_mapping[node_start_index].start_index;
     error.range.end_index = analyser->compiler->parser.token_mapping[node_end_index].end_index;
     dynamic_array_push_back(&analyser->errors, error);
+    if (analyser->error_recording != 0) {
+        Semantic_Cached_Error cached;
+        cached.message = msg;
+        cached.start_node_index = node_start_index;
+        cached.end_node_index = node_end_index;
+        dynamic_array_push_back(analyser->error_recording, cached);
+    }
 }
 
 Symbol_Table* semantic_analyser_create_symbol_table(Semantic_Analyser* analyser, Symbol_Table* parent, int node_index)
 {
-    Symbol_Table* table = new Symbol_Table();
+    Allocator* allocator = analyser->symbol_table_allocator;
+    Symbol_Table* table = allocator_allocate<Symbol_Table>(allocator);
     table->parent = parent;
-    table->symbols = dynamic_array_create_empty<Symbol>(8);
+    table->symbols = dynamic_array_create_empty<Symbol>(8, allocator);
+    table->is_hashed = false;
     table->ast_node_index = node_index;
+    table->statistics = &analyser->lookup_statistics;
     dynamic_array_push_back(&analyser->symbol_tables, table);
     hashtable_insert_element(&analyser->ast_to_symbol_table, node_index, table);
     return table;
@@ -1353,12 +1507,12 @@ void semantic_analyser_define_type(Semantic_Analyser* analyser, Symbol_Table* ta
 
 Type_Signature* semantic_analyser_analyse_type(Semantic_Analyser* analyser, Symbol_Table* table, int type_node_index)
 {
-    AST_Node* type_node = &analyser->compiler->parser.nodes[type_node_index];
-    switch (type_node->type)
+    AST_Node type_node = ast_parser_get_node(&analyser->compiler->parser, type_node_index);
+    switch (type_node.type)
     {
     case AST_Node_Type::TYPE_IDENTIFIER:
     {
-        Symbol* symbol = symbol_table_find_symbol_of_identifer_node_of_type(table, Symbol_Type::TYPE, &analyser->compiler->parser, type_node->children[0]);
+        Symbol* symbol = symbol_table_find_symbol_of_identifer_node_of_type(table, Symbol_Type::TYPE, &analyser->compiler->parser, type_node.children[0]);
         if (symbol == 0) {
             semantic_analyser_log_error(analyser, "Invalid type, identifier is not a type!", type_node_index);
             return analyser->compiler->type_system.error_type;
@@ -1366,14 +1520,14 @@ Type_Signature* semantic_analyser_analyse_type(Semantic_Analyser* analyser, Symb
         return symbol->options.data_type;
     }
     case AST_Node_Type::TYPE_POINTER_TO: {
-        return type_system_make_pointer(&analyser->compiler->type_system, semantic_analyser_analyse_type(analyser, table, type_node->children[0]));
+        return type_system_make_pointer(&analyser->compiler->type_system, semantic_analyser_analyse_type(analyser, table, type_node.children[0]));
     }
     case AST_Node_Type::TYPE_ARRAY_SIZED:
     {
         // TODO: check if expression is compile time known, currently only literal value is supported
-        int index_node_array_size = type_node->children[0];
-        AST_Node* node_array_size = &analyser->compiler->parser.nodes[index_node_array_size];
-        if (node_array_size->type != AST_Node_Type::EXPRESSION_LITERAL) {
+        int index_node_array_size = type_node.children[0];
+        AST_Node node_array_size = ast_parser_get_node(&analyser->compiler->parser, index_node_array_size);
+        if (node_array_size.type != AST_Node_Type::EXPRESSION_LITERAL) {
             semantic_analyser_log_error(analyser, "Array size is not a expression literal, currently not evaluable", index_node_array_size);
             return analyser->compiler->type_system.error_type;
         }
@@ -1383,7 +1537,7 @@ Type_Signature* semantic_analyser_analyse_type(Semantic_Analyser* analyser, Symb
             return analyser->compiler->type_system.error_type;
         }
 
-        Type_Signature* element_type = semantic_analyser_analyse_type(analyser, table, type_node->children[1]);
+        Type_Signature* element_type = semantic_analyser_analyse_type(analyser, table, type_node.children[1]);
         if (element_type == analyser->compiler->type_system.void_type) {
             semantic_analyser_log_error(analyser, "Cannot have array of void type!", index_node_array_size);
             return analyser->compiler->type_system.error_type;
@@ -1396,25 +1550,25 @@ Type_Signature* semantic_analyser_analyse_type(Semantic_Analyser* analyser, Symb
         );
     }
     case AST_Node_Type::TYPE_ARRAY_UNSIZED: {
-        Type_Signature* element_type = semantic_analyser_analyse_type(analyser, table, type_node->children[0]);
+        Type_Signature* element_type = semantic_analyser_analyse_type(analyser, table, type_node.children[0]);
         if (element_type == analyser->compiler->type_system.void_type) {
-            semantic_analyser_log_error(analyser, "Cannot have array of void type!", type_node->children[0]);
+            semantic_analyser_log_error(analyser, "Cannot have array of void type!", type_node.children[0]);
             return analyser->compiler->type_system.error_type;
         }
         return type_system_make_array_unsized(&analyser->compiler->type_system, element_type);
     }
     case AST_Node_Type::TYPE_FUNCTION_POINTER:
     {
-        AST_Node* parameter_block = &analyser->compiler->parser.nodes[type_node->children[0]];
-        Dynamic_Array<Type_Signature*> parameter_types = dynamic_array_create_empty<Type_Signature*>(parameter_block->children.size);
-        for (int i = 0; i < parameter_block->children.size; i++) {
-            int param_type_index = parameter_block->children[i];
+        AST_Node parameter_block = ast_parser_get_node(&analyser->compiler->parser, type_node.children[0]);
+        Dynamic_Array<Type_Signature*> parameter_types = dynamic_array_create_empty<Type_Signature*>(parameter_block.children.size);
+        for (int i = 0; i < parameter_block.children.size; i++) {
+            int param_type_index = parameter_block.children[i];
             dynamic_array_push_back(&parameter_types, semantic_analyser_analyse_type(analyser, table, param_type_index));
         }
 
         Type_Signature* return_type;
-        if (type_node->children.size == 2) {
-            return_type = semantic_analyser_analyse_type(analyser, table, type_node->children[1]);
+        if (type_node.children.size == 2) {
+            return_type = semantic_analyser_analyse_type(analyser, table, type_node.children[1]);
         }
         else {
             return_type = analyser->compiler->type_system.void_type;
@@ -1514,24 +1668,66 @@ Semantic_Analyser semantic_analyser_create()
     result.location_globals = dynamic_array_create_empty<AST_Top_Level_Node_Location>(64);
     result.location_structs = dynamic_array_create_empty<AST_Top_Level_Node_Location>(64);
     result.errors = dynamic_array_create_empty<Compiler_Error>(64);
-    result.ast_to_symbol_table = hashtable_create_empty<int, Symbol_Table*>(256, &hash_i32, &equals_i32);
+    result.ast_to_symbol_table = hashtable_create_empty<int, Symbol_Table*, Hasher_I32>(256);
     result.program = 0;
+    result.global_init_function = 0;
+    result.ir_arena = arena_create(1024 * 1024);
+    result.ir_arena_size_after_reset = 0;
+    result.cache_parse_generation = -1;
+    result.function_cache = hashtable_create_empty<int, Semantic_Function_Cache, Hasher_I32>(64);
+    result.cached_struct_nodes = dynamic_array_create_empty<int>(16);
+    result.cached_struct_types = dynamic_array_create_empty<Type_Signature*>(16);
+    result.cached_struct_errors = dynamic_array_create_empty<Semantic_Cached_Error>(4);
+    result.symbol_signatures = hashtable_create_empty<int, u64, Hasher_I32>(256);
+    result.previous_symbol_signatures = hashtable_create_empty<int, u64, Hasher_I32>(256);
+    result.error_recording = 0;
+    result.analysed_function_count = 0;
+    result.body_worker_count = 1;
+    result.workers = dynamic_array_create_empty<Semantic_Analysis_Worker>(1);
+    result.symbol_table_allocator = 0;
     return result;
 }
 
+void semantic_analyser_reset_cache(Semantic_Analyser* analyser)
+{
+    auto iter = hashtable_iterator_create(&analyser->function_cache);
+    while (hashtable_iterator_has_next(&iter)) {
+        dynamic_array_destroy(&iter.value->referenced_names);
+        dynamic_array_destroy(&iter.value->errors);
+        hashtable_iterator_next(&iter);
+    }
+    hashtable_reset(&analyser->function_cache);
+    dynamic_array_reset(&analyser->cached_struct_nodes);
+    dynamic_array_reset(&analyser->cached_struct_types);
+    dynamic_array_reset(&analyser->cached_struct_errors);
+    hashtable_reset(&analyser->symbol_signatures);
+    hashtable_reset(&analyser->previous_symbol_signatures);
+}
+
 void semantic_analyser_destroy(Semantic_Analyser* analyser)
 {
-    for (int i = 0; i < analyser->symbol_tables.size; i++) {
-        Symbol_Table* table = analyser->symbol_tables[i];
-        dynamic_array_destroy(&table->symbols);
-        delete analyser->symbol_tables[i];
-    }
+    // Symbol tables are owned by the compiler arena, the IR_Program by the ir_arena
+    semantic_analyser_reset_cache(analyser);
+    hashtable_destroy(&analyser->function_cache);
+    dynamic_array_destroy(&analyser->cached_struct_nodes);
+    dynamic_array_destroy(&analyser->cached_struct_types);
+    dynamic_array_destroy(&analyser->cached_struct_errors);
+    hashtable_destroy(&analyser->symbol_signatures);
+    hashtable_destroy(&analyser->previous_symbol_signatures);
+    arena_destroy(&analyser->ir_arena);
     dynamic_array_destroy(&analyser->symbol_tables);
     dynamic_array_destroy(&analyser->location_functions);
     dynamic_array_destroy(&analyser->location_structs);
     dynamic_array_destroy(&analyser->location_globals);
     hashtable_destroy(&analyser->ast_to_symbol_table);
     dynamic_array_destroy(&analyser->errors);
+    for (int i = 0; i < analyser->workers.size; i++) {
+        Semantic_Analysis_Worker* worker = &analyser->workers[i];
+        arena_destroy(&worker->ir_arena);
+        arena_destroy(&worker->symbol_table_arena);
+        dynamic_array_destroy(&worker->analysed_functions);
+    }
+    dynamic_array_destroy(&analyser->workers);
 }
 
 Expression_Analysis_Result semantic_analyser_analyse_expression
@@ -1540,12 +1736,12 @@ Expression_Analysis_Result semantic_analyser_analyse_expression
 void ir_data_access_change_type(IR_Data_Access access, Type_Signature* new_type);
 void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* analyser, Symbol_Table* symbol_table, int statement_index, IR_Code_Block* code_block)
 {
-    AST_Node* statement = &analyser->compiler->parser.nodes[statement_index];
-    switch (statement->type)
+    AST_Node statement = ast_parser_get_node(&analyser->compiler->parser, statement_index);
+    switch (statement.type)
     {
     case AST_Node_Type::STATEMENT_VARIABLE_DEFINITION:
     {
-        Type_Signature* var_type = semantic_analyser_analyse_type(analyser, symbol_table, statement->children[0]);
+        Type_Signature* var_type = semantic_analyser_analyse_type(analyser, symbol_table, statement.children[0]);
         if (var_type == analyser->compiler->type_system.void_type) {
             semantic_analyser_log_error(analyser, "Cannot create variable of void type", statement_index);
             var_type = analyser->compiler->type_system.error_type;
@@ -1553,7 +1749,7 @@ void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* a
 
         Symbol var_symbol;
         var_symbol.symbol_type = Symbol_Type::VARIABLE;
-        var_symbol.name_handle = statement->name_id;
+        var_symbol.name_handle = statement.name_id;
         var_symbol.definition_node_index = statement_index;
         if (code_block == 0) {
             dynamic_array_push_back(&analyser->program->globals, var_type);
@@ -1574,7 +1770,7 @@ void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* a
     }
     case AST_Node_Type::STATEMENT_VARIABLE_DEFINE_ASSIGN:
     {
-        Type_Signature* var_type = semantic_analyser_analyse_type(analyser, symbol_table, statement->children[0]);
+        Type_Signature* var_type = semantic_analyser_analyse_type(analyser, symbol_table, statement.children[0]);
         if (var_type == analyser->compiler->type_system.void_type) {
             semantic_analyser_log_error(analyser, "Cannot create variable of void type", statement_index);
             var_type = analyser->compiler->type_system.error_type;
@@ -1582,7 +1778,7 @@ void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* a
 
         Symbol var_symbol;
         var_symbol.symbol_type = Symbol_Type::VARIABLE;
-        var_symbol.name_handle = statement->name_id;
+        var_symbol.name_handle = statement.name_id;
         var_symbol.definition_node_index = statement_index;
         IR_Code_Block* definition_block = 0;
         if (code_block == 0) {
@@ -1603,7 +1799,7 @@ void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* a
         }
 
         Expression_Analysis_Result expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement->children[1], definition_block, false, &var_symbol.options.variable_access
+            analyser, symbol_table, statement.children[1], definition_block, false, &var_symbol.options.variable_access
         );
         if (!expr_result.error_occured) {
             if (expr_result.type != var_type) {
@@ -1618,7 +1814,7 @@ void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* a
     {
         Symbol var_symbol;
         var_symbol.symbol_type = Symbol_Type::VARIABLE;
-        var_symbol.name_handle = statement->name_id;
+        var_symbol.name_handle = statement.name_id;
         var_symbol.definition_node_index = statement_index;
         IR_Code_Block* definition_block = 0;
         if (code_block == 0) {
@@ -1639,7 +1835,7 @@ void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* a
         }
 
         Expression_Analysis_Result expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement->children[0], definition_block, false, &var_symbol.options.variable_access
+            analyser, symbol_table, statement.children[0], definition_block, false, &var_symbol.options.variable_access
         );
         Type_Signature* var_type = analyser->compiler->type_system.error_type;
         if (!expr_result.error_occured) {
@@ -1661,15 +1857,15 @@ void semantic_analyser_analyse_variable_creation_statements(Semantic_Analyser* a
 
 void semantic_analyser_find_definitions(Semantic_Analyser* analyser, Symbol_Table* parent_table, int node_index)
 {
-    AST_Node* module_node = &analyser->compiler->parser.nodes[node_index];
+    AST_Node module_node = ast_parser_get_node(&analyser->compiler->parser, node_index);
 
     Symbol_Table* module_table;
-    if (module_node->type != AST_Node_Type::ROOT) {
+    if (module_node.type != AST_Node_Type::ROOT) {
         module_table = semantic_analyser_create_symbol_table(analyser, parent_table, node_index);
         Symbol sym;
         sym.symbol_type = Symbol_Type::MODULE;
         sym.definition_node_index = node_index;
-        sym.name_handle = module_node->name_id;
+        sym.name_handle = module_node.name_id;
         sym.options.module_table = module_table;
         symbol_table_define_symbol(parent_table, analyser, sym, false);
     }
@@ -1677,11 +1873,11 @@ void semantic_analyser_find_definitions(Semantic_Analyser* analyser, Symbol_Tabl
         module_table = analyser->root_table;
     }
 
-    for (int i = 0; i < module_node->children.size; i++)
+    for (int i = 0; i < module_node.children.size; i++)
     {
-        int child_index = module_node->children[i];
-        AST_Node* top_level_node = &analyser->compiler->parser.nodes[child_index];
-        switch (top_level_node->type)
+        int child_index = module_node.children[i];
+        AST_Node top_level_node = ast_parser_get_node(&analyser->compiler->parser, child_index);
+        switch (top_level_node.type)
         {
         case AST_Node_Type::MODULE:
             semantic_analyser_find_definitions(analyser, module_table, child_index);
@@ -1861,13 +2057,13 @@ IR_Data_Access ir_data_access_dereference_pointer(IR_Code_Block* block, IR_Data_
 Expression_Analysis_Result semantic_analyser_analyse_expression(
     Semantic_Analyser* analyser, Symbol_Table* symbol_table, int expression_index, IR_Code_Block* code_block, bool create_temporary_access, IR_Data_Access* access)
 {
-    AST_Node* expression_node = &analyser->compiler->parser.nodes[expression_index];
+    AST_Node expression_node = ast_parser_get_node(&analyser->compiler->parser, expression_index);
     Type_System* type_system = &analyser->compiler->type_system;
 
     bool is_binary_op = false;
     IR_Instruction_Binary_OP_Type binary_op_type;
 
-    switch (expression_node->type)
+    switch (expression_node.type)
     {
     case AST_Node_Type::EXPRESSION_FUNCTION_CALL:
     {
@@ -1876,7 +2072,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
 
         Type_Signature* signature = 0;
         Symbol* symbol = symbol_table_find_symbol_of_identifer_node(
-            symbol_table, &analyser->compiler->parser, expression_node->children[0]
+            symbol_table, &analyser->compiler->parser, expression_node.children[0]
         );
         if (symbol == 0) {
             semantic_analyser_log_error(analyser, "Function identifer could not be found", expression_index);
@@ -1923,20 +2119,20 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
         }
         call_instruction.options.call.destination = *access;
 
-        int arguments_node_index = expression_node->children[1];
-        AST_Node* arguments_node = &analyser->compiler->parser.nodes[arguments_node_index];
-        if (arguments_node->children.size != signature->parameter_types.size) {
+        int arguments_node_index = expression_node.children[1];
+        AST_Node arguments_node = ast_parser_get_node(&analyser->compiler->parser, arguments_node_index);
+        if (arguments_node.children.size != signature->parameter_types.size) {
             semantic_analyser_log_error(analyser, "Argument size does not match function parameter size!", expression_index);
             return expression_analysis_result_make(signature->return_type, false);
         }
 
-        call_instruction.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(arguments_node->children.size);
+        call_instruction.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(arguments_node.children.size, analyser->program->allocator);
         bool error_occured = false;
-        for (int i = 0; i < signature->parameter_types.size && i < arguments_node->children.size; i++)
+        for (int i = 0; i < signature->parameter_types.size && i < arguments_node.children.size; i++)
         {
             IR_Data_Access argument_access;
             Expression_Analysis_Result expr_result = semantic_analyser_analyse_expression(
-                analyser, symbol_table, arguments_node->children[i], code_block, true, &argument_access
+                analyser, symbol_table, arguments_node.children[i], code_block, true, &argument_access
             );
             if (expr_result.error_occured) {
                 error_occured = true;
@@ -1962,7 +2158,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     }
     case AST_Node_Type::EXPRESSION_VARIABLE_READ:
     {
-        Symbol* symbol = symbol_table_find_symbol_of_identifer_node(symbol_table, &analyser->compiler->parser, expression_node->children[0]);
+        Symbol* symbol = symbol_table_find_symbol_of_identifer_node(symbol_table, &analyser->compiler->parser, expression_node.children[0]);
         if (symbol == 0) {
             semantic_analyser_log_error(analyser, "Identifier not found!", expression_index);
             return expression_analysis_result_make_error();
@@ -2004,14 +2200,14 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     }
     case AST_Node_Type::EXPRESSION_CAST:
     {
-        Type_Signature* cast_destination_type = semantic_analyser_analyse_type(analyser, symbol_table, expression_node->children[0]);
+        Type_Signature* cast_destination_type = semantic_analyser_analyse_type(analyser, symbol_table, expression_node.children[0]);
         if (cast_destination_type == analyser->compiler->type_system.error_type) {
             return expression_analysis_result_make_error();
         }
 
         IR_Data_Access source_access;
         Expression_Analysis_Result expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[1], code_block, true, &source_access
+            analyser, symbol_table, expression_node.children[1], code_block, true, &source_access
         );
         if (expr_result.error_occured) {
             return expression_analysis_result_make_error();
@@ -2019,7 +2215,8 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
 
         Type_Signature* cast_source_type = expr_result.type;
         if (cast_source_type == analyser->compiler->type_system.error_type) {
-            return expression_analysis_result_make(analyser->compiler->type_system.error_type, true);
+            // No access was written for the source, so the cast cannot produce one either
+            return expression_analysis_result_make_error();
         }
 
         bool cast_valid = false;
@@ -2131,7 +2328,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     }
     case AST_Node_Type::EXPRESSION_NEW:
     {
-        Type_Signature* new_type = semantic_analyser_analyse_type(analyser, symbol_table, expression_node->children[0]);
+        Type_Signature* new_type = semantic_analyser_analyse_type(analyser, symbol_table, expression_node.children[0]);
         if (new_type == analyser->compiler->type_system.error_type) {
             return expression_analysis_result_make_error();
         }
@@ -2144,7 +2341,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
         IR_Instruction instruction;
         instruction.type = IR_Instruction_Type::FUNCTION_CALL;
         instruction.options.call.call_type = IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL;
-        instruction.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1);
+        instruction.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1, analyser->program->allocator);
         dynamic_array_push_back(&instruction.options.call.arguments, ir_data_access_create_constant_i32(analyser, result_type->size_in_bytes));
         if (create_temporary_access) {
             *access = ir_data_access_create_intermediate(code_block, result_type);
@@ -2157,7 +2354,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     }
     case AST_Node_Type::EXPRESSION_NEW_ARRAY:
     {
-        Type_Signature* element_type = semantic_analyser_analyse_type(analyser, symbol_table, expression_node->children[1]);
+        Type_Signature* element_type = semantic_analyser_analyse_type(analyser, symbol_table, expression_node.children[1]);
         Type_Signature* array_type = type_system_make_array_unsized(&analyser->compiler->type_system, element_type);
         if (element_type == analyser->compiler->type_system.error_type) {
             return expression_analysis_result_make_error();
@@ -2187,7 +2384,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
         }
 
         Expression_Analysis_Result index_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, false, &array_size_access);
+            analyser, symbol_table, expression_node.children[0], code_block, false, &array_size_access);
         if (index_result.error_occured) {
             return expression_analysis_result_make(array_type, false);
         }
@@ -2225,7 +2422,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
         IR_Instruction instruction;
         instruction.type = IR_Instruction_Type::FUNCTION_CALL;
         instruction.options.call.call_type = IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL;
-        instruction.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1);
+        instruction.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1, analyser->program->allocator);
         dynamic_array_push_back(&instruction.options.call.arguments, array_memory_size_access);
         instruction.options.call.destination = array_data_access;
         instruction.options.call.options.hardcoded = analyser->program->hardcoded_functions[(int)IR_Hardcoded_Function_Type::MALLOC_SIZE_I32];
@@ -2236,24 +2433,24 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     case AST_Node_Type::EXPRESSION_ARRAY_ACCESS: {
         IR_Data_Access array_expr_access;
         Expression_Analysis_Result array_access_expr = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, true, &array_expr_access);
+            analyser, symbol_table, expression_node.children[0], code_block, true, &array_expr_access);
         if (array_access_expr.error_occured) {
             return expression_analysis_result_make_error();
         }
         Type_Signature* access_signature = array_access_expr.type;
         if (access_signature->type != Signature_Type::ARRAY_SIZED && access_signature->type != Signature_Type::ARRAY_UNSIZED) {
-            semantic_analyser_log_error(analyser, "Expression is not an array, cannot access with []!", expression_node->children[0]);
+            semantic_analyser_log_error(analyser, "Expression is not an array, cannot access with []!", expression_node.children[0]);
             return expression_analysis_result_make_error();
         }
 
         IR_Data_Access index_access;
         Expression_Analysis_Result index_expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[1], code_block, true, &index_access);
+            analyser, symbol_table, expression_node.children[1], code_block, true, &index_access);
         if (array_access_expr.error_occured) {
             return expression_analysis_result_make(access_signature->child_type, true);
         }
         if (index_expr_result.type != analyser->compiler->type_system.i32_type) {
-            semantic_analyser_log_error(analyser, "Array index must be integer!", expression_node->children[1]);
+            semantic_analyser_log_error(analyser, "Array index must be integer!", expression_node.children[1]);
             return expression_analysis_result_make(access_signature->child_type, true);
         }
 
@@ -2285,7 +2482,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     {
         IR_Data_Access expr_access;
         Expression_Analysis_Result access_expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, true, &expr_access
+            analyser, symbol_table, expression_node.children[0], code_block, true, &expr_access
         );
         if (access_expr_result.error_occured) {
             return expression_analysis_result_make_error();
@@ -2311,7 +2508,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
             Struct_Member* found = 0;
             for (int i = 0; i < type_signature->member_types.size; i++) {
                 Struct_Member* member = &type_signature->member_types[i];
-                if (member->name_handle == expression_node->name_id) {
+                if (member->name_handle == expression_node.name_id) {
                     found = member;
                 }
             }
@@ -2325,28 +2522,28 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
         }
         else if (type_signature->type == Signature_Type::ARRAY_SIZED || type_signature->type == Signature_Type::ARRAY_UNSIZED)
         {
-            if (expression_node->name_id != analyser->token_index_size && expression_node->name_id != analyser->token_index_data) {
+            if (expression_node.name_id != analyser->token_index_size && expression_node.name_id != analyser->token_index_data) {
                 semantic_analyser_log_error(analyser, "Arrays only have .size or .data as member!", expression_index);
                 return expression_analysis_result_make_error();
             }
             if (type_signature->type == Signature_Type::ARRAY_UNSIZED)
             {
-                if (expression_node->name_id == analyser->token_index_size) {
+                if (expression_node.name_id == analyser->token_index_size) {
                     member_type = analyser->compiler->type_system.i32_type;
-                    access_instr.options.address_of.options.member.name_handle = expression_node->name_id;
+                    access_instr.options.address_of.options.member.name_handle = expression_node.name_id;
                     access_instr.options.address_of.options.member.offset = 8;
                     access_instr.options.address_of.options.member.type = member_type;
                 }
                 else {
                     member_type = type_system_make_pointer(&analyser->compiler->type_system, type_signature->child_type);
-                    access_instr.options.address_of.options.member.name_handle = expression_node->name_id;
+                    access_instr.options.address_of.options.member.name_handle = expression_node.name_id;
                     access_instr.options.address_of.options.member.offset = 0;
                     access_instr.options.address_of.options.member.type = member_type;
                 }
             }
             else // Array_Sized
             {
-                if (expression_node->name_id == analyser->token_index_size)
+                if (expression_node.name_id == analyser->token_index_size)
                 {
                     IR_Instruction move_instr;
                     move_instr.type = IR_Instruction_Type::MOVE;
@@ -2402,7 +2599,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     {
         IR_Data_Access operand_access;
         Expression_Analysis_Result operand_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, true, &operand_access
+            analyser, symbol_table, expression_node.children[0], code_block, true, &operand_access
         );
         if (operand_result.error_occured) {
             return expression_analysis_result_make(type_system->bool_type, false);
@@ -2426,7 +2623,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     {
         IR_Data_Access operand_access;
         Expression_Analysis_Result operand_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, true, &operand_access
+            analyser, symbol_table, expression_node.children[0], code_block, true, &operand_access
         );
         if (operand_result.error_occured) {
             return expression_analysis_result_make_error();
@@ -2462,11 +2659,11 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     }
     case AST_Node_Type::EXPRESSION_UNARY_OPERATION_ADDRESS_OF:
     {
-        AST_Node* child_node = &analyser->compiler->parser.nodes[expression_node->children[0]];
+        AST_Node child_node = ast_parser_get_node(&analyser->compiler->parser, expression_node.children[0]);
 
         IR_Data_Access expr_access;
         Expression_Analysis_Result expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, true, &expr_access
+            analyser, symbol_table, expression_node.children[0], code_block, true, &expr_access
         );
         if (expr_result.error_occured) {
             return expression_analysis_result_make_error();
@@ -2522,7 +2719,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
     {
         IR_Data_Access pointer_access;
         Expression_Analysis_Result result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, true, &pointer_access
+            analyser, symbol_table, expression_node.children[0], code_block, true, &pointer_access
         );
         if (result.error_occured) {
             return expression_analysis_result_make_error();
@@ -2530,7 +2727,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
 
         Type_Signature* signature = result.type;
         if (signature->type != Signature_Type::POINTER) {
-            semantic_analyser_log_error(analyser, "Cannot dereference non-pointer type", expression_node->children[0]);
+            semantic_analyser_log_error(analyser, "Cannot dereference non-pointer type", expression_node.children[0]);
             return expression_analysis_result_make_error();
         }
 
@@ -2611,10 +2808,10 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
         IR_Data_Access left_access;
         IR_Data_Access right_access;
         Expression_Analysis_Result left_expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[0], code_block, true, &left_access
+            analyser, symbol_table, expression_node.children[0], code_block, true, &left_access
         );
         Expression_Analysis_Result right_expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, expression_node->children[1], code_block, true, &right_access
+            analyser, symbol_table, expression_node.children[1], code_block, true, &right_access
         );
         if (left_expr_result.error_occured || right_expr_result.error_occured) {
             return expression_analysis_result_make_error();
@@ -2625,7 +2822,7 @@ Expression_Analysis_Result semantic_analyser_analyse_expression(
         if (left_expr_result.type != right_expr_result.type)
         {
             bool cast_possible = false;
-            switch (expression_node->type)
+            switch (expression_node.type)
             {
             case AST_Node_Type::EXPRESSION_BINARY_OPERATION_ADDITION:
             case AST_Node_Type::EXPRESSION_BINARY_OPERATION_SUBTRACTION:
@@ -2762,8 +2959,8 @@ Statement_Analysis_Result semantic_analyser_analyse_statement_block
 Statement_Analysis_Result semantic_analyser_analyse_statement(
     Semantic_Analyser* analyser, Symbol_Table* symbol_table, int statement_index, IR_Code_Block* code_block)
 {
-    AST_Node* statement_node = &analyser->compiler->parser.nodes[statement_index];
-    switch (statement_node->type)
+    AST_Node statement_node = ast_parser_get_node(&analyser->compiler->parser, statement_index);
+    switch (statement_node.type)
     {
     case AST_Node_Type::STATEMENT_RETURN:
     {
@@ -2777,7 +2974,7 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
         }
         else
         {
-            if (statement_node->children.size == 0) {
+            if (statement_node.children.size == 0) {
                 return_type = analyser->compiler->type_system.void_type;
                 return_instr.options.return_instr.type = IR_Instruction_Return_Type::RETURN_EMPTY;
             }
@@ -2785,13 +2982,16 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
             {
                 return_instr.options.return_instr.type = IR_Instruction_Return_Type::RETURN_DATA;
                 Expression_Analysis_Result expr_result = semantic_analyser_analyse_expression(
-                    analyser, symbol_table, statement_node->children[0], code_block, true, &return_instr.options.return_instr.options.return_value
+                    analyser, symbol_table, statement_node.children[0], code_block, true, &return_instr.options.return_instr.options.return_value
                 );
-                if (!expr_result.error_occured) {
-                    if (expr_result.type == analyser->compiler->type_system.void_type) {
-                        semantic_analyser_log_error(analyser, "Cannot return void type", statement_index);
-                        return Statement_Analysis_Result::RETURN;
-                    }
+                if (expr_result.error_occured) {
+                    // Type of failed expressions is undefined, and the error was already logged
+                    dynamic_array_push_back(&code_block->instructions, return_instr);
+                    return Statement_Analysis_Result::RETURN;
+                }
+                if (expr_result.type == analyser->compiler->type_system.void_type) {
+                    semantic_analyser_log_error(analyser, "Cannot return void type", statement_index);
+                    return Statement_Analysis_Result::RETURN;
                 }
                 return_type = expr_result.type;
             }
@@ -2823,19 +3023,19 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
     }
     case AST_Node_Type::STATEMENT_EXPRESSION:
     {
-        AST_Node* expression_node = &analyser->compiler->parser.nodes[statement_node->children[0]];
-        if (expression_node->type != AST_Node_Type::EXPRESSION_FUNCTION_CALL) {
+        AST_Node expression_node = ast_parser_get_node(&analyser->compiler->parser, statement_node.children[0]);
+        if (expression_node.type != AST_Node_Type::EXPRESSION_FUNCTION_CALL) {
             semantic_analyser_log_error(analyser, "Expression statement must be function call!", statement_index);
             return Statement_Analysis_Result::NO_RETURN;
         }
         IR_Data_Access temp;
-        semantic_analyser_analyse_expression(analyser, symbol_table, statement_node->children[0], code_block, true, &temp);
+        semantic_analyser_analyse_expression(analyser, symbol_table, statement_node.children[0], code_block, true, &temp);
         return Statement_Analysis_Result::NO_RETURN;
     }
     case AST_Node_Type::STATEMENT_BLOCK: {
         IR_Instruction block_instruction;
         block_instruction.type = IR_Instruction_Type::BLOCK;
-        block_instruction.options.block = ir_code_block_create(code_block->function);
+        block_instruction.options.block = ir_code_block_create(code_block->function, analyser->program->allocator);
         Statement_Analysis_Result result = semantic_analyser_analyse_statement_block(
             analyser, symbol_table, statement_index, block_instruction.options.block
         );
@@ -2847,7 +3047,7 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
         IR_Instruction if_instruction;
         if_instruction.type = IR_Instruction_Type::IF;
         Expression_Analysis_Result expression_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement_node->children[0], code_block, true, &if_instruction.options.if_instr.condition
+            analyser, symbol_table, statement_node.children[0], code_block, true, &if_instruction.options.if_instr.condition
         );
         if (!expression_result.error_occured) {
             if (expression_result.type != analyser->compiler->type_system.bool_type) {
@@ -2855,10 +3055,10 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
             }
         }
 
-        if_instruction.options.if_instr.true_branch = ir_code_block_create(code_block->function);
-        if_instruction.options.if_instr.false_branch = ir_code_block_create(code_block->function);
+        if_instruction.options.if_instr.true_branch = ir_code_block_create(code_block->function, analyser->program->allocator);
+        if_instruction.options.if_instr.false_branch = ir_code_block_create(code_block->function, analyser->program->allocator);
         Statement_Analysis_Result true_branch_result = semantic_analyser_analyse_statement_block(
-            analyser, symbol_table, statement_node->children[1], if_instruction.options.if_instr.true_branch
+            analyser, symbol_table, statement_node.children[1], if_instruction.options.if_instr.true_branch
         );
         dynamic_array_push_back(&code_block->instructions, if_instruction);
         return Statement_Analysis_Result::NO_RETURN;
@@ -2868,7 +3068,7 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
         IR_Instruction if_instruction;
         if_instruction.type = IR_Instruction_Type::IF;
         Expression_Analysis_Result expression_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement_node->children[0], code_block, true, &if_instruction.options.if_instr.condition
+            analyser, symbol_table, statement_node.children[0], code_block, true, &if_instruction.options.if_instr.condition
         );
         if (!expression_result.error_occured) {
             if (expression_result.type != analyser->compiler->type_system.bool_type) {
@@ -2876,13 +3076,13 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
             }
         }
 
-        if_instruction.options.if_instr.true_branch = ir_code_block_create(code_block->function);
-        if_instruction.options.if_instr.false_branch = ir_code_block_create(code_block->function);
+        if_instruction.options.if_instr.true_branch = ir_code_block_create(code_block->function, analyser->program->allocator);
+        if_instruction.options.if_instr.false_branch = ir_code_block_create(code_block->function, analyser->program->allocator);
         Statement_Analysis_Result true_branch_result = semantic_analyser_analyse_statement_block(
-            analyser, symbol_table, statement_node->children[1], if_instruction.options.if_instr.true_branch
+            analyser, symbol_table, statement_node.children[1], if_instruction.options.if_instr.true_branch
         );
         Statement_Analysis_Result false_branch_result = semantic_analyser_analyse_statement_block(
-            analyser, symbol_table, statement_node->children[2], if_instruction.options.if_instr.false_branch
+            analyser, symbol_table, statement_node.children[2], if_instruction.options.if_instr.false_branch
         );
         dynamic_array_push_back(&code_block->instructions, if_instruction);
 
@@ -2893,9 +3093,9 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
     {
         IR_Instruction while_instruction;
         while_instruction.type = IR_Instruction_Type::WHILE;
-        while_instruction.options.while_instr.condition_code = ir_code_block_create(code_block->function);
+        while_instruction.options.while_instr.condition_code = ir_code_block_create(code_block->function, analyser->program->allocator);
         Expression_Analysis_Result expression_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement_node->children[0], while_instruction.options.while_instr.condition_code,
+            analyser, symbol_table, statement_node.children[0], while_instruction.options.while_instr.condition_code,
             true, &while_instruction.options.while_instr.condition_access
         );
         if (!expression_result.error_occured) {
@@ -2904,10 +3104,10 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
             }
         }
 
-        while_instruction.options.while_instr.code = ir_code_block_create(code_block->function);
+        while_instruction.options.while_instr.code = ir_code_block_create(code_block->function, analyser->program->allocator);
         analyser->loop_depth++;
         Statement_Analysis_Result code_result = semantic_analyser_analyse_statement_block(
-            analyser, symbol_table, statement_node->children[1], while_instruction.options.while_instr.code
+            analyser, symbol_table, statement_node.children[1], while_instruction.options.while_instr.code
         );
         analyser->loop_depth--;
         dynamic_array_push_back(&code_block->instructions, while_instruction);
@@ -2927,7 +3127,7 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
     {
         IR_Data_Access delete_access;
         Expression_Analysis_Result expr_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement_node->children[0], code_block, true, &delete_access
+            analyser, symbol_table, statement_node.children[0], code_block, true, &delete_access
         );
         if (expr_result.error_occured) {
             return Statement_Analysis_Result::NO_RETURN;
@@ -2940,7 +3140,7 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
 
         IR_Instruction delete_instr;
         delete_instr.type = IR_Instruction_Type::FUNCTION_CALL;
-        delete_instr.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1);
+        delete_instr.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1, analyser->program->allocator);
         delete_instr.options.call.call_type = IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL;
         delete_instr.options.call.destination = {};
         delete_instr.options.call.options.hardcoded = analyser->program->hardcoded_functions[(int)IR_Hardcoded_Function_Type::FREE_POINTER];
@@ -2972,7 +3172,7 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
     {
         IR_Data_Access left_access;
         Expression_Analysis_Result left_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement_node->children[0], code_block, true, &left_access
+            analyser, symbol_table, statement_node.children[0], code_block, true, &left_access
         );
         if (left_result.error_occured) {
             return Statement_Analysis_Result::NO_RETURN;
@@ -2980,7 +3180,7 @@ Statement_Analysis_Result semantic_analyser_analyse_statement(
 
         IR_Data_Access right_access;
         Expression_Analysis_Result right_result = semantic_analyser_analyse_expression(
-            analyser, symbol_table, statement_node->children[1], code_block, true, &right_access
+            analyser, symbol_table, statement_node.children[1], code_block, true, &right_access
         );
         if (right_result.error_occured) {
             return Statement_Analysis_Result::NO_RETURN;
@@ -3030,10 +3230,10 @@ Statement_Analysis_Result semantic_analyser_analyse_statement_block
 
     bool unreachable = false;
     Statement_Analysis_Result result = Statement_Analysis_Result::NO_RETURN;
-    AST_Node* block_node = &analyser->compiler->parser.nodes[block_index];
-    for (int i = 0; i < block_node->children.size; i++)
+    AST_Node block_node = ast_parser_get_node(&analyser->compiler->parser, block_index);
+    for (int i = 0; i < block_node.children.size; i++)
     {
-        Statement_Analysis_Result statement_result = semantic_analyser_analyse_statement(analyser, block_table, block_node->children[i], code_block);
+        Statement_Analysis_Result statement_result = semantic_analyser_analyse_statement(analyser, block_table, block_node.children[i], code_block);
         switch (statement_result)
         {
         case Statement_Analysis_Result::BREAK:
@@ -3041,10 +3241,10 @@ Statement_Analysis_Result semantic_analyser_analyse_statement_block
             if (!unreachable)
             {
                 result = Statement_Analysis_Result::NO_RETURN;
-                if (i != block_node->children.size - 1) {
+                if (i != block_node.children.size - 1) {
                     // This should probably be a warning
                     semantic_analyser_log_error(analyser, "Code will never be reached, break or continue before prevents that!",
-                        block_node->children[i + 1], block_node->children[block_node->children.size - 1]);
+                        block_node.children[i + 1], block_node.children[block_node.children.size - 1]);
                 }
                 unreachable = true;
             }
@@ -3054,10 +3254,10 @@ Statement_Analysis_Result semantic_analyser_analyse_statement_block
             if (!unreachable)
             {
                 result = Statement_Analysis_Result::RETURN;
-                if (i != block_node->children.size - 1) {
+                if (i != block_node.children.size - 1) {
                     // This should probably be a warning
                     semantic_analyser_log_error(analyser, "Code will never be reached, return before prevents that!",
-                        block_node->children[i + 1], block_node->children[block_node->children.size - 1]);
+                        block_node.children[i + 1], block_node.children[block_node.children.size - 1]);
                 }
                 unreachable = true;
             }
@@ -3070,27 +3270,510 @@ Statement_Analysis_Result semantic_analyser_analyse_statement_block
     return result;
 }
 
-void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
+void semantic_analyser_collect_referenced_names(Semantic_Analyser* analyser, int node_index, Dynamic_Array<int>* names)
 {
-    analyser->compiler = compiler;
-    for (int i = 0; i < analyser->symbol_tables.size; i++) {
+    AST_Node node = ast_parser_get_node(&analyser->compiler->parser, node_index);
+    if (node.type == AST_Node_Type::IDENTIFIER || node.type == AST_Node_Type::IDENTIFIER_PATH) {
+        dynamic_array_push_back(names, node.name_id);
+    }
+    for (int i = 0; i < node.children.size; i++) {
+        semantic_analyser_collect_referenced_names(analyser, node.children[i], names);
+    }
+}
+
+// Hashes everything a lookup of the symbol can observe, the defining table is included because of shadowing
+u64 semantic_analyser_hash_symbol(Symbol_Table* table, Symbol* symbol)
+{
+    u64 parts[4];
+    parts[0] = (u64)table->ast_node_index;
+    parts[1] = (u64)symbol->symbol_type;
+    parts[2] = 0;
+    parts[3] = 0;
+    switch (symbol->symbol_type)
+    {
+    case Symbol_Type::FUNCTION:
+        parts[2] = (u64)symbol->options.function;
+        parts[3] = (u64)symbol->options.function->function_type;
+        break;
+    case Symbol_Type::HARDCODED_FUNCTION:
+        parts[2] = (u64)symbol->options.hardcoded_function;
+        break;
+    case Symbol_Type::TYPE:
+        parts[2] = (u64)symbol->options.data_type;
+        break;
+    case Symbol_Type::VARIABLE:
+        parts[2] = (u64)ir_data_access_get_type(&symbol->options.variable_access);
+        parts[3] = (u64)symbol->options.variable_access.index;
+        break;
+    case Symbol_Type::MODULE:
+        parts[2] = (u64)symbol->definition_node_index;
+        break;
+    default: panic("");
+    }
+    return hash_memory(array_create_static((byte*)parts, sizeof(parts)));
+}
+
+void semantic_analyser_update_symbol_signatures(Semantic_Analyser* analyser, int top_level_table_count)
+{
+    Hashtable<int, u64, Hasher_I32> swap = analyser->previous_symbol_signatures;
+    analyser->previous_symbol_signatures = analyser->symbol_signatures;
+    analyser->symbol_signatures = swap;
+    hashtable_reset(&analyser->symbol_signatures);
+    for (int i = 0; i < top_level_table_count; i++)
+    {
         Symbol_Table* table = analyser->symbol_tables[i];
-        dynamic_array_destroy(&table->symbols);
-        delete analyser->symbol_tables[i];
+        for (int j = 0; j < table->symbols.size; j++)
+        {
+            Symbol* symbol = &table->symbols[j];
+            // Summed so that the order of definitions does not matter
+            u64 hash = semantic_analyser_hash_symbol(table, symbol);
+            u64* signature = hashtable_find_element(&analyser->symbol_signatures, symbol->name_handle);
+            if (signature != 0) {
+                *signature += hash;
+            }
+            else {
+                hashtable_insert_element(&analyser->symbol_signatures, symbol->name_handle, hash);
+            }
+        }
+    }
+}
+
+bool semantic_analyser_referenced_symbols_changed(Semantic_Analyser* analyser, Dynamic_Array<int>* names)
+{
+    for (int i = 0; i < names->size; i++)
+    {
+        u64* current = hashtable_find_element(&analyser->symbol_signatures, names->data[i]);
+        u64* previous = hashtable_find_element(&analyser->previous_symbol_signatures, names->data[i]);
+        if ((current == 0) != (previous == 0)) return true;
+        if (current != 0 && *current != *previous) return true;
+    }
+    return false;
+}
+
+void semantic_analyser_log_cached_errors(Semantic_Analyser* analyser, Dynamic_Array<Semantic_Cached_Error>* errors)
+{
+    for (int i = 0; i < errors->size; i++) {
+        Semantic_Cached_Error error = errors->data[i];
+        semantic_analyser_log_error(analyser, error.message, error.start_node_index, error.end_node_index);
+    }
+}
+
+struct Queued_Function
+{
+    AST_Node_Index node_index;
+    IR_Function* function;
+    Symbol_Table* function_symbol_table;
+};
+
+bool semantic_analyser_function_cache_is_reusable(Semantic_Analyser* analyser, Semantic_Function_Cache* cache, IR_Function* function)
+{
+    bool is_entry_function = function == analyser->program->entry_function;
+    return cache->body_valid && cache->was_entry_function == is_entry_function &&
+        !semantic_analyser_referenced_symbols_changed(analyser, &cache->referenced_names);
+}
+
+// Bodies with inlined copies of a function that is analysed again are outdated, so they are analysed again too
+void semantic_analyser_invalidate_outdated_inlining(Semantic_Analyser* analyser, Dynamic_Array<Queued_Function>* queued_functions)
+{
+    Hashtable<IR_Function*, bool, Hasher_Pointer<IR_Function*>> analysed_again =
+        hashtable_create_empty<IR_Function*, bool, Hasher_Pointer<IR_Function*>>(64);
+    SCOPE_EXIT(hashtable_destroy(&analysed_again));
+    hashtable_insert_element(&analysed_again, analyser->global_init_function, true);
+    for (int i = 0; i < queued_functions->size; i++) {
+        Queued_Function item = queued_functions->data[i];
+        Semantic_Function_Cache* cache = hashtable_find_element(&analyser->function_cache, item.node_index);
+        if (!semantic_analyser_function_cache_is_reusable(analyser, cache, item.function)) {
+            hashtable_insert_element(&analysed_again, item.function, true);
+        }
+    }
+
+    // Inlined function lists are transitive, so checking them once is enough
+    for (int i = 0; i < queued_functions->size; i++)
+    {
+        Queued_Function item = queued_functions->data[i];
+        Semantic_Function_Cache* cache = hashtable_find_element(&analyser->function_cache, item.node_index);
+        for (int j = 0; j < item.function->inlined_functions.size && cache->body_valid; j++) {
+            if (hashtable_find_element(&analysed_again, item.function->inlined_functions[j]) != 0) {
+                cache->body_valid = false;
+            }
+        }
     }
-    type_system_reset_all(&analyser->compiler->type_system, &analyser->compiler->lexer);
+}
+
+// Returns false if the cached body was reused
+bool semantic_analyser_analyse_function_body(Semantic_Analyser* analyser, Queued_Function item, bool reuse_cache)
+{
+    Semantic_Function_Cache* cache = hashtable_find_element(&analyser->function_cache, item.node_index);
+    bool is_entry_function = item.function == analyser->program->entry_function;
+    if (reuse_cache && semantic_analyser_function_cache_is_reusable(analyser, cache, item.function))
+    {
+        semantic_analyser_log_cached_errors(analyser, &cache->errors);
+        return false;
+    }
+    // Workers allocate bodies in their own arena, the code block created with the function belongs to the main program
+    if (reuse_cache || analyser->program->allocator != item.function->program->allocator) {
+        item.function->code = ir_code_block_create(item.function, analyser->program->allocator);
+    }
+    dynamic_array_reset(&item.function->inlined_functions);
+    dynamic_array_reset(&cache->errors);
+    analyser->error_recording = &cache->errors;
+    analyser->analysed_function_count++;
+
+    analyser->loop_depth = 0;
+    AST_Node function_node = ast_parser_get_node(&analyser->compiler->parser, item.node_index);
+    if (is_entry_function) {
+        IR_Instruction call_instr;
+        call_instr.type = IR_Instruction_Type::FUNCTION_CALL;
+        call_instr.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1, analyser->program->allocator);
+        call_instr.options.call.call_type = IR_Instruction_Call_Type::FUNCTION_CALL;
+        call_instr.options.call.options.function = analyser->global_init_function;
+        dynamic_array_push_back(&item.function->code->instructions, call_instr);
+    }
+
+    Statement_Analysis_Result block_result = semantic_analyser_analyse_statement_block(
+        analyser, item.function_symbol_table, function_node.children[1], item.function->code
+    );
+
+    if (block_result == Statement_Analysis_Result::NO_RETURN)
+    {
+        if (item.function->function_type->return_type == analyser->compiler->type_system.void_type) {
+            IR_Instruction return_instr;
+            return_instr.type = IR_Instruction_Type::RETURN;
+            if (is_entry_function) {
+                return_instr.options.return_instr.type = IR_Instruction_Return_Type::EXIT;
+                return_instr.options.return_instr.options.exit_code = Exit_Code::SUCCESS;
+            }
+            else {
+                return_instr.options.return_instr.type = IR_Instruction_Return_Type::RETURN_EMPTY;
+            }
+            dynamic_array_push_back(&item.function->code->instructions, return_instr);
+        }
+        else {
+            semantic_analyser_log_error(analyser, "No return found inside function", item.node_index);
+        }
+    }
+
+    analyser->error_recording = 0;
+    dynamic_array_reset(&cache->referenced_names);
+    semantic_analyser_collect_referenced_names(analyser, item.node_index, &cache->referenced_names);
+    cache->body_valid = true;
+    cache->was_entry_function = is_entry_function;
+    return true;
+}
+
+void ir_data_access_move_to_program(IR_Data_Access* access, IR_Program* from, IR_Program* to, int constant_base)
+{
+    if (access->type != IR_Data_Access_Type::CONSTANT && access->type != IR_Data_Access_Type::GLOBAL_DATA) return;
+    if (access->option.program != from) return;
+    if (access->type == IR_Data_Access_Type::CONSTANT) {
+        access->index += constant_base;
+    }
+    access->option.program = to;
+}
+
+// Redirects constant and global accesses of the from program to the to program, constant indices are offset by constant_base
+void ir_code_block_move_to_program(IR_Code_Block* code_block, IR_Program* from, IR_Program* to, int constant_base)
+{
+    for (int i = 0; i < code_block->instructions.size; i++)
+    {
+        IR_Instruction* instr = &code_block->instructions[i];
+        switch (instr->type)
+        {
+        case IR_Instruction_Type::FUNCTION_CALL:
+        {
+            IR_Instruction_Call* call = &instr->options.call;
+            Type_Signature* function_sig = 0;
+            switch (call->call_type)
+            {
+            case IR_Instruction_Call_Type::FUNCTION_CALL:
+                function_sig = call->options.function->function_type;
+                break;
+            case IR_Instruction_Call_Type::FUNCTION_POINTER_CALL:
+                ir_data_access_move_to_program(&call->options.pointer_access, from, to, constant_base);
+                function_sig = ir_data_access_get_type(&call->options.pointer_access)->child_type;
+                break;
+            case IR_Instruction_Call_Type::HARDCODED_FUNCTION_CALL:
+                function_sig = call->options.hardcoded->signature;
+                break;
+            default: panic("Error");
+            }
+            for (int j = 0; j < call->arguments.size; j++) {
+                ir_data_access_move_to_program(&call->arguments[j], from, to, constant_base);
+            }
+            if (function_sig->return_type->type != Signature_Type::VOID_TYPE) {
+                ir_data_access_move_to_program(&call->destination, from, to, constant_base);
+            }
+            break;
+        }
+        case IR_Instruction_Type::IF:
+            ir_data_access_move_to_program(&instr->options.if_instr.condition, from, to, constant_base);
+            ir_code_block_move_to_program(instr->options.if_instr.true_branch, from, to, constant_base);
+            ir_code_block_move_to_program(instr->options.if_instr.false_branch, from, to, constant_base);
+            break;
+        case IR_Instruction_Type::WHILE:
+            ir_code_block_move_to_program(instr->options.while_instr.condition_code, from, to, constant_base);
+            ir_data_access_move_to_program(&instr->options.while_instr.condition_access, from, to, constant_base);
+            ir_code_block_move_to_program(instr->options.while_instr.code, from, to, constant_base);
+            break;
+        case IR_Instruction_Type::BLOCK:
+            ir_code_block_move_to_program(instr->options.block, from, to, constant_base);
+            break;
+        case IR_Instruction_Type::BREAK:
+        case IR_Instruction_Type::CONTINUE:
+            break;
+        case IR_Instruction_Type::RETURN:
+            if (instr->options.return_instr.type == IR_Instruction_Return_Type::RETURN_DATA) {
+                ir_data_access_move_to_program(&instr->options.return_instr.options.return_value, from, to, constant_base);
+            }
+            break;
+        case IR_Instruction_Type::MOVE:
+            ir_data_access_move_to_program(&instr->options.move.destination, from, to, constant_base);
+            ir_data_access_move_to_program(&instr->options.move.source, from, to, constant_base);
+            break;
+        case IR_Instruction_Type::CAST:
+            ir_data_access_move_to_program(&instr->options.cast.destination, from, to, constant_base);
+            ir_data_access_move_to_program(&instr->options.cast.source, from, to, constant_base);
+            break;
+        case IR_Instruction_Type::ADDRESS_OF:
+        {
+            IR_Instruction_Address_Of* address_of = &instr->options.address_of;
+            ir_data_access_move_to_program(&address_of->destination, from, to, constant_base);
+            if (address_of->type != IR_Instruction_Address_Of_Type::FUNCTION) {
+                ir_data_access_move_to_program(&address_of->source, from, to, constant_base);
+            }
+            if (address_of->type == IR_Instruction_Address_Of_Type::ARRAY_ELEMENT) {
+                ir_data_access_move_to_program(&address_of->options.index_access, from, to, constant_base);
+            }
+            break;
+        }
+        case IR_Instruction_Type::UNARY_OP:
+            ir_data_access_move_to_program(&instr->options.unary_op.destination, from, to, constant_base);
+            ir_data_access_move_to_program(&instr->options.unary_op.source, from, to, constant_base);
+            break;
+        case IR_Instruction_Type::BINARY_OP:
+            ir_data_access_move_to_program(&instr->options.binary_op.destination, from, to, constant_base);
+            ir_data_access_move_to_program(&instr->options.binary_op.operand_left, from, to, constant_base);
+            ir_data_access_move_to_program(&instr->options.binary_op.operand_right, from, to, constant_base);
+            break;
+        default: panic("Lul");
+        }
+    }
+}
+
+u64 semantic_analyser_get_ir_memory_size(Semantic_Analyser* analyser)
+{
+    u64 size = arena_get_allocated_size(&analyser->ir_arena);
+    for (int i = 0; i < analyser->workers.size; i++) {
+        size += arena_get_allocated_size(&analyser->workers[i].ir_arena);
+    }
+    return size;
+}
+
+struct Semantic_Analysis_Parallel_Work
+{
+    Semantic_Analyser* analyser;
+    Dynamic_Array<Queued_Function>* queued_functions;
+    bool reuse_cache;
+};
+
+void semantic_analyser_worker_analyse_bodies(void* userdata, int worker_index)
+{
+    Semantic_Analysis_Parallel_Work* work = (Semantic_Analysis_Parallel_Work*)userdata;
+    Semantic_Analysis_Worker* worker = &work->analyser->workers[worker_index];
+    thread_lookup_statistics = &worker->analyser.lookup_statistics;
+    for (int i = worker->first_function; i < worker->function_end; i++)
+    {
+        Queued_Function item = work->queued_functions->data[i];
+        if (semantic_analyser_analyse_function_body(&worker->analyser, item, work->reuse_cache)) {
+            dynamic_array_push_back(&worker->analysed_functions, item.function);
+        }
+    }
+    thread_lookup_statistics = 0;
+}
+
+void semantic_analyser_worker_move_bodies_to_program(void* userdata, int worker_index)
+{
+    Semantic_Analysis_Parallel_Work* work = (Semantic_Analysis_Parallel_Work*)userdata;
+    Semantic_Analysis_Worker* worker = &work->analyser->workers[worker_index];
+    for (int i = 0; i < worker->analysed_functions.size; i++) {
+        ir_code_block_move_to_program(worker->analysed_functions[i]->code, &worker->program, work->analyser->program, worker->constant_base);
+    }
+}
+
+// Below this many body tokens per worker, dispatching to the thread pool costs more than it saves
+const int SEMANTIC_ANALYSER_PARALLEL_TOKENS_PER_WORKER = 4096;
+
+// Returns 1 if the bodies should be analysed serially
+int semantic_analyser_body_worker_count(Semantic_Analyser* analyser, Dynamic_Array<Queued_Function>* queued_functions)
+{
+    AST_Parser* parser = &analyser->compiler->parser;
+    i64 total_size = 0;
+    for (int i = 0; i < queued_functions->size; i++) {
+        Token_Range range = parser->token_mapping[queued_functions->data[i].node_index];
+        total_size += range.end_index - range.start_index + 1;
+    }
+    int worker_count = math_minimum(analyser->body_worker_count, queued_functions->size);
+    worker_count = (int)math_minimum((i64)worker_count, total_size / SEMANTIC_ANALYSER_PARALLEL_TOKENS_PER_WORKER);
+    return math_maximum(worker_count, 1);
+}
+
+void semantic_analyser_analyse_function_bodies_parallel(Semantic_Analyser* analyser, Dynamic_Array<Queued_Function>* queued_functions, bool reuse_cache, int worker_count)
+{
+    while (analyser->workers.size < worker_count) {
+        Semantic_Analysis_Worker worker;
+        worker.ir_arena = arena_create(1024 * 1024);
+        worker.symbol_table_arena = arena_create(64 * 1024);
+        worker.analysed_functions = dynamic_array_create_empty<IR_Function*>(64);
+        dynamic_array_push_back(&analyser->workers, worker);
+    }
+
+    // Consecutive ranges of similar token count, merging the workers in order keeps the order of errors, symbol tables and constants
+    {
+        AST_Parser* parser = &analyser->compiler->parser;
+        i64 total_size = 0;
+        for (int i = 0; i < queued_functions->size; i++) {
+            Token_Range range = parser->token_mapping[queued_functions->data[i].node_index];
+            total_size += range.end_index - range.start_index + 1;
+        }
+        i64 accumulated_size = 0;
+        int function_index = 0;
+        for (int i = 0; i < worker_count; i++)
+        {
+            Semantic_Analysis_Worker* worker = &analyser->workers[i];
+            worker->first_function = function_index;
+            i64 range_end_size = total_size * (i + 1) / worker_count;
+            while (function_index < queued_functions->size && (accumulated_size < range_end_size || i == worker_count - 1)) {
+                Token_Range range = parser->token_mapping[queued_functions->data[function_index].node_index];
+                accumulated_size += range.end_index - range.start_index + 1;
+                function_index++;
+            }
+            worker->function_end = function_index;
+        }
+    }
+
+    // Workers are shallow copies of the analyser, everything they write to is replaced
+    for (int i = 0; i < worker_count; i++)
+    {
+        Semantic_Analysis_Worker* worker = &analyser->workers[i];
+        worker->program = *analyser->program;
+        worker->program.allocator = &worker->ir_arena.allocator;
+        worker->program.constant_pool.constants = dynamic_array_create_empty<IR_Constant>(64);
+        worker->program.constant_pool.constant_memory = dynamic_array_create_empty<byte>(256);
+        arena_reset(&worker->symbol_table_arena);
+        dynamic_array_reset(&worker->analysed_functions);
+
+        Semantic_Analyser* copy = &worker->analyser;
+        *copy = *analyser;
+        copy->program = &worker->program;
+        copy->symbol_tables = dynamic_array_create_empty<Symbol_Table*>(64);
+        copy->ast_to_symbol_table = hashtable_create_empty<int, Symbol_Table*, Hasher_I32>(64);
+        copy->errors = dynamic_array_create_empty<Compiler_Error>(16);
+        copy->symbol_table_allocator = &worker->symbol_table_arena.allocator;
+        copy->error_recording = 0;
+        copy->analysed_function_count = 0;
+        copy->lookup_statistics.lookup_count = 0;
+        copy->lookup_statistics.tables_visited = 0;
+        copy->lookup_statistics.hashed_tables_visited = 0;
+    }
+
+    Semantic_Analysis_Parallel_Work work;
+    work.analyser = analyser;
+    work.queued_functions = queued_functions;
+    work.reuse_cache = reuse_cache;
+    analyser->compiler->type_system.is_concurrent = true;
+    parallel_run(worker_count, semantic_analyser_worker_analyse_bodies, &work);
+    analyser->compiler->type_system.is_concurrent = false;
+
+    // Merge worker results
+    IR_Constant_Pool* pool = &analyser->program->constant_pool;
+    for (int i = 0; i < worker_count; i++)
+    {
+        Semantic_Analysis_Worker* worker = &analyser->workers[i];
+        Semantic_Analyser* copy = &worker->analyser;
+
+        // Constants, the memory is aligned so that worker constants keep their alignment
+        IR_Constant_Pool* worker_pool = &worker->program.constant_pool;
+        int alignment = 1;
+        for (int j = 0; j < worker_pool->constants.size; j++) {
+            alignment = math_maximum(alignment, worker_pool->constants[j].type->alignment_in_bytes);
+        }
+        while (pool->constant_memory.size % alignment != 0) {
+            dynamic_array_push_back(&pool->constant_memory, (byte)0);
+        }
+        worker->constant_base = pool->constants.size;
+        int memory_base = pool->constant_memory.size;
+        for (int j = 0; j < worker_pool->constants.size; j++) {
+            IR_Constant constant = worker_pool->constants[j];
+            constant.offset += memory_base;
+            dynamic_array_push_back(&pool->constants, constant);
+        }
+        dynamic_array_reserve(&pool->constant_memory, pool->constant_memory.size + worker_pool->constant_memory.size);
+        for (int j = 0; j < worker_pool->constant_memory.size; j++) {
+            dynamic_array_push_back(&pool->constant_memory, worker_pool->constant_memory[j]);
+        }
+        dynamic_array_destroy(&worker_pool->constants);
+        dynamic_array_destroy(&worker_pool->constant_memory);
+
+        for (int j = 0; j < copy->errors.size; j++) {
+            dynamic_array_push_back(&analyser->errors, copy->errors[j]);
+        }
+        for (int j = 0; j < copy->symbol_tables.size; j++) {
+            Symbol_Table* table = copy->symbol_tables[j];
+            table->statistics = &analyser->lookup_statistics;
+            dynamic_array_push_back(&analyser->symbol_tables, table);
+            hashtable_insert_element(&analyser->ast_to_symbol_table, table->ast_node_index, table);
+        }
+        dynamic_array_destroy(&copy->errors);
+        dynamic_array_destroy(&copy->symbol_tables);
+        hashtable_destroy(&copy->ast_to_symbol_table);
+
+        analyser->analysed_function_count += copy->analysed_function_count;
+        analyser->lookup_statistics.lookup_count += copy->lookup_statistics.lookup_count;
+        analyser->lookup_statistics.tables_visited += copy->lookup_statistics.tables_visited;
+        analyser->lookup_statistics.hashed_tables_visited += copy->lookup_statistics.hashed_tables_visited;
+    }
+
+    parallel_run(worker_count, semantic_analyser_worker_move_bodies_to_program, &work);
+}
+
+void semantic_analyser_analyse_internal(Semantic_Analyser* analyser, Compiler* compiler, bool incremental)
+{
+    // Symbol tables of the last analysis were allocated in the compiler arena, which compiler_compile already reset
+    analyser->compiler = compiler;
     dynamic_array_reset(&analyser->symbol_tables);
     dynamic_array_reset(&analyser->errors);
     dynamic_array_reset(&analyser->location_functions);
     dynamic_array_reset(&analyser->location_globals);
     dynamic_array_reset(&analyser->location_structs);
     hashtable_reset(&analyser->ast_to_symbol_table);
+    analyser->analysed_function_count = 0;
+    analyser->error_recording = 0;
+    analyser->lookup_statistics.lookup_count = 0;
+    analyser->lookup_statistics.tables_visited = 0;
+    analyser->lookup_statistics.hashed_tables_visited = 0;
+    analyser->symbol_table_allocator = &compiler->arena.allocator;
+
+    // Replaced function bodies stay in the ir_arena until the next reset
+    bool reuse_cache = incremental &&
+        analyser->program != 0 &&
+        analyser->cache_parse_generation == compiler->parser.parse_generation &&
+        semantic_analyser_get_ir_memory_size(analyser) < analyser->ir_arena_size_after_reset * 4 + 1024 * 1024;
+    if (reuse_cache) {
+        dynamic_array_reset(&analyser->program->functions);
+        dynamic_array_reset(&analyser->program->globals);
+    }
+    else {
+        type_system_reset_all(&analyser->compiler->type_system, &analyser->compiler->lexer);
+        semantic_analyser_reset_cache(analyser);
+        arena_reset(&analyser->ir_arena);
+        for (int i = 0; i < analyser->workers.size; i++) {
+            arena_reset(&analyser->workers[i].ir_arena);
+        }
+        analyser->program = ir_program_create(&analyser->compiler->type_system, &analyser->ir_arena.allocator);
+        analyser->cache_parse_generation = compiler->parser.parse_generation;
+    }
 
     analyser->root_table = semantic_analyser_create_symbol_table(analyser, nullptr, 0);
-    if (analyser->program != 0) {
-        ir_program_destroy(analyser->program);
-    }
-    analyser->program = ir_program_create(&analyser->compiler->type_system);
 
     // Add symbols for basic datatypes
     {
@@ -3189,17 +3872,41 @@ void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
     }
 
     semantic_analyser_find_definitions(analyser, analyser->root_table, 0);
+    int top_level_table_count = analyser->symbol_tables.size;
+
+    // Struct layouts are baked into the IR, so any change to the struct declarations requires a full analysis
+    if (reuse_cache)
+    {
+        bool structs_changed = analyser->location_structs.size != analyser->cached_struct_nodes.size;
+        for (int i = 0; i < analyser->location_structs.size && !structs_changed; i++) {
+            structs_changed = analyser->location_structs[i].node_index != analyser->cached_struct_nodes[i];
+        }
+        if (structs_changed) {
+            semantic_analyser_analyse_internal(analyser, compiler, false);
+            return;
+        }
+    }
 
     // First analyse structs, then function headers, then globals, then function code
-    Dynamic_Array<AST_Node>* nodes = &analyser->compiler->parser.nodes;
+    AST_Parser* parser = &analyser->compiler->parser;
     // Analyse Structs
+    if (reuse_cache)
     {
-        Dynamic_Array<Type_Signature*> struct_types = dynamic_array_create_empty<Type_Signature*>(32);
-        SCOPE_EXIT(dynamic_array_destroy(&struct_types));
+        for (int i = 0; i < analyser->location_structs.size; i++) {
+            AST_Top_Level_Node_Location struct_loc = analyser->location_structs[i];
+            semantic_analyser_define_type(analyser, struct_loc.table, parser->node_name_ids[struct_loc.node_index],
+                analyser->cached_struct_types[i], struct_loc.node_index);
+        }
+        semantic_analyser_log_cached_errors(analyser, &analyser->cached_struct_errors);
+    }
+    else
+    {
+        Dynamic_Array<Type_Signature*>* struct_types = &analyser->cached_struct_types;
+        analyser->error_recording = &analyser->cached_struct_errors;
         for (int i = 0; i < analyser->location_structs.size; i++)
         {
             AST_Top_Level_Node_Location struct_loc = analyser->location_structs[i];
-            AST_Node* struct_node = &nodes->data[struct_loc.node_index];
+            AST_Node struct_node = ast_parser_get_node(parser, struct_loc.node_index);
 
             Type_Signature* signature = new Type_Signature();
             signature->type = Signature_Type::STRUCT;
@@ -3207,27 +3914,28 @@ void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
             signature->alignment_in_bytes = 0;
             signature->size_in_bytes = 0;
             type_system_register_type(&analyser->compiler->type_system, signature);
-            dynamic_array_push_back(&struct_types, signature);
-            semantic_analyser_define_type(analyser, struct_loc.table, struct_node->name_id, signature, struct_loc.node_index);
+            dynamic_array_push_back(struct_types, signature);
+            dynamic_array_push_back(&analyser->cached_struct_nodes, struct_loc.node_index);
+            semantic_analyser_define_type(analyser, struct_loc.table, struct_node.name_id, signature, struct_loc.node_index);
 
-            if (struct_node->children.size == 0) {
+            if (struct_node.children.size == 0) {
                 semantic_analyser_log_error(analyser, "Struct cannot have 0 members", struct_loc.node_index);
             }
         }
 
         // Create members
-        for (int i = 0; i < struct_types.size; i++)
+        for (int i = 0; i < struct_types->size; i++)
         {
-            Type_Signature* struct_type = struct_types[i];
+            Type_Signature* struct_type = struct_types->data[i];
             AST_Top_Level_Node_Location struct_loc = analyser->location_structs[i];
-            AST_Node* struct_node = &nodes->data[struct_loc.node_index];
+            AST_Node struct_node = ast_parser_get_node(parser, struct_loc.node_index);
 
-            for (int j = 0; j < struct_node->children.size; j++)
+            for (int j = 0; j < struct_node.children.size; j++)
             {
-                AST_Node* child_node = &nodes->data[struct_node->children[j]];
+                AST_Node child_node = ast_parser_get_node(parser, struct_node.children[j]);
                 Struct_Member member;
-                member.name_handle = child_node->name_id;
-                member.type = semantic_analyser_analyse_type(analyser, struct_loc.table, child_node->children[0]);
+                member.name_handle = child_node.name_id;
+                member.type = semantic_analyser_analyse_type(analyser, struct_loc.table, child_node.children[0]);
                 member.offset = 0;
                 dynamic_array_push_back(&struct_type->member_types, member);
             }
@@ -3244,11 +3952,12 @@ void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
         );
         SCOPE_EXIT(hashset_destroy(&visited_structs));
         SCOPE_EXIT(hashset_destroy(&finished_structs));
-        for (int i = 0; i < struct_types.size; i++)
+        for (int i = 0; i < struct_types->size; i++)
         {
-            Type_Signature* struct_type = struct_types[i];
+            Type_Signature* struct_type = struct_types->data[i];
             semantic_analyser_calculate_struct_size(analyser, struct_type, &visited_structs, &finished_structs, analyser->location_structs[i].node_index);
         }
+        analyser->error_recording = 0;
 
         // Recalculate sized array sizes
         for (int j = 0; j < compiler->type_system.types.size; j++) {
@@ -3263,40 +3972,43 @@ void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
         }
     }
 
-    struct Queued_Function
-    {
-        AST_Node_Index node_index;
-        IR_Function* function;
-        Symbol_Table* function_symbol_table;
-    };
     Dynamic_Array<Queued_Function> queued_functions = dynamic_array_create_empty<Queued_Function>(64);
     SCOPE_EXIT(dynamic_array_destroy(&queued_functions));
 
+    // Functions keep their IR_Function between incremental analyses, so calls in reused bodies stay valid.
+    // The cache is rebuilt each analysis, replaced declarations take over the function of the same name.
+    Hashtable<int, Semantic_Function_Cache, Hasher_I32> previous_cache = analyser->function_cache;
+    analyser->function_cache = hashtable_create_empty<int, Semantic_Function_Cache, Hasher_I32>(math_maximum(analyser->location_functions.size, 64));
+    for (int i = 0; i < analyser->location_functions.size; i++) {
+        Semantic_Function_Cache* cached = hashtable_find_element(&previous_cache, analyser->location_functions[i].node_index);
+        if (cached != 0) cached->claimed = true;
+    }
+
     // Analyse function headers
     {
         analyser->program->entry_function = 0;
         for (int i = 0; i < analyser->location_functions.size; i++)
         {
             AST_Top_Level_Node_Location loc = analyser->location_functions[i];
-            int function_name = analyser->compiler->parser.nodes[loc.node_index].name_id;
-            AST_Node* function_node = &nodes->data[loc.node_index];
-            AST_Node* signature_node = &nodes->data[function_node->children[0]];
-            AST_Node* parameter_block = &nodes->data[signature_node->children[0]];
+            int function_name = analyser->compiler->parser.node_name_ids[loc.node_index];
+            AST_Node function_node = ast_parser_get_node(parser, loc.node_index);
+            AST_Node signature_node = ast_parser_get_node(parser, function_node.children[0]);
+            AST_Node parameter_block = ast_parser_get_node(parser, signature_node.children[0]);
 
             // Create function signature
             Type_Signature* function_type;
             {
-                Dynamic_Array<Type_Signature*> parameter_types = dynamic_array_create_empty<Type_Signature*>(parameter_block->children.size);
-                for (int i = 0; i < parameter_block->children.size; i++)
+                Dynamic_Array<Type_Signature*> parameter_types = dynamic_array_create_empty<Type_Signature*>(parameter_block.children.size);
+                for (int i = 0; i < parameter_block.children.size; i++)
                 {
-                    int parameter_index = parameter_block->children[i];
-                    AST_Node* parameter = &analyser->compiler->parser.nodes[parameter_index];
-                    dynamic_array_push_back(&parameter_types, semantic_analyser_analyse_type(analyser, loc.table, parameter->children[0]));
+                    int parameter_index = parameter_block.children[i];
+                    AST_Node parameter = ast_parser_get_node(&analyser->compiler->parser, parameter_index);
+                    dynamic_array_push_back(&parameter_types, semantic_analyser_analyse_type(analyser, loc.table, parameter.children[0]));
                 }
 
                 Type_Signature* return_type;
-                if (signature_node->children.size == 2) {
-                    return_type = semantic_analyser_analyse_type(analyser, loc.table, signature_node->children[1]);
+                if (signature_node.children.size == 2) {
+                    return_type = semantic_analyser_analyse_type(analyser, loc.table, signature_node.children[1]);
                 }
                 else {
                     return_type = analyser->compiler->type_system.void_type;
@@ -3305,27 +4017,69 @@ void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
             }
 
             // Create function
-            IR_Function* function = ir_function_create(analyser->program, function_type);
+            Semantic_Function_Cache cache;
+            Semantic_Function_Cache* cached = hashtable_find_element(&previous_cache, loc.node_index);
+            if (cached != 0) {
+                cache = *cached;
+            }
+            else
+            {
+                auto iter = hashtable_iterator_create(&previous_cache);
+                while (hashtable_iterator_has_next(&iter)) {
+                    Semantic_Function_Cache* candidate = iter.value;
+                    if (!candidate->claimed && candidate->name_handle == function_node.name_id && candidate->table_node_index == loc.table->ast_node_index) {
+                        cached = candidate;
+                        break;
+                    }
+                    hashtable_iterator_next(&iter);
+                }
+                if (cached != 0) {
+                    cached->claimed = true;
+                    cache = *cached;
+                    cache.body_valid = false;
+                }
+                else {
+                    cache.function = 0;
+                    cache.body_valid = false;
+                    cache.was_entry_function = false;
+                    cache.referenced_names = dynamic_array_create_empty<int>(32);
+                    cache.errors = dynamic_array_create_empty<Semantic_Cached_Error>(1);
+                }
+            }
+            cache.table_node_index = loc.table->ast_node_index;
+            cache.name_handle = function_node.name_id;
+            cache.claimed = false;
+            IR_Function* function = cache.function;
+            if (function == 0) {
+                function = ir_function_create(analyser->program, function_type);
+                cache.function = function;
+            }
+            else {
+                function->function_type = function_type;
+                dynamic_array_push_back(&analyser->program->functions, function);
+            }
+            // Duplicate node indices cannot happen, each node is visited once by find_definitions
+            hashtable_insert_element(&analyser->function_cache, loc.node_index, cache);
             Symbol function_symbol;
             function_symbol.definition_node_index = loc.node_index;
-            function_symbol.name_handle = function_node->name_id;
+            function_symbol.name_handle = function_node.name_id;
             function_symbol.options.function = function;
             function_symbol.symbol_type = Symbol_Type::FUNCTION;
             symbol_table_define_symbol(loc.table, analyser, function_symbol, false);
-            if (function_node->name_id == analyser->token_index_main) {
+            if (function_node.name_id == analyser->token_index_main) {
                 analyser->program->entry_function = function;
             }
 
             Symbol_Table* function_table = semantic_analyser_create_symbol_table(analyser, loc.table, loc.node_index);
             // Define parameters
-            for (int i = 0; i < parameter_block->children.size; i++)
+            for (int i = 0; i < parameter_block.children.size; i++)
             {
-                int parameter_index = parameter_block->children[i];
-                AST_Node* parameter = &analyser->compiler->parser.nodes[parameter_index];
+                int parameter_index = parameter_block.children[i];
+                AST_Node parameter = ast_parser_get_node(&analyser->compiler->parser, parameter_index);
 
                 Symbol symbol;
                 symbol.definition_node_index = parameter_index;
-                symbol.name_handle = parameter->name_id;
+                symbol.name_handle = parameter.name_id;
                 symbol.symbol_type = Symbol_Type::VARIABLE;
                 symbol.options.variable_access.index = i;
                 symbol.options.variable_access.type = IR_Data_Access_Type::PARAMETER;
@@ -3345,15 +4099,33 @@ void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
             semantic_analyser_log_error(analyser, "Main function not found!", 0);
         }
     }
+    {
+        auto iter = hashtable_iterator_create(&previous_cache);
+        while (hashtable_iterator_has_next(&iter)) {
+            if (!iter.value->claimed) {
+                dynamic_array_destroy(&iter.value->referenced_names);
+                dynamic_array_destroy(&iter.value->errors);
+            }
+            hashtable_iterator_next(&iter);
+        }
+        hashtable_destroy(&previous_cache);
+    }
 
     // Analyse Globals
-    analyser->global_init_function = ir_function_create(analyser->program,
-        type_system_make_function(&analyser->compiler->type_system, dynamic_array_create_empty<Type_Signature*>(1), analyser->compiler->type_system.void_type)
-    );
+    if (reuse_cache) {
+        analyser->global_init_function->code = ir_code_block_create(analyser->global_init_function, analyser->program->allocator);
+        dynamic_array_reset(&analyser->global_init_function->inlined_functions);
+        dynamic_array_push_back(&analyser->program->functions, analyser->global_init_function);
+    }
+    else {
+        analyser->global_init_function = ir_function_create(analyser->program,
+            type_system_make_function(&analyser->compiler->type_system, dynamic_array_create_empty<Type_Signature*>(1), analyser->compiler->type_system.void_type)
+        );
+    }
     for (int i = 0; i < analyser->location_globals.size; i++)
     {
         AST_Top_Level_Node_Location location = analyser->location_globals[i];
-        AST_Node* node = &nodes->data[location.node_index];
+        AST_Node node = ast_parser_get_node(parser, location.node_index);
         semantic_analyser_analyse_variable_creation_statements(analyser, location.table, location.node_index, 0);
     }
     {
@@ -3363,42 +4135,31 @@ void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler)
         dynamic_array_push_back(&analyser->global_init_function->code->instructions, return_instr);
     }
 
-    // Create function code
-    for (int i = 0; i < queued_functions.size; i++)
-    {
-        Queued_Function item = queued_functions[i];
-        analyser->loop_depth = 0;
-        AST_Node* function_node = &nodes->data[item.node_index];
-        if (item.function == analyser->program->entry_function) {
-            IR_Instruction call_instr;
-            call_instr.type = IR_Instruction_Type::FUNCTION_CALL;
-            call_instr.options.call.arguments = dynamic_array_create_empty<IR_Data_Access>(1);
-            call_instr.options.call.call_type = IR_Instruction_Call_Type::FUNCTION_CALL;
-            call_instr.options.call.options.function = analyser->global_init_function;
-            dynamic_array_push_back(&item.function->code->instructions, call_instr);
-        }
-
-        Statement_Analysis_Result block_result = semantic_analyser_analyse_statement_block(
-            analyser, item.function_symbol_table, function_node->children[1], item.function->code
-        );
+    semantic_analyser_update_symbol_signatures(analyser, top_level_table_count);
 
-        if (block_result == Statement_Analysis_Result::NO_RETURN)
-        {
-            if (item.function->function_type->return_type == analyser->compiler->type_system.void_type) {
-                IR_Instruction return_instr;
-                return_instr.type = IR_Instruction_Type::RETURN;
-                if (item.function == analyser->program->entry_function) {
-                    return_instr.options.return_instr.type = IR_Instruction_Return_Type::EXIT;
-                    return_instr.options.return_instr.options.exit_code = Exit_Code::SUCCESS;
-                }
-                else {
-                    return_instr.options.return_instr.type = IR_Instruction_Return_Type::RETURN_EMPTY;
-                }
-                dynamic_array_push_back(&item.function->code->instructions, return_instr);
-            }
-            else {
-                semantic_analyser_log_error(analyser, "No return found inside function", item.node_index);
-            }
+    // Create function code
+    if (reuse_cache) {
+        semantic_analyser_invalidate_outdated_inlining(analyser, &queued_functions);
+    }
+    int worker_count = semantic_analyser_body_worker_count(analyser, &queued_functions);
+    if (worker_count > 1) {
+        semantic_analyser_analyse_function_bodies_parallel(analyser, &queued_functions, reuse_cache, worker_count);
+    }
+    else {
+        for (int i = 0; i < queued_functions.size; i++) {
+            semantic_analyser_analyse_function_body(analyser, queued_functions[i], reuse_cache);
         }
     }
+
+    if (!reuse_cache) {
+        analyser->ir_arena_size_after_reset = semantic_analyser_get_ir_memory_size(analyser);
+    }
+}
+
+void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler) {
+    semantic_analyser_analyse_internal(analyser, compiler, false);
+}
+
+void semantic_analyser_analyse_incremental(Semantic_Analyser* analyser, Compiler* compiler) {
+    semantic_analyser_analyse_internal(analyser, compiler, true);
 }
@@ -3,6 +3,8 @@
 #include "../../datastructures/string.hpp"
 #include "../../datastructures/dynamic_array.hpp"
 #include "../../datastructures/hashtable.hpp"
+#include "../../utility/allocators.hpp"
+#include "../../utility/parallel.hpp"
 
 struct Compiler;
 struct Lexer;
@@ -26,6 +28,7 @@ String primitive_type_to_string(Primitive_Type type);
 bool primitive_type_is_float(Primitive_Type type);
 bool primitive_type_is_signed(Primitive_Type type);
 bool primitive_type_is_integer(Primitive_Type type);
+int primitive_type_size_in_bytes(Primitive_Type type);
 
 enum class Signature_Type
 {
@@ -81,10 +84,23 @@ void type_signature_print_value(Type_Signature* type, byte* value_ptr);
              * size: Character count
              Size: 20 byte (When u64 size it will be 24), alignment: 8 Byte
 */
+u64 type_signature_hash(Type_Signature* signature);
+bool type_signatures_are_equal(Type_Signature* sig1, Type_Signature* sig2);
+// Child types are interned before their parents, so hashing and equality only look at the child pointers
+struct Hasher_Type_Signature {
+    static u64 hash(Type_Signature** signature) { return type_signature_hash(*signature); }
+    static bool equals(Type_Signature** a, Type_Signature** b) { return type_signatures_are_equal(*a, *b); }
+};
+
 struct Type_System
 {
     Lexer* lexer;
     Dynamic_Array<Type_Signature*> types;
+    // All types except structs (Which are registered per declaration), key and value are the same pointer
+    Hashtable<Type_Signature*, Type_Signature*, Hasher_Type_Signature> interned_types;
+    // Set while function bodies are analysed on multiple threads, type_system_make_type then locks the mutex
+    bool is_concurrent;
+    Mutex mutex;
 
     Type_Signature* error_type;
     Type_Signature* bool_type;
@@ -139,6 +155,8 @@ struct IR_Data_Access
     int index;
 };
 Type_Signature* ir_data_access_get_type(IR_Data_Access* access);
+// Appends the bytes to the constant pool of the program
+IR_Data_Access ir_data_access_create_constant_access(IR_Program* program, Type_Signature* signature, Array<byte> bytes);
 
 
 
@@ -171,11 +189,23 @@ struct Symbol
     } options;
 };
 
+struct Symbol_Lookup_Statistics
+{
+    int lookup_count;
+    int tables_visited;
+    int hashed_tables_visited;
+};
+
+// Small tables (Most blocks) are scanned linearly, larger ones get a name index
+const int SYMBOL_TABLE_HASH_THRESHOLD = 8;
 struct Symbol_Table
 {
     Symbol_Table* parent;
     Dynamic_Array<Symbol> symbols;
+    bool is_hashed;
+    Hashtable<int, int, Hasher_I32> symbol_indices; // Name handle -> Index in symbols, names are unique per table
     int ast_node_index;
+    Symbol_Lookup_Statistics* statistics;
 };
 
 Symbol* symbol_table_find_symbol(Symbol_Table* table, int name_handle);
@@ -223,8 +253,9 @@ struct IR_Instruction_Call
         IR_Hardcoded_Function* hardcoded;
     } options;
     Dynamic_Array<IR_Data_Access> arguments;
-    IR_Data_Access destination;
+    IR_Data_Access destination; // Only set if the return type is not void
 };
+Type_Signature* ir_instruction_call_get_return_type(IR_Instruction_Call* call);
 
 enum class IR_Instruction_Return_Type
 {
@@ -338,6 +369,9 @@ struct IR_Code_Block
     Dynamic_Array<Type_Signature*> registers;
     Dynamic_Array<IR_Instruction> instructions;
 };
+IR_Code_Block* ir_code_block_create(IR_Function* function, Allocator* allocator);
+// Counts all instructions, including the ones of nested blocks
+int ir_code_block_count_instructions(IR_Code_Block* code_block);
 
 enum class IR_Instruction_Type
 {
@@ -381,6 +415,8 @@ struct IR_Function
     IR_Program* program;
     Type_Signature* function_type;
     IR_Code_Block* code;
+    // Functions whose bodies were copied into code by the inliner, the body is outdated once one of them is analysed again
+    Dynamic_Array<IR_Function*> inlined_functions;
 };
 
 struct IR_Constant
@@ -426,6 +462,7 @@ struct IR_Program
     Dynamic_Array<Type_Signature*> globals; // Global initialization needs to be done in the main function
     IR_Constant_Pool constant_pool;
     IR_Function* entry_function;
+    Allocator* allocator; // All IR memory of the program (Functions, code blocks, instruction arrays)
 };
 struct Semantic_Analyser;
 void ir_program_append_to_string(IR_Program* program, String* string, Semantic_Analyser* analyser);
@@ -440,12 +477,34 @@ struct AST_Top_Level_Node_Location
     int node_index;
 };
 
+// Error of a cached analysis step, logged again with the current token mapping when the step is reused
+struct Semantic_Cached_Error
+{
+    const char* message;
+    int start_node_index;
+    int end_node_index;
+};
+
+// Analysis result of a function, reused while its node and all top level symbols it references stay the same
+struct Semantic_Function_Cache
+{
+    IR_Function* function;
+    int table_node_index;
+    int name_handle;
+    bool body_valid;
+    bool was_entry_function;
+    bool claimed;
+    Dynamic_Array<int> referenced_names; // Name handles of all identifiers inside the function
+    Dynamic_Array<Semantic_Cached_Error> errors;
+};
+
+struct Semantic_Analysis_Worker;
 struct Semantic_Analyser
 {
     IR_Program* program;
     Symbol_Table* root_table;
     Dynamic_Array<Symbol_Table*> symbol_tables;
-    Hashtable<int, Symbol_Table*> ast_to_symbol_table;
+    Hashtable<int, Symbol_Table*, Hasher_I32> ast_to_symbol_table;
     Dynamic_Array<Compiler_Error> errors;
     IR_Function* global_init_function;
 
@@ -461,10 +520,48 @@ struct Semantic_Analyser
     int token_index_data;
     int token_index_main;
 
+    // Incremental analysis, the IR_Program lives in ir_arena and is kept between incremental analyses
+    Arena ir_arena;
+    u64 ir_arena_size_after_reset;
+    int cache_parse_generation;
+    Hashtable<int, Semantic_Function_Cache, Hasher_I32> function_cache; // Function node index -> Cache
+    Dynamic_Array<int> cached_struct_nodes;
+    Dynamic_Array<Type_Signature*> cached_struct_types;
+    Dynamic_Array<Semantic_Cached_Error> cached_struct_errors;
+    Hashtable<int, u64, Hasher_I32> symbol_signatures; // Name handle -> Hash of all top level symbols with that name
+    Hashtable<int, u64, Hasher_I32> previous_symbol_signatures;
+    Dynamic_Array<Semantic_Cached_Error>* error_recording; // If set, logged errors are also recorded here
+    int analysed_function_count; // Function bodies analysed by the last analysis
+    Symbol_Lookup_Statistics lookup_statistics;
+
+    // Parallel analysis of function bodies, 1 analyses all bodies on the calling thread
+    int body_worker_count;
+    Dynamic_Array<Semantic_Analysis_Worker> workers;
+    Allocator* symbol_table_allocator;
+
     //Dynamic_Array<Struct_Fill_Out> struct_fill_outs;
     //Dynamic_Array<Semantic_Node_Information> semantic_information;
 };
 
+/*
+    Analyses a consecutive range of function bodies. The analyser is a shallow copy of the main analyser,
+    with its own errors, symbol tables and program. The program shares everything with the main program except
+    the constant pool and the allocator, its constants are merged into the main program after all workers are done.
+*/
+struct Semantic_Analysis_Worker
+{
+    Semantic_Analyser analyser;
+    IR_Program program;
+    Arena ir_arena; // Analysed bodies, kept between incremental analyses like the main ir_arena
+    Arena symbol_table_arena;
+    Dynamic_Array<IR_Function*> analysed_functions;
+    int first_function;
+    int function_end;
+    int constant_base; // Index of the first worker constant in the merged constant pool
+};
+
 Semantic_Analyser semantic_analyser_create();
 void semantic_analyser_destroy(Semantic_Analyser* analyser);
 void semantic_analyser_analyse(Semantic_Analyser* analyser, Compiler* compiler);
+// Reuses the IR of functions whose nodes survived the incremental parse, if no top level symbol they reference has changed
+void semantic_analyser_analyse_incremental(Semantic_Analyser* analyser, Compiler* compiler);
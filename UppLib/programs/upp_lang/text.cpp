@@ -1,5 +1,7 @@
 #include "text.hpp"
 
+#include "../../math/scalars.hpp"
+
 #include <cstring>
 
 Dynamic_Array<String> text_create_empty() {
@@ -91,6 +93,37 @@ bool text_position_are_in_order(Text_Position* a, Text_Position* b) {
     }
 }
 
+Text_Changed_Lines text_changed_lines_make_empty()
+{
+    Text_Changed_Lines result;
+    result.changed = false;
+    result.first_line = 0;
+    result.old_end_line = 0;
+    result.new_end_line = 0;
+    return result;
+}
+
+void text_changed_lines_add(Text_Changed_Lines* lines, int first_line, int old_end_line, int new_end_line)
+{
+    if (!lines->changed) {
+        lines->changed = true;
+        lines->first_line = first_line;
+        lines->old_end_line = old_end_line;
+        lines->new_end_line = new_end_line;
+        return;
+    }
+    // Lines before the current region map 1:1 to the original text, lines after it are shifted by (new_end - old_end)
+    int line_delta = new_end_line - old_end_line;
+    if (old_end_line > lines->new_end_line) {
+        lines->old_end_line += old_end_line - lines->new_end_line;
+        lines->new_end_line = new_end_line;
+    }
+    else {
+        lines->new_end_line += line_delta;
+    }
+    lines->first_line = math_minimum(lines->first_line, first_line);
+}
+
 Text_Slice text_slice_make(Text_Position start, Text_Position end) {
     Text_Slice result;
     result.start = start;
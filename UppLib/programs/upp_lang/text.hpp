@@ -30,6 +30,18 @@ Text_Slice text_slice_make_line(Dynamic_Array<String> text, int line);
 Text_Slice text_slice_make_character_after(Text_Position pos, Dynamic_Array<String> text);
 bool text_slice_contains_position(Text_Slice slice, Text_Position pos, Dynamic_Array<String> text);
 
+// Lines [first_line, new_end_line) of the current text replaced the lines [first_line, old_end_line) of the previous text
+struct Text_Changed_Lines
+{
+    bool changed;
+    int first_line;
+    int old_end_line;
+    int new_end_line;
+};
+Text_Changed_Lines text_changed_lines_make_empty();
+// Merges a change that replaced the current lines [first_line, old_end_line) with [first_line, new_end_line)
+void text_changed_lines_add(Text_Changed_Lines* lines, int first_line, int old_end_line, int new_end_line);
+
 // Text Functions
 Dynamic_Array<String> text_create_empty();
 void text_destroy(Dynamic_Array<String>* text);
@@ -54,12 +54,14 @@ void text_change_apply(Text_Change* change, Text_Editor* editor)
     switch (change->type)
     {
     case Text_Change_Type::STRING_DELETION: {
+        text_changed_lines_add(&editor->history.changed_lines, change->slice.start.line, change->slice.end.line + 1, change->slice.start.line + 1);
         text_delete_slice(&editor->text, change->slice);
         editor->cursor_position = change->slice.start;
         text_position_sanitize(&editor->cursor_position, editor->text);
         break;
     }
     case Text_Change_Type::STRING_INSERTION: {
+        text_changed_lines_add(&editor->history.changed_lines, change->slice.start.line, change->slice.start.line + 1, change->slice.end.line + 1);
         text_insert_string(&editor->text, change->slice.start, change->string);
         editor->cursor_position = change->slice.end;
         text_position_sanitize(&editor->cursor_position, editor->text);
@@ -67,10 +69,13 @@ void text_change_apply(Text_Change* change, Text_Editor* editor)
     }
     case Text_Change_Type::CHARACTER_DELETION: {
         Text_Slice slice = text_slice_make(change->character_position, text_position_next(change->character_position, editor->text));
+        text_changed_lines_add(&editor->history.changed_lines, slice.start.line, slice.end.line + 1, slice.start.line + 1);
         text_delete_slice(&editor->text, slice);
         break;
     }
     case Text_Change_Type::CHARACTER_INSERTION: {
+        int line = change->character_position.line;
+        text_changed_lines_add(&editor->history.changed_lines, line, line + 1, change->character == '\n' ? line + 2 : line + 1);
         text_insert_character_before(&editor->text, change->character_position, change->character);
         break;
     }
@@ -90,23 +95,28 @@ void text_change_undo(Text_Change* change, Text_Editor* editor)
     switch (change->type)
     {
     case Text_Change_Type::STRING_DELETION: {
+        text_changed_lines_add(&editor->history.changed_lines, change->slice.start.line, change->slice.start.line + 1, change->slice.end.line + 1);
         text_insert_string(&editor->text, change->slice.start, change->string);
         editor->cursor_position = text_position_previous(change->slice.end, editor->text);
         text_editor_clamp_cursor(editor);
         break;
     }
     case Text_Change_Type::STRING_INSERTION: {
+        text_changed_lines_add(&editor->history.changed_lines, change->slice.start.line, change->slice.end.line + 1, change->slice.start.line + 1);
         text_delete_slice(&editor->text, change->slice);
         editor->cursor_position = change->slice.start;
         text_editor_clamp_cursor(editor);
         break;
     }
     case Text_Change_Type::CHARACTER_DELETION: {
+        int line = change->character_position.line;
+        text_changed_lines_add(&editor->history.changed_lines, line, line + 1, change->character == '\n' ? line + 2 : line + 1);
         text_insert_character_before(&editor->text, change->character_position, change->character);
         break;
     }
     case Text_Change_Type::CHARACTER_INSERTION: {
         Text_Slice slice = text_slice_make(change->character_position, text_position_next(change->character_position, editor->text));
+        text_changed_lines_add(&editor->history.changed_lines, slice.start.line, slice.end.line + 1, slice.start.line + 1);
         text_delete_slice(&editor->text, slice);
         break;
     }
@@ -128,6 +138,7 @@ Text_History text_history_create(Text_Editor* editor) {
     result.current = 0;
     result.undo_first_change = false;
     result.recording_depth = 0;
+    result.changed_lines = text_changed_lines_make_empty();
     return result;
 }
 
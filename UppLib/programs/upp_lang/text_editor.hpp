@@ -45,6 +45,7 @@ struct Text_History
     int recording_depth;
     Dynamic_Array<Text_Change> complex_command;
     Text_Position complex_command_start_pos;
+    Text_Changed_Lines changed_lines; // Accumulated since the last compile, used for incremental relexing
 };
 
 enum class Movement_Type
@@ -0,0 +1,402 @@
+#include "upp_cli.hpp"
+
+#include <cstring>
+#include "compiler.hpp"
+#include "../../utility/file_io.hpp"
+#include "../../utility/binary_stream.hpp"
+#include "../../win32/timing.hpp"
+
+void upp_cli_print_usage()
+{
+    logg("Usage:\n");
+    logg("    run <file> [--jit] [--profile] [--verbose]\n");
+    logg("    bench [-n repetitions] [-s scale,scale...] [-o output.json] [files...]\n");
+    logg("    test\n");
+}
+
+/*
+    Returns true if the compiler had errors. For scaled sources (See upp_cli_create_scaled_source) copy_line_count is the
+    number of lines of one copy, so the lines are reported relative to the copy, otherwise it is 0
+*/
+bool upp_cli_print_errors(Compiler* compiler, const char* filepath, int copy_line_count)
+{
+    Dynamic_Array<Compiler_Error>* errors = &compiler->parser.errors;
+    const char* kind = "Parse";
+    if (errors->size == 0) {
+        errors = &compiler->analyser.errors;
+        kind = "Semantic";
+    }
+    for (int i = 0; i < errors->size; i++) {
+        Compiler_Error* error = &errors->data[i];
+        Text_Slice slice = token_range_to_text_slice(error->range, compiler);
+        if (copy_line_count == 0) {
+            logg("%s:%d:%d: %s Error: %s\n", filepath, slice.start.line + 1, slice.start.character + 1, kind, error->message);
+        }
+        else {
+            int copy = slice.start.line / copy_line_count;
+            logg("%s:%d: (copy %d) %s Error: %s\n", filepath, slice.start.line % copy_line_count + 1, copy, kind, error->message);
+        }
+    }
+    return errors->size != 0;
+}
+
+int upp_cli_run(int argc, char** argv)
+{
+    const char* filepath = 0;
+    bool verbose = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jit") == 0) {
+            enable_jit = true;
+        }
+        else if (strcmp(argv[i], "--profile") == 0) {
+            enable_profiling = true;
+        }
+        else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        }
+        else if (filepath == 0) {
+            filepath = argv[i];
+        }
+        else {
+            upp_cli_print_usage();
+            return 1;
+        }
+    }
+    if (filepath == 0) {
+        upp_cli_print_usage();
+        return 1;
+    }
+    Optional<File_Mapping> mapping = file_io_map_file(filepath);
+    if (!mapping.available) {
+        logg("Could not load file %s\n", filepath);
+        return 1;
+    }
+    SCOPE_EXIT(file_io_unmap_file(&mapping.value));
+    String source = file_io_mapping_as_string(&mapping.value);
+
+    output_im = verbose;
+    output_bytecode = verbose;
+    output_timing = verbose;
+    Timer timer = timer_make();
+    Compiler compiler = compiler_create(&timer);
+    SCOPE_EXIT(compiler_destroy(&compiler));
+    compiler_compile(&compiler, &source, true);
+    if (upp_cli_print_errors(&compiler, filepath, 0)) {
+        return 1;
+    }
+    compiler_execute(&compiler);
+    logg("\n");
+    return compiler.bytecode_interpreter.exit_code == Exit_Code::SUCCESS ? 0 : 2;
+}
+
+bool upp_cli_is_identifier_character(char c, bool first) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (!first && c >= '0' && c <= '9');
+}
+
+/*
+    Appends the source scale times, separated by a newline. Names followed by a colon at the start of a line are
+    top level definitions ("name ::", "name :=", "name: type"), in copy i every identifier with such a name
+    gets the suffix _scale_i, so the copies do not collide.
+*/
+String upp_cli_create_scaled_source(String* source, int scale)
+{
+    Dynamic_Array<String> names = dynamic_array_create_empty<String>(32);
+    SCOPE_EXIT(dynamic_array_destroy(&names));
+    for (int i = 0; i < source->size; i++)
+    {
+        if (i != 0 && source->characters[i - 1] != '\n') continue;
+        int end = i;
+        while (end < source->size && upp_cli_is_identifier_character(source->characters[end], end == i)) {
+            end++;
+        }
+        int colon = end;
+        while (colon < source->size && (source->characters[colon] == ' ' || source->characters[colon] == '\t')) {
+            colon++;
+        }
+        if (end != i && colon < source->size && source->characters[colon] == ':') {
+            dynamic_array_push_back(&names, string_create_substring_static(source, i, end));
+        }
+    }
+
+    String result = string_create_empty(source->size * scale + 64);
+    string_append_string(&result, source);
+    for (int copy = 1; copy < scale; copy++)
+    {
+        string_append_formated(&result, "\n");
+        int i = 0;
+        while (i < source->size)
+        {
+            if (!upp_cli_is_identifier_character(source->characters[i], true)) {
+                string_append_character(&result, source->characters[i]);
+                i++;
+                continue;
+            }
+            int start = i;
+            while (i < source->size && upp_cli_is_identifier_character(source->characters[i], false)) {
+                i++;
+            }
+            String identifier = string_create_substring_static(source, start, i);
+            string_append_character_array(&result, array_create_static(identifier.characters, identifier.size));
+            for (int j = 0; j < names.size; j++) {
+                if (string_equals(&identifier, &names[j])) {
+                    string_append_formated(&result, "_scale_%d", copy);
+                    break;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void upp_cli_append_json_string(String* string, const char* value)
+{
+    string_append_character(string, '"');
+    for (int i = 0; value[i] != 0; i++) {
+        if (value[i] == '"' || value[i] == '\\') {
+            string_append_character(string, '\\');
+        }
+        string_append_character(string, value[i]);
+    }
+    string_append_character(string, '"');
+}
+
+// Sorts ascending
+void upp_cli_sort_times(Dynamic_Array<double>* times)
+{
+    for (int i = 1; i < times->size; i++)
+    {
+        double time = times->data[i];
+        int j = i;
+        while (j > 0 && times->data[j - 1] > time) {
+            times->data[j] = times->data[j - 1];
+            j--;
+        }
+        times->data[j] = time;
+    }
+}
+
+// The standalone lexer measurement repeats small sources until about this much text was lexed
+const int UPP_CLI_LEXER_BENCHMARK_BYTES = 16 * 1024 * 1024;
+
+/*
+    Compiles and executes the source repetitions times and appends a JSON object with the statistics.
+    Returns false without measuring if the source does not compile.
+*/
+bool upp_cli_benchmark_source(String* source, const char* name, int scale, int copy_line_count, int repetitions, String* json)
+{
+    Timer timer = timer_make();
+    Compiler compiler = compiler_create(&timer);
+    SCOPE_EXIT(compiler_destroy(&compiler));
+    compiler.measure_phase_memory = true;
+
+    const int phase_count = (int)Compiler_Phase::PHASE_COUNT;
+    Dynamic_Array<double> times[phase_count];
+    u64 peak_memory[phase_count];
+    bool executed[phase_count];
+    for (int i = 0; i < phase_count; i++) {
+        times[i] = dynamic_array_create_empty<double>(repetitions);
+        peak_memory[i] = 0;
+        executed[i] = false;
+    }
+
+    SCOPE_EXIT(for (int i = 0; i < phase_count; i++) dynamic_array_destroy(&times[i]));
+
+    for (int i = 0; i < repetitions; i++)
+    {
+        compiler_compile(&compiler, source, true);
+        if (upp_cli_print_errors(&compiler, name, scale > 1 ? copy_line_count : 0)) {
+            logg("Benchmark %s x%d does not compile, it is left out of the results\n", name, scale);
+            return false;
+        }
+        compiler_execute(&compiler);
+        for (int j = 0; j < phase_count; j++) {
+            Compiler_Phase_Statistics* statistics = &compiler.phase_statistics[j];
+            if (!statistics->executed) continue;
+            executed[j] = true;
+            dynamic_array_push_back(&times[j], statistics->time);
+            peak_memory[j] = math_maximum(peak_memory[j], statistics->peak_memory);
+        }
+    }
+
+    int token_count = compiler.lexer.tokens.size;
+    int node_count = compiler.parser.next_free_node;
+    String exit_code = string_create_empty(32);
+    SCOPE_EXIT(string_destroy(&exit_code));
+    exit_code_append_to_string(&exit_code, compiler.bytecode_interpreter.exit_code);
+    int lexer_repetitions = math_maximum(repetitions, UPP_CLI_LEXER_BENCHMARK_BYTES / math_maximum(source->size, 1));
+    double lexer_mb_per_second = lexer_benchmark_source(source, name, lexer_repetitions);
+
+    string_append_formated(json, "        {\n            \"name\": ");
+    upp_cli_append_json_string(json, name);
+    string_append_formated(json, ",\n            \"scale\": %d,\n            \"bytes\": %d,\n            \"tokens\": %d,\n            \"nodes\": %d,\n",
+        scale, source->size, token_count, node_count
+    );
+    string_append_formated(json, "            \"exit_code\": ");
+    upp_cli_append_json_string(json, exit_code.characters);
+    string_append_formated(json, ",\n            \"lexer_mb_per_s\": %.2f,\n            \"phases\": [\n", lexer_mb_per_second);
+
+    double total_median = 0;
+    bool first_phase = true;
+    for (int i = 0; i < phase_count; i++)
+    {
+        if (!executed[i]) continue;
+        Dynamic_Array<double>* phase_times = &times[i];
+        upp_cli_sort_times(phase_times);
+        double min = phase_times->data[0];
+        double median = phase_times->data[phase_times->size / 2];
+        int p99_index = math_clamp((int)(phase_times->size * 0.99 + 0.5) - 1, 0, phase_times->size - 1);
+        double p99 = phase_times->data[p99_index];
+        total_median += median;
+        double tokens_per_second = median > 0 ? token_count / median : 0;
+        double nodes_per_second = median > 0 ? node_count / median : 0;
+
+        string_append_formated(json, "%s                {\"phase\": \"%s\", \"min_ms\": %.4f, \"median_ms\": %.4f, \"p99_ms\": %.4f, ",
+            first_phase ? "" : ",\n", compiler_phase_to_string((Compiler_Phase)i), min * 1000, median * 1000, p99 * 1000
+        );
+        string_append_formated(json, "\"tokens_per_second\": %.1f, \"nodes_per_second\": %.1f, \"peak_memory_bytes\": %llu}",
+            tokens_per_second, nodes_per_second, (unsigned long long)peak_memory[i]
+        );
+        first_phase = false;
+    }
+    string_append_formated(json, "\n            ]\n        }");
+    logg("\nBenchmark %s x%d: %d tokens, %d nodes, median total %3.2fms\n", name, scale, token_count, node_count, total_median * 1000);
+    return true;
+}
+
+int upp_cli_bench(int argc, char** argv)
+{
+    int repetitions = 10;
+    const char* output_path = "upp_benchmark.json";
+    Dynamic_Array<int> scales = dynamic_array_create_empty<int>(4);
+    SCOPE_EXIT(dynamic_array_destroy(&scales));
+    Dynamic_Array<const char*> files = dynamic_array_create_empty<const char*>(4);
+    SCOPE_EXIT(dynamic_array_destroy(&files));
+
+    for (int i = 2; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-n") == 0 && has_value) {
+            i++;
+            String value = string_create_static(argv[i]);
+            Optional<int> parsed = string_parse_int(&value);
+            if (!parsed.available || parsed.value < 1) {
+                logg("Invalid repetition count %s\n", argv[i]);
+                return 1;
+            }
+            repetitions = parsed.value;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && has_value) {
+            i++;
+            String list = string_create_static(argv[i]);
+            int start = 0;
+            for (int j = 0; j <= list.size; j++)
+            {
+                if (j != list.size && list.characters[j] != ',') continue;
+                String value = string_create_substring_static(&list, start, j);
+                Optional<int> parsed = string_parse_int(&value);
+                if (!parsed.available || parsed.value < 1) {
+                    logg("Invalid scale list %s\n", argv[i]);
+                    return 1;
+                }
+                dynamic_array_push_back(&scales, parsed.value);
+                start = j + 1;
+            }
+        }
+        else if (strcmp(argv[i], "-o") == 0 && has_value) {
+            i++;
+            output_path = argv[i];
+        }
+        else if (argv[i][0] == '-') {
+            upp_cli_print_usage();
+            return 1;
+        }
+        else {
+            dynamic_array_push_back(&files, (const char*)argv[i]);
+        }
+    }
+    if (files.size == 0) {
+        dynamic_array_push_back(&files, "big_test.txt");
+        if (scales.size == 0) {
+            dynamic_array_push_back(&scales, 1);
+            dynamic_array_push_back(&scales, 4);
+            dynamic_array_push_back(&scales, 16);
+        }
+    }
+    if (scales.size == 0) {
+        dynamic_array_push_back(&scales, 1);
+    }
+
+    // Only the statistics are of interest, the program output of the executions is still printed
+    enable_output = false;
+    String json = string_create_empty(4096);
+    SCOPE_EXIT(string_destroy(&json));
+    string_append_formated(&json, "{\n    \"repetitions\": %d,\n    \"benchmarks\": [\n", repetitions);
+    bool first_entry = true;
+    int failed_count = 0;
+    for (int i = 0; i < files.size; i++)
+    {
+        Optional<File_Mapping> mapping = file_io_map_file(files[i]);
+        if (!mapping.available) {
+            logg("Could not load file %s\n", files[i]);
+            return 1;
+        }
+        SCOPE_EXIT(file_io_unmap_file(&mapping.value));
+        String source = file_io_mapping_as_string(&mapping.value);
+        int line_count = 1;
+        for (int j = 0; j < source.size; j++) {
+            if (source.characters[j] == '\n') line_count++;
+        }
+        for (int j = 0; j < scales.size; j++)
+        {
+            String scaled = upp_cli_create_scaled_source(&source, scales[j]);
+            SCOPE_EXIT(string_destroy(&scaled));
+            String entry = string_create_empty(1024);
+            SCOPE_EXIT(string_destroy(&entry));
+            if (!upp_cli_benchmark_source(&scaled, files[i], scales[j], line_count, repetitions, &entry)) {
+                failed_count++;
+                continue;
+            }
+            if (!first_entry) {
+                string_append_formated(&json, ",\n");
+            }
+            first_entry = false;
+            string_append_string(&json, &entry);
+        }
+    }
+    string_append_formated(&json, "\n    ]\n}\n");
+
+    if (!file_io_write_file(output_path, array_create_static((byte*)json.characters, json.size))) {
+        logg("Could not write %s\n", output_path);
+        return 1;
+    }
+    logg("Benchmark results written to %s\n", output_path);
+    if (failed_count != 0) {
+        logg("%d benchmarks did not compile\n", failed_count);
+        return 1;
+    }
+    return 0;
+}
+
+// Self checks of library code that is not exercised by compiling programs
+int upp_cli_test()
+{
+    bool success = binary_stream_test("upp_binary_stream_test.bin");
+    logg("Binary_Stream test %s\n", success ? "passed" : "failed");
+    return success ? 0 : 1;
+}
+
+int upp_cli_main(int argc, char** argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "run") == 0) {
+        return upp_cli_run(argc, argv);
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return upp_cli_bench(argc, argv);
+    }
+    if (argc == 2 && strcmp(argv[1], "test") == 0) {
+        return upp_cli_test();
+    }
+    upp_cli_print_usage();
+    return 1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+/*
+    Headless compiler driver, needs no window or OpenGL context.
+        run <file> [--jit] [--profile] [--verbose]
+            Compiles and executes the file. Returns 0 on success, 1 on compile errors and 2 on runtime errors.
+        bench [-n repetitions] [-s scale,scale...] [-o output.json] [files...]
+            Compiles and executes each file repetitions times at every scale and writes per phase statistics
+            (min/median/p99 time, tokens/s, nodes/s, peak memory) and the throughput of the lexer alone (lexer_mb_per_s)
+            as JSON. Defaults are big_test.txt at scales 1,4,16.
+            A scaled source contains the file scale times, the top level definitions of each copy are renamed,
+            so compile time grows with the scale while only the first copy is executed.
+        test
+            Runs the self checks of library code that compiling programs does not exercise (Binary_Stream round trip).
+*/
+int upp_cli_main(int argc, char** argv);
@@ -0,0 +1,117 @@
+#include "allocators.hpp"
+
+#include "../math/scalars.hpp"
+
+static void* arena_allocator_allocate(Allocator* allocator, u64 size, u64 alignment) {
+    return arena_allocate((Arena*)allocator, size, alignment);
+}
+
+static void arena_allocator_free(Allocator*, void*) {
+    // Arena memory is only released by arena_reset or arena_checkpoint_reset
+}
+
+Arena arena_create(u64 block_size)
+{
+    Arena result;
+    result.allocator.allocate_function = &arena_allocator_allocate;
+    result.allocator.free_function = &arena_allocator_free;
+    result.first_block = 0;
+    result.current_block = 0;
+    result.current_offset = 0;
+    result.block_size = block_size;
+    return result;
+}
+
+void arena_destroy(Arena* arena)
+{
+    Arena_Block* block = arena->first_block;
+    while (block != 0) {
+        Arena_Block* next = block->next;
+        delete[] block->memory;
+        delete block;
+        block = next;
+    }
+    arena->first_block = 0;
+    arena->current_block = 0;
+    arena->current_offset = 0;
+}
+
+static byte* arena_block_try_allocate(Arena_Block* block, u64 offset, u64 size, u64 alignment, u64* new_offset)
+{
+    u64 start = (u64)block->memory + offset;
+    u64 aligned_start = (start + alignment - 1) & ~(alignment - 1);
+    u64 end_offset = aligned_start + size - (u64)block->memory;
+    if (end_offset > block->size) {
+        return 0;
+    }
+    *new_offset = end_offset;
+    return (byte*)aligned_start;
+}
+
+void* arena_allocate(Arena* arena, u64 size, u64 alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0, "Alignment must be a power of 2");
+    if (arena->current_block != 0) {
+        byte* result = arena_block_try_allocate(arena->current_block, arena->current_offset, size, alignment, &arena->current_offset);
+        if (result != 0) {
+            return result;
+        }
+    }
+
+    // Reuse the next block if it is large enough (Blocks stay allocated after reset), otherwise insert a new one
+    Arena_Block* next = arena->current_block == 0 ? arena->first_block : arena->current_block->next;
+    if (next == 0 || next->size < size + alignment)
+    {
+        Arena_Block* block = new Arena_Block();
+        block->size = math_maximum(arena->block_size, size + alignment);
+        block->memory = new byte[block->size];
+        block->next = next;
+        if (arena->current_block == 0) {
+            arena->first_block = block;
+        }
+        else {
+            arena->current_block->next = block;
+        }
+        next = block;
+    }
+    arena->current_block = next;
+    arena->current_offset = 0;
+    byte* result = arena_block_try_allocate(arena->current_block, 0, size, alignment, &arena->current_offset);
+    assert(result != 0, "Fresh arena block must fit the allocation");
+    return result;
+}
+
+void arena_reset(Arena* arena)
+{
+    arena->current_block = 0;
+    arena->current_offset = 0;
+}
+
+Arena_Checkpoint arena_checkpoint_make(Arena* arena)
+{
+    Arena_Checkpoint result;
+    result.arena = arena;
+    result.block = arena->current_block;
+    result.offset = arena->current_offset;
+    return result;
+}
+
+void arena_checkpoint_reset(Arena_Checkpoint checkpoint)
+{
+    checkpoint.arena->current_block = checkpoint.block;
+    checkpoint.arena->current_offset = checkpoint.offset;
+}
+
+u64 arena_get_allocated_size(Arena* arena)
+{
+    if (arena->current_block == 0) {
+        return 0;
+    }
+    u64 size = 0;
+    Arena_Block* block = arena->first_block;
+    while (block != arena->current_block) {
+        size += block->size;
+        block = block->next;
+    }
+    return size + arena->current_offset;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "datatypes.hpp"
+#include "utils.hpp"
+
+/*
+    ALLOCATOR
+    Containers take an Allocator*, where 0 means the default heap (new[]/delete[]).
+    Implementations embed Allocator as their first member, so the functions can cast back to the implementation.
+*/
+struct Allocator
+{
+    void* (*allocate_function)(Allocator* allocator, u64 size, u64 alignment);
+    void (*free_function)(Allocator* allocator, void* memory);
+};
+
+template <typename T>
+T* allocator_allocate_array(Allocator* allocator, int count)
+{
+    if (allocator == 0) {
+        return new T[count];
+    }
+    return (T*)allocator->allocate_function(allocator, sizeof(T) * (u64)count, alignof(T));
+}
+
+template <typename T>
+void allocator_free_array(Allocator* allocator, T* data)
+{
+    if (allocator == 0) {
+        delete[] data;
+        return;
+    }
+    allocator->free_function(allocator, data);
+}
+
+// Returns zero initialized memory, like new T()
+template <typename T>
+T* allocator_allocate(Allocator* allocator)
+{
+    if (allocator == 0) {
+        return new T();
+    }
+    T* result = (T*)allocator->allocate_function(allocator, sizeof(T), alignof(T));
+    memory_set_bytes(result, sizeof(T), 0);
+    return result;
+}
+
+template <typename T>
+void allocator_free(Allocator* allocator, T* data)
+{
+    if (allocator == 0) {
+        delete data;
+        return;
+    }
+    allocator->free_function(allocator, data);
+}
+
+
+
+/*
+    ARENA
+    Linear allocator, individual frees are ignored and all memory is released at once with arena_reset.
+    Blocks are kept after a reset, so an arena that is reused every frame stops allocating after warm up.
+*/
+struct Arena_Block
+{
+    byte* memory;
+    u64 size;
+    Arena_Block* next;
+};
+
+struct Arena
+{
+    Allocator allocator; // Handle for containers, e.g. dynamic_array_create_empty<int>(16, &arena.allocator)
+    Arena_Block* first_block;
+    Arena_Block* current_block;
+    u64 current_offset;
+    u64 block_size;
+};
+
+struct Arena_Checkpoint
+{
+    Arena* arena;
+    Arena_Block* block;
+    u64 offset;
+};
+
+Arena arena_create(u64 block_size);
+void arena_destroy(Arena* arena);
+void* arena_allocate(Arena* arena, u64 size, u64 alignment);
+void arena_reset(Arena* arena);
+Arena_Checkpoint arena_checkpoint_make(Arena* arena);
+void arena_checkpoint_reset(Arena_Checkpoint checkpoint);
+u64 arena_get_allocated_size(Arena* arena);
@@ -6,6 +6,7 @@
 BinaryParser binary_parser_create_empty(int capacity) {
     BinaryParser result;
     result.current_position = 0;
+    result.is_mapped = false;
     result.data = dynamic_array_create_empty<byte>(capacity);
     return result;
 }
@@ -14,26 +15,47 @@ BinaryParser binary_parser_create_from_bytes(Array<byte> data_to_read)
 {
     BinaryParser result;
     result.current_position = 0;
+    result.is_mapped = false;
     result.data = dynamic_array_create_copy<byte>(data_to_read.data, data_to_read.size);
     return result;
 }
 
 Optional<BinaryParser> binary_parser_create_from_file(const char* filename)
 {
+    // Reads directly from the mapped file instead of loading it into a buffer
     BinaryParser result;
     result.current_position = 0;
-    Optional<Array<byte>> file_data = file_io_load_binary_file(filename);
-    if (!file_data.available) {
+    Optional<File_Mapping> mapping = file_io_map_file(filename);
+    if (!mapping.available) {
         return optional_make_failure<BinaryParser>();
     }
-    result.data = array_to_dynamic_array(&file_data.value);
+    result.is_mapped = true;
+    result.mapping = mapping.value;
+    result.data.data = mapping.value.data.data;
+    result.data.size = mapping.value.data.size;
+    result.data.capacity = mapping.value.data.size;
+    result.data.allocator = 0;
     return optional_make_success(result);
 }
 
 void binary_parser_destroy(BinaryParser* parser) {
+    if (parser->is_mapped) {
+        file_io_unmap_file(&parser->mapping);
+        return;
+    }
     dynamic_array_destroy(&parser->data);
 }
 
+// The mapping is read only, so the data is copied before the first write
+void binary_parser_make_writable(BinaryParser* parser)
+{
+    if (!parser->is_mapped) return;
+    Dynamic_Array<byte> copy = dynamic_array_create_copy<byte>(parser->data.data, parser->data.size);
+    file_io_unmap_file(&parser->mapping);
+    parser->data = copy;
+    parser->is_mapped = false;
+}
+
 bool binary_parser_write_to_file(BinaryParser* parser, const char* filepath) {
     return file_io_write_file(filepath, dynamic_array_as_array(&parser->data));
 }
@@ -44,6 +66,7 @@ Array<byte> binary_parser_get_data(BinaryParser* parser) {
 
 void binary_parser_write_bytes(BinaryParser* parser, Array<byte> data)
 {
+    binary_parser_make_writable(parser);
     dynamic_array_reserve(&parser->data, parser->data.size + data.size+1);
     memcpy(parser->data.data + parser->data.size, data.data, data.size);
     parser->data.size += data.size;
@@ -51,70 +74,44 @@ void binary_parser_write_bytes(BinaryParser* parser, Array<byte> data)
 }
 
 void binary_parser_write_byte(BinaryParser* parser, byte value) {
+    binary_parser_make_writable(parser);
     dynamic_array_push_back(&parser->data, value);
     parser->current_position += 1;
 }
 
 void binary_parser_write_int(BinaryParser* parser, int value) {
-    byte* data = (byte*)&value;
-    dynamic_array_push_back(&parser->data, *(data+0));
-    dynamic_array_push_back(&parser->data, *(data+1));
-    dynamic_array_push_back(&parser->data, *(data+2));
-    dynamic_array_push_back(&parser->data, *(data+3));
-    parser->current_position += 4;
+    binary_parser_write_bytes(parser, array_create_static((byte*)&value, 4));
 }
 
 void binary_parser_write_float(BinaryParser* parser, float value) {
-    byte* data = (byte*)&value;
-    dynamic_array_push_back(&parser->data, *(data+0));
-    dynamic_array_push_back(&parser->data, *(data+1));
-    dynamic_array_push_back(&parser->data, *(data+2));
-    dynamic_array_push_back(&parser->data, *(data+3));
-    parser->current_position += 4;
+    binary_parser_write_bytes(parser, array_create_static((byte*)&value, 4));
 }
 
-byte binary_parser_read_byte(BinaryParser* parser) {
-    if (parser->current_position + 1 >= parser->data.size) {
+void binary_parser_read_bytes(BinaryParser* parser, Array<byte> destination)
+{
+    if (parser->current_position + destination.size > parser->data.size) {
         panic("Parser reading over given data!\n");
     }
-    
-    byte value = parser->data[parser->current_position];
-    parser->current_position += 1;
+    memcpy(destination.data, parser->data.data+parser->current_position, destination.size);
+    parser->current_position += destination.size;
+}
+
+byte binary_parser_read_byte(BinaryParser* parser) {
+    byte value;
+    binary_parser_read_bytes(parser, array_create_static(&value, 1));
     return value;
 }
 
 int binary_parser_read_int(BinaryParser* parser) 
 {
-    if (parser->current_position + 4 >= parser->data.size) {
-        panic("Parser reading over given data!\n");
-    }
-    
     int value;
-    *(((byte*)&value) + 0) = parser->data[parser->current_position];
-    *(((byte*)&value) + 1) = parser->data[parser->current_position+1];
-    *(((byte*)&value) + 2) = parser->data[parser->current_position+2];
-    *(((byte*)&value) + 3) = parser->data[parser->current_position+3];
-    parser->current_position += 4;
+    binary_parser_read_bytes(parser, array_create_static((byte*)&value, 4));
     return value;
 }
 
 float binary_parser_read_float(BinaryParser* parser) 
 {
-    if (parser->current_position + 4 >= parser->data.size) {
-        panic("Parser reading over given data!\n");
-    }
-    
     float value;
-    *(((byte*)&value) + 0) = parser->data[parser->current_position];
-    *(((byte*)&value) + 1) = parser->data[parser->current_position+1];
-    *(((byte*)&value) + 2) = parser->data[parser->current_position+2];
-    *(((byte*)&value) + 3) = parser->data[parser->current_position+3];
-    parser->current_position += 4;
+    binary_parser_read_bytes(parser, array_create_static((byte*)&value, 4));
     return value;
 }
-
-void binary_parser_read_bytes(BinaryParser* parser, Array<byte> destination)
-{
-    memcpy(destination.data, parser->data.data+parser->current_position, destination.size);
-    parser->current_position += destination.size;
-}
@@ -2,11 +2,14 @@
 
 #include "../datastructures/dynamic_array.hpp"
 #include "../utility/utils.hpp"
+#include "../utility/file_io.hpp"
 
 struct BinaryParser
 {
-    Dynamic_Array<byte> data;
+    Dynamic_Array<byte> data; // Points into the mapping if is_mapped, the first write then makes a copy
     int current_position;
+    bool is_mapped;
+    File_Mapping mapping;
 };
 
 BinaryParser binary_parser_create_empty(int capacity);
@@ -0,0 +1,548 @@
+#include "binary_stream.hpp"
+
+#include <cstring>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef UPPLIB_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "Binary_Stream arrays are written as raw memory and assume a little endian host"
+#endif
+
+const u64 BINARY_STREAM_MAX_ZLIB_CHUNK = 1 << 30;
+
+enum class Binary_Stream_Section_Type
+{
+    STORED = 0,
+    ZLIB = 1,
+};
+
+Optional<Binary_Stream> binary_stream_create(const char* filepath, bool is_writer)
+{
+    Binary_Stream result;
+#ifdef _WIN32
+    int flags = is_writer ? (_O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY) : (_O_RDONLY | _O_BINARY);
+    if (_sopen_s(&result.file_descriptor, filepath, flags, _SH_DENYWR, _S_IREAD | _S_IWRITE) != 0) {
+        return optional_make_failure<Binary_Stream>();
+    }
+#else
+    int flags = is_writer ? (O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC);
+    result.file_descriptor = open(filepath, flags, 0644);
+    if (result.file_descriptor == -1) {
+        return optional_make_failure<Binary_Stream>();
+    }
+#endif
+    result.is_writer = is_writer;
+    result.failed = false;
+    result.buffer = new byte[BINARY_STREAM_BUFFER_SIZE];
+    result.buffer_position = 0;
+    result.buffer_size = 0;
+    result.compression = 0;
+    result.compression_finished = false;
+    return optional_make_success(result);
+}
+
+Optional<Binary_Stream> binary_stream_create_writer(const char* filepath) {
+    return binary_stream_create(filepath, true);
+}
+
+Optional<Binary_Stream> binary_stream_create_reader(const char* filepath) {
+    return binary_stream_create(filepath, false);
+}
+
+// Returns false on errors, retries partial writes
+bool binary_stream_write_to_file(Binary_Stream* stream, byte* data, u64 size)
+{
+    while (size > 0)
+    {
+        int chunk_size = size > (u64)INT32_MAX ? INT32_MAX : (int)size;
+#ifdef _WIN32
+        int written = _write(stream->file_descriptor, data, (unsigned int)chunk_size);
+#else
+        int written = (int)write(stream->file_descriptor, data, chunk_size);
+#endif
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Returns the number of bytes read, 0 at the end of the file, -1 on errors
+int binary_stream_read_from_file(Binary_Stream* stream, byte* destination, u64 size)
+{
+    int chunk_size = size > (u64)INT32_MAX ? INT32_MAX : (int)size;
+#ifdef _WIN32
+    return _read(stream->file_descriptor, destination, (unsigned int)chunk_size);
+#else
+    return (int)read(stream->file_descriptor, destination, chunk_size);
+#endif
+}
+
+bool binary_stream_flush(Binary_Stream* stream)
+{
+    if (!stream->is_writer || stream->failed) return !stream->failed;
+    if (!binary_stream_write_to_file(stream, stream->buffer, stream->buffer_position)) {
+        stream->failed = true;
+    }
+    stream->buffer_position = 0;
+    return !stream->failed;
+}
+
+// Reads the next chunk of the file into the buffer, returns false at the end of the file
+bool binary_stream_refill(Binary_Stream* stream)
+{
+    int read_size = binary_stream_read_from_file(stream, stream->buffer, BINARY_STREAM_BUFFER_SIZE);
+    stream->buffer_position = 0;
+    stream->buffer_size = read_size > 0 ? read_size : 0;
+    return read_size > 0;
+}
+
+bool binary_stream_destroy(Binary_Stream* stream)
+{
+    if (stream->compression != 0)
+    {
+        if (stream->is_writer) {
+            binary_stream_end_compressed_section(stream);
+        }
+#ifdef UPPLIB_ZLIB
+        else { // Readers may stop before the end of a section
+            inflateEnd(stream->compression);
+            delete stream->compression;
+        }
+#endif
+    }
+    binary_stream_flush(stream);
+#ifdef _WIN32
+    _close(stream->file_descriptor);
+#else
+    if (close(stream->file_descriptor) != 0 && stream->is_writer) { // Delayed write errors are reported on close
+        stream->failed = true;
+    }
+#endif
+    delete[] stream->buffer;
+    return !stream->failed;
+}
+
+// Writes the data without compression, large blocks skip the buffer
+void binary_stream_write_uncompressed(Binary_Stream* stream, byte* data, u64 size)
+{
+    while (size > 0 && !stream->failed)
+    {
+        if (stream->buffer_position == 0 && size >= BINARY_STREAM_BUFFER_SIZE) {
+            if (!binary_stream_write_to_file(stream, data, size)) {
+                stream->failed = true;
+            }
+            return;
+        }
+        u64 copy_size = BINARY_STREAM_BUFFER_SIZE - stream->buffer_position;
+        copy_size = copy_size < size ? copy_size : size;
+        memcpy(stream->buffer + stream->buffer_position, data, copy_size);
+        stream->buffer_position += (int)copy_size;
+        data += copy_size;
+        size -= copy_size;
+        if (stream->buffer_position == BINARY_STREAM_BUFFER_SIZE) {
+            binary_stream_flush(stream);
+        }
+    }
+}
+
+bool binary_stream_read_uncompressed(Binary_Stream* stream, byte* destination, u64 size)
+{
+    while (size > 0)
+    {
+        if (stream->buffer_position == stream->buffer_size)
+        {
+            if (size >= BINARY_STREAM_BUFFER_SIZE) {
+                int read_size = binary_stream_read_from_file(stream, destination, size);
+                if (read_size <= 0) return false;
+                destination += read_size;
+                size -= read_size;
+                continue;
+            }
+            if (!binary_stream_refill(stream)) return false;
+        }
+        u64 copy_size = stream->buffer_size - stream->buffer_position;
+        copy_size = copy_size < size ? copy_size : size;
+        memcpy(destination, stream->buffer + stream->buffer_position, copy_size);
+        stream->buffer_position += (int)copy_size;
+        destination += copy_size;
+        size -= copy_size;
+    }
+    return true;
+}
+
+#ifdef UPPLIB_ZLIB
+// Deflates the input into the buffer, flushing the buffer to the file whenever it is full
+void binary_stream_deflate(Binary_Stream* stream, byte* data, u64 size, int flush_mode)
+{
+    z_stream* compression = stream->compression;
+    compression->next_in = data;
+    compression->avail_in = (uInt)size;
+    while (!stream->failed)
+    {
+        compression->next_out = stream->buffer + stream->buffer_position;
+        compression->avail_out = (uInt)(BINARY_STREAM_BUFFER_SIZE - stream->buffer_position);
+        int result = deflate(compression, flush_mode);
+        stream->buffer_position = BINARY_STREAM_BUFFER_SIZE - (int)compression->avail_out;
+        if (result == Z_STREAM_ERROR) {
+            stream->failed = true;
+            return;
+        }
+        bool output_full = compression->avail_out == 0;
+        if (output_full) {
+            binary_stream_flush(stream);
+        }
+        // Without finishing all input is consumed once deflate leaves output space, finishing ends with Z_STREAM_END
+        if (flush_mode == Z_FINISH ? result == Z_STREAM_END : !output_full) {
+            return;
+        }
+    }
+}
+
+bool binary_stream_inflate(Binary_Stream* stream, byte* destination, u64 size)
+{
+    z_stream* compression = stream->compression;
+    compression->next_out = destination;
+    compression->avail_out = (uInt)size;
+    while (compression->avail_out > 0)
+    {
+        if (stream->compression_finished) return false;
+        if (stream->buffer_position == stream->buffer_size && !binary_stream_refill(stream)) {
+            return false;
+        }
+        compression->next_in = stream->buffer + stream->buffer_position;
+        compression->avail_in = (uInt)(stream->buffer_size - stream->buffer_position);
+        int result = inflate(compression, Z_NO_FLUSH);
+        stream->buffer_position = stream->buffer_size - (int)compression->avail_in;
+        if (result == Z_STREAM_END) {
+            stream->compression_finished = true;
+        }
+        else if (result != Z_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+void binary_stream_begin_compressed_section(Binary_Stream* stream)
+{
+    if (stream->compression != 0) {
+        panic("Compressed sections cannot be nested");
+    }
+    if (stream->is_writer)
+    {
+#ifdef UPPLIB_ZLIB
+        binary_stream_write_byte(stream, (byte)Binary_Stream_Section_Type::ZLIB);
+        stream->compression = new z_stream();
+        if (deflateInit(stream->compression, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            stream->failed = true;
+        }
+#else
+        binary_stream_write_byte(stream, (byte)Binary_Stream_Section_Type::STORED);
+#endif
+        return;
+    }
+
+    Binary_Stream_Section_Type type = (Binary_Stream_Section_Type)binary_stream_read_byte(stream);
+    if (stream->failed || type == Binary_Stream_Section_Type::STORED) return;
+#ifdef UPPLIB_ZLIB
+    if (type == Binary_Stream_Section_Type::ZLIB) {
+        stream->compression = new z_stream();
+        stream->compression_finished = false;
+        if (inflateInit(stream->compression) != Z_OK) {
+            stream->failed = true;
+        }
+        return;
+    }
+#endif
+    stream->failed = true;
+}
+
+void binary_stream_end_compressed_section(Binary_Stream* stream)
+{
+    if (stream->compression == 0) return;
+#ifdef UPPLIB_ZLIB
+    if (stream->is_writer) {
+        binary_stream_deflate(stream, 0, 0, Z_FINISH);
+        deflateEnd(stream->compression);
+    }
+    else {
+        // All data of the section must have been read, so only the end of the zlib stream may remain
+        byte unread;
+        if (!stream->failed && binary_stream_inflate(stream, &unread, 1)) {
+            stream->failed = true;
+        }
+        if (!stream->compression_finished) {
+            stream->failed = true;
+        }
+        inflateEnd(stream->compression);
+    }
+    delete stream->compression;
+#endif
+    stream->compression = 0;
+}
+
+void binary_stream_write_bytes(Binary_Stream* stream, void* data, u64 size)
+{
+    if (stream->failed) return;
+#ifdef UPPLIB_ZLIB
+    if (stream->compression != 0) {
+        // zlib sizes are 32 bit
+        for (u64 offset = 0; offset < size; offset += BINARY_STREAM_MAX_ZLIB_CHUNK) {
+            u64 chunk_size = size - offset < BINARY_STREAM_MAX_ZLIB_CHUNK ? size - offset : BINARY_STREAM_MAX_ZLIB_CHUNK;
+            binary_stream_deflate(stream, (byte*)data + offset, chunk_size, Z_NO_FLUSH);
+        }
+        return;
+    }
+#endif
+    binary_stream_write_uncompressed(stream, (byte*)data, size);
+}
+
+void binary_stream_read_bytes(Binary_Stream* stream, void* destination, u64 size)
+{
+    bool success = false;
+    if (!stream->failed) {
+#ifdef UPPLIB_ZLIB
+        if (stream->compression != 0) {
+            success = true;
+            for (u64 offset = 0; offset < size && success; offset += BINARY_STREAM_MAX_ZLIB_CHUNK) {
+                u64 chunk_size = size - offset < BINARY_STREAM_MAX_ZLIB_CHUNK ? size - offset : BINARY_STREAM_MAX_ZLIB_CHUNK;
+                success = binary_stream_inflate(stream, (byte*)destination + offset, chunk_size);
+            }
+        }
+        else
+#endif
+        success = binary_stream_read_uncompressed(stream, (byte*)destination, size);
+    }
+    if (!success) {
+        stream->failed = true;
+        memset(destination, 0, size);
+    }
+}
+
+void binary_stream_write_byte(Binary_Stream* stream, byte value)
+{
+    // Single bytes are the most common write (Varints), so they skip the generic path if possible
+    if (stream->compression == 0 && stream->buffer_position < BINARY_STREAM_BUFFER_SIZE && !stream->failed) {
+        stream->buffer[stream->buffer_position] = value;
+        stream->buffer_position++;
+        if (stream->buffer_position == BINARY_STREAM_BUFFER_SIZE) {
+            binary_stream_flush(stream);
+        }
+        return;
+    }
+    binary_stream_write_bytes(stream, &value, 1);
+}
+
+byte binary_stream_read_byte(Binary_Stream* stream)
+{
+    if (stream->compression == 0 && stream->buffer_position < stream->buffer_size && !stream->failed) {
+        byte value = stream->buffer[stream->buffer_position];
+        stream->buffer_position++;
+        return value;
+    }
+    byte value;
+    binary_stream_read_bytes(stream, &value, 1);
+    return value;
+}
+
+void binary_stream_write_int(Binary_Stream* stream, int value)
+{
+    u32 bits = (u32)value;
+    byte bytes[4] = { (byte)bits, (byte)(bits >> 8), (byte)(bits >> 16), (byte)(bits >> 24) };
+    binary_stream_write_bytes(stream, bytes, 4);
+}
+
+int binary_stream_read_int(Binary_Stream* stream)
+{
+    byte bytes[4];
+    binary_stream_read_bytes(stream, bytes, 4);
+    return (int)((u32)bytes[0] | ((u32)bytes[1] << 8) | ((u32)bytes[2] << 16) | ((u32)bytes[3] << 24));
+}
+
+void binary_stream_write_float(Binary_Stream* stream, float value)
+{
+    int bits;
+    memcpy(&bits, &value, 4);
+    binary_stream_write_int(stream, bits);
+}
+
+float binary_stream_read_float(Binary_Stream* stream)
+{
+    int bits = binary_stream_read_int(stream);
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+void binary_stream_write_varint(Binary_Stream* stream, u64 value)
+{
+    while (value >= 0x80) {
+        binary_stream_write_byte(stream, (byte)(value | 0x80));
+        value = value >> 7;
+    }
+    binary_stream_write_byte(stream, (byte)value);
+}
+
+u64 binary_stream_read_varint(Binary_Stream* stream)
+{
+    u64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        byte part = binary_stream_read_byte(stream);
+        value = value | ((u64)(part & 0x7F) << shift);
+        if ((part & 0x80) == 0) {
+            return value;
+        }
+    }
+    stream->failed = true; // More than 10 bytes
+    return 0;
+}
+
+void binary_stream_write_varint_signed(Binary_Stream* stream, i64 value)
+{
+    // Signed LEB128: Stops once the remaining bits are only the sign extension of the last written bit
+    while (true)
+    {
+        byte part = (byte)(value & 0x7F);
+        value = value >> 7; // Arithmetic shift
+        bool done = (value == 0 && (part & 0x40) == 0) || (value == -1 && (part & 0x40) != 0);
+        if (done) {
+            binary_stream_write_byte(stream, part);
+            return;
+        }
+        binary_stream_write_byte(stream, part | 0x80);
+    }
+}
+
+i64 binary_stream_read_varint_signed(Binary_Stream* stream)
+{
+    u64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        byte part = binary_stream_read_byte(stream);
+        value = value | ((u64)(part & 0x7F) << shift);
+        if ((part & 0x80) == 0) {
+            if (shift + 7 < 64 && (part & 0x40) != 0) {
+                value = value | (~(u64)0 << (shift + 7)); // Sign extend
+            }
+            return (i64)value;
+        }
+    }
+    stream->failed = true;
+    return 0;
+}
+
+bool binary_stream_test_check(bool condition, const char* description)
+{
+    if (!condition) {
+        logg("Binary_Stream test failed: %s\n", description);
+    }
+    return condition;
+}
+
+bool binary_stream_test(const char* filepath)
+{
+    u64 unsigned_values[] = { 0, 1, 63, 64, 127, 128, 16383, 16384, (u64)INT64_MAX, UINT64_MAX };
+    i64 signed_values[] = { 0, -1, 1, 63, -63, 64, -64, 65, -65, 8191, -8192, INT64_MAX, INT64_MIN };
+    const int unsigned_count = (int)(sizeof(unsigned_values) / sizeof(u64));
+    const int signed_count = (int)(sizeof(signed_values) / sizeof(i64));
+
+    // More than one buffer, so the bulk copy has to flush and refill in between
+    Array<int> large = array_create_empty<int>(BINARY_STREAM_BUFFER_SIZE / 2);
+    SCOPE_EXIT(array_destroy(&large));
+    for (int i = 0; i < large.size; i++) {
+        large[i] = i * 7919 - 1000000;
+    }
+    Array<byte> compressible = array_create_empty<byte>(100000);
+    SCOPE_EXIT(array_destroy(&compressible));
+    for (int i = 0; i < compressible.size; i++) {
+        compressible[i] = (byte)(i % 61);
+    }
+    SCOPE_EXIT(remove(filepath));
+
+    // Write
+    {
+        Optional<Binary_Stream> writer = binary_stream_create_writer(filepath);
+        if (!binary_stream_test_check(writer.available, "Could not create writer")) {
+            return false;
+        }
+        Binary_Stream* stream = &writer.value;
+        for (int i = 0; i < unsigned_count; i++) {
+            binary_stream_write_varint(stream, unsigned_values[i]);
+        }
+        for (int i = 0; i < signed_count; i++) {
+            binary_stream_write_varint_signed(stream, signed_values[i]);
+        }
+        binary_stream_write_int(stream, -5);
+        binary_stream_write_float(stream, 1.5f);
+        binary_stream_write_array(stream, large);
+
+        binary_stream_begin_compressed_section(stream);
+        binary_stream_write_array(stream, compressible);
+        binary_stream_write_varint_signed(stream, INT64_MIN);
+        binary_stream_end_compressed_section(stream);
+
+        binary_stream_write_int(stream, 0x12345678);
+        binary_stream_write_varint(stream, 300);
+        if (!binary_stream_test_check(binary_stream_destroy(stream), "Writing failed")) {
+            return false;
+        }
+    }
+
+    // Read back
+    Optional<Binary_Stream> reader = binary_stream_create_reader(filepath);
+    if (!binary_stream_test_check(reader.available, "Could not create reader")) {
+        return false;
+    }
+    Binary_Stream* stream = &reader.value;
+    bool success = true;
+    for (int i = 0; i < unsigned_count; i++) {
+        success = binary_stream_test_check(binary_stream_read_varint(stream) == unsigned_values[i], "Unsigned varint") && success;
+    }
+    for (int i = 0; i < signed_count; i++) {
+        success = binary_stream_test_check(binary_stream_read_varint_signed(stream) == signed_values[i], "Signed varint") && success;
+    }
+    success = binary_stream_test_check(binary_stream_read_int(stream) == -5, "Int") && success;
+    success = binary_stream_test_check(binary_stream_read_float(stream) == 1.5f, "Float") && success;
+
+    Array<int> large_read = binary_stream_read_array<int>(stream);
+    SCOPE_EXIT(array_destroy(&large_read));
+    success = binary_stream_test_check(
+        large_read.size == large.size && memcmp(large_read.data, large.data, large.size * sizeof(int)) == 0, "Large array"
+    ) && success;
+
+    binary_stream_begin_compressed_section(stream);
+    Array<byte> compressible_read = binary_stream_read_array<byte>(stream);
+    SCOPE_EXIT(array_destroy(&compressible_read));
+    success = binary_stream_test_check(
+        compressible_read.size == compressible.size && memcmp(compressible_read.data, compressible.data, compressible.size) == 0,
+        "Compressed array"
+    ) && success;
+    success = binary_stream_test_check(binary_stream_read_varint_signed(stream) == INT64_MIN, "Varint in compressed section") && success;
+    binary_stream_end_compressed_section(stream);
+
+    success = binary_stream_test_check(binary_stream_read_int(stream) == 0x12345678, "Int after compressed section") && success;
+    success = binary_stream_test_check(binary_stream_read_varint(stream) == 300, "Varint after compressed section") && success;
+    success = binary_stream_test_check(!stream->failed, "Stream failed before the end of the file") && success;
+
+    // Reading past the end of the file fails the stream
+    int past_end = binary_stream_read_int(stream);
+    success = binary_stream_test_check(stream->failed && past_end == 0, "Reading past the end did not fail") && success;
+    success = binary_stream_test_check(!binary_stream_destroy(stream), "Destroy did not report the failed read") && success;
+    return success;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../datastructures/array.hpp"
+#include "../utility/datatypes.hpp"
+#include "../utility/utils.hpp"
+
+struct z_stream_s;
+
+/*
+    Buffered binary reader/writer over a file descriptor, only BINARY_STREAM_BUFFER_SIZE bytes are held in memory.
+    Values are stored in little endian, arrays are copied in bulk as raw memory (Only for types without pointers).
+    Errors (I/O errors, reading past the end, corrupt compressed data) are sticky: After the first error
+    reads return 0 and writes are ignored, so the result only has to be checked once with binary_stream_destroy.
+
+    Data between begin/end_compressed_section is deflated with zlib if UPPLIB_ZLIB is defined, otherwise it is
+    stored as is. Readers without zlib fail on compressed sections.
+*/
+const int BINARY_STREAM_BUFFER_SIZE = 64 * 1024;
+
+struct Binary_Stream
+{
+    int file_descriptor;
+    bool is_writer;
+    bool failed;
+    byte* buffer;
+    int buffer_position;
+    int buffer_size; // Bytes available in the buffer when reading
+    z_stream_s* compression; // Only set inside a compressed section
+    bool compression_finished; // Reader has seen the end of the compressed data
+};
+
+Optional<Binary_Stream> binary_stream_create_writer(const char* filepath);
+Optional<Binary_Stream> binary_stream_create_reader(const char* filepath);
+// Flushes a writer and closes the file, returns false if any operation of the stream failed
+bool binary_stream_destroy(Binary_Stream* stream);
+bool binary_stream_flush(Binary_Stream* stream);
+
+void binary_stream_begin_compressed_section(Binary_Stream* stream);
+void binary_stream_end_compressed_section(Binary_Stream* stream);
+
+void binary_stream_write_bytes(Binary_Stream* stream, void* data, u64 size);
+void binary_stream_write_byte(Binary_Stream* stream, byte value);
+void binary_stream_write_int(Binary_Stream* stream, int value);
+void binary_stream_write_float(Binary_Stream* stream, float value);
+// LEB128, 7 bits per byte, small values take one byte
+void binary_stream_write_varint(Binary_Stream* stream, u64 value);
+void binary_stream_write_varint_signed(Binary_Stream* stream, i64 value);
+
+void binary_stream_read_bytes(Binary_Stream* stream, void* destination, u64 size);
+byte binary_stream_read_byte(Binary_Stream* stream);
+int binary_stream_read_int(Binary_Stream* stream);
+float binary_stream_read_float(Binary_Stream* stream);
+u64 binary_stream_read_varint(Binary_Stream* stream);
+i64 binary_stream_read_varint_signed(Binary_Stream* stream);
+
+// Element count as varint, followed by the raw elements
+template<typename T>
+void binary_stream_write_array(Binary_Stream* stream, Array<T> array) {
+    binary_stream_write_varint(stream, (u64)array.size);
+    binary_stream_write_bytes(stream, array.data, (u64)array.size * sizeof(T));
+}
+
+// Returns an empty array if the stream failed, the array must be destroyed
+template<typename T>
+Array<T> binary_stream_read_array(Binary_Stream* stream)
+{
+    u64 count = binary_stream_read_varint(stream);
+    if (stream->failed || count > (u64)INT32_MAX / sizeof(T)) {
+        stream->failed = true;
+        return array_create_empty<T>(0);
+    }
+    Array<T> result = array_create_empty<T>((int)count);
+    binary_stream_read_bytes(stream, result.data, count * sizeof(T));
+    return result;
+}
+
+/*
+    Writes a file with varint edge values, an array larger than the buffer, a compressed section and trailing data,
+    reads it back and checks that reading past the end fails the stream. Logs mismatches and returns false on errors.
+*/
+bool binary_stream_test(const char* filepath);
@@ -1,16 +1,39 @@
 #include "file_io.hpp"
 
 #include <cstdio>
+#include <cstring>
+#include <climits>
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "../utility/utils.hpp"
 
+// Returns 0 if the file cannot be opened, fopen_s is only available with the Microsoft runtime
+FILE* file_io_open(const char* filepath, const char* mode)
+{
+    FILE* file;
+#ifdef _WIN32
+    if (fopen_s(&file, filepath, mode) != 0) {
+        return 0;
+    }
+#else
+    file = fopen(filepath, mode);
+#endif
+    return file;
+}
+
 Optional<u64> file_io_get_file_size(const char* filepath)
 {
     Optional<u64> result;
 
-    FILE* file;
-    if (fopen_s(&file, filepath, "rb") != 0) {
+    FILE* file = file_io_open(filepath, "rb");
+    if (file == 0) {
         result.available = false;
         return result;
     }
@@ -32,8 +55,8 @@ Optional<Array<byte>> file_io_load_binary_file(const char* filepath)
     Optional<Array<byte>> result;
     result.available = false;
 
-    FILE* file;
-    if (fopen_s(&file, filepath, "rb") != 0) {
+    FILE* file = file_io_open(filepath, "rb");
+    if (file == 0) {
         return result;
     }
     SCOPE_EXIT(fclose(file));
@@ -67,20 +90,27 @@ Optional<String> file_io_load_text_file(const char* filepath)
     Optional<String> result;
     result.available = false;
 
-    Optional<Array<byte>> binary_file_content = file_io_load_binary_file(filepath);
-    if (binary_file_content.available == false) {
+    FILE* file = file_io_open(filepath, "rb");
+    if (file == 0) {
         return result;
     }
-    SCOPE_EXIT(file_io_unload_binary_file(&binary_file_content));
+    SCOPE_EXIT(fclose(file));
 
-    // Copy binary array content to string
+    // Read directly into the string buffer
+    fseek(file, 0, SEEK_END);
+    u64 file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
     String* string = &result.value;
-    string->characters = new char[binary_file_content.value.size+1];
-    memcpy(string->characters, binary_file_content.value.data, binary_file_content.value.size);
-    string->characters[binary_file_content.value.size] = 0; // Add 0 terminator
+    string->characters = new char[file_size+1];
+    string->allocator = 0;
+    string->capacity = (int)file_size+1;
+    u64 read_size = (u64)fread(string->characters, 1, file_size, file);
+    if (read_size != file_size) {
+        delete[] string->characters;
+        return result;
+    }
+    string->characters[file_size] = 0; // Add 0 terminator
     string->size = (int)strlen(string->characters);
-    assert(string->size <= binary_file_content.value.size, "Null terminator did not work!\n");
-    string->capacity = binary_file_content.value.size+1;
 
     result.available = true;
     return result;
@@ -95,8 +125,8 @@ void file_io_unload_text_file(Optional<String>* file_content)
 
 bool file_io_check_if_file_exists(const char* filepath)
 {
-    FILE* file;
-    if (fopen_s(&file, filepath, "r") != 0) {
+    FILE* file = file_io_open(filepath, "r");
+    if (file == 0) {
         return false;
     }
     fclose(file);
@@ -105,11 +135,19 @@ bool file_io_check_if_file_exists(const char* filepath)
 
 bool file_io_is_directory(const char* filepath) 
 {
+#ifdef _WIN32
     DWORD attributes = GetFileAttributesA(filepath);
     if (attributes == INVALID_FILE_ATTRIBUTES) {
         return false;
     }
     return (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat info;
+    if (stat(filepath, &info) != 0) {
+        return false;
+    }
+    return S_ISDIR(info.st_mode);
+#endif
 }
 
 Optional<u64> file_io_get_last_write_access_time(const char* filepath) 
@@ -117,6 +155,7 @@ Optional<u64> file_io_get_last_write_access_time(const char* filepath)
     Optional<u64> result;
     result.available = false;
 
+#ifdef _WIN32
     // Get File Handle
     HANDLE file_handle = CreateFileA(filepath, GENERIC_READ, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
     if (file_handle == INVALID_HANDLE_VALUE) {
@@ -132,14 +171,23 @@ Optional<u64> file_io_get_last_write_access_time(const char* filepath)
 
     result.available = true;
     result.value = (((u64)time.dwHighDateTime) << 32) | (time.dwLowDateTime);
+#else
+    // Nanoseconds since the epoch, only compared against earlier values of this function
+    struct stat info;
+    if (stat(filepath, &info) != 0) {
+        return result;
+    }
+    result.available = true;
+    result.value = (u64)info.st_mtim.tv_sec * 1000000000ull + (u64)info.st_mtim.tv_nsec;
+#endif
 
     return result;
 }
 
 bool file_io_write_file(const char* filepath, Array<byte> data)
 {
-    FILE* file;
-    if (fopen_s(&file, filepath, "wb") != 0) {
+    FILE* file = file_io_open(filepath, "wb");
+    if (file == 0) {
         return false;
     }
     SCOPE_EXIT(fclose(file));
@@ -147,3 +195,113 @@ bool file_io_write_file(const char* filepath, Array<byte> data)
     fwrite(data.data, 1, data.size, file);
     return true;
 }
+
+// Fallback of file_io_map_file
+Optional<File_Mapping> file_io_map_file_as_copy(const char* filepath)
+{
+    Optional<File_Mapping> result;
+    result.available = false;
+    Optional<String> content = file_io_load_text_file(filepath);
+    if (!content.available) {
+        return result;
+    }
+    result.value.data = array_create_static((byte*)content.value.characters, content.value.capacity - 1);
+    result.value.mapping_size = 0;
+#ifdef _WIN32
+    result.value.mapping_handle = 0;
+#endif
+    result.available = true;
+    return result;
+}
+
+Optional<File_Mapping> file_io_map_file(const char* filepath)
+{
+    Optional<File_Mapping> result;
+    result.available = false;
+
+#ifdef _WIN32
+    HANDLE file_handle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return result;
+    }
+    SCOPE_EXIT(CloseHandle(file_handle));
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file_handle, &file_size) == 0 || file_size.QuadPart >= INT_MAX) {
+        return result;
+    }
+
+    // Views cannot extend past the end of the file, so the terminator only exists if the size is not a multiple of the page size
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    if (file_size.QuadPart == 0 || file_size.QuadPart % system_info.dwPageSize == 0) {
+        return file_io_map_file_as_copy(filepath);
+    }
+    HANDLE mapping_handle = CreateFileMappingA(file_handle, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapping_handle == 0) {
+        return file_io_map_file_as_copy(filepath);
+    }
+    void* view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (view == 0) {
+        CloseHandle(mapping_handle);
+        return file_io_map_file_as_copy(filepath);
+    }
+    result.value.mapping_handle = mapping_handle;
+    result.value.mapping_size = (u64)file_size.QuadPart;
+    result.value.data = array_create_static((byte*)view, (int)file_size.QuadPart);
+#else
+    int file_descriptor = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (file_descriptor == -1) {
+        return result;
+    }
+    SCOPE_EXIT(close(file_descriptor));
+    struct stat info;
+    if (fstat(file_descriptor, &info) != 0 || info.st_size >= INT_MAX) {
+        return result;
+    }
+    u64 file_size = (u64)info.st_size;
+    if (file_size == 0) {
+        return file_io_map_file_as_copy(filepath);
+    }
+
+    // Zeroed anonymous pages are reserved first and the file is mapped over their start, so the bytes after the content
+    // are always 0, even if the file size is a multiple of the page size
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+    u64 mapping_size = (file_size + 1 + page_size - 1) / page_size * page_size;
+    void* base = mmap(0, mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return file_io_map_file_as_copy(filepath);
+    }
+    void* view = mmap(base, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, file_descriptor, 0);
+    if (view == MAP_FAILED) {
+        munmap(base, mapping_size);
+        return file_io_map_file_as_copy(filepath);
+    }
+    madvise(view, file_size, MADV_WILLNEED);
+    result.value.mapping_size = mapping_size;
+    result.value.data = array_create_static((byte*)view, (int)file_size);
+#endif
+
+    result.available = true;
+    return result;
+}
+
+void file_io_unmap_file(File_Mapping* mapping)
+{
+    if (mapping->mapping_size == 0) {
+        delete[] (char*)mapping->data.data; // Buffer of file_io_load_text_file
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mapping->data.data);
+    CloseHandle(mapping->mapping_handle);
+#else
+    munmap(mapping->data.data, mapping->mapping_size);
+#endif
+}
+
+String file_io_mapping_as_string(File_Mapping* mapping)
+{
+    byte* terminator = (byte*)memchr(mapping->data.data, 0, mapping->data.size);
+    int length = terminator == 0 ? mapping->data.size : (int)(terminator - mapping->data.data);
+    return string_create_static_with_size((const char*)mapping->data.data, length);
+}
@@ -18,3 +18,22 @@ bool file_io_is_directory(const char* filepath);
 Optional<u64> file_io_get_last_write_access_time(const char* filepath);
 
 bool file_io_write_file(const char* filepath, Array<byte> data);
+
+/*
+    Read only view of a file mapped into memory, the content is not copied. At least one 0 byte follows the
+    content, so the view can be used as a null terminated string. Files that cannot be mapped (e.g. empty files)
+    are loaded into a heap buffer instead. Truncating a mapped file from another process invalidates the view.
+*/
+struct File_Mapping
+{
+    Array<byte> data;
+    u64 mapping_size; // 0 if data is a heap copy
+#ifdef _WIN32
+    void* mapping_handle;
+#endif
+};
+
+Optional<File_Mapping> file_io_map_file(const char* filepath);
+void file_io_unmap_file(File_Mapping* mapping);
+// Ends at the first 0 byte like file_io_load_text_file, must not be destroyed or modified
+String file_io_mapping_as_string(File_Mapping* mapping);
@@ -1,25 +1,43 @@
 #include "file_listener.hpp"
 
-#include <Windows.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cstring>
+#endif
 
 #include "../utility/utils.hpp"
 #include "file_io.hpp"
 #include "../datastructures/dynamic_array.hpp"
 #include "../datastructures/string.hpp"
+#include "../win32/timing.hpp"
+
+// Changes are only reported after a file was quiet for this long, so the many writes of a single save give one callback
+const double FILE_LISTENER_SETTLE_TIME = 0.05;
+// Files without an event source are checked with stat at this interval instead of on every call
+const double FILE_LISTENER_POLL_INTERVAL = 0.25;
 
 struct Watched_File
 {
     String filepath;
+    String filename; // Part of filepath after the last slash, inotify only reports names relative to the directory
     file_listener_callback_func callback;
     u64 last_write_time;
     void* userdata;
+    int watch_descriptor; // Of the directory, -1 if the file is polled
+    bool change_pending;
+    double last_change_time;
+    u64 pending_write_time; // Only used for polling
 };
 
 struct File_Listener {
     Dynamic_Array<Watched_File*> files;
+    Timer timer;
+    double next_poll_time;
+    int inotify_fd; // -1 if all files are polled
 };
 
-Watched_File* watched_file_create(const char* filepath, file_listener_callback_func callback, void* userdata) 
+Watched_File* watched_file_create(const char* filepath, file_listener_callback_func callback, void* userdata)
 {
     Optional<u64> last_access = file_io_get_last_write_access_time(filepath);
     if (last_access.available == false) {
@@ -32,36 +50,79 @@ Watched_File* watched_file_create(const char* filepath, file_listener_callback_f
     file->filepath = string_create(filepath);
     file->last_write_time = last_access.value;
     file->userdata = userdata;
+    file->watch_descriptor = -1;
+    file->change_pending = false;
+    file->last_change_time = 0.0;
+    file->pending_write_time = 0;
+
+    int name_start = 0;
+    for (int i = 0; i < file->filepath.size; i++) {
+        if (file->filepath.characters[i] == '/' || file->filepath.characters[i] == '\\') {
+            name_start = i + 1;
+        }
+    }
+    file->filename = string_create(file->filepath.characters + name_start);
     return file;
 }
 
 void watched_file_destroy(Watched_File* watched_file) {
     string_destroy(&watched_file->filepath);
+    string_destroy(&watched_file->filename);
     delete watched_file;
 }
 
 File_Listener* file_listener_create() {
     File_Listener* result = new File_Listener();
     result->files = dynamic_array_create_empty<Watched_File*>(8);
+    result->timer = timer_make();
+    result->next_poll_time = 0.0;
+    result->inotify_fd = -1;
+#ifdef __linux__
+    result->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (result->inotify_fd == -1) {
+        logg("File_Listener: inotify not available, falling back to polling\n");
+    }
+#endif
     return result;
 }
 
-void file_listener_destroy(File_Listener* listener) 
+void file_listener_destroy(File_Listener* listener)
 {
     for (int i = 0; i < listener->files.size; i++) {
         Watched_File* file = listener->files.data[i];
         watched_file_destroy(file);
     }
     dynamic_array_destroy<Watched_File*>(&listener->files);
+#ifdef __linux__
+    if (listener->inotify_fd != -1) {
+        close(listener->inotify_fd); // Also removes all watches
+    }
+#endif
+    delete listener;
 }
 
-Watched_File* file_listener_add_file(File_Listener* listener, const char* filepath, file_listener_callback_func callback, void* userdata) 
+Watched_File* file_listener_add_file(File_Listener* listener, const char* filepath, file_listener_callback_func callback, void* userdata)
 {
     // Check if file exists/if we can get last access time
     Watched_File* watched_file = watched_file_create(filepath, callback, userdata);
     if (watched_file == 0) {
         return 0;
     }
+
+#ifdef __linux__
+    // The directory is watched instead of the file, since editors often save by replacing the file, which would end a file watch.
+    // Adding the same directory again returns the existing watch descriptor
+    if (listener->inotify_fd != -1)
+    {
+        int directory_length = watched_file->filepath.size - watched_file->filename.size;
+        String directory = directory_length == 0 ? string_create(".") : string_create_substring(&watched_file->filepath, 0, directory_length - 1);
+        SCOPE_EXIT(string_destroy(&directory));
+        watched_file->watch_descriptor = inotify_add_watch(listener->inotify_fd, directory.characters, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MASK_ADD);
+        if (watched_file->watch_descriptor == -1) {
+            logg("File_Listener: Could not watch directory \"%s\", polling \"%s\" instead\n", directory.characters, filepath);
+        }
+    }
+#endif
     dynamic_array_push_back<Watched_File*>(&listener->files, watched_file);
 
     return watched_file;
@@ -72,6 +133,21 @@ bool file_listener_remove_file(File_Listener* listener, Watched_File* file)
     for (int i = 0; i < listener->files.size; i++) {
         if (listener->files.data[i] == file) {
             dynamic_array_swap_remove<Watched_File*>(&listener->files, i);
+#ifdef __linux__
+            // Directory watches are shared between all files of the directory
+            if (file->watch_descriptor != -1) {
+                bool directory_still_used = false;
+                for (int j = 0; j < listener->files.size; j++) {
+                    if (listener->files.data[j]->watch_descriptor == file->watch_descriptor) {
+                        directory_still_used = true;
+                        break;
+                    }
+                }
+                if (!directory_still_used) {
+                    inotify_rm_watch(listener->inotify_fd, file->watch_descriptor);
+                }
+            }
+#endif
             watched_file_destroy(file);
             return true;
         }
@@ -79,19 +155,88 @@ bool file_listener_remove_file(File_Listener* listener, Watched_File* file)
     return false;
 }
 
+void file_listener_mark_changed(Watched_File* file, double now) {
+    file->change_pending = true;
+    file->last_change_time = now;
+}
+
+#ifdef __linux__
+void file_listener_read_inotify_events(File_Listener* listener, double now)
+{
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        ssize_t length = read(listener->inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) { // EAGAIN once all queued events are read
+            break;
+        }
+
+        for (char* pointer = buffer; pointer < buffer + length; pointer += sizeof(inotify_event) + ((inotify_event*)pointer)->len)
+        {
+            inotify_event* event = (inotify_event*)pointer;
+            for (int i = 0; i < listener->files.size; i++)
+            {
+                Watched_File* file = listener->files.data[i];
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Events were dropped, so every file may have changed
+                    if (file->watch_descriptor != -1) {
+                        file_listener_mark_changed(file, now);
+                    }
+                    continue;
+                }
+                if (file->watch_descriptor != event->wd) continue;
+                if (event->mask & IN_IGNORED) {
+                    // Directory was removed or unmounted, continue with polling
+                    file->watch_descriptor = -1;
+                    continue;
+                }
+                if (event->len != 0 && strcmp(event->name, file->filename.characters) == 0) {
+                    file_listener_mark_changed(file, now);
+                }
+            }
+        }
+    }
+}
+#endif
+
 void file_listener_check_if_files_changed(File_Listener* listener)
 {
-    for (int i = 0; i < listener->files.size; i++) 
+    double now = timer_current_time_in_seconds(&listener->timer);
+
+    // Collect changes of this call
+#ifdef __linux__
+    if (listener->inotify_fd != -1) {
+        file_listener_read_inotify_events(listener, now);
+    }
+#endif
+    if (now >= listener->next_poll_time)
+    {
+        listener->next_poll_time = now + FILE_LISTENER_POLL_INTERVAL;
+        for (int i = 0; i < listener->files.size; i++)
+        {
+            Watched_File* file = listener->files.data[i];
+            if (file->watch_descriptor != -1) continue;
+            Optional<u64> write_time = file_io_get_last_write_access_time(file->filepath.characters);
+            if (!write_time.available || write_time.value == file->last_write_time) continue;
+            // Only a new write restarts the settle time
+            if (!file->change_pending || write_time.value != file->pending_write_time) {
+                file->pending_write_time = write_time.value;
+                file_listener_mark_changed(file, now);
+            }
+        }
+    }
+
+    // Report changes that have settled, the write time filters out events where the content was not modified
+    for (int i = 0; i < listener->files.size; i++)
     {
         Watched_File* file = listener->files.data[i];
+        if (!file->change_pending || now - file->last_change_time < FILE_LISTENER_SETTLE_TIME) continue;
+        file->change_pending = false;
         Optional<u64> newest_write_time = file_io_get_last_write_access_time(file->filepath.characters);
-        if (newest_write_time.available)
+        if (newest_write_time.available && newest_write_time.value != file->last_write_time)
         {
-            if (newest_write_time.value > file->last_write_time) // First value is later than second
-            {
-                file->last_write_time = newest_write_time.value;
-                file->callback(file->userdata, file->filepath.characters); // Call callback
-            }
+            file->last_write_time = newest_write_time.value;
+            file->callback(file->userdata, file->filepath.characters); // Call callback
         }
     }
 }
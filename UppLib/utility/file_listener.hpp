@@ -5,9 +5,13 @@ typedef void(*file_listener_callback_func)(void* userdata, const char* filename)
 struct File_Listener;
 struct Watched_File;
 
+/*
+    On Linux changes are received from inotify watches on the directories of the files, other platforms
+    (or files that cannot be watched) are polled. Callbacks are only called from file_listener_check_if_files_changed,
+    once per file after its writes have settled and only if the last write time changed.
+*/
 File_Listener* file_listener_create();
 Watched_File* file_listener_add_file(File_Listener* listener, const char* filepath, file_listener_callback_func callback, void* userdata);
 bool file_listener_remove_file(File_Listener* listener, Watched_File* file);
 void file_listener_check_if_files_changed(File_Listener* listener);
 void file_listener_destroy(File_Listener* listener);
-
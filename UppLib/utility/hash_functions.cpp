@@ -1,5 +1,7 @@
 #include "hash_functions.hpp"
 
+#include <cstddef>
+
 u64 mix(u64 h) {
     (h) ^= (h) >> 23;
     (h) *= 0x2127599bf4325c37ULL;
@@ -13,3 +13,20 @@ u64 hash_pointer(void* ptr);
 bool equals_i32(i32* a, i32* b);
 bool equals_i64(i64* a, i64* b);
 bool equals_pointer(void** a, void** b);
+
+// Compile time hashers for Hashtable, so hashing and comparing can be inlined
+struct Hasher_String {
+    static u64 hash(String* string) { return hash_string(string); }
+    static bool equals(String* a, String* b) { return string_equals(a, b); }
+};
+
+struct Hasher_I32 {
+    static u64 hash(i32* i) { return hash_i32(i); }
+    static bool equals(i32* a, i32* b) { return *a == *b; }
+};
+
+template <typename T>
+struct Hasher_Pointer {
+    static u64 hash(T* ptr) { return hash_pointer((void*)*ptr); }
+    static bool equals(T* a, T* b) { return *a == *b; }
+};
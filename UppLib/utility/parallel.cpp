@@ -0,0 +1,126 @@
+#include "parallel.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "utils.hpp"
+#include "../datastructures/dynamic_array.hpp"
+
+int parallel_hardware_thread_count()
+{
+    int count = (int)std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+struct Parallel_Pool
+{
+    std::mutex run_mutex; // Held for a whole parallel_run
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    Dynamic_Array<std::thread*> threads; // Thread i runs worker index i + 1
+    u64 generation; // Incremented for each run, threads wait until it changes
+    int worker_count;
+    int running_count;
+    void (*work)(void* userdata, int worker_index);
+    void* userdata;
+    bool shutdown;
+
+    Parallel_Pool() {
+        threads = dynamic_array_create_empty<std::thread*>(8);
+        generation = 0;
+        worker_count = 0;
+        running_count = 0;
+        shutdown = false;
+    }
+
+    // Threads are joined at program exit
+    ~Parallel_Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutdown = true;
+        }
+        work_available.notify_all();
+        for (int i = 0; i < threads.size; i++) {
+            threads[i]->join();
+            delete threads[i];
+        }
+        dynamic_array_destroy(&threads);
+    }
+};
+
+Parallel_Pool* parallel_pool_get()
+{
+    static Parallel_Pool pool;
+    return &pool;
+}
+
+void parallel_pool_thread(Parallel_Pool* pool, int worker_index, u64 seen_generation)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    while (true)
+    {
+        pool->work_available.wait(lock, [&]() { return pool->shutdown || pool->generation != seen_generation; });
+        if (pool->shutdown) return;
+        seen_generation = pool->generation;
+        if (worker_index >= pool->worker_count) continue;
+
+        lock.unlock();
+        pool->work(pool->userdata, worker_index);
+        lock.lock();
+        pool->running_count--;
+        if (pool->running_count == 0) {
+            pool->work_done.notify_one();
+        }
+    }
+}
+
+void parallel_run(int worker_count, void (*work)(void* userdata, int worker_index), void* userdata)
+{
+    assert(worker_count >= 1, "Need at least one worker");
+    if (worker_count == 1) {
+        work(userdata, 0);
+        return;
+    }
+
+    Parallel_Pool* pool = parallel_pool_get();
+    std::lock_guard<std::mutex> run_lock(pool->run_mutex);
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        while (pool->threads.size < worker_count - 1) {
+            dynamic_array_push_back(&pool->threads, new std::thread(parallel_pool_thread, pool, pool->threads.size + 1, pool->generation));
+        }
+        pool->work = work;
+        pool->userdata = userdata;
+        pool->worker_count = worker_count;
+        pool->running_count = worker_count - 1;
+        pool->generation++;
+    }
+    pool->work_available.notify_all();
+
+    work(userdata, 0);
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->work_done.wait(lock, [&]() { return pool->running_count == 0; });
+}
+
+Mutex mutex_create()
+{
+    Mutex result;
+    result.handle = new std::mutex();
+    return result;
+}
+
+void mutex_destroy(Mutex* mutex)
+{
+    delete (std::mutex*)mutex->handle;
+    mutex->handle = 0;
+}
+
+void mutex_lock(Mutex* mutex) {
+    ((std::mutex*)mutex->handle)->lock();
+}
+
+void mutex_unlock(Mutex* mutex) {
+    ((std::mutex*)mutex->handle)->unlock();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "datatypes.hpp"
+
+// Number of hardware threads, always at least 1
+int parallel_hardware_thread_count();
+
+/*
+    Runs work(userdata, worker_index) for all worker indices in [0, worker_count) and returns once all are done.
+    Worker 0 runs on the calling thread, the others run on a process wide pool of threads, which are created on first
+    use and then wait for the next call. Calls from different threads are serialized, work must not call parallel_run.
+    The work function must only write to data owned by its worker index.
+*/
+void parallel_run(int worker_count, void (*work)(void* userdata, int worker_index), void* userdata);
+
+// Mutual exclusion lock, not recursive
+struct Mutex
+{
+    void* handle;
+};
+
+Mutex mutex_create();
+void mutex_destroy(Mutex* mutex);
+void mutex_lock(Mutex* mutex);
+void mutex_unlock(Mutex* mutex);
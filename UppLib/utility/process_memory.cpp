@@ -0,0 +1,70 @@
+#include "process_memory.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+
+static PROCESS_MEMORY_COUNTERS process_memory_query()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    counters.cb = sizeof(counters);
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        counters.WorkingSetSize = 0;
+        counters.PeakWorkingSetSize = 0;
+    }
+    return counters;
+}
+
+u64 process_memory_current_usage() {
+    return process_memory_query().WorkingSetSize;
+}
+
+u64 process_memory_peak_usage() {
+    return process_memory_query().PeakWorkingSetSize;
+}
+
+void process_memory_reset_peak() {
+}
+
+#else
+#include <cstdio>
+#include <cstring>
+
+// Reads a "Name:   1234 kB" line of /proc/self/status
+static u64 process_memory_read_status_field(const char* field)
+{
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == 0) return 0;
+    char line[256];
+    u64 result = 0;
+    int field_length = (int)strlen(field);
+    while (fgets(line, sizeof(line), file) != 0) {
+        if (strncmp(line, field, field_length) == 0 && line[field_length] == ':') {
+            unsigned long long kilobytes = 0;
+            sscanf(line + field_length + 1, "%llu", &kilobytes);
+            result = (u64)kilobytes * 1024;
+            break;
+        }
+    }
+    fclose(file);
+    return result;
+}
+
+u64 process_memory_current_usage() {
+    return process_memory_read_status_field("VmRSS");
+}
+
+u64 process_memory_peak_usage() {
+    return process_memory_read_status_field("VmHWM");
+}
+
+void process_memory_reset_peak()
+{
+    // Writing 5 resets the peak resident size (VmHWM) to the current resident size
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file == 0) return;
+    fputs("5", file);
+    fclose(file);
+}
+
+#endif
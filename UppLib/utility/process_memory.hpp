@@ -0,0 +1,9 @@
+#pragma once
+
+#include "datatypes.hpp"
+
+// Resident memory (Working set on Windows) of the process in bytes
+u64 process_memory_current_usage();
+// Peak resident memory in bytes since the last reset, or since process start where resetting is not supported (Windows)
+u64 process_memory_peak_usage();
+void process_memory_reset_peak();
@@ -4,7 +4,14 @@
 #include <cstdlib>
 #include <cstdarg>
 #include <cstring>
+#ifdef _WIN32
 #include <Windows.h>
+#define DEBUG_BREAK() __debugbreak()
+#else
+#include <csignal>
+#include <unistd.h>
+#define DEBUG_BREAK() raise(SIGTRAP)
+#endif
 
 /*
     LOGGER
@@ -16,7 +23,9 @@ static void logger_default_log_function(const char* message) {
 static void logger_default_panic_function(const char* message) {
     printf("\n\nSYSTEM_PANIC %s", message);
     printf("\n\n");
+#ifdef _WIN32
     system("pause");
+#endif
     //exit(-1);
 }
 
@@ -50,7 +59,10 @@ void logger_log(const char* file_name, int line_number, const char* message_form
     va_list variadic_arguments;
     va_start(variadic_arguments, message_format);
     int prefix_length = snprintf(0, 0, LOGGER_PREFIX_FORMAT, file_name, line_number);
-    int message_length = vsnprintf(0, 0, message_format, variadic_arguments);
+    va_list arguments_copy; // A va_list cannot be used again after vsnprintf
+    va_copy(arguments_copy, variadic_arguments);
+    int message_length = vsnprintf(0, 0, message_format, arguments_copy);
+    va_end(arguments_copy);
 
     // Allocate buffer
     const int required_length = prefix_length + message_length + 1;
@@ -82,7 +94,10 @@ void logger_panic(const char* file_name, int line_number, const char* message_fo
     va_list variadic_arguments;
     va_start(variadic_arguments, message_format);
     int prefix_length = snprintf(0, 0, LOGGER_PREFIX_FORMAT, file_name, line_number);
-    int message_length = vsnprintf(0, 0, message_format, variadic_arguments);
+    va_list arguments_copy; // A va_list cannot be used again after vsnprintf
+    va_copy(arguments_copy, variadic_arguments);
+    int message_length = vsnprintf(0, 0, message_format, arguments_copy);
+    va_end(arguments_copy);
 
     // Allocate buffer
     const int required_length = prefix_length + message_length + 1;
@@ -102,7 +117,7 @@ void logger_panic(const char* file_name, int line_number, const char* message_fo
 
     // Send to custom panic function
     logger_custom_panic_fn(logger_message_buffer);
-    __debugbreak();
+    DEBUG_BREAK();
 }
 
 void assert_function(bool condition, const char* condition_as_string, const char* file_name, int line_number, const char* message, ...) {
@@ -114,7 +129,7 @@ void assert_function(bool condition, const char* condition_as_string, const char
         printf("\tMsg: ");
         vprintf(message, args);
         va_end(args);
-        __debugbreak();
+        DEBUG_BREAK();
         panic("ASSERTION FAILED");
     }
 }
@@ -129,8 +144,34 @@ void memory_set_bytes(void* destination, u64 size, byte value) {
 
 bool memory_is_readable(void* destination, u64 read_size)
 {
+#ifdef _WIN32
     if (IsBadReadPtr(destination, read_size)) { return false; }
     else {
         return true;
     }
+#else
+    // Writing from an unreadable address into a pipe fails with EFAULT instead of raising a signal
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        return false;
+    }
+    bool readable = true;
+    byte buffer[4096];
+    u64 offset = 0;
+    while (offset < read_size)
+    {
+        u64 chunk_size = read_size - offset < sizeof(buffer) ? read_size - offset : sizeof(buffer);
+        ssize_t written = write(pipe_fds[1], (byte*)destination + offset, chunk_size);
+        if (written <= 0) { // EFAULT if the memory is not readable
+            readable = false;
+            break;
+        }
+        ssize_t read_bytes = read(pipe_fds[0], buffer, (size_t)written);
+        (void)read_bytes;
+        offset += written;
+    }
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return readable;
+#endif
 }
@@ -1,10 +1,19 @@
 #include "timing.hpp"
 
+#ifdef _WIN32
 #include <Windows.h>
+#include "windows_helper_functions.hpp"
+#else
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
 
 #include "../utility/datatypes.hpp"
 #include "../utility/utils.hpp"
-#include "windows_helper_functions.hpp"
+
+#ifdef _WIN32
 
 i64 timing_current_cpu_tick() {
     return __rdtsc();
@@ -51,6 +60,58 @@ void timer_sleep_until(Timer* timer, double until_in_seconds)
     do { sleep_cycles++; } while (timer_current_time_in_seconds(timer) < until_in_seconds);
 }
 
+#else
+
+// Monotonic clock in nanoseconds, so the performance frequency is fixed
+static i64 timing_monotonic_nanoseconds()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (i64)time.tv_sec * 1000000000ll + (i64)time.tv_nsec;
+}
+
+i64 timing_current_cpu_tick() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return timing_monotonic_nanoseconds();
+#endif
+}
+
+Timer timer_make()
+{
+    Timer result;
+    result.timing_performance_frequency = 1000000000ll;
+    result.timing_start_time = timing_monotonic_nanoseconds();
+    return result;
+}
+
+double timer_current_time_in_seconds(Timer* timer)
+{
+    i64 now = timing_monotonic_nanoseconds() - timer->timing_start_time;
+    return (double)now/timer->timing_performance_frequency;
+}
+
+void timer_sleep_until(Timer* timer, double until_in_seconds)
+{
+    double now_in_seconds = timer_current_time_in_seconds(timer);
+    double diff = until_in_seconds - now_in_seconds;
+    if (diff <= 0.0) return;
+
+    // nanosleep may oversleep by the scheduler granularity, so the last 100 microseconds are busy waited
+    diff -= 0.0001;
+    if (diff > 0.0) {
+        timespec duration;
+        duration.tv_sec = (time_t)diff;
+        duration.tv_nsec = (long)((diff - (double)duration.tv_sec) * 1000000000.0);
+        while (nanosleep(&duration, &duration) != 0) {} // Continue after signal interrupts
+    }
+
+    while (timer_current_time_in_seconds(timer) < until_in_seconds) {}
+}
+
+#endif
+
 void timer_sleep_for(Timer* timer, double seconds) {
     double start = timer_current_time_in_seconds(timer);
     timer_sleep_until(timer, start + seconds);
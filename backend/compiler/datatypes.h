@@ -1,6 +1,12 @@
 #pragma once
 
+// Also included by the C code of the C-Backend
+#ifdef __cplusplus
 #include <cstdint>
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#endif
 
 typedef unsigned char byte;
 typedef int8_t int8;
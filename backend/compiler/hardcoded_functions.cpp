@@ -26,6 +26,11 @@ void print_line() {
 	return;
 }
 
+void print_string(const char* str, i32 size) {
+	printf("%.*s", size, str);
+	return;
+}
+
 i32 read_i32() 
 {
 	printf("Please input an i32: ");
@@ -52,7 +57,7 @@ f32 read_f32()
 	return num;
 }
 
-u8 read_bool() 
+bool read_bool() 
 {
 	printf("Please input an bool (As int): ");
     i32 num;
@@ -62,7 +67,7 @@ u8 read_bool()
     }
     std::cin.ignore(10000, '\n');
     std::cin.clear();
-	return num == 0 ? 0 : 1;
+	return num != 0;
 }
 
 uint32 g_xor_shift;
@@ -2,15 +2,23 @@
 
 #include "datatypes.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void print_i32(i32 x);
 void print_f32(f32 x);
 void print_bool(bool x);
 void print_line();
+void print_string(const char* str, i32 size);
 i32 read_i32();
 f32 read_f32();
+bool read_bool();
 i32 random_i32();
 void* malloc_size_i32(i32 x);
 void free_pointer(void* ptr);
 void random_initialize();
 
-
+#ifdef __cplusplus
+}
+#endif